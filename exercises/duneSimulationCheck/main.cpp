@@ -0,0 +1,127 @@
+// Checks that DuneSimulation gives the same dunes for a seed with any number of workers. The same map is simulated for
+// some ticks with load queues of different sizes, and the published values must be the same, bit for bit.
+// A different seed must give different dunes, and the dunes must move, so the check can't pass by doing nothing.
+// It doesn't need a GL context. Returns 0 if all the runs match
+
+#include <ituGL/geometry/DuneSimulation.h>
+#include <ituGL/geometry/Heightfield.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <glm/trigonometric.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Sizes that are not multiples of the tiles, so the last band and the last tile of each row are partial
+const int MapWidth = 100;
+const int MapHeight = 70;
+const int TileSize = 16;
+const unsigned int TickCount = 20;
+const unsigned int Seed = 1234u;
+
+// Like the sand demo: a 100 units desert on a 512 texels map, with heights up to 2 units
+const float TexelSize = 100.0f / 512.0f / 2.0f;
+
+// Rough dunes with some sharp steps, so the wind finds crests with shadows and the slopes avalanche
+Heightfield CreateHeightfield()
+{
+    std::vector<unsigned char> texels(static_cast<size_t>(MapWidth) * MapHeight);
+    uint32_t state = 12345u;
+    for (int j = 0; j < MapHeight; ++j)
+    {
+        for (int i = 0; i < MapWidth; ++i)
+        {
+            state = state * 1664525u + 1013904223u;
+            float dune = 0.5f + 0.35f * std::sin(0.3f * i + 0.2f * j) + 0.1f * static_cast<float>(state >> 24) / 255.0f;
+            if ((i / 7 + j / 5) % 3 == 0)
+            {
+                dune *= 0.5f;
+            }
+            texels[static_cast<size_t>(j) * MapWidth + i] = static_cast<unsigned char>(std::clamp(dune, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+
+    Heightfield heightfield;
+    heightfield.Initialize(texels, MapWidth, MapHeight);
+    return heightfield;
+}
+
+// Published values after the ticks, run on this thread and the workers of a new load queue
+std::vector<float> Simulate(const Heightfield& heightfield, unsigned int workerCount, unsigned int seed)
+{
+    AssetLoadQueue loadQueue(workerCount);
+    DuneSimulation duneSimulation(heightfield, loadQueue, seed, TileSize);
+    duneSimulation.SetTexelSize(TexelSize);
+    duneSimulation.SetWind(glm::vec2(std::cos(glm::radians(30.0f)), std::sin(glm::radians(30.0f))), 0.01f);
+    for (unsigned int tick = 0; tick < TickCount; ++tick)
+    {
+        duneSimulation.Tick();
+    }
+
+    std::vector<float> values;
+    for (int y = 0; y < MapHeight; ++y)
+    {
+        for (int x = 0; x < MapWidth; ++x)
+        {
+            values.push_back(duneSimulation.GetValue(x, y));
+        }
+    }
+    return values;
+}
+
+// Number of texels that are not the same, bit for bit
+int CountMismatches(const std::vector<float>& values, const std::vector<float>& reference)
+{
+    int mismatches = 0;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        mismatches += std::memcmp(&values[i], &reference[i], sizeof(float)) != 0 ? 1 : 0;
+    }
+    return mismatches;
+}
+
+int main()
+{
+    Heightfield heightfield = CreateHeightfield();
+    std::vector<float> initialValues;
+    for (int y = 0; y < MapHeight; ++y)
+    {
+        for (int x = 0; x < MapWidth; ++x)
+        {
+            initialValues.push_back(heightfield.GetValue(x, y));
+        }
+    }
+
+    // One worker runs the bands in whatever order the two threads take them, more workers split them further
+    std::vector<float> reference = Simulate(heightfield, 1, Seed);
+    int failures = 0;
+
+    int movedTexels = CountMismatches(reference, initialValues);
+    if (movedTexels == 0)
+    {
+        std::cout << "The dunes didn't move in " << TickCount << " ticks" << std::endl;
+        ++failures;
+    }
+
+    if (CountMismatches(Simulate(heightfield, 1, Seed + 1), reference) == 0)
+    {
+        std::cout << "Another seed gives the same dunes" << std::endl;
+        ++failures;
+    }
+
+    for (unsigned int workerCount : { 2u, 3u, 7u })
+    {
+        int mismatches = CountMismatches(Simulate(heightfield, workerCount, Seed), reference);
+        if (mismatches != 0)
+        {
+            std::cout << workerCount << " workers: " << mismatches << " texels differ from 1 worker" << std::endl;
+            ++failures;
+        }
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAILED") << ": " << failures << " failed checks, "
+        << movedTexels << " texels moved in " << TickCount << " ticks" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
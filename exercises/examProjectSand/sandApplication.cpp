@@ -1,7 +1,8 @@
 #include "sandApplication.h"
 
 #include <ituGL/asset/TextureCubemapLoader.h>
-#include <ituGL/asset/ShaderLoader.h>
+#include <ituGL/asset/ShaderLibrary.h>
+#include <ituGL/asset/ShaderVariantSet.h>
 #include <ituGL/asset/ModelLoader.h>
 
 #include <ituGL/camera/Camera.h>
@@ -13,6 +14,7 @@
 
 #include <ituGL/shader/ShaderUniformCollection.h>
 #include <ituGL/shader/Material.h>
+#include <ituGL/shader/MaterialInstance.h>
 #include <ituGL/geometry/Model.h>
 #include <ituGL/scene/SceneModel.h>
 
@@ -21,19 +23,29 @@
 #include <ituGL/renderer/DeferredRenderPass.h>
 #include <ituGL/renderer/ShadowMapRenderPass.h>
 #include <ituGL/renderer/PostFXRenderPass.h>
-#include <ituGL/scene/RendererSceneVisitor.h>
+#include <ituGL/renderer/VirtualTextureFeedbackPass.h>
+#include <ituGL/scene/RendererSceneSystem.h>
+#include <ituGL/scene/TextureStreamingSceneVisitor.h>
 
 #include <ituGL/scene/ImGuiSceneVisitor.h>
 #include <imgui.h>
+#include <cassert>
+#include <algorithm>
+#include <future>
+#include <cmath>
+#include <iostream>
 
 // Includes for manual plane generation.
 #include <ituGL/scene/Transform.h>
+#include <glm/gtx/euler_angles.hpp>
 
 
 SandApplication::SandApplication()
     : Application(1024, 1024, "Cool Sand shader demo")
     , m_renderer(GetDevice())
+    , m_textureCache("cache/textures")
     , m_sceneFramebuffer(std::make_shared<FramebufferObject>())
+    , m_sampleDistance(0.01f)
     , m_exposure(1.0f)
     , m_contrast(1.0f)
     , m_hueShift(0.0f)
@@ -42,7 +54,6 @@ SandApplication::SandApplication()
     , m_blurIterations(1)
     , m_bloomRange(1.0f, 2.0f)
     , m_bloomIntensity(1.0f)
-    , m_sampleDistance(0.01f)
 {
 }
 
@@ -58,6 +69,9 @@ void SandApplication::Initialize()
     // Commonly used open source UI framework. The one used in CSG and the like.
     m_imGui.Initialize(GetMainWindow());
 
+    // Upload the assets with a second context, so streaming them doesn't stall the frames. Otherwise they are uploaded in Update
+    m_loadQueue.StartUploadThread(GetMainWindow());
+
     InitializeCamera();
     InitializeLights();
 
@@ -65,24 +79,73 @@ void SandApplication::Initialize()
     InitializeMaterials();
     InitializeModels();
     InitializeRenderer();
+
+    // Report how many shaders were actually compiled, and how many were shared
+    m_shaderLibrary.PrintStats();
 }
 
 void SandApplication::Update()
 {
     Application::Update();
 
+    // Finish the assets loaded in the background, without taking too much of the frame
+    m_loadQueue.ProcessUploads(0.002);
+
     // Update camera controller
     //m_cameraController.Update(GetMainWindow(), GetDeltaTime());
 
     // Move car with WASD
     HandlePlayerMovement();
 
+    // Move the dunes, then leave tracks behind the car
+    MoveDunes();
+    DeformSand();
+
+    // Follow the dunes with the car and keep the props on them
+    PlaceObjectsOnSurface();
+
+    // Throw sand from the wheels, and move it on the workers. The sand collides with the surface the player is on,
+    // then all the particles are uploaded at once
+    for (ParticleEmitter& emitter : m_wheelEmitters)
+    {
+        emitter.Update(GetDeltaTime());
+    }
+    m_particleSystem->Update(GetDeltaTime(), &m_loadQueue);
+    m_particleSystem->UpdateModel();
+
     // Follow car insterad of free cam
     MakeCameraFollowPlayer();
+
+    // Stream the texture levels needed by the visible models
+    int width, height;
+    GetMainWindow().GetDimensions(width, height);
+    TextureStreamingSceneVisitor textureStreamingVisitor(m_textureStreamer, *m_cameraController.GetCamera()->GetCamera(), static_cast<float>(height));
+    m_scene.AcceptVisitor(textureStreamingVisitor);
+    m_textureStreamer.Update();
+
+    // Select the terrain patches for the main camera. The shadow pass uses the same ones, so they morph the same way
+    m_terrain->Update(*m_cameraController.GetCamera()->GetCamera(), m_desertModel->GetTransform()->GetTransformMatrix());
+    m_desertSandMaterial->SetUniformValue("TerrainViewPosition", m_terrain->GetViewPosition());
+    m_desertSandShadowMaterial->SetUniformValue("TerrainViewPosition", m_terrain->GetViewPosition());
+    m_desertSandFeedbackMaterial->SetUniformValue("TerrainViewPosition", m_terrain->GetViewPosition());
+
+    // Load the pages of the sand detail asked by the feedback of the previous frames
+    m_sandDetailTexture->Update();
+
+    // Load the prop tiles around the player and evict the ones left behind, then upload the instances of the scattered
+    // props in the visible chunks of the resident tiles. The shadow pass draws the same ones
+    m_worldStreamer->Update(m_parentModel->GetTransform()->GetTranslation());
+    for (const std::shared_ptr<WorldTile>& tile : m_worldStreamer->GetResidentTiles())
+    {
+        PropScatter& propScatter = static_cast<PropScatterTile&>(*tile).GetPropScatter();
+        propScatter.SetHeightRange(m_terrain->GetMinHeight(), m_terrain->GetMaxHeight());
+        propScatter.Update(*m_cameraController.GetCamera()->GetCamera(), m_desertModel->GetTransform()->GetTransformMatrix());
+    }
     
-    // Add the scene nodes to the renderer
-    RendererSceneVisitor rendererSceneVisitor(m_renderer);
-    m_scene.AcceptVisitor(rendererSceneVisitor);
+    // Add the scene to the renderer, with the world matrices of all the nodes read on the workers first
+    m_scene.UpdateWorldMatrices(&m_loadQueue);
+    RendererSceneSystem rendererSceneSystem(m_renderer);
+    rendererSceneSystem.Render(m_scene);
 }
 
 // Moves the player transform based in player input. Control with WASD
@@ -135,10 +198,227 @@ void SandApplication::HandlePlayerMovement() {
     // apply the updated translation and rotation to the parent.
     parentTransform->SetTranslation(translation);
     parentTransform->SetRotation(rotation);
+}
+
+void SandApplication::PlaceObjectsOnSurface()
+{
+    if (m_heightfield->IsEmpty())
+    {
+        return;
+    }
+
+    // The player first, then the props
+    std::vector<std::shared_ptr<Transform>> transforms;
+    transforms.push_back(m_parentModel->GetTransform());
+    for (const std::shared_ptr<SceneModel>& prop : *m_propModels)
+    {
+        transforms.push_back(prop->GetTransform());
+    }
 
-    // Apply move the visual model along with the parnet
+    std::vector<glm::vec2> uvs;
+    uvs.reserve(transforms.size());
+    for (const std::shared_ptr<Transform>& transform : transforms)
+    {
+        uvs.push_back(GetDesertUV(transform->GetTranslation()));
+    }
+
+    std::vector<float> heights(uvs.size());
+    std::vector<glm::vec3> tangents(uvs.size()), bitangents(uvs.size()), normals(uvs.size());
+    m_heightfield->GetHeights(uvs, m_sampleDistance, m_offsetStength, heights);
+    m_heightfield->GetTangentSpaces(uvs, m_sampleDistance, m_offsetStength, tangents, bitangents, normals);
+
+    // Objects sink slightly into the sand
+    float surfaceHeight = m_desertModel->GetTransform()->GetTranslation().y - 0.1f;
+    for (size_t i = 0; i < transforms.size(); ++i)
+    {
+        glm::vec3 translation = transforms[i]->GetTranslation();
+        translation.y = surfaceHeight + heights[i];
+        transforms[i]->SetTranslation(translation);
+    }
+
+    // The visual model keeps the heading of the parent, tilted to follow the normal of the sand
+    glm::vec3 right = glm::normalize(glm::vec3(m_parentModel->GetTransform()->GetTransformMatrix()[0]));
+    glm::vec3 normal = normals[0];
+    glm::vec3 zaxis = glm::normalize(glm::cross(right, normal));
+    glm::vec3 xaxis = glm::normalize(glm::cross(zaxis, normal));
+    glm::vec3 yaxis = glm::cross(xaxis, zaxis);
+    glm::mat4 surfaceRotation(glm::vec4(xaxis, 0.0f), glm::vec4(yaxis, 0.0f), glm::vec4(-zaxis, 0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    // Transform applies the rotations in Y, X, Z order
+    glm::vec3 rotation;
+    glm::extractEulerAngleYXZ(surfaceRotation, rotation.y, rotation.x, rotation.z);
     std::shared_ptr<Transform> playerModelTransform = m_visualPlayerModel->GetTransform();
-    playerModelTransform->SetTranslation(translation);
+    playerModelTransform->SetTranslation(transforms[0]->GetTranslation());
+    playerModelTransform->SetRotation(rotation);
+
+    // Debug values shown in the GUI
+    u = uvs[0].x;
+    v = uvs[0].y;
+}
+
+void SandApplication::DeformSand()
+{
+    if (!m_sandDeformer || !m_heightfieldBaker)
+    {
+        return;
+    }
+
+    // The heightfield values are scaled by the offset strength, the tracks have a fixed depth in world units
+    if (m_offsetStength > 0.0f)
+    {
+        glm::vec2 uv = GetDesertUV(m_parentModel->GetTransform()->GetTranslation());
+        m_sandDeformer->Stamp(uv, m_trackRadius / m_desertLength, m_trackDepth / m_offsetStength);
+    }
+
+    // Only the tiles with recent tracks change, and only those are baked and uploaded again
+    const std::vector<HeightfieldDeformer::Region>& regions = m_sandDeformer->Update(GetCurrentTime());
+    for (const HeightfieldDeformer::Region& region : regions)
+    {
+        m_heightfieldBaker->UpdateRegion(region.x, region.y, region.width, region.height);
+    }
+    if (!regions.empty())
+    {
+        UpdateTerrainHeightRange();
+    }
+}
+
+void SandApplication::MoveDunes()
+{
+    if (!m_duneSimulation || !m_heightfieldBaker)
+    {
+        return;
+    }
+
+    // The ticks run in the background. Only the tiles that moved enough are published, and only those are baked and uploaded again
+    const std::vector<DuneSimulation::Region>& regions = m_duneSimulation->Update(GetCurrentTime());
+    for (const DuneSimulation::Region& region : regions)
+    {
+        for (int y = region.y; y < region.y + region.height; ++y)
+        {
+            for (int x = region.x; x < region.x + region.width; ++x)
+            {
+                m_sandDeformer->SetOriginalValue(x, y, m_duneSimulation->GetValue(x, y));
+            }
+        }
+        m_heightfieldBaker->UpdateRegion(region.x, region.y, region.width, region.height);
+    }
+    if (!regions.empty())
+    {
+        UpdateTerrainHeightRange();
+    }
+}
+
+void SandApplication::UpdateDuneTexelSize()
+{
+    if (m_duneSimulation && m_offsetStength > 0.0f)
+    {
+        m_duneSimulation->SetTexelSize(m_desertLength / m_duneSimulation->GetWidth() / m_offsetStength);
+    }
+}
+
+glm::vec2 SandApplication::GetDesertUV(const glm::vec3& position) const
+{
+    glm::vec3 desertPos = m_desertModel->GetTransform()->GetTranslation();
+    glm::vec3 desertScale = m_desertModel->GetTransform()->GetScale();
+    glm::vec3 desertPosOnDesert = position - desertPos;
+    return glm::vec2(desertPosOnDesert.x / m_desertLength * desertScale.x + 0.5f, desertPosOnDesert.z / m_desertWidth * desertScale.z + 0.5f);
+}
+
+void SandApplication::UpdateTerrainHeightRange()
+{
+    float minHeight = 0.0f, maxHeight = m_offsetStength;
+    if (!m_heightfield->IsEmpty())
+    {
+        m_heightfield->GetHeightRange(m_offsetStength, minHeight, maxHeight);
+    }
+    m_terrain->SetHeightRange(minHeight, maxHeight);
+}
+
+void SandApplication::FillSandDetailPage(const TextureCache::CachedTexture& normalMap, float desertLength, float tileSize,
+    const VirtualTexture::PageRequest& request, std::span<uint32_t> texels)
+{
+    // Level of the normal map with about one texel per texel of the page
+    float texelWorldSize = request.texelSize * desertLength;
+    int level = 0;
+    if (!normalMap.levels.empty())
+    {
+        float footprint = texelWorldSize / tileSize * normalMap.width;
+        level = std::clamp(static_cast<int>(std::floor(std::log2(std::max(footprint, 1.0f)))), 0, static_cast<int>(normalMap.levels.size()) - 1);
+    }
+    int width = std::max(normalMap.width >> level, 1);
+    int height = std::max(normalMap.height >> level, 1);
+
+    // Bilinear sample of the xy of the normal map, in [-1, 1], wrapping around
+    auto sampleNormal = [&](glm::vec2 uv)
+    {
+        if (normalMap.levels.empty())
+        {
+            return glm::vec2(0.0f);
+        }
+        const std::byte* data = normalMap.levels[level].data();
+        auto fetch = [&](int x, int y)
+        {
+            x = (x % width + width) % width;
+            y = (y % height + height) % height;
+            const std::byte* texel = data + (static_cast<size_t>(y) * width + x) * 3;
+            return glm::vec2(static_cast<float>(texel[0]), static_cast<float>(texel[1])) / 127.5f - 1.0f;
+        };
+        glm::vec2 position = uv * glm::vec2(width, height) - 0.5f;
+        glm::vec2 floorPosition = glm::floor(position);
+        glm::vec2 t = position - floorPosition;
+        int x = static_cast<int>(floorPosition.x);
+        int y = static_cast<int>(floorPosition.y);
+        return glm::mix(glm::mix(fetch(x, y), fetch(x + 1, y), t.x), glm::mix(fetch(x, y + 1), fetch(x + 1, y + 1), t.x), t.y);
+    };
+
+    // Smooth value noise in [0, 1]
+    auto valueNoise = [](glm::vec2 position)
+    {
+        auto hash = [](int x, int y)
+        {
+            uint32_t h = static_cast<uint32_t>(x) * 0x8da6b343u ^ static_cast<uint32_t>(y) * 0xd8163841u;
+            h = (h ^ (h >> 15)) * 0x2c1b3c6du;
+            h = (h ^ (h >> 12)) * 0x297a2d39u;
+            return static_cast<float>((h ^ (h >> 15)) & 0xffffu) / 65535.0f;
+        };
+        glm::vec2 floorPosition = glm::floor(position);
+        glm::vec2 t = position - floorPosition;
+        t = t * t * (3.0f - 2.0f * t);
+        int x = static_cast<int>(floorPosition.x);
+        int y = static_cast<int>(floorPosition.y);
+        return glm::mix(glm::mix(hash(x, y), hash(x + 1, y), t.x), glm::mix(hash(x, y + 1), hash(x + 1, y + 1), t.x), t.y);
+    };
+
+    // A second layer of the normal map, rotated and scaled, blended in where the noise says, hides the tiling.
+    // The normals of the rotated layer are rotated back to the desert
+    const float angle = 0.6f;
+    const glm::mat2 rotation(std::cos(angle), std::sin(angle), -std::sin(angle), std::cos(angle));
+    const glm::mat2 inverseRotation = glm::transpose(rotation);
+
+    // The fine brightness noise fades out on the coarse pages, where it would alias
+    float fineNoiseWeight = std::clamp(1.0f - 2.0f * texelWorldSize, 0.0f, 1.0f);
+
+    for (int y = 0; y < request.size; ++y)
+    {
+        for (int x = 0; x < request.size; ++x)
+        {
+            glm::vec2 uv = request.uvMin + (glm::vec2(x, y) + 0.5f) * request.texelSize;
+            glm::vec2 position = uv * desertLength;
+            glm::vec2 tileUV = position / tileSize;
+
+            glm::vec2 normal = sampleNormal(tileUV);
+            glm::vec2 rotatedNormal = inverseRotation * sampleNormal(rotation * tileUV * 1.37f + glm::vec2(0.31f, 0.77f));
+            float blend = glm::smoothstep(0.3f, 0.7f, valueNoise(position / 17.0f));
+            normal = glm::clamp(glm::mix(normal, rotatedNormal, blend), -1.0f, 1.0f);
+
+            float brightness = 0.5f + 0.6f * (valueNoise(position / 3.1f) - 0.5f) + 0.4f * fineNoiseWeight * (valueNoise(position / 0.9f) - 0.5f);
+
+            uint32_t r = static_cast<uint32_t>((normal.x * 0.5f + 0.5f) * 255.0f + 0.5f);
+            uint32_t g = static_cast<uint32_t>((normal.y * 0.5f + 0.5f) * 255.0f + 0.5f);
+            uint32_t b = static_cast<uint32_t>(std::clamp(brightness, 0.0f, 1.0f) * 255.0f + 0.5f);
+            texels[static_cast<size_t>(y) * request.size + x] = r | (g << 8) | (b << 16) | (255u << 24);
+        }
+    }
 }
 
 // Makes camera follow the model in m_parentModel in a third person view.
@@ -165,8 +445,8 @@ void SandApplication::MakeCameraFollowPlayer() {
     std::shared_ptr<SceneCamera> camera = m_cameraController.GetCamera();
     camera->GetCamera()->ExtractVectors(right, up, forward);
 
-    // Now we can move the camera back and a bit up to get the player model in frame
-    translation += (forward + up / 3.0f) * m_cameraPlayerDistance + up * m_offsetStength/2.0f;
+    // Now we can move the camera back and a bit up to get the player model in frame. The player is already on the sand
+    translation += (forward + up / 3.0f) * m_cameraPlayerDistance;
     cameraTransform->SetTranslation(translation);
 
     // Lastly, make the actual camera viewport update according to the transform changes.
@@ -179,7 +459,8 @@ void SandApplication::Render()
 
     GetDevice().Clear(true, Color(0.0f, 0.0f, 0.0f, 1.0f), true, 1.0f);
 
-    // Render the scene
+    // Render the scene, counting the uniform data sent this frame
+    ShaderUniformCollection::ResetUploadStats();
     m_renderer.Render();
     
     // Debug output to check the shadow map
@@ -233,27 +514,109 @@ void SandApplication::InitializeLights()
 
 void SandApplication::InitializeMaterials()
 {
+    // Submit all the programs up front, so the driver can compile them in parallel while the textures load.
+    // Each material below waits only for its own program, and only extracts the uniforms once it is linked
+    std::vector<const char*> shadowMapVertexShaderPaths = { "shaders/version330.glsl", "shaders/renderer/empty.vert" };
+    std::vector<const char*> shadowMapFragmentShaderPaths = { "shaders/version330.glsl", "shaders/renderer/empty.frag" };
+    ShaderLibrary::ProgramFuture shadowMapProgram = m_shaderLibrary.SubmitProgram(shadowMapVertexShaderPaths, shadowMapFragmentShaderPaths);
+
+    // The shadow replacement shaders are the SHADOW_PASS variants of the same sources
+    std::vector<const char*> desertSandVertexShaderPaths = { "shaders/version330.glsl", "shaders/terrain.vert" };
+    std::vector<const char*> desertSandFragmentShaderPaths = { "shaders/version330.glsl", "shaders/utils.glsl", "shaders/virtualTexture.glsl", "shaders/normalGenerator.frag" };
+    std::shared_ptr<ShaderVariantSet> desertSandShaders = std::make_shared<ShaderVariantSet>(m_shaderLibrary,
+        desertSandVertexShaderPaths, desertSandFragmentShaderPaths, ShaderVariantSet::ShadowPass | ShaderVariantSet::VirtualFeedback);
+    desertSandShaders->SubmitVariant(ShaderVariantSet::NoKeywords);
+    desertSandShaders->SubmitVariant(ShaderVariantSet::ShadowPass);
+    desertSandShaders->SubmitVariant(ShaderVariantSet::VirtualFeedback);
+
+    std::vector<const char*> driveOnSandVertexShaderPaths = { "shaders/version330.glsl", "shaders/driveOnSand.vert" };
+    std::vector<const char*> driveOnSandFragmentShaderPaths = { "shaders/version330.glsl", "shaders/utils.glsl", "shaders/driveOnSand.frag" };
+    std::shared_ptr<ShaderVariantSet> driveOnSandShaders = std::make_shared<ShaderVariantSet>(m_shaderLibrary,
+        driveOnSandVertexShaderPaths, driveOnSandFragmentShaderPaths, ShaderVariantSet::ShadowPass | ShaderVariantSet::NormalMap);
+    driveOnSandShaders->SubmitVariant(ShaderVariantSet::NormalMap);
+    driveOnSandShaders->SubmitVariant(ShaderVariantSet::ShadowPass);
+
+    std::vector<const char*> propVertexShaderPaths = { "shaders/version330.glsl", "shaders/prop.vert" };
+    std::vector<const char*> propFragmentShaderPaths = { "shaders/version330.glsl", "shaders/utils.glsl", "shaders/prop.frag" };
+    std::shared_ptr<ShaderVariantSet> propShaders = std::make_shared<ShaderVariantSet>(m_shaderLibrary,
+        propVertexShaderPaths, propFragmentShaderPaths, ShaderVariantSet::ShadowPass | ShaderVariantSet::NormalMap | ShaderVariantSet::Instanced);
+    propShaders->SubmitVariant(ShaderVariantSet::NormalMap);
+    propShaders->SubmitVariant(ShaderVariantSet::NormalMap | ShaderVariantSet::Instanced);
+    propShaders->SubmitVariant(ShaderVariantSet::ShadowPass | ShaderVariantSet::Instanced);
+
+    std::vector<const char*> impostorVertexShaderPaths = { "shaders/version330.glsl", "shaders/utils.glsl", "shaders/impostor.vert" };
+    std::vector<const char*> impostorFragmentShaderPaths = { "shaders/version330.glsl", "shaders/utils.glsl", "shaders/impostor.frag" };
+    std::shared_ptr<ShaderVariantSet> impostorShaders = std::make_shared<ShaderVariantSet>(m_shaderLibrary,
+        impostorVertexShaderPaths, impostorFragmentShaderPaths, ShaderVariantSet::ShadowPass);
+    impostorShaders->SubmitVariant(ShaderVariantSet::NoKeywords);
+    impostorShaders->SubmitVariant(ShaderVariantSet::ShadowPass);
+
+    std::vector<const char*> particleVertexShaderPaths = { "shaders/version330.glsl", "shaders/particle.vert" };
+    std::vector<const char*> particleFragmentShaderPaths = { "shaders/version330.glsl", "shaders/particle.frag" };
+    std::shared_ptr<ShaderVariantSet> particleShaders = std::make_shared<ShaderVariantSet>(m_shaderLibrary,
+        particleVertexShaderPaths, particleFragmentShaderPaths, ShaderVariantSet::ShadowPass);
+    particleShaders->SubmitVariant(ShaderVariantSet::NoKeywords);
+    particleShaders->SubmitVariant(ShaderVariantSet::ShadowPass);
+
+    std::vector<const char*> gBufferVertexShaderPaths = { "shaders/version330.glsl", "shaders/default.vert" };
+    std::vector<const char*> gBufferFragmentShaderPaths = { "shaders/version330.glsl", "shaders/utils.glsl", "shaders/default.frag" };
+    ShaderLibrary::ProgramFuture gBufferProgram = m_shaderLibrary.SubmitProgram(gBufferVertexShaderPaths, gBufferFragmentShaderPaths);
+
+    // Fog is a compile-time keyword, the variant without it is only compiled if fog gets disabled
+    std::vector<const char*> deferredVertexShaderPaths = { "shaders/version330.glsl", "shaders/renderer/deferred.vert" };
+    std::vector<const char*> deferredFragmentShaderPaths = { "shaders/version330.glsl", "shaders/utils.glsl", "shaders/lambert-ggx.glsl", "shaders/lighting.glsl", "shaders/renderer/deferred.frag" };
+    std::shared_ptr<ShaderVariantSet> deferredShaders = std::make_shared<ShaderVariantSet>(m_shaderLibrary,
+        deferredVertexShaderPaths, deferredFragmentShaderPaths, ShaderVariantSet::Fog);
+    deferredShaders->SubmitVariant(m_enableFog ? ShaderVariantSet::Fog : ShaderVariantSet::NoKeywords);
+
+    // Decode the textures on the workers while the programs compile
+    // Both go through the cache: after the first run they are mapped from disk with their mip chains, and the
+    // displacement map is stored as BC4, a quarter of the memory of the 8-bit version
+    Texture2DLoader displacementMapLoader(TextureObject::FormatR, TextureObject::InternalFormatR);
+    displacementMapLoader.SetGenerateMipmap(true);
+    displacementMapLoader.SetWrapping(false);
+    displacementMapLoader.SetCache(&m_textureCache);
+    displacementMapLoader.SetCompressed(true);
+    AssetFuture<Texture2DObject> displacementMapFuture = displacementMapLoader.LoadAsync("textures/SandDisplacementMapTest2.jpg", m_loadQueue);
+
+    // The sand normal map is not uploaded, the pages of the sand detail are built from its levels in the cache
+    Texture2DLoader sandNormalMapLoader(TextureObject::FormatRGB, TextureObject::InternalFormatRGB8);
+    sandNormalMapLoader.SetGenerateMipmap(true);
+    std::shared_ptr<TextureCache::CachedTexture> sandNormalMap = std::make_shared<TextureCache::CachedTexture>();
+    std::shared_ptr<std::promise<bool>> sandNormalMapPromise = std::make_shared<std::promise<bool>>();
+    std::future<bool> sandNormalMapFuture = sandNormalMapPromise->get_future();
+    m_loadQueue.SubmitWork([textureCache = &m_textureCache, settings = sandNormalMapLoader.GetCacheSettings(), sandNormalMap, sandNormalMapPromise]()
+        {
+            sandNormalMapPromise->set_value(textureCache->Load("textures/SandNormalMap.png", settings, *sandNormalMap));
+        });
+
     // Initialize shadow replacement 
     m_materialsWithUniqueShadows = std::make_shared<std::vector<std::shared_ptr<const Material>>>();
     m_uniqueShadowMaterials = std::make_shared<std::vector<std::shared_ptr<const Material>>>();
 
-    m_displacementMap = Texture2DLoader::LoadTextureShared("textures/SandDisplacementMapTest2.jpg", TextureObject::FormatR, TextureObject::InternalFormatR, true, false, false);
+    m_displacementMap = m_loadQueue.Wait(displacementMapFuture);
 
-    // default shadow map material
+    // Keep the displacement map on the CPU too, read from the same cached file as the texture, to place objects on the sand
+    TextureCache::CachedTexture cachedDisplacementMap;
+    if (m_textureCache.Load("textures/SandDisplacementMapTest2.jpg", displacementMapLoader.GetCacheSettings(), cachedDisplacementMap))
     {
-        // Load and build shader
-        std::vector<const char*> vertexShaderPaths;
-        vertexShaderPaths.push_back("shaders/version330.glsl");
-        vertexShaderPaths.push_back("shaders/renderer/empty.vert");
-        Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
+        m_heightfield->Initialize(cachedDisplacementMap);
+        m_sandDeformer = std::make_unique<HeightfieldDeformer>(m_heightfield);
+
+        // The wind blows over the map, and the tracks are pressed into the dunes it leaves
+        m_duneSimulation = std::make_unique<DuneSimulation>(*m_heightfield, m_loadQueue);
+        m_duneSimulation->SetTickRate(m_duneTickRate);
+        m_duneSimulation->SetWind(glm::vec2(std::cos(glm::radians(m_windAngle)), std::sin(glm::radians(m_windAngle))), m_windErosion);
+        UpdateDuneTexelSize();
+    }
 
-        std::vector<const char*> fragmentShaderPaths;
-        fragmentShaderPaths.push_back("shaders/version330.glsl");
-        fragmentShaderPaths.push_back("shaders/renderer/empty.frag");
-        Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
+    // Finish the programs that compiled while the texture was loading, without blocking on the rest
+    m_shaderLibrary.Poll();
 
-        std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-        shaderProgramPtr->Build(vertexShader, fragmentShader);
+    // default shadow map material
+    {
+        // Wait for the program submitted at the start
+        std::shared_ptr<ShaderProgram> shaderProgramPtr = shadowMapProgram.get();
 
         // Get transform related uniform locations
         ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
@@ -279,292 +642,262 @@ void SandApplication::InitializeMaterials()
     }
 
 
-    // Sand material
+    // Sand material, and its shadow map replacement
+    // The replacement allows the desert sand to cast shadows even with modified vertexes.
     {
-        // Load and build shader
-        std::vector<const char*> vertexShaderPaths;
-        vertexShaderPaths.push_back("shaders/version330.glsl");
-        vertexShaderPaths.push_back("shaders/depthMapUtils.glsl");
-        vertexShaderPaths.push_back("shaders/normalGenerator.vert");
-        Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-        std::vector<const char*> fragmentShaderPaths;
-        fragmentShaderPaths.push_back("shaders/version330.glsl");
-        fragmentShaderPaths.push_back("shaders/utils.glsl");
-        fragmentShaderPaths.push_back("shaders/normalGenerator.frag");
-        Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-        std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-        shaderProgramPtr->Build(vertexShader, fragmentShader);
-
-        // Get transform related uniform locations
-        ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
-        ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
-
-        // Register shader with renderer
-        m_renderer.RegisterShaderProgram(shaderProgramPtr,
-            [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+        // Register each variant with the renderer when it is created
+        desertSandShaders->SetVariantCreatedFunction([=, this](std::shared_ptr<ShaderProgram> shaderProgramPtr, ShaderVariantSet::KeywordMask /*keywords*/)
             {
-                shaderProgram.SetUniform(worldViewMatrixLocation, camera.GetViewMatrix() * worldMatrix);
-        shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
-            },
-            nullptr
-                );
+                // Get transform related uniform locations
+                ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
+                ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
+
+                // Register shader with renderer
+                m_renderer.RegisterShaderProgram(shaderProgramPtr,
+                    [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+                    {
+                        shaderProgram.SetUniform(worldViewMatrixLocation, camera.GetViewMatrix() * worldMatrix);
+                        shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
+                    },
+                    nullptr
+                        );
+            });
 
         // Filter out uniforms that are not material properties
         ShaderUniformCollection::NameSet filteredUniforms;
         filteredUniforms.insert("WorldViewMatrix");
         filteredUniforms.insert("WorldViewProjMatrix");
 
-        // Create material
-        m_desertSandMaterial = std::make_shared<Material>(shaderProgramPtr, filteredUniforms);
+        // Create materials
+        m_desertSandMaterial = std::make_shared<Material>(desertSandShaders, ShaderVariantSet::NoKeywords, filteredUniforms);
+        m_desertSandShadowMaterial = std::make_shared<Material>(desertSandShaders, ShaderVariantSet::ShadowPass, filteredUniforms);
+        m_desertSandFeedbackMaterial = std::make_shared<Material>(desertSandShaders, ShaderVariantSet::VirtualFeedback, filteredUniforms);
 
         // Set material uniforms
 
         // Color
         m_desertSandMaterial->SetUniformValue("Color", glm::vec3(0.15f, 0.06f, 0.01f));  // Sand ground color
 
-        // Depth map. Since it's black and white, there's no reason to load more than one channel.
-        m_desertSandMaterial->SetUniformValue("DepthMap", m_displacementMap);
-
-        // Initial depth parameters
-        m_desertSandMaterial->SetUniformValue("SampleDistance", m_sampleDistance);
-        m_desertSandMaterial->SetUniformValue("OffsetStrength", m_offsetStength);
-
-        // Normal texture
-        std::shared_ptr<Texture2DObject> normalMap = Texture2DLoader::LoadTextureShared("textures/SandNormalMap.png", TextureObject::FormatRGB, TextureObject::InternalFormatRGB8, true, false);
-        m_desertSandMaterial->SetUniformValue("NormalTexture", normalMap);
-        m_desertSandMaterial->SetUniformValue("ObjectSize", glm::vec2(m_desertWidth, m_desertLength));
-        m_desertSandMaterial->SetUniformValue("TileSize", 10.0f);
-
-
+        // Height and normal baked from the depth map, so the vertex shader reads them with a single fetch.
+        // They are baked again on the workers when the depth parameters change
+        if (!m_heightfield->IsEmpty())
+        {
+            m_heightfieldBaker = std::make_unique<HeightfieldBaker>(m_heightfield, m_loadQueue, [=, this](std::shared_ptr<Texture2DObject> heightNormalMap)
+                {
+                    m_desertSandMaterial->SetUniformValue("HeightNormalMap", heightNormalMap);
+                    m_desertSandShadowMaterial->SetUniformValue("HeightNormalMap", heightNormalMap);
+                    m_desertSandFeedbackMaterial->SetUniformValue("HeightNormalMap", heightNormalMap);
+
+                    // The materials of the scattered props are instances of this one, they see the new texture too
+                    if (m_scatterMaterial)
+                    {
+                        m_scatterMaterial->SetUniformValue("HeightNormalMap", heightNormalMap);
+                        m_scatterShadowMaterial->SetUniformValue("HeightNormalMap", heightNormalMap);
+                    }
+                });
+            m_heightfieldBaker->BakeNow(m_sampleDistance, m_offsetStength);
+        }
 
-        m_desertSandMaterial->SetUniformValue("ColorTexture", normalMap);
+        // Sand detail: 128 x 128 pages of 120 texels over the desert, with 4 texels of border so the slots of the 16 x 16
+        // atlas are 128 wide. Only the pages seen by the camera are built, on the workers. The normal map tiles every 10 units
+        if (!sandNormalMapFuture.get())
+        {
+            std::cout << "ERROR::SANDAPPLICATION::SAND_NORMAL_MAP_NOT_LOADED: The sand detail will be flat" << std::endl;
+        }
+        float desertLength = m_desertLength;
+        m_sandDetailTexture = std::make_shared<VirtualTexture>(128, 120, 4, 16, m_loadQueue,
+            [sandNormalMap, desertLength](const VirtualTexture::PageRequest& request, std::span<uint32_t> texels)
+            {
+                FillSandDetailPage(*sandNormalMap, desertLength, 10.0f, request, texels);
+            });
+        for (std::shared_ptr<Material> material : { m_desertSandMaterial, m_desertSandFeedbackMaterial })
+        {
+            material->SetUniformValue("VirtualPageTable", m_sandDetailTexture->GetPageTable());
+            material->SetUniformValue("VirtualAtlas", m_sandDetailTexture->GetAtlas());
+            material->SetUniformValue("VirtualPageCount", static_cast<float>(m_sandDetailTexture->GetPageCount()));
+            material->SetUniformValue("VirtualPageSize", static_cast<float>(m_sandDetailTexture->GetPageSize()));
+            material->SetUniformValue("VirtualBorder", static_cast<float>(m_sandDetailTexture->GetBorder()));
+            material->SetUniformValue("VirtualAtlasSize", static_cast<float>(m_sandDetailTexture->GetAtlasSize()));
+            material->SetUniformValue("VirtualLevelCount", static_cast<float>(m_sandDetailTexture->GetLevelCount()));
+        }
+        m_desertSandMaterial->SetUniformValue("VirtualLevelBias", 0.0f);
+        // The smaller target has bigger derivatives, the bias asks for the level the screen needs
+        m_desertSandFeedbackMaterial->SetUniformValue("VirtualLevelBias", -std::log2(static_cast<float>(m_feedbackDownscale)));
 
         m_materialsWithUniqueShadows->push_back(m_desertSandMaterial);
+        m_uniqueShadowMaterials->push_back(m_desertSandShadowMaterial);
     }
 
-    // Shadow map replacement material for the desert sand
-    // This allows the desert sand to cast shadows even with modified vertexes.
-    {
-        // Load and build shader
-        std::vector<const char*> vertexShaderPaths;
-        vertexShaderPaths.push_back("shaders/version330.glsl");
-        vertexShaderPaths.push_back("shaders/depthMapUtils.glsl");
-        vertexShaderPaths.push_back("shaders/normalGenerator.vert");
-        Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-        std::vector<const char*> fragmentShaderPaths;
-        fragmentShaderPaths.push_back("shaders/version330.glsl");
-        fragmentShaderPaths.push_back("shaders/renderer/empty.frag");
-        Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-        std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-        shaderProgramPtr->Build(vertexShader, fragmentShader);
 
-        // Get transform related uniform locations
-        ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
-        ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
-
-        // Register shader with renderer
-        m_renderer.RegisterShaderProgram(shaderProgramPtr,
-            [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+    // Drive on sand material, and its shadow map replacement
+    {
+        // Register each variant with the renderer when it is created
+        driveOnSandShaders->SetVariantCreatedFunction([=, this](std::shared_ptr<ShaderProgram> shaderProgramPtr, ShaderVariantSet::KeywordMask /*keywords*/)
             {
-                shaderProgram.SetUniform(worldViewMatrixLocation, camera.GetViewMatrix() * worldMatrix);
-        shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
-            },
-            nullptr
-                );
+                // Get transform related uniform locations
+                ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
+                ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
+
+                // Register shader with renderer. The models are placed on the sand by their transforms
+                m_renderer.RegisterShaderProgram(shaderProgramPtr,
+                    [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+                    {
+                        shaderProgram.SetUniform(worldViewMatrixLocation, camera.GetViewMatrix() * worldMatrix);
+                        shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
+                    },
+                    nullptr
+                        );
+            });
 
         // Filter out uniforms that are not material properties
         ShaderUniformCollection::NameSet filteredUniforms;
         filteredUniforms.insert("WorldViewMatrix");
         filteredUniforms.insert("WorldViewProjMatrix");
 
-        // Create material
-        m_desertSandShadowMaterial = std::make_shared<Material>(shaderProgramPtr, filteredUniforms);
+        // Create materials
+        m_driveOnSandMaterial = std::make_shared<Material>(driveOnSandShaders, ShaderVariantSet::NormalMap, filteredUniforms);
+        m_driveOnSandShadowMaterial = std::make_shared<Material>(driveOnSandShaders, ShaderVariantSet::ShadowPass, filteredUniforms);
 
-        // Set material uniforms
-        // Depth map. Since it's black and white, there's no reason to load more than one channel.
-        m_desertSandShadowMaterial->SetUniformValue("DepthMap", m_displacementMap);
+        //// Set material uniforms
 
-        // Initial depth parameters
-        m_desertSandShadowMaterial->SetUniformValue("SampleDistance", m_sampleDistance);
-        m_desertSandShadowMaterial->SetUniformValue("OffsetStrength", m_offsetStength);
+        // Color
+        m_driveOnSandMaterial->SetUniformValue("Color", glm::vec3(1.0f, 1.0f, 1.0f));  // Sand ground color
 
-        m_uniqueShadowMaterials->push_back(m_desertSandShadowMaterial);
+        m_materialsWithUniqueShadows->push_back(m_driveOnSandMaterial);
+        m_uniqueShadowMaterials->push_back(m_driveOnSandShadowMaterial);
     }
 
-
-    // Drive on sand material
+    // Prop materials, and the shadow map replacement of the scattered ones
     {
-        // Load and build shader
-        std::vector<const char*> vertexShaderPaths;
-        vertexShaderPaths.push_back("shaders/version330.glsl");
-        vertexShaderPaths.push_back("shaders/depthMapUtils.glsl");
-        vertexShaderPaths.push_back("shaders/driveOnSand.vert");
-        Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-        std::vector<const char*> fragmentShaderPaths;
-        fragmentShaderPaths.push_back("shaders/version330.glsl");
-        fragmentShaderPaths.push_back("shaders/utils.glsl");
-        fragmentShaderPaths.push_back("shaders/driveOnSand.frag");
-        Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-        std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-        shaderProgramPtr->Build(vertexShader, fragmentShader);
-
-        // Get transform related uniform locations
-        ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
-        ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
-        ShaderProgram::Location objectUVPositionLocation = shaderProgramPtr->GetUniformLocation("DesertUV");
-        ShaderProgram::Location objectPivotPositionLocation = shaderProgramPtr->GetUniformLocation("PivotPosition");
-        ShaderProgram::Location forwardLocation = shaderProgramPtr->GetUniformLocation("Right");
-        ShaderProgram::Location offsetStrengthLocation = shaderProgramPtr->GetUniformLocation("OffsetStrength");
-        ShaderProgram::Location sampleDistanceLocation = shaderProgramPtr->GetUniformLocation("SampleDistance");
-
-        // Register shader with renderer
-        m_renderer.RegisterShaderProgram(shaderProgramPtr,
-            [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+        // Register each variant with the renderer when it is created
+        propShaders->SetVariantCreatedFunction([=, this](std::shared_ptr<ShaderProgram> shaderProgramPtr, ShaderVariantSet::KeywordMask /*keywords*/)
             {
-                shaderProgram.SetUniform(offsetStrengthLocation, m_offsetStength);
-                shaderProgram.SetUniform(sampleDistanceLocation, m_sampleDistance);
-                shaderProgram.SetUniform(worldViewMatrixLocation, camera.GetViewMatrix() * worldMatrix);
-        shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
-        glm::vec3 modelPos = m_parentModel->GetTransform()->GetTranslation();
-        shaderProgram.SetUniform(objectPivotPositionLocation, modelPos);
-
-        // Calculate the models position on the desert model in UV coordinates.
-        glm::vec3 desertPos = m_desertModel->GetTransform()->GetTranslation();
-        glm::vec3 desertScale = m_desertModel->GetTransform()->GetScale();
-        glm::vec3 desertPosOnDesert = modelPos - desertPos;
-        u = desertPosOnDesert.x / m_desertLength * desertScale.x + 0.5;
-        v = desertPosOnDesert.z / m_desertWidth * desertScale.z + 0.5;
-        shaderProgram.SetUniform(objectUVPositionLocation, glm::vec2(u, v));
-
-        // Calculate model right direction direction, so we can cross it with the plane's normal to get the new model forward.
-        glm::mat3 transposed = m_parentModel->GetTransform()->GetTransformMatrix(); // glm::transpose(parentTransform->GetTranslationMatrix());
-        glm::vec3 right = transposed[0];
-        shaderProgram.SetUniform(forwardLocation, right);
-            },
-            nullptr
-                );
+                // Get transform related uniform locations
+                ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
+                ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
+
+                // Register shader with renderer. Single props are placed on the sand by their transforms, scattered ones by the shader
+                m_renderer.RegisterShaderProgram(shaderProgramPtr,
+                    [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+                    {
+                        shaderProgram.SetUniform(worldViewMatrixLocation, camera.GetViewMatrix() * worldMatrix);
+                        shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
+                    },
+                    nullptr
+                        );
+            });
 
         // Filter out uniforms that are not material properties
         ShaderUniformCollection::NameSet filteredUniforms;
         filteredUniforms.insert("WorldViewMatrix");
         filteredUniforms.insert("WorldViewProjMatrix");
-        filteredUniforms.insert("desertUV");
-        filteredUniforms.insert("PivotPositon");
-        filteredUniforms.insert("Right");
 
-        // Create material
-        m_driveOnSandMaterial = std::make_shared<Material>(shaderProgramPtr, filteredUniforms);
+        // Create materials
+        m_propMaterial = std::make_shared<Material>(propShaders, ShaderVariantSet::NormalMap, filteredUniforms);
+        m_scatterMaterial = std::make_shared<Material>(propShaders, ShaderVariantSet::NormalMap | ShaderVariantSet::Instanced, filteredUniforms);
+        m_scatterShadowMaterial = std::make_shared<Material>(propShaders, ShaderVariantSet::ShadowPass | ShaderVariantSet::Instanced, filteredUniforms);
 
         //// Set material uniforms
 
         // Color
-        m_driveOnSandMaterial->SetUniformValue("Color", glm::vec3(1.0f, 1.0f, 1.0f));  // Sand ground color
+        m_propMaterial->SetUniformValue("Color", glm::vec3(1.0f, 1.0f, 1.0f));
+        m_scatterMaterial->SetUniformValue("Color", glm::vec3(1.0f, 1.0f, 1.0f));
 
-        // Depth map. Since it's black and white, there's no reason to load more than one channel.
-        m_driveOnSandMaterial->SetUniformValue("DepthMap", m_displacementMap);
+        // No fade, unless the prop has an impostor. Set on all of them, they share the program
+        m_propMaterial->SetUniformValue("ImpostorFadeRange", glm::vec2(0.0f));
+        m_scatterMaterial->SetUniformValue("ImpostorFadeRange", glm::vec2(0.0f));
 
-        m_materialsWithUniqueShadows->push_back(m_driveOnSandMaterial);
+        // The scattered props stand on the same baked height as the terrain, and sink slightly into the sand like the player
+        for (std::shared_ptr<Material> material : { m_scatterMaterial, m_scatterShadowMaterial })
+        {
+            material->SetUniformValue("TerrainSize", m_desertLength);
+            material->SetUniformValue("SurfaceOffset", -0.1f);
+            if (m_heightfieldBaker)
+            {
+                material->SetUniformValue("HeightNormalMap", m_heightfieldBaker->GetTexture());
+            }
+        }
+
+        m_materialsWithUniqueShadows->push_back(m_scatterMaterial);
+        m_uniqueShadowMaterials->push_back(m_scatterShadowMaterial);
     }
 
-    // drive on desert shadow material.
+    // Impostor materials. The atlas is set on the instances created for each impostor
     {
-        // Load and build shader
-        std::vector<const char*> vertexShaderPaths;
-        vertexShaderPaths.push_back("shaders/version330.glsl");
-        vertexShaderPaths.push_back("shaders/depthMapUtils.glsl");
-        vertexShaderPaths.push_back("shaders/driveOnSand.vert");
-        Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-        std::vector<const char*> fragmentShaderPaths;
-        fragmentShaderPaths.push_back("shaders/version330.glsl");
-        fragmentShaderPaths.push_back("shaders/utils.glsl");
-        fragmentShaderPaths.push_back("shaders/renderer/empty.frag");
-        Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-        std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-        shaderProgramPtr->Build(vertexShader, fragmentShader);
+        // Register each variant with the renderer when it is created
+        impostorShaders->SetVariantCreatedFunction([=, this](std::shared_ptr<ShaderProgram> shaderProgramPtr, ShaderVariantSet::KeywordMask /*keywords*/)
+            {
+                // Get transform related uniform locations
+                ShaderProgram::Location viewMatrixLocation = shaderProgramPtr->GetUniformLocation("ViewMatrix");
+                ShaderProgram::Location projMatrixLocation = shaderProgramPtr->GetUniformLocation("ProjMatrix");
+
+                // Register shader with renderer. The quads are placed by the world matrices of the instances
+                m_renderer.RegisterShaderProgram(shaderProgramPtr,
+                    [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+                    {
+                        if (cameraChanged)
+                        {
+                            shaderProgram.SetUniform(viewMatrixLocation, camera.GetViewMatrix());
+                            shaderProgram.SetUniform(projMatrixLocation, camera.GetProjectionMatrix());
+                        }
+                    },
+                    nullptr
+                        );
+            });
 
-        // Get transform related uniform locations
-        ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
-        ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
-        ShaderProgram::Location objectUVPositionLocation = shaderProgramPtr->GetUniformLocation("DesertUV");
-        ShaderProgram::Location objectPivotPositionLocation = shaderProgramPtr->GetUniformLocation("PivotPosition");
-        ShaderProgram::Location forwardLocation = shaderProgramPtr->GetUniformLocation("Right");
+        // Filter out uniforms that are not material properties
+        ShaderUniformCollection::NameSet filteredUniforms;
+        filteredUniforms.insert("ViewMatrix");
+        filteredUniforms.insert("ProjMatrix");
 
+        // Create materials
+        m_impostorMaterial = std::make_shared<Material>(impostorShaders, ShaderVariantSet::NoKeywords, filteredUniforms);
+        m_impostorShadowMaterial = std::make_shared<Material>(impostorShaders, ShaderVariantSet::ShadowPass, filteredUniforms);
+    }
 
-        // Register shader with renderer
-        m_renderer.RegisterShaderProgram(shaderProgramPtr,
-            [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+    // Particle material, and its shadow map replacement that keeps the same dithered pixels
+    {
+        // Register each variant with the renderer when it is created
+        particleShaders->SetVariantCreatedFunction([=, this](std::shared_ptr<ShaderProgram> shaderProgramPtr, ShaderVariantSet::KeywordMask /*keywords*/)
             {
-                shaderProgram.SetUniform(worldViewMatrixLocation, camera.GetViewMatrix() * worldMatrix);
-                shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
-                glm::vec3 modelPos = m_parentModel->GetTransform()->GetTranslation();
-                shaderProgram.SetUniform(objectPivotPositionLocation, modelPos);
-
-                // Calculate the models position on the desert model in UV coordinates.
-                glm::vec3 desertPos = m_desertModel->GetTransform()->GetTranslation();
-                glm::vec3 desertScale = m_desertModel->GetTransform()->GetScale();
-                glm::vec3 desertPosOnDesert = modelPos - desertPos;
-                u = desertPosOnDesert.x / m_desertLength * desertScale.x + 0.5;
-                v = desertPosOnDesert.z / m_desertWidth * desertScale.z + 0.5;
-                shaderProgram.SetUniform(objectUVPositionLocation, glm::vec2(u, v));
-
-                // Calculate model right direction direction, so we can cross it with the plane's normal to get the new model forward.
-                glm::mat3 transposed = m_parentModel->GetTransform()->GetTransformMatrix(); // glm::transpose(parentTransform->GetTranslationMatrix());
-                glm::vec3 right = transposed[0];
-                shaderProgram.SetUniform(forwardLocation, right);
-            },
-            nullptr
-                );
+                // Get transform related uniform locations
+                ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
+                ShaderProgram::Location projMatrixLocation = shaderProgramPtr->GetUniformLocation("ProjMatrix");
+
+                // Register shader with renderer. The billboards are expanded in view space, so they need the projection on its own
+                m_renderer.RegisterShaderProgram(shaderProgramPtr,
+                    [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+                    {
+                        shaderProgram.SetUniform(worldViewMatrixLocation, camera.GetViewMatrix() * worldMatrix);
+                        if (cameraChanged)
+                        {
+                            shaderProgram.SetUniform(projMatrixLocation, camera.GetProjectionMatrix());
+                        }
+                    },
+                    nullptr
+                        );
+            });
 
         // Filter out uniforms that are not material properties
         ShaderUniformCollection::NameSet filteredUniforms;
         filteredUniforms.insert("WorldViewMatrix");
-        filteredUniforms.insert("WorldViewProjMatrix");
-        filteredUniforms.insert("desertUV");
-        filteredUniforms.insert("PivotPositon");
-        filteredUniforms.insert("Right");
-
-        // Create material
-        m_driveOnSandShadowMaterial = std::make_shared<Material>(shaderProgramPtr, filteredUniforms);
+        filteredUniforms.insert("ProjMatrix");
 
-        //// Set material uniforms
-        // Depth map. Since it's black and white, there's no reason to load more than one channel.
-        m_driveOnSandShadowMaterial->SetUniformValue("DepthMap", m_displacementMap);
+        // Create materials
+        m_particleMaterial = std::make_shared<Material>(particleShaders, ShaderVariantSet::NoKeywords, filteredUniforms);
+        m_particleShadowMaterial = std::make_shared<Material>(particleShaders, ShaderVariantSet::ShadowPass, filteredUniforms);
 
-        // Initial depth parameters
-        m_driveOnSandShadowMaterial->SetUniformValue("SampleDistance", m_sampleDistance);
-        m_driveOnSandShadowMaterial->SetUniformValue("OffsetStrength", m_offsetStength);
+        // Color, a bit lighter than the ground
+        m_particleMaterial->SetUniformValue("Color", glm::vec3(0.3f, 0.15f, 0.05f));
 
-        m_uniqueShadowMaterials->push_back(m_driveOnSandShadowMaterial);
+        m_materialsWithUniqueShadows->push_back(m_particleMaterial);
+        m_uniqueShadowMaterials->push_back(m_particleShadowMaterial);
     }
 
-    // Prop material ( Needs to be complied individually for each prop)
-    
-
-
     // G-buffer material
     {
-        // Load and build shader
-        std::vector<const char*> vertexShaderPaths;
-        vertexShaderPaths.push_back("shaders/version330.glsl");
-        vertexShaderPaths.push_back("shaders/default.vert");
-        Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-        std::vector<const char*> fragmentShaderPaths;
-        fragmentShaderPaths.push_back("shaders/version330.glsl");
-        fragmentShaderPaths.push_back("shaders/utils.glsl");
-        fragmentShaderPaths.push_back("shaders/default.frag");
-        Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-        std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-        shaderProgramPtr->Build(vertexShader, fragmentShader);
+        // Wait for the program submitted at the start
+        std::shared_ptr<ShaderProgram> shaderProgramPtr = gBufferProgram.get();
 
         // Get transform related uniform locations
         ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
@@ -592,21 +925,28 @@ void SandApplication::InitializeMaterials()
     
     // Deferred material
     {
-        std::vector<const char*> vertexShaderPaths;
-        vertexShaderPaths.push_back("shaders/version330.glsl");
-        vertexShaderPaths.push_back("shaders/renderer/deferred.vert");
-        Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-        std::vector<const char*> fragmentShaderPaths;
-        fragmentShaderPaths.push_back("shaders/version330.glsl");
-        fragmentShaderPaths.push_back("shaders/utils.glsl");
-        fragmentShaderPaths.push_back("shaders/lambert-ggx.glsl");
-        fragmentShaderPaths.push_back("shaders/lighting.glsl");
-        fragmentShaderPaths.push_back("shaders/renderer/deferred.frag");
-        Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-        std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-        shaderProgramPtr->Build(vertexShader, fragmentShader);
+        // Register each variant with the renderer when it is created, the other one is compiled when fog is toggled
+        deferredShaders->SetVariantCreatedFunction([=, this](std::shared_ptr<ShaderProgram> shaderProgramPtr, ShaderVariantSet::KeywordMask /*keywords*/)
+            {
+                // Get transform related uniform locations
+                ShaderProgram::Location invViewMatrixLocation = shaderProgramPtr->GetUniformLocation("InvViewMatrix");
+                ShaderProgram::Location invProjMatrixLocation = shaderProgramPtr->GetUniformLocation("InvProjMatrix");
+                ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
+
+                // Register shader with renderer
+                m_renderer.RegisterShaderProgram(shaderProgramPtr,
+                    [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
+                    {
+                        if (cameraChanged)
+                        {
+                            shaderProgram.SetUniform(invViewMatrixLocation, glm::inverse(camera.GetViewMatrix()));
+                            shaderProgram.SetUniform(invProjMatrixLocation, glm::inverse(camera.GetProjectionMatrix()));
+                        }
+                        shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
+                    },
+                    m_renderer.GetDefaultUpdateLightsFunction(*shaderProgramPtr)
+                        );
+            });
 
         // Filter out uniforms that are not material properties
         ShaderUniformCollection::NameSet filteredUniforms;
@@ -619,111 +959,63 @@ void SandApplication::InitializeMaterials()
         filteredUniforms.insert("LightDirection");
         filteredUniforms.insert("LightAttenuation");
 
-        // Get transform related uniform locations
-        ShaderProgram::Location invViewMatrixLocation = shaderProgramPtr->GetUniformLocation("InvViewMatrix");
-        ShaderProgram::Location invProjMatrixLocation = shaderProgramPtr->GetUniformLocation("InvProjMatrix");
-        ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
-
-        // Register shader with renderer
-        m_renderer.RegisterShaderProgram(shaderProgramPtr,
-            [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
-            {
-                if (cameraChanged)
-                {
-                    shaderProgram.SetUniform(invViewMatrixLocation, glm::inverse(camera.GetViewMatrix()));
-                    shaderProgram.SetUniform(invProjMatrixLocation, glm::inverse(camera.GetProjectionMatrix()));
-                }
-                shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
-            },
-            m_renderer.GetDefaultUpdateLightsFunction(*shaderProgramPtr)
-                );
-
         // Create material
-        m_deferredMaterial = std::make_shared<Material>(shaderProgramPtr, filteredUniforms);
+        m_deferredMaterial = std::make_shared<Material>(deferredShaders, m_enableFog ? ShaderVariantSet::Fog : ShaderVariantSet::NoKeywords, filteredUniforms);
 
         m_deferredMaterial->SetUniformValue("FadeColor", glm::vec3(0.42f, 0.32f, 0.09f));  // Sand Sky color
-        m_deferredMaterial->SetUniformValue("EnableFog", m_enableFog);
     }
 }
 
-std::shared_ptr<Material> SandApplication::GeneratePropMaterial() {
-    {
-        // Load and build shader
-        std::vector<const char*> vertexShaderPaths;
-        vertexShaderPaths.push_back("shaders/version330.glsl");
-        vertexShaderPaths.push_back("shaders/depthMapUtils.glsl");
-        vertexShaderPaths.push_back("shaders/prop.vert");
-        Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-        std::vector<const char*> fragmentShaderPaths;
-        fragmentShaderPaths.push_back("shaders/version330.glsl");
-        fragmentShaderPaths.push_back("shaders/utils.glsl");
-        fragmentShaderPaths.push_back("shaders/prop.frag");
-        Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-        std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-        shaderProgramPtr->Build(vertexShader, fragmentShader);
+void SandApplication::SetLoaderReferenceMaterial(ModelLoader& loader, std::shared_ptr<Material> referenceMaterial)
+{
+    loader.SetReferenceMaterial(referenceMaterial);
 
-        // Get transform related uniform locations
-        ShaderProgram::Location worldViewMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewMatrix");
-        ShaderProgram::Location worldViewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldViewProjMatrix");
-        ShaderProgram::Location objectUVPositionLocation = shaderProgramPtr->GetUniformLocation("DesertUV");
-        ShaderProgram::Location offsetStrengthLocation = shaderProgramPtr->GetUniformLocation("OffsetStrength");
-        ShaderProgram::Location sampleDistanceLocation = shaderProgramPtr->GetUniformLocation("SampleDistance");
+    // Link vertex properties to attributes found in the matrial provided to the loader.
+    loader.SetMaterialAttribute(VertexAttribute::Semantic::Position, "VertexPosition");
+    loader.SetMaterialAttribute(VertexAttribute::Semantic::Normal, "VertexNormal");
+    loader.SetMaterialAttribute(VertexAttribute::Semantic::Tangent, "VertexTangent");
+    loader.SetMaterialAttribute(VertexAttribute::Semantic::Bitangent, "VertexBitangent");
+    loader.SetMaterialAttribute(VertexAttribute::Semantic::TexCoord0, "VertexTexCoord");
 
-        // Register shader with renderer
-        m_renderer.RegisterShaderProgram(shaderProgramPtr,
-            [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
-            {
-                shaderProgram.SetUniform(offsetStrengthLocation, m_offsetStength);
-        shaderProgram.SetUniform(sampleDistanceLocation, m_sampleDistance);
-        shaderProgram.SetUniform(worldViewMatrixLocation, camera.GetViewMatrix() * worldMatrix);
-        shaderProgram.SetUniform(worldViewProjMatrixLocation, camera.GetViewProjectionMatrix() * worldMatrix);
-        glm::vec3 modelPos = m_propModels->at(0)->GetTransform()->GetTranslation();
-
-        // Calculate the models position on the desert model in UV coordinates.
-        glm::vec3 desertPos = m_desertModel->GetTransform()->GetTranslation();
-        glm::vec3 desertScale = m_desertModel->GetTransform()->GetScale();
-        glm::vec3 desertPosOnDesert = modelPos - desertPos;
-        u = desertPosOnDesert.x / m_desertLength * desertScale.x + 0.5;
-        v = desertPosOnDesert.z / m_desertWidth * desertScale.z + 0.5;
-        shaderProgram.SetUniform(objectUVPositionLocation, glm::vec2(u, v));
-
-        // Calculate model right direction direction, so we can cross it with the plane's normal to get the new model forward.
-        glm::mat3 transposed = m_propModels->at(0)->GetTransform()->GetTransformMatrix(); // glm::transpose(parentTransform->GetTranslationMatrix());
-        glm::vec3 right = transposed[0];
-            },
-            nullptr
-                );
+    // Link material properties to uniforms
+    loader.SetMaterialProperty(ModelLoader::MaterialProperty::DiffuseColor, "Color");
+    loader.SetMaterialProperty(ModelLoader::MaterialProperty::DiffuseTexture, "ColorTexture");
+    loader.SetMaterialProperty(ModelLoader::MaterialProperty::NormalTexture, "NormalTexture");
+    loader.SetMaterialProperty(ModelLoader::MaterialProperty::SpecularTexture, "SpecularTexture");
+}
 
-        // Filter out uniforms that are not material properties
-        ShaderUniformCollection::NameSet filteredUniforms;
-        filteredUniforms.insert("WorldViewMatrix");
-        filteredUniforms.insert("WorldViewProjMatrix");
-        filteredUniforms.insert("DesertUV");
-        filteredUniforms.insert("OffsetStrength");
-        filteredUniforms.insert("SampleDist");
+void SandApplication::InitializeModels()
+{
+    // Start decoding the skybox, it is the biggest image
+    AssetFuture<TextureCubemapObject> skyboxTextureFuture = TextureCubemapLoader::LoadTextureSharedAsync("models/skybox/DesertSkybox.hdr", m_loadQueue,
+        TextureObject::FormatRGB, TextureObject::InternalFormatRGB16F);
 
-        // Create material
-        std::shared_ptr<Material> propMaterial = std::make_shared<Material>(shaderProgramPtr, filteredUniforms);
+    // Configure loader
+    ModelLoader loader(m_driveOnSandMaterial);
 
-        //// Set material uniforms
+    // Create a new material copy for each submaterial
+    loader.SetCreateMaterials(true);
 
-        // Color
-        propMaterial->SetUniformValue("Color", glm::vec3(1.0f, 1.0f, 1.0f));  // Sand ground color
+    // Flip vertically textures loaded by the model loader
+    loader.GetTexture2DLoader().SetFlipVertical(true);
 
-        // Depth map. Since it's black and white, there's no reason to load more than one channel.
-        propMaterial->SetUniformValue("DepthMap", m_displacementMap);
+    // Stream the model textures, they are big and only needed at full size up close
+    loader.GetTexture2DLoader().SetStreamer(&m_textureStreamer);
 
-        //m_materialsWithUniqueShadows->push_back(propMaterial);
+    // Pack the normals, tangent frames and texture coordinates, the shaders read them unchanged
+    loader.SetVertexQuantization(ModelLoader::VertexQuantization::Packed);
 
-        return propMaterial;
-    }
-}
+    // Simplified levels of detail for the models seen from far away
+    loader.SetLodCount(3);
 
-void SandApplication::InitializeModels()
-{
-    m_skyboxTexture = TextureCubemapLoader::LoadTextureShared("models/skybox/DesertSkybox.hdr", TextureObject::FormatRGB, TextureObject::InternalFormatRGB16F);
+    // Link vertex properties and material properties to the material provided to the loader.
+    SetLoaderReferenceMaterial(loader, m_driveOnSandMaterial);
+
+    // Import the models on the workers, they are only uploaded when waited on, or when the queue is processed
+    AssetFuture<Model> cannonModelFuture = loader.LoadAsync("models/temple-ruin/Temple ruin.obj", m_loadQueue);
+    AssetFuture<Model> debugCannonModelFuture = loader.LoadAsync("models/cannon/cannon.obj", m_loadQueue);
+
+    m_skyboxTexture = m_loadQueue.Wait(skyboxTextureFuture);
 
     m_skyboxTexture->Bind();
     float maxLod;
@@ -734,31 +1026,9 @@ void SandApplication::InitializeModels()
     m_deferredMaterial->SetUniformValue("EnvironmentTexture", m_skyboxTexture);
     m_deferredMaterial->SetUniformValue("EnvironmentMaxLod", maxLod);
 
-    // Configure loader
-    ModelLoader loader(m_driveOnSandMaterial);
-
-    // Create a new material copy for each submaterial
-    loader.SetCreateMaterials(true);
-
-    // Flip vertically textures loaded by the model loader
-    loader.GetTexture2DLoader().SetFlipVertical(true);
-
-    // Link vertex properties to attributes found in the matrial provided to the loader.
-    loader.SetMaterialAttribute(VertexAttribute::Semantic::Position, "VertexPosition");
-    loader.SetMaterialAttribute(VertexAttribute::Semantic::Normal, "VertexNormal");
-    loader.SetMaterialAttribute(VertexAttribute::Semantic::Tangent, "VertexTangent");
-    loader.SetMaterialAttribute(VertexAttribute::Semantic::Bitangent, "VertexBitangent");
-    loader.SetMaterialAttribute(VertexAttribute::Semantic::TexCoord0, "VertexTexCoord");
-
-    // Link material properties to uniforms
-    loader.SetMaterialProperty(ModelLoader::MaterialProperty::DiffuseColor, "Color");
-    loader.SetMaterialProperty(ModelLoader::MaterialProperty::DiffuseTexture, "ColorTexture");
-    loader.SetMaterialProperty(ModelLoader::MaterialProperty::NormalTexture, "NormalTexture");
-    loader.SetMaterialProperty(ModelLoader::MaterialProperty::SpecularTexture, "SpecularTexture");
-
     // Load models. ALL MODELS NEED UNIQUE NAMES. Otherwise they won't be rendered.
     // The loader probably needs to be configured differntly for each different material we use for an object.
-    std::shared_ptr<Model> cannonModel = loader.LoadShared("models/temple-ruin/Temple ruin.obj");
+    std::shared_ptr<Model> cannonModel = m_loadQueue.Wait(cannonModelFuture);
     std::shared_ptr<SceneModel> player =  std::make_shared<SceneModel>("cannon", cannonModel);
     m_scene.AddSceneNode(player);
     m_visualPlayerModel = player;
@@ -772,16 +1042,24 @@ void SandApplication::InitializeModels()
 
     // The parent framework doesn't look like it's done, so Instead I'm doing a quick and dirty hack to emulate an empty parent of the
     // camera and the player visual model.
-    // there's probably techinaclly a memory leak here, but i don't think i have time to fix it. It's small anyway.
-    std::shared_ptr<Model> debugCanonModel(loader.LoadNew("models/cannon/cannon.obj"));
+    std::shared_ptr<Model> debugCanonModel = m_loadQueue.Wait(debugCannonModelFuture);
     std::shared_ptr<SceneModel> parent = std::make_shared<SceneModel>("parent", debugCanonModel);
     parent->GetTransform()->SetScale(glm::vec3(0.1f, 0.1f, 0.1f));
     m_scene.AddSceneNode(parent);
     m_parentModel = parent;
 
-    // Generate ground plane
-    std::shared_ptr<Model> planeModel = Model::GeneratePlane(m_desertLength,m_desertWidth, m_desertVertexRows, m_desertVertexCollumns);
+    // Generate ground terrain. It is square and covers the same area as the old plane, so the UVs don't change
+    assert(m_desertLength == m_desertWidth);
+    m_terrain = std::make_shared<Terrain>(m_desertLength, m_desertLevelCount);
+    std::shared_ptr<Model> planeModel = m_terrain->GetModel();
     planeModel->AddMaterial(m_desertSandMaterial);
+    for (std::shared_ptr<Material> material : { m_desertSandMaterial, m_desertSandShadowMaterial, m_desertSandFeedbackMaterial })
+    {
+        material->SetUniformValue("TerrainSize", m_terrain->GetSize());
+        material->SetUniformValue("TerrainGridSize", static_cast<float>(m_terrain->GetGridSize()));
+        material->SetUniformValue("TerrainLodDistance", m_terrain->GetLodDistance());
+        material->SetUniformValue("TerrainMorphStart", m_terrain->GetMorphStart());
+    }
     std::shared_ptr<SceneModel> plane = std::make_shared<SceneModel>("Plane", planeModel);
     m_scene.AddSceneNode(plane);
     m_desertModel = plane;
@@ -789,21 +1067,195 @@ void SandApplication::InitializeModels()
     // Load props
     m_propModels = std::make_shared<std::vector<std::shared_ptr<SceneModel>>>();
     //AddProp("Temple Ruin", "models/temple-ruin/Temple ruin.obj", loader);
+    InitializeLandmarks(loader);
+
+    UpdateTerrainHeightRange();
+    InitializeWorldStreamer(loader);
+
+    InitializeParticles();
 }
 
-std::shared_ptr<SceneModel> SandApplication::AddProp(const char* objectName, const char* modelPath, ModelLoader loader) {
-    std::shared_ptr<Material> propMaterial = GeneratePropMaterial();
+void SandApplication::InitializeWorldStreamer(const ModelLoader& loader)
+{
+    // Each type is a model loaded once in the background, the tiles draw it with the instance data of their props.
+    // The copy of the loader forgets the models it loaded with other materials
+    ModelLoader scatterLoader = loader;
+    scatterLoader.ClearShared();
+    SetLoaderReferenceMaterial(scatterLoader, m_scatterMaterial);
+    struct ScatterModel
+    {
+        const char* name;
+        const char* path;
+        float weight;
+        float minScale;
+        float maxScale;
+    };
+    const ScatterModel scatterModels[] = {
+        { "Scattered cannons", "models/cannon/cannon.obj", 1.0f, 0.03f, 0.06f },
+        { "Scattered ruins", "models/temple-ruin/Temple ruin.obj", 0.01f, 0.1f, 0.2f },
+    };
+    m_scatterTileSettings = std::make_shared<PropScatterTile::Settings>();
+    for (const ScatterModel& scatterModel : scatterModels)
+    {
+        AssetFuture<Model> model = scatterLoader.LoadAsync(scatterModel.path, m_loadQueue);
+        if (!model.valid())
+        {
+            std::cout << "ERROR::SANDAPPLICATION::SCATTER_MODEL_NOT_LOADED: " << scatterModel.path << std::endl;
+            continue;
+        }
+        m_scatterTileSettings->propTypes.push_back({ scatterModel.name, model, scatterModel.weight, scatterModel.minScale, scatterModel.maxScale });
+    }
+    m_scatterTileSettings->instanceLocation = 5;
+    m_scatterTileSettings->minDistance = m_scatterDistance;
+    m_scatterTileSettings->transform = m_desertModel->GetTransform();
+
+    // Fewer props up on the dunes than down between them
+    std::shared_ptr<const Heightfield> heightfield = m_heightfield;
+    if (!heightfield->IsEmpty())
+    {
+        float desertLength = m_desertLength;
+        m_scatterTileSettings->densityFunction = [heightfield, desertLength](const glm::vec2& position)
+            {
+                return 1.0f - 0.8f * heightfield->Sample(position / desertLength + 0.5f);
+            };
+    }
+
+    // The desert in 4 x 4 tiles, each one in 4 x 4 chunks. The tiles start at the corner of the desert
+    int tileCount = 4;
+    float tileSize = m_desertLength / tileCount;
+    m_scatterTileSettings->chunkSize = tileSize / 4;
+    glm::vec3 origin = m_desertModel->GetTransform()->GetTranslation() - glm::vec3(0.5f * m_desertLength, 0.0f, 0.5f * m_desertLength);
+    m_worldStreamer = std::make_unique<WorldStreamer>(m_scene, origin, tileSize, [this, tileSize](int tileX, int tileY)
+        {
+            glm::vec2 center = (glm::vec2(tileX, tileY) + 0.5f) * tileSize - 0.5f * m_desertLength;
+            return std::make_shared<PropScatterTile>(tileX, tileY, center, tileSize, m_scatterTileSettings, m_loadQueue);
+        });
+    m_worldStreamer->SetBounds(glm::ivec2(0), glm::ivec2(tileCount - 1));
+    m_worldStreamer->SetRadii(m_tileLoadRadius, m_tileUnloadRadius);
+    m_worldStreamer->SetLoadBudget(1, 1);
+}
 
-    // Set the generated material as reference, so that object textures are inserted correctly.
-    loader.SetReferenceMaterial(propMaterial);
+void SandApplication::InitializeParticles()
+{
+    m_particleSystem = std::make_shared<ParticleSystem>(65536);
+    m_particleSystem->SetDrag(1.5f);
+    m_particleSystem->SetRestitution(0.2f);
+    m_particleSystem->SetFriction(0.5f);
+    UpdateParticleGround();
+
+    // The particles are in world space, so the model has no transform of its own
+    std::shared_ptr<Model> particleModel = m_particleSystem->CreateModel();
+    particleModel->AddMaterial(m_particleMaterial);
+    m_scene.AddSceneNode(std::make_shared<SceneModel>("Sand spray", particleModel));
+
+    // One emitter behind each side of the player, in the space of the parent, that is scaled by 0.1.
+    // The spray goes up and back, and the faster the player goes, the more sand it throws
+    for (float side : { -1.0f, 1.0f })
+    {
+        ParticleEmitter& emitter = m_wheelEmitters.emplace_back(m_particleSystem, m_parentModel->GetTransform());
+        emitter.SetLocalPosition(glm::vec3(side * 5.0f, 1.0f, -5.0f));
+        emitter.SetLocalVelocity(glm::vec3(side * 0.3f, 1.5f, -0.5f));
+        emitter.SetRate(0.0f, 150.0f);
+        emitter.SetSpread(0.6f);
+        emitter.SetInheritVelocity(0.3f);
+        emitter.SetLifetime(0.8f, 1.6f);
+        emitter.SetSize(0.03f, 0.08f);
+    }
+}
+
+void SandApplication::UpdateParticleGround()
+{
+    if (!m_particleSystem)
+    {
+        return;
+    }
+
+    if (m_heightfield->IsEmpty())
+    {
+        m_particleSystem->SetGround(m_desertModel->GetTransform()->GetTranslation().y);
+    }
+    else
+    {
+        m_particleSystem->SetGround(m_heightfield, m_desertModel->GetTransform()->GetTranslation(), m_desertLength, m_sampleDistance, m_offsetStength);
+    }
+}
+
+void SandApplication::InitializeLandmarks(ModelLoader loader)
+{
+    // The impostors are baked from the full textures
+    loader.GetTexture2DLoader().SetStreamer(nullptr);
+
+    // Position in the desert, heading in degrees and scale
+    struct Landmark
+    {
+        const char* name;
+        const char* path;
+        glm::vec2 position;
+        float heading;
+        float scale;
+    };
+    const Landmark landmarks[] = {
+        { "Landmark cannon", "models/cannon/cannon.obj", glm::vec2(20.0f, 25.0f), 30.0f, 0.15f },
+        { "Landmark cannon 2", "models/cannon/cannon.obj", glm::vec2(-30.0f, 10.0f), 200.0f, 0.15f },
+        { "Landmark ruin", "models/temple-ruin/Temple ruin.obj", glm::vec2(-15.0f, -35.0f), 0.0f, 0.5f },
+    };
+
+    // The height is set every frame, on the sand
+    glm::vec3 center = m_desertModel->GetTransform()->GetTranslation();
+    for (const Landmark& landmark : landmarks)
+    {
+        std::shared_ptr<SceneModel> prop = AddProp(landmark.name, landmark.path, loader);
+        std::shared_ptr<Transform> transform = prop->GetTransform();
+        transform->SetTranslation(center + glm::vec3(landmark.position.x, 0.0f, landmark.position.y));
+        transform->SetRotation(glm::vec3(0.0f, glm::radians(landmark.heading), 0.0f));
+        transform->SetScale(glm::vec3(landmark.scale));
+
+        // Props of the same model share its impostor, and are drawn in the same instanced quads
+        std::shared_ptr<Model> model = prop->GetModel();
+        if (!model->GetImpostor())
+        {
+            model->SetImpostor(CreateImpostor(*model, landmark.path));
+        }
+    }
+}
+
+std::shared_ptr<Impostor> SandApplication::CreateImpostor(Model& model, const char* modelPath)
+{
+    // Baked once, then read from the cache next to the model
+    std::shared_ptr<Impostor> impostor = std::make_shared<Impostor>();
+    impostor->Bake(model, m_renderer, modelPath);
+    impostor->SetFadeRange(m_impostorFadeStart, m_impostorFadeEnd);
+
+    // Instances of the impostor materials with the atlas, the shadow map replaces the one with the other
+    std::shared_ptr<Material> material = std::make_shared<MaterialInstance>(m_impostorMaterial);
+    std::shared_ptr<Material> shadowMaterial = std::make_shared<MaterialInstance>(m_impostorShadowMaterial);
+    impostor->SetMaterialUniforms(*material);
+    impostor->SetMaterialUniforms(*shadowMaterial);
+    impostor->CreateModel(material);
+    m_materialsWithUniqueShadows->push_back(material);
+    m_uniqueShadowMaterials->push_back(shadowMaterial);
+
+    // The model dithers out over the same distances the impostor dithers in
+    for (unsigned int i = 0; i < model.GetMaterialCount(); ++i)
+    {
+        model.GetMaterial(i).SetUniformValue("ImpostorFadeRange", glm::vec2(m_impostorFadeStart, m_impostorFadeEnd));
+    }
+
+    m_impostors.push_back(impostor);
+    return impostor;
+}
+
+std::shared_ptr<SceneModel> SandApplication::AddProp(const char* objectName, const char* modelPath, ModelLoader& loader) {
+    // Set the prop material as reference, so that object textures are inserted correctly.
+    SetLoaderReferenceMaterial(loader, m_propMaterial);
     std::shared_ptr<Model> model = loader.LoadShared(modelPath);
     std::shared_ptr<SceneModel> sceneModel = std::make_shared<SceneModel>(objectName, model);
     m_propModels->push_back(sceneModel);
 
     // add prop to scene.
-    m_scene.AddSceneNode(m_propModels->at(0));
+    m_scene.AddSceneNode(sceneModel);
 
-    return m_propModels->at(0);
+    return sceneModel;
 }
 
 void SandApplication::InitializeFramebuffers()
@@ -864,9 +1316,21 @@ void SandApplication::InitializeRenderer()
             ,m_materialsWithUniqueShadows, m_uniqueShadowMaterials));
         // This volume should follow the player to render high quality shadows only near the player.
         shadowMapRenderPass->SetVolume(glm::vec3(-3.0f * m_mainLight->GetDirection()), glm::vec3(30.0f));
+        // The 512x512 shadow map doesn't show the detail, so the shadows use a coarser level
+        shadowMapRenderPass->SetLodBias(1);
         m_renderer.AddRenderPass(std::move(shadowMapRenderPass));
     }
 
+    // Feedback of the sand detail pages seen by the camera, on a small target read back a couple of frames later
+    {
+        std::shared_ptr<std::vector<std::shared_ptr<const Material>>> virtualTextureMaterials = std::make_shared<std::vector<std::shared_ptr<const Material>>>();
+        std::shared_ptr<std::vector<std::shared_ptr<const Material>>> feedbackMaterials = std::make_shared<std::vector<std::shared_ptr<const Material>>>();
+        virtualTextureMaterials->push_back(m_desertSandMaterial);
+        feedbackMaterials->push_back(m_desertSandFeedbackMaterial);
+        m_renderer.AddRenderPass(std::make_unique<VirtualTextureFeedbackPass>(m_sandDetailTexture,
+            std::max(width / m_feedbackDownscale, 1), std::max(height / m_feedbackDownscale, 1), virtualTextureMaterials, feedbackMaterials));
+    }
+
     // Set up deferred passes
     {
         std::unique_ptr<GBufferRenderPass> gbufferRenderPass(std::make_unique<GBufferRenderPass>(width, height));
@@ -936,16 +1400,13 @@ std::shared_ptr<Material> SandApplication::CreatePostFXMaterial(const char* frag
     std::vector<const char*> vertexShaderPaths;
     vertexShaderPaths.push_back("shaders/version330.glsl");
     vertexShaderPaths.push_back("shaders/renderer/fullscreen.vert");
-    Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
 
     std::vector<const char*> fragmentShaderPaths;
     fragmentShaderPaths.push_back("shaders/version330.glsl");
     fragmentShaderPaths.push_back("shaders/utils.glsl");
     fragmentShaderPaths.push_back(fragmentShaderPath);
-    Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
 
-    std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-    shaderProgramPtr->Build(vertexShader, fragmentShader);
+    std::shared_ptr<ShaderProgram> shaderProgramPtr = m_shaderLibrary.GetProgram(vertexShaderPaths, fragmentShaderPaths);
 
     // Create material
     std::shared_ptr<Material> material = std::make_shared<Material>(shaderProgramPtr);
@@ -986,29 +1447,85 @@ void SandApplication::RenderGUI()
 
     if (auto window = m_imGui.UseWindow("Shader Uniforms"))
     {
-        // For some reason Setting sampleDistance and OffsetDistance has no effect on the driveOnSand material, but it does on the shadow version...
-        if (ImGui::DragFloat("Sample distance", &m_sampleDistance, 0.001f, 0.0f, 0.1f))
+        bool sampleDistanceChanged = ImGui::DragFloat("Sample distance", &m_sampleDistance, 0.001f, 0.0f, 0.1f);
+        bool offsetStrengthChanged = ImGui::DragFloat("Offset strength", &m_offsetStength, 0.1f, 0.0f, 10.0f);
+        if ((sampleDistanceChanged || offsetStrengthChanged) && m_heightfieldBaker)
         {
-            m_desertSandMaterial->SetUniformValue("SampleDistance", m_sampleDistance);
-            m_desertSandShadowMaterial->SetUniformValue("SampleDistance", m_sampleDistance);
-            m_driveOnSandMaterial->SetUniformValue("SampleDistance", m_sampleDistance);
-            m_driveOnSandShadowMaterial->SetUniformValue("SampleDistance", m_sampleDistance);
+            m_heightfieldBaker->Bake(m_sampleDistance, m_offsetStength);
         }
-
-        if (ImGui::DragFloat("Offset strength", &m_offsetStength,0.1f, 0.0f, 10.0f))
+        if (offsetStrengthChanged)
+        {
+            UpdateTerrainHeightRange();
+            UpdateDuneTexelSize();
+        }
+        if (sampleDistanceChanged || offsetStrengthChanged)
         {
-            m_desertSandMaterial->SetUniformValue("OffsetStrength", m_offsetStength);
-            m_desertSandShadowMaterial->SetUniformValue("OffsetStrength", m_offsetStength);
-            m_driveOnSandMaterial->SetUniformValue("OffsetStrength", m_offsetStength);
-            m_driveOnSandShadowMaterial->SetUniformValue("OffsetStrength", m_offsetStength);
+            UpdateParticleGround();
+        }
+        ImGui::DragFloat("Track radius", &m_trackRadius, 0.01f, 0.0f, 5.0f);
+        ImGui::DragFloat("Track depth", &m_trackDepth, 0.01f, 0.0f, 1.0f);
+        if (m_duneSimulation)
+        {
+            if (ImGui::DragFloat("Dune ticks per second", &m_duneTickRate, 0.1f, 0.0f, 30.0f))
+            {
+                m_duneSimulation->SetTickRate(m_duneTickRate);
+            }
+            if (ImGui::DragFloat("Wind angle", &m_windAngle, 1.0f, -180.0f, 180.0f))
+            {
+                m_duneSimulation->SetWind(glm::vec2(std::cos(glm::radians(m_windAngle)), std::sin(glm::radians(m_windAngle))), m_windErosion);
+            }
+            ImGui::Text("Dune ticks: %u", m_duneSimulation->GetTickCount());
         }
 
-        if (ImGui::DragFloat("EnableFog", &m_enableFog, 0.1f, 0, 1)) {
-            m_deferredMaterial->SetUniformValue("EnableFog", m_enableFog);
+        if (ImGui::Checkbox("Fog", &m_enableFog)) {
+            m_deferredMaterial->SetKeywords(m_enableFog ? ShaderVariantSet::Fog : ShaderVariantSet::NoKeywords);
         }
 
         ImGui::InputFloat("U", &u);
         ImGui::InputFloat("V", &v);
+
+        const ShaderUniformCollection::UploadStats& uploadStats = ShaderUniformCollection::GetUploadStats();
+        ImGui::Text("Uniforms set: %u (%u bytes)", uploadStats.uniformCount, uploadStats.uniformBytes);
+        ImGui::Text("Material blocks uploaded: %u (%u bytes)", uploadStats.blockCount, uploadStats.blockBytes);
+
+        const TextureStreamer::Stats& streamingStats = m_textureStreamer.GetStats();
+        ImGui::Text("Terrain patches: %u", m_terrain->GetPatchCount());
+        unsigned int visibleProps = 0, props = 0;
+        for (const std::shared_ptr<WorldTile>& tile : m_worldStreamer->GetResidentTiles())
+        {
+            const PropScatter& propScatter = static_cast<const PropScatterTile&>(*tile).GetPropScatter();
+            visibleProps += propScatter.GetVisibleInstanceCount();
+            props += propScatter.GetInstanceCount();
+        }
+        ImGui::Text("Scattered props: %u / %u", visibleProps, props);
+        unsigned int impostorInstances = 0;
+        for (const std::shared_ptr<Impostor>& impostor : m_impostors)
+        {
+            impostorInstances += impostor->GetInstanceCount();
+        }
+        ImGui::Text("Impostors drawn: %u", impostorInstances);
+        ImGui::Text("Sand particles: %u / %u", m_particleSystem->GetParticleCount(), m_particleSystem->GetCapacity());
+
+        ImGui::Text("Streamed textures: %u (%zu / %zu KB resident)", streamingStats.textureCount, streamingStats.residentBytes >> 10, streamingStats.totalBytes >> 10);
+        ImGui::Text("Levels uploaded: %u (%zu KB), dropped: %u", streamingStats.uploadedLevels, streamingStats.uploadedBytes >> 10, streamingStats.droppedLevels);
+
+        const WorldStreamer::Stats& worldStats = m_worldStreamer->GetStats();
+        ImGui::Text("World tiles: %u resident (%zu KB), %u loading (%zu KB)", worldStats.residentTiles, worldStats.residentBytes >> 10,
+            worldStats.loadingTiles, worldStats.loadingBytes >> 10);
+        ImGui::Text("Tiles shown: %u, evicted: %u, cancelled: %u", worldStats.shownTiles, worldStats.evictedTiles, worldStats.cancelledTiles);
+        const VirtualTexture::Stats& sandDetailStats = m_sandDetailTexture->GetStats();
+        ImGui::Text("Sand detail pages: %u resident, %u loading, %u requested", sandDetailStats.residentPages, sandDetailStats.loadingPages, sandDetailStats.requestedPages);
+        ImGui::Text("Pages loaded: %u, evicted: %u", sandDetailStats.loadedPages, sandDetailStats.evictedPages);
+        if (ImGui::DragFloat("Tile load radius", &m_tileLoadRadius, 1.0f, 0.0f, 100.0f))
+        {
+            m_tileUnloadRadius = std::max(m_tileUnloadRadius, m_tileLoadRadius);
+            m_worldStreamer->SetRadii(m_tileLoadRadius, m_tileUnloadRadius);
+        }
+        if (ImGui::DragFloat("Tile unload radius", &m_tileUnloadRadius, 1.0f, 0.0f, 150.0f))
+        {
+            m_tileLoadRadius = std::min(m_tileLoadRadius, m_tileUnloadRadius);
+            m_worldStreamer->SetRadii(m_tileLoadRadius, m_tileUnloadRadius);
+        }
     }
     
 
@@ -6,10 +6,25 @@
 #include <ituGL/scene/SceneModel.h>
 #include <ituGL/texture/FramebufferObject.h>
 #include <ituGL/renderer/Renderer.h>
+#include <ituGL/renderer/Impostor.h>
 #include <ituGL/camera/CameraController.h>
 #include <ituGL/utils/DearImGui.h>
 #include <array>
 #include <ituGL/asset/ModelLoader.h>
+#include <ituGL/asset/ShaderLibrary.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <ituGL/texture/TextureStreamer.h>
+#include <ituGL/texture/VirtualTexture.h>
+#include <ituGL/asset/TextureCache.h>
+#include <ituGL/geometry/Terrain.h>
+#include <ituGL/geometry/Heightfield.h>
+#include <ituGL/geometry/HeightfieldBaker.h>
+#include <ituGL/geometry/HeightfieldDeformer.h>
+#include <ituGL/geometry/DuneSimulation.h>
+#include <ituGL/scene/WorldStreamer.h>
+#include <ituGL/scene/PropScatterTile.h>
+#include <ituGL/particles/ParticleSystem.h>
+#include <ituGL/particles/ParticleEmitter.h>
 
 class Texture2DObject;
 class TextureCubemapObject;
@@ -34,8 +49,26 @@ private:
     void InitializeModels();
     void InitializeFramebuffers();
     void InitializeRenderer();
-    std::shared_ptr<SceneModel> AddProp(const char* objectName, const char* modelPath, ModelLoader loader);
-    std::shared_ptr<Material> GeneratePropMaterial();
+    // Make the loader create instances of the material, with the vertex attributes and properties linked to its shader
+    void SetLoaderReferenceMaterial(ModelLoader& loader, std::shared_ptr<Material> referenceMaterial);
+
+    // Load the prop with the prop material. Props of the same model share it, and the loader keeps it
+    std::shared_ptr<SceneModel> AddProp(const char* objectName, const char* modelPath, ModelLoader& loader);
+
+    // Big props placed around the desert, drawn as impostors far away
+    void InitializeLandmarks(ModelLoader loader);
+
+    // Bake the impostor of the model, and fade the model to it
+    std::shared_ptr<Impostor> CreateImpostor(Model& model, const char* modelPath);
+
+    // Scatter instances of the prop models over the desert
+    void InitializeWorldStreamer(const ModelLoader& loader);
+
+    // Sand thrown up by the wheels of the player
+    void InitializeParticles();
+
+    // Collide the particles with the same surface as the terrain
+    void UpdateParticleGround();
 
     std::shared_ptr<Material> CreatePostFXMaterial(const char* fragmentShaderPath, std::shared_ptr<Texture2DObject> sourceTexture = nullptr);
 
@@ -46,6 +79,28 @@ private:
     void MakeCameraFollowPlayer();
     void HandlePlayerMovement();
 
+    // Put the player and the props on the displaced sand, with one batched heightfield query for all of them
+    void PlaceObjectsOnSurface();
+
+    // Press the tracks of the player into the sand, and update the baked texture where the sand changed
+    void DeformSand();
+
+    // Publish the dunes moved by the wind, under the tracks, and update the baked texture there
+    void MoveDunes();
+
+    // Size of a texel of the displacement map in heightfield values, for the slopes of the dunes
+    void UpdateDuneTexelSize();
+
+    // Position of the point in the UV space of the desert displacement map
+    glm::vec2 GetDesertUV(const glm::vec3& position) const;
+
+    // Cull the terrain patches with the heights the displacement map can actually reach
+    void UpdateTerrainHeightRange();
+
+    // Fill a page of the sand detail from the normal map. Called on the workers
+    static void FillSandDetailPage(const TextureCache::CachedTexture& normalMap, float desertLength, float tileSize,
+        const VirtualTexture::PageRequest& request, std::span<uint32_t> texels);
+
 private:
     // Helper object for debug GUI
     DearImGui m_imGui;
@@ -59,6 +114,18 @@ private:
     // Renderer
     Renderer m_renderer;
 
+    // Shared shaders and programs, loaded once
+    ShaderLibrary m_shaderLibrary;
+
+    // Sand textures converted and compressed on the first run
+    TextureCache m_textureCache;
+
+    // Streams the mip levels of the prop textures
+    TextureStreamer m_textureStreamer;
+
+    // Loads textures and models in the background. Declared after the streamer, its pending uploads use it
+    AssetLoadQueue m_loadQueue;
+
     // Skybox texture
     std::shared_ptr<TextureCubemapObject> m_skyboxTexture;
 
@@ -77,17 +144,46 @@ private:
 
     std::shared_ptr<Material> m_desertSandMaterial;
     std::shared_ptr<Material> m_desertSandShadowMaterial;
+    // Writes the pages of the sand detail seen by the camera
+    std::shared_ptr<Material> m_desertSandFeedbackMaterial;
+
+    // Detail of the sand, different over the whole desert, with only the pages that are seen in memory
+    std::shared_ptr<VirtualTexture> m_sandDetailTexture;
+    // The feedback is drawn this many times smaller than the screen
+    int m_feedbackDownscale = 8;
 
     std::shared_ptr<Material> m_driveOnSandMaterial;
     std::shared_ptr<Material> m_driveOnSandShadowMaterial;
 
     // Decoration Object materials
-    // The shader program is the same as the driveOnSand material, the uniform properties are assigned different textures
-    std::shared_ptr<std::vector<std::shared_ptr<const Material>>> m_propMaterials;
-    std::shared_ptr<std::vector<std::shared_ptr<const Material>>> m_propShadowMaterials;
+    // All the props share the program, the materials created by the model loader are instances with their own textures
+    std::shared_ptr<Material> m_propMaterial;
+    // Scattered props, drawn instanced, and their shadow map replacement
+    std::shared_ptr<Material> m_scatterMaterial;
+    std::shared_ptr<Material> m_scatterShadowMaterial;
+    // Impostor quads, and their shadow map replacement. Each impostor has instances of them with its own atlas
+    std::shared_ptr<Material> m_impostorMaterial;
+    std::shared_ptr<Material> m_impostorShadowMaterial;
     
     // Prop stuff
     std::shared_ptr<std::vector<std::shared_ptr<SceneModel>>> m_propModels;
+    // Impostors of the landmarks, and the distances where the models fade to them
+    std::vector<std::shared_ptr<Impostor>> m_impostors;
+    float m_impostorFadeStart = 15.0f;
+    float m_impostorFadeEnd = 20.0f;
+    // Props scattered over the desert in tiles, loaded around the player and evicted behind it. Each tile has its own
+    // models, one scene model per type sharing the transform of the desert
+    std::unique_ptr<WorldStreamer> m_worldStreamer;
+    std::shared_ptr<PropScatterTile::Settings> m_scatterTileSettings;
+    float m_scatterDistance = 0.5f;
+    float m_tileLoadRadius = 20.0f;
+    float m_tileUnloadRadius = 30.0f;
+
+    // Sand spray, simulated on the CPU and drawn as billboards, and its shadow map replacement
+    std::shared_ptr<Material> m_particleMaterial;
+    std::shared_ptr<Material> m_particleShadowMaterial;
+    std::shared_ptr<ParticleSystem> m_particleSystem;
+    std::vector<ParticleEmitter> m_wheelEmitters;
 
 
     // Framebuffers
@@ -110,11 +206,25 @@ private:
     std::shared_ptr<Texture2DObject> m_displacementMap;
     float m_sampleDistance = 0.2f;
     float m_offsetStength = 2.0f;
-    float m_enableFog = 0.0f;
+    bool m_enableFog = false;
     float m_desertWidth = 100;
     float m_desertLength = 100;
-    float m_desertVertexRows = 100;
-    float m_desertVertexCollumns = 100;
+    // Number of patch sizes of the terrain, the smallest patches are m_desertLength / 2^(levels-1) wide
+    int m_desertLevelCount = 4;
+    std::shared_ptr<Terrain> m_terrain;
+    // CPU copy of the displacement map, sampled like the shaders do
+    std::shared_ptr<Heightfield> m_heightfield = std::make_shared<Heightfield>();
+    // Bakes the height and normal texture read by the terrain shader
+    std::unique_ptr<HeightfieldBaker> m_heightfieldBaker;
+    // Tracks of the player in the heightfield, that relax over time
+    std::unique_ptr<HeightfieldDeformer> m_sandDeformer;
+    float m_trackRadius = 1.0f;
+    float m_trackDepth = 0.15f;
+    // Dunes moved by the wind, simulated on the workers
+    std::unique_ptr<DuneSimulation> m_duneSimulation;
+    float m_duneTickRate = 4.0f;
+    float m_windAngle = 30.0f;
+    float m_windErosion = 0.002f;
 
 
 
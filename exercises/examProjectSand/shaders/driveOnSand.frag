@@ -10,16 +10,29 @@ layout (location = 1) out vec2 FragNormal;
 layout (location = 2) out vec4 FragOthers;
 
 //Uniforms
-uniform vec3 Color;
+layout(std140) uniform MaterialBlock
+{
+    vec3 Color;
+};
 uniform sampler2D ColorTexture;
 uniform sampler2D NormalTexture;
 uniform sampler2D SpecularTexture;
 
+#ifdef SHADOW_PASS
+// Shadow maps only need depth
+void main()
+{
+}
+#else
 void main()
 {
 	FragAlbedo = vec4(Color.rgb * texture(ColorTexture, TexCoord).rgb, 1);
 
+#ifdef NORMAL_MAP
 	vec3 viewNormal = SampleNormalMap(NormalTexture, TexCoord, normalize(ViewNormal), normalize(ViewTangent), normalize(ViewBitangent));
+#else
+	vec3 viewNormal = normalize(ViewNormal);
+#endif
 	FragNormal = viewNormal.xy;
 
 	// hardcode metal metalness etc. since we don't have a texture for that.
@@ -27,3 +40,4 @@ void main()
 	//FragOthers = vec4(0, 0.8f, 0.3f, 0); Good base values
 	FragOthers = texture(SpecularTexture, TexCoord);
 }
+#endif
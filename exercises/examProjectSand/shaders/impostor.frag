@@ -0,0 +1,71 @@
+//Inputs
+layout (location = 0) in vec2 FrameTexCoord;
+layout (location = 1) flat in vec2 Frame;
+layout (location = 2) flat in float Fade;
+layout (location = 3) flat in float ViewRadius;
+layout (location = 4) in vec3 ViewPosition;
+layout (location = 5) flat in mat3 FrameToViewMatrix;
+
+//Outputs
+layout (location = 0) out vec4 FragAlbedo;
+layout (location = 1) out vec2 FragNormal;
+layout (location = 2) out vec4 FragOthers;
+
+//Uniforms
+uniform mat4 ProjMatrix;
+
+uniform sampler2D ImpostorAlbedoTexture; // Coverage in alpha
+uniform sampler2D ImpostorNormalTexture; // In the view space of the frame
+uniform sampler2D ImpostorOthersTexture;
+uniform sampler2D ImpostorDepthTexture; // Linear, from the front of the sphere to the back
+uniform float ImpostorFrameCount;
+
+// Position in the atlas. Outside the frame, the quad shows nothing
+vec2 GetAtlasTexCoord()
+{
+	if (any(lessThan(FrameTexCoord, vec2(0))) || any(greaterThan(FrameTexCoord, vec2(1))))
+		discard;
+	return (Frame + FrameTexCoord) / ImpostorFrameCount;
+}
+
+// Move the pixel from the quad to the surface of the model
+void WriteDepth(vec2 texCoord)
+{
+	float depth = textureLod(ImpostorDepthTexture, texCoord, 0).r;
+	vec3 viewPosition = ViewPosition;
+	viewPosition.z += (1 - 2 * depth) * ViewRadius;
+	vec4 clipPosition = ProjMatrix * vec4(viewPosition, 1);
+	gl_FragDepth = clipPosition.z / clipPosition.w * 0.5f + 0.5f;
+}
+
+#ifdef SHADOW_PASS
+// The model casts the shadows until it is replaced completely, see Renderer::AddModel
+void main()
+{
+	vec2 texCoord = GetAtlasTexCoord();
+	if (Fade < 1 || textureLod(ImpostorAlbedoTexture, texCoord, 0).a < 0.5f)
+		discard;
+
+	WriteDepth(texCoord);
+}
+#else
+void main()
+{
+	vec2 texCoord = GetAtlasTexCoord();
+
+	// Pixels of the model are drawn where the impostor is not, see prop.frag
+	vec4 albedo = texture(ImpostorAlbedoTexture, texCoord);
+	if (albedo.a < 0.5f || GetDitherThreshold(gl_FragCoord.xy) >= Fade)
+		discard;
+
+	WriteDepth(texCoord);
+
+	// The texels around the model are zero, and darken the filtered values at its edges
+	FragAlbedo = vec4(albedo.rgb / albedo.a, 1);
+
+	vec3 frameNormal = GetImplicitNormal(texture(ImpostorNormalTexture, texCoord).xy / albedo.a);
+	FragNormal = normalize(FrameToViewMatrix * frameNormal).xy;
+
+	FragOthers = texture(ImpostorOthersTexture, texCoord) / albedo.a;
+}
+#endif
@@ -0,0 +1,75 @@
+//Inputs
+layout (location = 0) in vec2 Corner; // In [-1, 1] on the quad
+layout (location = 1) in mat4 InstanceWorldMatrix; // World matrix of the model the impostor replaces
+layout (location = 5) in float InstanceFade; // Fraction of the pixels drawn by the impostor
+
+//Outputs
+layout (location = 0) out vec2 FrameTexCoord; // In [0, 1] inside the frame
+layout (location = 1) flat out vec2 Frame;
+layout (location = 2) flat out float Fade;
+layout (location = 3) flat out float ViewRadius;
+layout (location = 4) out vec3 ViewPosition;
+layout (location = 5) flat out mat3 FrameToViewMatrix; // From the view space of the frame to the view space of the camera
+
+//Uniforms
+uniform mat4 ViewMatrix;
+uniform mat4 ProjMatrix;
+
+uniform float ImpostorFrameCount;
+uniform vec3 ImpostorCenter;
+uniform float ImpostorRadius;
+
+// Up vector of the camera of a frame, the same as in Impostor.cpp
+vec3 GetFrameUp(vec3 direction)
+{
+	return abs(direction.y) > 0.999f ? vec3(0, 0, -1) : vec3(0, 1, 0);
+}
+
+// Direction to the camera of the frame, with the hemi-octahedral mapping of Impostor::GetFrameDirection
+vec3 GetFrameDirection(vec2 frame)
+{
+	vec2 octahedral = frame / (ImpostorFrameCount - 1) * 2 - 1;
+	vec2 xz = 0.5f * vec2(octahedral.x + octahedral.y, octahedral.x - octahedral.y);
+	return normalize(vec3(xz.x, 1 - abs(xz.x) - abs(xz.y), xz.y));
+}
+
+// Frame closest to the direction. From below, the frames of the horizon are the closest
+vec2 GetFrame(vec3 direction)
+{
+	direction.y = max(direction.y, 0);
+	direction /= max(abs(direction.x) + direction.y + abs(direction.z), 1e-5f);
+	vec2 octahedral = vec2(direction.x + direction.z, direction.x - direction.z);
+	return clamp(round((octahedral * 0.5f + 0.5f) * (ImpostorFrameCount - 1)), vec2(0), vec2(ImpostorFrameCount - 1));
+}
+
+void main()
+{
+	// Models are scaled uniformly
+	mat3 worldRotation = mat3(InstanceWorldMatrix);
+	float worldScale = length(worldRotation[0]);
+	vec3 worldCenter = (InstanceWorldMatrix * vec4(ImpostorCenter, 1)).xyz;
+	vec3 cameraPosition = GetCameraPosition(ViewMatrix);
+
+	// Pick the frame looking from the camera, in model space
+	vec3 cameraDirection = transpose(worldRotation) * (cameraPosition - worldCenter);
+	Frame = GetFrame(cameraDirection);
+	vec3 frameDirection = GetFrameDirection(Frame);
+	vec3 frameRight = normalize(cross(GetFrameUp(frameDirection), frameDirection));
+	vec3 frameUp = cross(frameDirection, frameRight);
+
+	// Quad facing the camera, covering the sphere of the frames
+	ViewRadius = ImpostorRadius * worldScale;
+	ViewPosition = (ViewMatrix * vec4(worldCenter, 1)).xyz + vec3(Corner * ViewRadius, 0);
+	gl_Position = ProjMatrix * vec4(ViewPosition, 1);
+
+	// Where the ray from the camera through the corner crosses the plane of the frame, in model space
+	vec3 worldPosition = (inverse(ViewMatrix) * vec4(ViewPosition, 1)).xyz;
+	vec3 planeNormal = normalize(worldRotation * frameDirection);
+	vec3 ray = worldPosition - cameraPosition;
+	float rayDistance = dot(worldCenter - cameraPosition, planeNormal) / min(dot(ray, planeNormal), -1e-5f);
+	vec3 framePosition = transpose(worldRotation) * (cameraPosition + ray * rayDistance - worldCenter) / (worldScale * worldScale);
+	FrameTexCoord = vec2(dot(framePosition, frameRight), dot(framePosition, frameUp)) / ImpostorRadius * 0.5f + 0.5f;
+
+	FrameToViewMatrix = mat3(ViewMatrix) * worldRotation * mat3(frameRight, frameUp, frameDirection) / worldScale;
+	Fade = InstanceFade;
+}
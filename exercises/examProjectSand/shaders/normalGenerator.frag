@@ -12,20 +12,30 @@ layout (location = 2) out vec4 FragOthers;
 // Create another framebuffer for the celshading.
 
 //Uniforms
-uniform vec3 Color;
-uniform sampler2D NormalTexture;
+layout(std140) uniform MaterialBlock
+{
+    vec3 Color;
+};
 uniform sampler2D SpecularTexture;
-uniform vec2 ObjectSize; // world size of the two lengths of the plane
-uniform float TileSize;
 
+#ifdef SHADOW_PASS
+// Shadow maps only need depth
+void main()
+{
+}
+#elif defined(VIRTUAL_FEEDBACK)
+// Write the page of the sand detail that the pixel needs
+void main()
+{
+	FragAlbedo = GetVirtualFeedback(TexCoord);
+}
+#else
 void main()
 {	
 
-	// Read normalTexture
-	// Multiply texcoord with world size to get a tiling texture.
-	float u = mod(TexCoord.x * ObjectSize.x / TileSize, 1);
-	float v = mod(TexCoord.y * ObjectSize.y / TileSize, 1);
-	vec2 normalMap = texture(NormalTexture, vec2(u,v)).xy * 2 - vec2(1);
+	// Read the sand detail, unique over the whole desert: xy is the normal map and z the brightness
+	vec4 detail = SampleVirtualTexture(TexCoord);
+	vec2 normalMap = detail.xy * 2 - vec2(1);
 
 	// Get implicit Z component
 	vec3 normalTangentSpace = GetImplicitNormal(normalMap);
@@ -47,7 +57,7 @@ void main()
 	vec3 combinedNormal =  normalize(vec3(screenSpaceMapNormal.x + ViewNormal.x, screenSpaceMapNormal.y + ViewNormal.y, ViewNormal.z));
 	FragNormal = combinedNormal.xy;
 
-	FragAlbedo = vec4(Color, 1);
+	FragAlbedo = vec4(Color * (0.75f + 0.5f * detail.z), 1);
 
 	FragOthers = vec4(1,0.5,0,1);
 
@@ -62,4 +72,5 @@ void main()
 
 	// Combine normals with the UDN method
 	// vec3 combinedNormal =  normalize(float3(n1.xy + n2.xy, n1.z));	
-}
\ No newline at end of file
+}
+#endif
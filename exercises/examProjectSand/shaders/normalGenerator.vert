@@ -33,6 +33,8 @@ void main()
 
 	gl_Position = WorldViewProjMatrix * vec4(VertexPosition + vertexOffsetVector, 1.0);
 
+#ifndef SHADOW_PASS
+	// The shadow pass only needs the position, skip the extra samples for the tangent space
 	vec3 tangent;
 	vec3 bitangent;
 	vec3 normal;
@@ -42,6 +44,7 @@ void main()
 	ViewTangent = (WorldViewMatrix * vec4(tangent, 0.0)).xyz;
 	ViewBitangent = (WorldViewMatrix * vec4(bitangent, 0.0)).xyz;
 	ViewNormal = (WorldViewMatrix * vec4(normal, 0.0)).xyz;
+#endif
 
 	// Move Sample Distance to method paramter.
 }
@@ -0,0 +1,49 @@
+//Inputs
+layout (location = 0) in vec2 TexCoord;
+layout (location = 1) in float Age;
+
+//Outputs
+layout (location = 0) out vec4 FragAlbedo;
+layout (location = 1) out vec2 FragNormal;
+layout (location = 2) out vec4 FragOthers;
+
+//Uniforms
+layout(std140) uniform MaterialBlock
+{
+    vec3 Color;
+};
+
+// The g-buffer can't blend, so the particles fade out by discarding more pixels, in a fixed dither pattern
+bool IsDiscarded()
+{
+	float radiusSquared = dot(TexCoord, TexCoord);
+	float alpha = (1.0 - radiusSquared) * (1.0 - Age);
+
+	const float bayer[16] = float[](0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5);
+	ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+	float threshold = (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+	return alpha <= threshold;
+}
+
+#ifdef SHADOW_PASS
+// Shadow maps only need depth, with the same pixels as the particles
+void main()
+{
+	if (IsDiscarded())
+		discard;
+}
+#else
+void main()
+{
+	if (IsDiscarded())
+		discard;
+
+	FragAlbedo = vec4(Color, 1);
+
+	// Round like a small ball of sand, facing the camera
+	FragNormal = TexCoord * 0.7;
+
+	// ambientOcclusion, metalness, roughness
+	FragOthers = vec4(1, 0, 0.9, 0);
+}
+#endif
@@ -0,0 +1,25 @@
+//Inputs
+layout (location = 0) in vec2 Corner;       // In [-0.5, 0.5] on the quad
+layout (location = 1) in vec4 ParticleData; // World position and size, from ParticleSystem. One per instance
+layout (location = 2) in float ParticleAge; // Age relative to the lifetime, in [0, 1]
+
+//Outputs
+layout (location = 0) out vec2 TexCoord;   // Corner, in [-1, 1]
+layout (location = 1) out float Age;
+
+//Uniforms
+uniform mat4 WorldViewMatrix; // converts from world space to view space
+uniform mat4 ProjMatrix; // Converts from view space to clip space
+
+void main()
+{
+	TexCoord = Corner * 2.0;
+	Age = ParticleAge;
+
+	// Grow slightly while the sand spreads out. In the shadow pass the view is the light, so the billboards face it
+	float size = ParticleData.w * (0.5 + ParticleAge);
+	vec3 viewPosition = (WorldViewMatrix * vec4(ParticleData.xyz, 1.0)).xyz;
+	viewPosition.xy += Corner * size;
+
+	gl_Position = ProjMatrix * vec4(viewPosition, 1.0);
+}
@@ -5,6 +5,9 @@ layout (location = 1) in vec3 VertexNormal;
 layout (location = 2) in vec3 VertexTangent;
 layout (location = 3) in vec3 VertexBitangent;
 layout (location = 4) in vec2 VertexTexCoord;
+#ifdef INSTANCED
+layout (location = 5) in vec4 InstanceData; // Position x and z, rotation around Y and scale, from PropScatter. One per instance
+#endif
 
 //Outputs
 layout (location = 0) out vec3 ViewNormal;
@@ -15,12 +18,13 @@ layout (location = 3) out vec2 TexCoord;   // UV
 //Uniforms
 uniform mat4 WorldViewMatrix; // converts from world space to view space
 uniform mat4 WorldViewProjMatrix; // Converts from world space to clip space
-uniform float OffsetStrength;
-uniform float SampleDistance;
-uniform sampler2D DepthMap;
-uniform vec3 PivotPosition; // position of pivot in world position
-uniform vec2 DesertUV; // position of pivot in desert UV space.
-uniform vec3 Right;
+
+#ifdef INSTANCED
+// The instances are placed in the space of the terrain, and stand on the same baked height
+uniform sampler2D HeightNormalMap; // Baked by HeightfieldBaker: height of GetHeightFromSample in r, normal in gba
+uniform float TerrainSize;
+uniform float SurfaceOffset; // Added to the height, so the props sink slightly into the sand
+#endif
 
 void main()
 {
@@ -29,23 +33,30 @@ void main()
 	// texture coordinates
 	TexCoord = VertexTexCoord;
 
-	// ------- Vertex position --------
-	// Add the height map sample at the center of the mdoel to every vertex
-	// final vertex position (for opengl rendering, *AND* for lighting)
-	// This is the UV position of the pivot of the player object on the desert. Thus, the same height is retreived for all vertexes.
-	float vertexOffset = GetHeightFromSample(DesertUV, DepthMap, SampleDistance, OffsetStrength);
-
-	vec3 vertexOffsetVector = vec3(0, vertexOffset -0.1f, 0);
-
-	gl_Position = WorldViewProjMatrix * vec4(VertexPosition + vertexOffsetVector, 1.0);
-
-	vec3 at = Right;  
-
-
+#ifdef INSTANCED
+	// Rotate around Y and scale, then move to the instance position on the sand
+	float rotationSin = sin(InstanceData.z);
+	float rotationCos = cos(InstanceData.z);
+	mat3 rotation = mat3(rotationCos, 0, -rotationSin, 0, 1, 0, rotationSin, 0, rotationCos);
+	float height = textureLod(HeightNormalMap, InstanceData.xy / TerrainSize + 0.5, 0).r + SurfaceOffset;
+	vec3 position = rotation * VertexPosition * InstanceData.w + vec3(InstanceData.x, height, InstanceData.y);
+	vec3 normal = rotation * VertexNormal;
+	vec3 tangent = rotation * VertexTangent;
+	vec3 bitangent = rotation * VertexBitangent;
+#else
+	// The height of the prop on the sand is computed once per frame on the CPU, with the same sampling
+	// as depthMapUtils.glsl, and is already part of the world matrix
+	vec3 position = VertexPosition;
+	vec3 normal = VertexNormal;
+	vec3 tangent = VertexTangent;
+	vec3 bitangent = VertexBitangent;
+#endif
 
+	// ------- Vertex position --------
+	gl_Position = WorldViewProjMatrix * vec4(position, 1.0);
 
 	// Convert normal and tangents from world space to view space
-	ViewTangent = (WorldViewMatrix * vec4(VertexTangent, 0.0)).xyz;
-	ViewBitangent = (WorldViewMatrix * vec4(VertexBitangent, 0.0)).xyz;
-	ViewNormal = (WorldViewMatrix * vec4(VertexNormal, 0.0)).xyz;
+	ViewTangent = (WorldViewMatrix * vec4(tangent, 0.0)).xyz;
+	ViewBitangent = (WorldViewMatrix * vec4(bitangent, 0.0)).xyz;
+	ViewNormal = (WorldViewMatrix * vec4(normal, 0.0)).xyz;
 }
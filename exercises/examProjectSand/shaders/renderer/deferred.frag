@@ -16,7 +16,6 @@ uniform mat4 InvProjMatrix;
 
 // fog stuff
 uniform vec3 FadeColor;
-uniform float EnableFog;
 
 void main()
 {
@@ -45,6 +44,7 @@ void main()
 	// Compute lighting
 	vec3 lighting = ComputeLighting(position, data, viewDir, true);
 
+#ifdef FOG
 	// Add dust fade to final color after lighting
 	// Camera Clipping planes
 	float near = 0.1;
@@ -63,8 +63,9 @@ void main()
 	powerDepth = max(0.1f, powerDepth);
 
 	
-	// Add uniform bool/int multiplied to powerDepth to enable/disable fog during playtest.
-	vec3 fadedLight = mix(lighting, FadeColor, powerDepth * EnableFog);
+	// The FOG variant of the shader is selected to enable/disable fog during playtest.
+	lighting = mix(lighting, FadeColor, powerDepth);
+#endif
 
-	FragColor = vec4(fadedLight, 1.0f);
+	FragColor = vec4(lighting, 1.0f);
 }
@@ -0,0 +1,66 @@
+//Inputs
+layout (location = 0) in vec2 GridPosition; // In [0, 1] inside the patch
+layout (location = 1) in vec4 PatchData;    // Corner x and z, size and level of the patch, in model space. One per instance
+
+//Outputs
+layout (location = 0) out vec3 ViewNormal;
+layout (location = 1) out vec3 ViewTangent;
+layout (location = 2) out vec3 ViewBitangent;
+layout (location = 3) out vec2 TexCoord;   // UV
+
+//Uniforms
+uniform mat4 WorldViewMatrix; // converts from world space to view space
+uniform mat4 WorldViewProjMatrix; // Converts from world space to clip space
+uniform sampler2D HeightNormalMap; // Baked by HeightfieldBaker: height of GetHeightFromSample in r, normal in gba
+
+// Terrain parameters, they must match the ones of the Terrain class
+uniform float TerrainSize;
+uniform float TerrainGridSize;
+uniform float TerrainLodDistance;
+uniform float TerrainMorphStart;
+uniform vec3 TerrainViewPosition; // Camera position the patches were selected for, in model space
+
+// Same mapping as the plane the terrain replaces: the whole depth map covers the terrain once
+vec2 GetTerrainUV(vec2 position)
+{
+	return position / TerrainSize + 0.5;
+}
+
+void main()
+{
+	float patchSize = PatchData.z;
+	vec2 position = PatchData.xy + GridPosition * patchSize;
+
+	// Morph the odd vertices onto the grid of the next level near the end of the range of this one,
+	// so the patches match their bigger neighbours without cracks and the level changes don't pop
+	float height = texture(HeightNormalMap, GetTerrainUV(position)).r;
+	float morphEnd = TerrainLodDistance * exp2(PatchData.w);
+	float morphStart = morphEnd * TerrainMorphStart;
+	float morph = clamp((distance(TerrainViewPosition, vec3(position.x, height, position.y)) - morphStart) / (morphEnd - morphStart), 0.0, 1.0);
+	vec2 oddOffset = fract(GridPosition * TerrainGridSize * 0.5) * 2.0 / TerrainGridSize;
+	position -= oddOffset * patchSize * morph;
+
+	// texture coordinates
+	TexCoord = GetTerrainUV(position);
+
+	// ------- Vertex position --------
+
+	// final vertex position (for opengl rendering, *AND* for lighting)
+	vec4 heightNormal = texture(HeightNormalMap, TexCoord);
+	float vertexOffset = heightNormal.r;
+
+	gl_Position = WorldViewProjMatrix * vec4(position.x, vertexOffset, position.y, 1.0);
+
+#ifndef SHADOW_PASS
+	// The shadow pass only needs the position. The tangent of GetTangentSpaceVectorsFromSample is always +Z on the map,
+	// so the frame is rebuilt from the baked normal the same way
+	vec3 normal = normalize(heightNormal.gba);
+	vec3 tangent = vec3(0, 0, 1);
+	vec3 bitangent = normalize(cross(normal, tangent));
+
+	// Convert normal and tangents from world space to view space
+	ViewTangent = (WorldViewMatrix * vec4(tangent, 0.0)).xyz;
+	ViewBitangent = (WorldViewMatrix * vec4(bitangent, 0.0)).xyz;
+	ViewNormal = (WorldViewMatrix * vec4(normal, 0.0)).xyz;
+#endif
+}
@@ -71,6 +71,14 @@ vec3 ReconstructViewPosition(sampler2D depthTexture, vec2 texCoord, mat4 invProj
 	return viewPosition.xyz / viewPosition.w;
 }
 
+// Threshold of an ordered 4x4 dither for the pixel, in (0, 1). Pixels below a fraction are about that fraction of all
+float GetDitherThreshold(vec2 fragCoord)
+{
+	const float bayer[16] = float[](0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5);
+	ivec2 pixel = ivec2(fragCoord) & 3;
+	return (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+}
+
 float GetLuminance(vec3 color)
 {
    return dot(color, vec3(0.2126f, 0.7152f, 0.0722f));
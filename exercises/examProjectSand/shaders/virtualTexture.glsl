@@ -0,0 +1,45 @@
+// Virtual texture: the page table has one texel per page, (slot x, slot y, level of the page, 255), and points to the
+// closest resident page. The pages are in slots of the atlas, with a border of texels around them
+uniform sampler2D VirtualPageTable;
+uniform sampler2D VirtualAtlas;
+uniform float VirtualPageCount; // pages per side of the first level
+uniform float VirtualPageSize; // texels per side of a page, without the border
+uniform float VirtualBorder;
+uniform float VirtualAtlasSize; // texels per side of the atlas
+uniform float VirtualLevelCount;
+uniform float VirtualLevelBias; // negative when the feedback is drawn smaller than the screen
+
+// Level of the virtual texture with about one texel per pixel
+float GetVirtualLevel(vec2 uv)
+{
+	vec2 texel = uv * VirtualPageCount * VirtualPageSize;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5f * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8f)) + VirtualLevelBias;
+	return clamp(floor(lod), 0, VirtualLevelCount - 1);
+}
+
+// Bilinear sample of the best resident page for the level
+vec4 SampleVirtualTexture(vec2 uv)
+{
+	uv = clamp(uv, vec2(0), vec2(0.99999f));
+	float level = GetVirtualLevel(uv);
+
+	vec3 entry = floor(textureLod(VirtualPageTable, uv, level).xyz * 255 + 0.5f);
+
+	// Position inside the page, of the level that is resident
+	vec2 pageUV = fract(uv * VirtualPageCount / exp2(entry.z));
+
+	float slotSize = VirtualPageSize + 2 * VirtualBorder;
+	vec2 atlasUV = (entry.xy * slotSize + VirtualBorder + pageUV * VirtualPageSize) / VirtualAtlasSize;
+	return textureLod(VirtualAtlas, atlasUV, 0);
+}
+
+// Page needed by the pixel, to write in the feedback pass
+vec4 GetVirtualFeedback(vec2 uv)
+{
+	uv = clamp(uv, vec2(0), vec2(0.99999f));
+	float level = GetVirtualLevel(uv);
+	vec2 page = floor(uv * VirtualPageCount / exp2(level));
+	return vec4(page, level, 255) / 255;
+}
@@ -0,0 +1,196 @@
+// Checks that HeightfieldBaker::BakeRegion gives, at every texel center, what the sand shaders compute on the GPU.
+// The reference is a plain scalar transcription of GetHeightFromSample and GetTangentSpaceVectorsFromSample
+// (shaders/depthMapUtils.glsl of examProjectSand), sampling the map like texture() does with GL_LINEAR and GL_CLAMP_TO_EDGE.
+// It doesn't need a GL context. Returns 0 if all the texels match
+
+#include <ituGL/geometry/Heightfield.h>
+#include <ituGL/geometry/HeightfieldBaker.h>
+#include <glm/gtc/packing.hpp>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// The baked values are half floats: they can differ from the reference by one half float ulp, 2^-10 relative.
+// Near zero, where half floats lose precision, the single precision differences of the filters dominate, so 2^-14 absolute
+const float RelativeTolerance = 1.0f / 1024.0f;
+const float AbsoluteTolerance = 1.0f / 16384.0f;
+
+// The map, as the texture the shaders sample
+struct DepthMap
+{
+    int width;
+    int height;
+    std::vector<unsigned char> texels;
+};
+
+// texture(depthMap, uv).r with bilinear filtering and clamp to edge, on the only level
+float texture(const DepthMap& depthMap, glm::vec2 uv)
+{
+    float x = uv.x * depthMap.width - 0.5f;
+    float y = uv.y * depthMap.height - 0.5f;
+    float x0 = std::floor(x);
+    float y0 = std::floor(y);
+    float alpha = x - x0;
+    float beta = y - y0;
+
+    auto texel = [&](float tx, float ty)
+    {
+        int i = std::clamp(static_cast<int>(tx), 0, depthMap.width - 1);
+        int j = std::clamp(static_cast<int>(ty), 0, depthMap.height - 1);
+        return depthMap.texels[static_cast<size_t>(j) * depthMap.width + i] / 255.0f;
+    };
+
+    float bottom = (1 - alpha) * texel(x0, y0) + alpha * texel(x0 + 1, y0);
+    float top = (1 - alpha) * texel(x0, y0 + 1) + alpha * texel(x0 + 1, y0 + 1);
+    return (1 - beta) * bottom + beta * top;
+}
+
+float Ease(float value)
+{
+    return value;
+}
+
+float GetHeightFromSample(glm::vec2 pos, const DepthMap& depthMap, float sampleDistance, float offsetStrength)
+{
+    float depthSampleCenter = texture(depthMap, pos);
+
+    float depthSampleNorth = texture(depthMap, pos + glm::vec2(1, 0) * sampleDistance);
+    float depthSampleSouth = texture(depthMap, pos + glm::vec2(-1, 0) * sampleDistance);
+    float depthSampleEast = texture(depthMap, pos + glm::vec2(0, 1) * sampleDistance);
+    float depthSampleWest = texture(depthMap, pos + glm::vec2(0, -1) * sampleDistance);
+
+    float depthSample = (depthSampleCenter + depthSampleNorth + depthSampleSouth + depthSampleEast + depthSampleWest) / 5;
+
+    float vertexOffsetIntensity = depthSample * offsetStrength;
+
+    float easedOffset = Ease(vertexOffsetIntensity);
+
+    return easedOffset;
+}
+
+glm::vec3 GetNormalFromSample(glm::vec2 uv, const DepthMap& depthMap, float sampleDistance, float offsetStrength)
+{
+    glm::vec2 northUV = glm::min(uv + glm::vec2(0, 1) * sampleDistance, glm::vec2(1, 1));
+    glm::vec2 southUV = glm::max(uv + glm::vec2(0, -1) * sampleDistance, glm::vec2(0, 0));
+    glm::vec2 eastUV = glm::min(uv + glm::vec2(1, 0) * sampleDistance, glm::vec2(1, 1));
+    glm::vec2 westUV = glm::max(uv + glm::vec2(-1, 0) * sampleDistance, glm::vec2(0, 0));
+
+    float depthSampleNorth = Ease(texture(depthMap, northUV));
+    float depthSampleSouth = Ease(texture(depthMap, southUV));
+    float depthSampleEast = Ease(texture(depthMap, eastUV));
+    float depthSampleWest = Ease(texture(depthMap, westUV));
+
+    float deltaX = (depthSampleEast - depthSampleWest) / (eastUV.x - westUV.x);
+    float deltaY = (depthSampleNorth - depthSampleSouth) / (northUV.y - southUV.y);
+
+    return glm::normalize(glm::vec3(-deltaX, 1 / (sampleDistance * sampleDistance + 0.1f) + offsetStrength, -deltaY));
+}
+
+// Rough dunes with some sharp steps, so the normals tilt in every direction. Deterministic, so the failures can be repeated
+DepthMap CreateDepthMap(int width, int height)
+{
+    DepthMap depthMap{ width, height, std::vector<unsigned char>(static_cast<size_t>(width) * height) };
+    uint32_t state = 12345u;
+    for (int j = 0; j < height; ++j)
+    {
+        for (int i = 0; i < width; ++i)
+        {
+            state = state * 1664525u + 1013904223u;
+            float dune = 0.5f + 0.35f * std::sin(0.4f * i + 0.25f * j) + 0.1f * static_cast<float>(state >> 24) / 255.0f;
+            if ((i / 7 + j / 5) % 3 == 0)
+            {
+                dune *= 0.5f;
+            }
+            depthMap.texels[static_cast<size_t>(j) * width + i] = static_cast<unsigned char>(std::clamp(dune, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+    return depthMap;
+}
+
+bool IsClose(float value, float reference)
+{
+    return std::abs(value - reference) <= std::max(RelativeTolerance * std::abs(reference), AbsoluteTolerance);
+}
+
+// Bake the region and compare each texel with the reference. Returns the number of texels that don't match
+int CheckRegion(const DepthMap& depthMap, const Heightfield& heightfield, float sampleDistance, float offsetStrength,
+    int x, int y, int width, int height, int& edgeTexels)
+{
+    std::vector<uint64_t> baked(static_cast<size_t>(width) * height);
+    HeightfieldBaker::BakeRegion(heightfield, sampleDistance, offsetStrength, x, y, width, height, baked);
+
+    int failures = 0;
+    for (int row = 0; row < height; ++row)
+    {
+        for (int column = 0; column < width; ++column)
+        {
+            int i = x + column;
+            int j = y + row;
+            glm::vec2 uv((i + 0.5f) / depthMap.width, (j + 0.5f) / depthMap.height);
+
+            // Some of the samples land outside the map, where the clamping matters
+            if (uv.x - sampleDistance < 0 || uv.x + sampleDistance > 1 || uv.y - sampleDistance < 0 || uv.y + sampleDistance > 1)
+            {
+                ++edgeTexels;
+            }
+
+            glm::vec4 value = glm::unpackHalf4x16(baked[static_cast<size_t>(row) * width + column]);
+            glm::vec4 reference(GetHeightFromSample(uv, depthMap, sampleDistance, offsetStrength),
+                GetNormalFromSample(uv, depthMap, sampleDistance, offsetStrength));
+
+            for (int component = 0; component < 4; ++component)
+            {
+                if (!IsClose(value[component], reference[component]))
+                {
+                    if (failures < 10)
+                    {
+                        std::cout << "Texel (" << i << ", " << j << ") component " << component << ": baked " << value[component]
+                            << ", expected " << reference[component] << " (sample distance " << sampleDistance << ")" << std::endl;
+                    }
+                    ++failures;
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+int main()
+{
+    // Odd sizes, so the rows end with incomplete groups of 4 points
+    const int width = 37;
+    const int height = 29;
+    DepthMap depthMap = CreateDepthMap(width, height);
+
+    Heightfield heightfield;
+    heightfield.Initialize(depthMap.texels, width, height);
+
+    // From less than a texel, to several texels, to almost the whole map
+    const float sampleDistances[] = { 0.01f, 0.05f, 0.2f, 0.45f };
+    const float offsetStrength = 2.0f;
+
+    int failures = 0;
+    int edgeTexels = 0;
+    for (float sampleDistance : sampleDistances)
+    {
+        // The whole map, and regions away from the origin like the ones of UpdateRegion, touching each border
+        failures += CheckRegion(depthMap, heightfield, sampleDistance, offsetStrength, 0, 0, width, height, edgeTexels);
+        failures += CheckRegion(depthMap, heightfield, sampleDistance, offsetStrength, 5, 3, 11, 7, edgeTexels);
+        failures += CheckRegion(depthMap, heightfield, sampleDistance, offsetStrength, width - 6, height - 5, 6, 5, edgeTexels);
+        failures += CheckRegion(depthMap, heightfield, sampleDistance, offsetStrength, 0, height - 1, width, 1, edgeTexels);
+        failures += CheckRegion(depthMap, heightfield, sampleDistance, offsetStrength, width - 1, 0, 1, height, edgeTexels);
+    }
+
+    if (edgeTexels == 0)
+    {
+        std::cout << "No texel samples outside the map" << std::endl;
+        return 1;
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAILED") << ": " << failures << " mismatches, "
+        << edgeTexels << " edge texels checked" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
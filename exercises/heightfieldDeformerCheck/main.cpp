@@ -0,0 +1,244 @@
+// Checks the ring-buffered history of HeightfieldDeformer against a plain model of the tracks, updated on every texel.
+// A wheel drives over the map, stamping every frame like the sand demo, with frames of different lengths, some longer
+// than the whole ring. After each update, the heightfield must have, on every texel, the original value minus the
+// relaxed depth of the deepest track, and the texels that changed must be inside the regions reported. Once the tracks
+// are older than the relax time, the surface must be back to the original values, and the updates must stop reporting.
+// It doesn't need a GL context. Returns 0 if all the updates match
+
+#include <ituGL/geometry/Heightfield.h>
+#include <ituGL/geometry/HeightfieldDeformer.h>
+#include <glm/vec2.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Odd sizes, so the last tiles of each row and column are partial
+const int MapWidth = 75;
+const int MapHeight = 53;
+const int TileSize = 16;
+const float RelaxTime = 2.0f;
+const float SlotDuration = 0.25f;
+
+const float TrackRadius = 0.04f;
+const float TrackDepth = 0.2f;
+
+// The model computes the same expressions, only the order of the updates differs
+const float Tolerance = 1e-6f;
+
+// The tracks on every texel, without tiles or history
+class TrackModel
+{
+public:
+    TrackModel(const Heightfield& heightfield)
+        : m_width(heightfield.GetWidth())
+        , m_height(heightfield.GetHeight())
+        , m_time(0.0f)
+    {
+        for (int y = 0; y < m_height; ++y)
+        {
+            for (int x = 0; x < m_width; ++x)
+            {
+                m_originalValues.push_back(heightfield.GetValue(x, y));
+            }
+        }
+        m_depths.resize(m_originalValues.size(), 0.0f);
+        m_times.resize(m_originalValues.size(), 0.0f);
+    }
+
+    void SetTime(float time) { m_time = time; }
+
+    // Round footprint with a smooth rim, where it is deeper than what is left of the older track
+    void Stamp(const glm::vec2& uv, float radius, float depth)
+    {
+        for (int y = 0; y < m_height; ++y)
+        {
+            for (int x = 0; x < m_width; ++x)
+            {
+                float dx = (x - (uv.x * m_width - 0.5f)) / (radius * m_width);
+                float dy = (y - (uv.y * m_height - 0.5f)) / (radius * m_height);
+                float distanceSquared = dx * dx + dy * dy;
+                if (distanceSquared < 1.0f)
+                {
+                    float falloff = 1.0f - distanceSquared;
+                    float stampDepth = depth * falloff * falloff;
+                    size_t index = static_cast<size_t>(y) * m_width + x;
+                    if (stampDepth > GetDepth(index))
+                    {
+                        m_depths[index] = stampDepth;
+                        m_times[index] = m_time;
+                    }
+                }
+            }
+        }
+    }
+
+    void SetOriginalValue(int x, int y, float value) { m_originalValues[static_cast<size_t>(y) * m_width + x] = value; }
+
+    float GetValue(int x, int y) const
+    {
+        size_t index = static_cast<size_t>(y) * m_width + x;
+        return m_originalValues[index] - GetDepth(index);
+    }
+
+    float GetOriginalValue(int x, int y) const { return m_originalValues[static_cast<size_t>(y) * m_width + x]; }
+
+private:
+    // Depth left of the track on the texel, relaxed linearly
+    float GetDepth(size_t index) const
+    {
+        return m_depths[index] * std::max(1.0f - (m_time - m_times[index]) / RelaxTime, 0.0f);
+    }
+
+private:
+    int m_width;
+    int m_height;
+    float m_time;
+    std::vector<float> m_originalValues;
+    std::vector<float> m_depths;
+    std::vector<float> m_times;
+};
+
+// Gentle dunes, deterministic so the failures can be repeated
+std::shared_ptr<Heightfield> CreateHeightfield()
+{
+    std::vector<unsigned char> texels(static_cast<size_t>(MapWidth) * MapHeight);
+    for (int j = 0; j < MapHeight; ++j)
+    {
+        for (int i = 0; i < MapWidth; ++i)
+        {
+            float dune = 0.5f + 0.3f * std::sin(0.2f * i) * std::cos(0.15f * j);
+            texels[static_cast<size_t>(j) * MapWidth + i] = static_cast<unsigned char>(dune * 255.0f + 0.5f);
+        }
+    }
+
+    std::shared_ptr<Heightfield> heightfield = std::make_shared<Heightfield>();
+    heightfield->Initialize(texels, MapWidth, MapHeight);
+    return heightfield;
+}
+
+bool IsInRegions(int x, int y, const std::vector<HeightfieldDeformer::Region>& regions)
+{
+    for (const HeightfieldDeformer::Region& region : regions)
+    {
+        if (x >= region.x && x < region.x + region.width && y >= region.y && y < region.y + region.height)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Compare the heightfield with the model, and the changes since the last frame with the regions.
+// Returns the number of texels that fail
+int CheckFrame(float time, const Heightfield& heightfield, const TrackModel& model,
+    const std::vector<HeightfieldDeformer::Region>& regions, std::vector<float>& previousValues)
+{
+    int failures = 0;
+    for (int y = 0; y < MapHeight; ++y)
+    {
+        for (int x = 0; x < MapWidth; ++x)
+        {
+            float value = heightfield.GetValue(x, y);
+            float& previousValue = previousValues[static_cast<size_t>(y) * MapWidth + x];
+            bool matches = std::abs(value - model.GetValue(x, y)) <= Tolerance;
+            bool reported = value == previousValue || IsInRegions(x, y, regions);
+            if (!matches || !reported)
+            {
+                if (failures < 10)
+                {
+                    std::cout << "Time " << time << ", texel (" << x << ", " << y << "): " << value << ", expected "
+                        << model.GetValue(x, y) << (reported ? "" : ", changed outside the regions") << std::endl;
+                }
+                ++failures;
+            }
+            previousValue = value;
+        }
+    }
+    return failures;
+}
+
+int main()
+{
+    std::shared_ptr<Heightfield> heightfield = CreateHeightfield();
+    HeightfieldDeformer deformer(heightfield, RelaxTime, SlotDuration, TileSize);
+    TrackModel model(*heightfield);
+
+    std::vector<float> previousValues;
+    for (int y = 0; y < MapHeight; ++y)
+    {
+        for (int x = 0; x < MapWidth; ++x)
+        {
+            previousValues.push_back(heightfield->GetValue(x, y));
+        }
+    }
+
+    // Frames a bit shorter and longer than the slots, and once a pause longer than the whole ring
+    const float frameTimes[] = { 0.016f, 0.1f, 0.3f, 0.016f, 0.7f, 0.05f, 0.033f };
+    const int pauseFrame = 30;
+    const float pauseTime = 2.5f;
+    int failures = 0;
+    float time = 0.0f;
+    int frame = 0;
+    for (; time < 12.0f; ++frame)
+    {
+        // The wheel drives in a circle that leaves the map on one side, and stops halfway. Like the demo, the stamp
+        // uses the time of the last update
+        float angle = 1.3f * time;
+        glm::vec2 uv = glm::vec2(0.6f, 0.5f) + 0.45f * glm::vec2(std::cos(angle), std::sin(angle));
+        if (time < 6.0f)
+        {
+            deformer.Stamp(uv, TrackRadius, TrackDepth);
+            model.Stamp(uv, TrackRadius, TrackDepth);
+        }
+
+        // The sand moves under the track that was just pressed, like the dunes do. The caller knows these texels changed
+        if (frame == 15)
+        {
+            int centerX = static_cast<int>(uv.x * MapWidth);
+            int centerY = static_cast<int>(uv.y * MapHeight);
+            for (int y = std::max(centerY - 1, 0); y <= std::min(centerY + 1, MapHeight - 1); ++y)
+            {
+                for (int x = std::max(centerX - 4, 0); x <= std::min(centerX + 4, MapWidth - 1); ++x)
+                {
+                    float value = model.GetOriginalValue(x, y) + 0.05f;
+                    deformer.SetOriginalValue(x, y, value);
+                    model.SetOriginalValue(x, y, value);
+                    if (std::abs(heightfield->GetValue(x, y) - model.GetValue(x, y)) > Tolerance)
+                    {
+                        std::cout << "Texel (" << x << ", " << y << ") doesn't keep its track when the surface changes" << std::endl;
+                        ++failures;
+                    }
+                    previousValues[static_cast<size_t>(y) * MapWidth + x] = heightfield->GetValue(x, y);
+                }
+            }
+        }
+
+        time += frame == pauseFrame ? pauseTime : frameTimes[frame % std::size(frameTimes)];
+        model.SetTime(time);
+        const std::vector<HeightfieldDeformer::Region>& regions = deformer.Update(time);
+        failures += CheckFrame(time, *heightfield, model, regions, previousValues);
+    }
+
+    // Long after the last stamp, the tracks are gone and the history is empty
+    for (int y = 0; y < MapHeight; ++y)
+    {
+        for (int x = 0; x < MapWidth; ++x)
+        {
+            if (heightfield->GetValue(x, y) != model.GetOriginalValue(x, y))
+            {
+                ++failures;
+            }
+        }
+    }
+    if (!deformer.Update(time + SlotDuration).empty())
+    {
+        std::cout << "Updates still report regions after the tracks relaxed" << std::endl;
+        ++failures;
+    }
+
+    std::cout << (failures == 0 ? "OK" : "FAILED") << ": " << failures << " mismatches in " << frame << " updates" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+// Checks that the filtering of Heightfield, 4 points at a time with SSE2 when it is available, gives the same values as its
+// scalar path. The reference is a transcription of the scalar branch of Heightfield::Sample4: clamp the coordinates to one
+// texel out of the map, floor, clamp both texels of each axis to the edge, and interpolate along x and then along y.
+// The points are inside the map, on the texel centers and edges, outside it on every side, and far away, where the
+// conversions to int could overflow. They are queried one by one and in batches of every size, so the incomplete groups
+// at the end of a batch are covered too.
+// It doesn't need a GL context. Returns 0 if all the points match
+
+#include <ituGL/geometry/Heightfield.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Both paths do the same operations in the same order, only a contraction into a fused multiply-add could change the
+// last bit
+const float Tolerance = 1e-6f;
+
+// Odd sizes, so the texel grid doesn't line up with the binary fractions of the coordinates
+const int MapWidth = 37;
+const int MapHeight = 29;
+
+// The scalar branch of Heightfield::Sample4, for one point
+float SampleScalar(const Heightfield& heightfield, float u, float v)
+{
+    int width = heightfield.GetWidth();
+    int height = heightfield.GetHeight();
+    float x = std::clamp(u * static_cast<float>(width) - 0.5f, -1.0f, static_cast<float>(width));
+    float y = std::clamp(v * static_cast<float>(height) - 0.5f, -1.0f, static_cast<float>(height));
+    float floorX = std::floor(x);
+    float floorY = std::floor(y);
+    float fractionX = x - floorX;
+    float fractionY = y - floorY;
+    int x0 = static_cast<int>(std::clamp(floorX, 0.0f, static_cast<float>(width - 1)));
+    int x1 = static_cast<int>(std::clamp(floorX + 1.0f, 0.0f, static_cast<float>(width - 1)));
+    int y0 = static_cast<int>(std::clamp(floorY, 0.0f, static_cast<float>(height - 1)));
+    int y1 = static_cast<int>(std::clamp(floorY + 1.0f, 0.0f, static_cast<float>(height - 1)));
+
+    float bottom = heightfield.GetValue(x0, y0) * (1.0f - fractionX) + heightfield.GetValue(x1, y0) * fractionX;
+    float top = heightfield.GetValue(x0, y1) * (1.0f - fractionX) + heightfield.GetValue(x1, y1) * fractionX;
+    return bottom * (1.0f - fractionY) + top * fractionY;
+}
+
+// Every texel different from its neighbours, so a wrong texel or weight shows. Deterministic, so failures can be repeated
+Heightfield CreateHeightfield()
+{
+    std::vector<unsigned char> texels(static_cast<size_t>(MapWidth) * MapHeight);
+    uint32_t state = 12345u;
+    for (unsigned char& texel : texels)
+    {
+        state = state * 1664525u + 1013904223u;
+        texel = static_cast<unsigned char>(state >> 24);
+    }
+
+    Heightfield heightfield;
+    heightfield.Initialize(texels, MapWidth, MapHeight);
+    return heightfield;
+}
+
+std::vector<glm::vec2> CreatePoints()
+{
+    std::vector<glm::vec2> points;
+
+    // Texel centers and edges, including the ones of the border texels, where the clamping starts
+    for (int j = -1; j <= MapHeight + 1; j += 3)
+    {
+        for (int i = -1; i <= MapWidth + 1; ++i)
+        {
+            points.push_back(glm::vec2((i + 0.5f) / MapWidth, (j + 0.5f) / MapHeight));
+            points.push_back(glm::vec2(static_cast<float>(i) / MapWidth, static_cast<float>(j) / MapHeight));
+        }
+    }
+
+    // Inside the map, and up to one map away on every side
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> inside(0.0f, 1.0f);
+    std::uniform_real_distribution<float> around(-1.0f, 2.0f);
+    for (int i = 0; i < 1000; ++i)
+    {
+        points.push_back(glm::vec2(inside(random), inside(random)));
+        points.push_back(glm::vec2(around(random), around(random)));
+    }
+
+    // Far away, past the range of int once in texels, and the exact corners
+    const float far = 1e9f;
+    for (glm::vec2 point : { glm::vec2(far, 0.5f), glm::vec2(-far, 0.5f), glm::vec2(0.5f, far), glm::vec2(0.5f, -far),
+        glm::vec2(far, -far), glm::vec2(-far, far), glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 0.0f) })
+    {
+        points.push_back(point);
+    }
+    return points;
+}
+
+bool IsClose(float value, float reference)
+{
+    return std::abs(value - reference) <= Tolerance;
+}
+
+int main()
+{
+    Heightfield heightfield = CreateHeightfield();
+    std::vector<glm::vec2> points = CreatePoints();
+
+    std::vector<float> references;
+    for (const glm::vec2& point : points)
+    {
+        references.push_back(SampleScalar(heightfield, point.x, point.y));
+    }
+
+    int failures = 0;
+    auto check = [&](size_t index, float value, const char* query)
+    {
+        if (!IsClose(value, references[index]))
+        {
+            if (failures < 10)
+            {
+                std::cout << query << " at (" << points[index].x << ", " << points[index].y << "): " << value
+                    << ", expected " << references[index] << std::endl;
+            }
+            ++failures;
+        }
+    };
+
+    // One by one
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        check(i, heightfield.Sample(points[i]), "Single sample");
+    }
+
+    // In batches of 1 to 9 points, starting anywhere in the groups of 4
+    for (size_t batchSize = 1; batchSize <= 9; ++batchSize)
+    {
+        for (size_t first = 0; first < points.size(); first += batchSize)
+        {
+            size_t count = std::min(batchSize, points.size() - first);
+            std::vector<float> values(count);
+            heightfield.Sample(std::span<const glm::vec2>(points).subspan(first, count), values);
+            for (size_t i = 0; i < count; ++i)
+            {
+                check(first + i, values[i], "Batched sample");
+            }
+        }
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    const char* path = "SSE2";
+#else
+    const char* path = "scalar";
+#endif
+    std::cout << (failures == 0 ? "OK" : "FAILED") << ": " << failures << " mismatches, " << points.size()
+        << " points with the " << path << " path" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// Checks the reordering of MeshOptimizer, the way ModelLoader runs it: vertex cache, then overdraw, then vertex fetch.
+// After the three passes, every index must point to a vertex left in the data, the mesh must have the same triangles, with
+// the same winding, and the ACMR must not be worse than before. The meshes are grids, with the triangles in rows and
+// shuffled, and some vertices that no triangle uses.
+// It doesn't need a GL context. Returns 0 if all the meshes pass
+
+#include <ituGL/geometry/MeshOptimizer.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <span>
+#include <vector>
+
+// The position, for the overdraw pass, and the index of the vertex in the original mesh, to follow the remap
+struct Vertex
+{
+    float position[3];
+    uint32_t id;
+};
+
+// Like ModelLoader::OptimizeSubmeshData, the overdraw pass can cost up to 5% of the cache efficiency
+const float OverdrawThreshold = 1.05f;
+
+struct TestMesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Grid of width x height quads on the XZ plane, 2 triangles each, in rows. The vertices after the grid are unused
+TestMesh CreateGrid(int width, int height, int unusedVertexCount)
+{
+    TestMesh mesh;
+    for (int j = 0; j <= height; ++j)
+    {
+        for (int i = 0; i <= width; ++i)
+        {
+            uint32_t id = static_cast<uint32_t>(mesh.vertices.size());
+            mesh.vertices.push_back({ { static_cast<float>(i), 0.0f, static_cast<float>(j) }, id });
+        }
+    }
+    for (int k = 0; k < unusedVertexCount; ++k)
+    {
+        uint32_t id = static_cast<uint32_t>(mesh.vertices.size());
+        mesh.vertices.push_back({ { -1.0f, static_cast<float>(k), -1.0f }, id });
+    }
+
+    uint32_t rowSize = static_cast<uint32_t>(width + 1);
+    for (uint32_t j = 0; j < static_cast<uint32_t>(height); ++j)
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(width); ++i)
+        {
+            uint32_t v0 = j * rowSize + i;
+            uint32_t v1 = v0 + 1;
+            uint32_t v2 = v0 + rowSize;
+            uint32_t v3 = v2 + 1;
+            mesh.indices.insert(mesh.indices.end(), { v0, v2, v1, v1, v2, v3 });
+        }
+    }
+    return mesh;
+}
+
+// Same triangles, in a random order, each one starting at a random corner. The worst case for the cache
+void ShuffleTriangles(TestMesh& mesh, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    size_t triangleCount = mesh.indices.size() / 3;
+    std::vector<std::array<uint32_t, 3>> triangles(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        int rotation = static_cast<int>(random() % 3);
+        for (int k = 0; k < 3; ++k)
+        {
+            triangles[triangle][k] = mesh.indices[triangle * 3 + (k + rotation) % 3];
+        }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), random);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        std::copy(triangles[triangle].begin(), triangles[triangle].end(), mesh.indices.begin() + triangle * 3);
+    }
+}
+
+// Triangles as the original ids of their vertices, starting with the smallest one so the winding is kept, and sorted
+std::vector<std::array<uint32_t, 3>> GetTriangleSet(std::span<const uint32_t> indices, std::span<const Vertex> vertices)
+{
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        std::array<uint32_t, 3> triangle = { vertices[indices[i]].id, vertices[indices[i + 1]].id, vertices[indices[i + 2]].id };
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+// Optimize the mesh and check it. Returns the number of failed checks
+int CheckMesh(const char* name, TestMesh mesh)
+{
+    size_t vertexCount = mesh.vertices.size();
+    std::vector<std::array<uint32_t, 3>> triangleSet = GetTriangleSet(mesh.indices, mesh.vertices);
+    std::vector<bool> usedVertices(vertexCount, false);
+    for (uint32_t index : mesh.indices)
+    {
+        usedVertices[index] = true;
+    }
+    size_t usedVertexCount = std::count(usedVertices.begin(), usedVertices.end(), true);
+    MeshOptimizer::Statistics before = MeshOptimizer::AnalyzeVertexCache(mesh.indices, vertexCount);
+
+    // The same passes as ModelLoader, on the bytes of the vertices
+    std::span<std::byte> vertexData = std::as_writable_bytes(std::span<Vertex>(mesh.vertices));
+    MeshOptimizer::OptimizeVertexCache(mesh.indices, vertexCount);
+    MeshOptimizer::Statistics afterCache = MeshOptimizer::AnalyzeVertexCache(mesh.indices, vertexCount);
+    MeshOptimizer::OptimizeOverdraw(mesh.indices, vertexData, sizeof(Vertex), offsetof(Vertex, position), OverdrawThreshold);
+    MeshOptimizer::Statistics afterOverdraw = MeshOptimizer::AnalyzeVertexCache(mesh.indices, vertexCount);
+    size_t newVertexCount = MeshOptimizer::OptimizeVertexFetch(mesh.indices, vertexData, sizeof(Vertex));
+    mesh.vertices.resize(newVertexCount);
+
+    int failures = 0;
+    auto check = [&](bool passed, const char* message)
+    {
+        if (!passed)
+        {
+            std::cout << name << ": " << message << std::endl;
+            ++failures;
+        }
+    };
+
+    // The remap keeps the used vertices only, in the order they are first used
+    check(newVertexCount == usedVertexCount, "the vertex fetch pass didn't keep exactly the used vertices");
+    check(std::all_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t index) { return index < newVertexCount; }),
+        "an index points past the vertices left");
+    uint32_t nextVertex = 0;
+    bool firstUseOrder = true;
+    for (uint32_t index : mesh.indices)
+    {
+        if (index == nextVertex)
+        {
+            ++nextVertex;
+        }
+        firstUseOrder &= index < nextVertex;
+    }
+    check(firstUseOrder, "the vertices are not in the order of first use");
+
+    // The remapped vertices still hold the data of the ones the triangles used
+    check(GetTriangleSet(mesh.indices, mesh.vertices) == triangleSet, "the triangles changed");
+
+    // The vertex fetch pass only renames the vertices, so it can't change the cache misses
+    MeshOptimizer::Statistics after = MeshOptimizer::AnalyzeVertexCache(mesh.indices, newVertexCount);
+    check(afterCache.acmr <= before.acmr, "the vertex cache pass made the ACMR worse");
+    check(afterOverdraw.acmr <= afterCache.acmr * OverdrawThreshold, "the overdraw pass lost more than its threshold");
+    check(after.acmr == afterOverdraw.acmr, "the vertex fetch pass changed the ACMR");
+    check(after.acmr <= before.acmr, "the ACMR is worse than before");
+
+    std::cout << name << ": " << triangleSet.size() << " triangles, " << usedVertexCount << " / " << vertexCount
+        << " vertices used, ACMR " << before.acmr << " -> " << after.acmr << std::endl;
+    return failures;
+}
+
+int main()
+{
+    int failures = 0;
+
+    // Rows of quads are already decent for the cache, wider rows than the cache are not
+    failures += CheckMesh("Grid 8 x 8", CreateGrid(8, 8, 0));
+    failures += CheckMesh("Grid 64 x 64", CreateGrid(64, 64, 0));
+
+    TestMesh shuffled = CreateGrid(64, 64, 0);
+    ShuffleTriangles(shuffled, 42u);
+    failures += CheckMesh("Shuffled grid 64 x 64", shuffled);
+
+    // Odd sizes, and vertices left out of the triangles, that the vertex fetch pass removes
+    TestMesh unused = CreateGrid(37, 29, 25);
+    ShuffleTriangles(unused, 7u);
+    failures += CheckMesh("Shuffled grid 37 x 29 with unused vertices", unused);
+
+    std::cout << (failures == 0 ? "OK" : "FAILED") << ": " << failures << " failed checks" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
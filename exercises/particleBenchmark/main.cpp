@@ -0,0 +1,114 @@
+// Times ParticleSystem::Update without a window: the same particles advanced with a fixed time step, with the SSE2 and the
+// scalar paths, on this thread only and in parallel chunks on the workers of a load queue.
+// The scalar path only covers the particle loops, the heightfield queries use SSE2 either way.
+// Usage: particleBenchmark [particle count] [updates]
+
+#include <ituGL/particles/ParticleSystem.h>
+#include <ituGL/geometry/Heightfield.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+const float DeltaTime = 1.0f / 60.0f;
+
+// Terrain with the same parameters as the sand demo, so the ground queries cost the same
+const int GroundResolution = 512;
+const float GroundSize = 100.0f;
+const float SampleDistance = 0.01f;
+const float OffsetStrength = 2.0f;
+
+std::shared_ptr<Heightfield> CreateGround()
+{
+    std::vector<unsigned char> texels(static_cast<size_t>(GroundResolution) * GroundResolution);
+    for (int j = 0; j < GroundResolution; ++j)
+    {
+        for (int i = 0; i < GroundResolution; ++i)
+        {
+            float dune = 0.5f + 0.4f * std::sin(0.05f * i) * std::cos(0.07f * j);
+            texels[static_cast<size_t>(j) * GroundResolution + i] = static_cast<unsigned char>(dune * 255.0f);
+        }
+    }
+
+    std::shared_ptr<Heightfield> heightfield = std::make_shared<Heightfield>();
+    heightfield->Initialize(texels, GroundResolution, GroundResolution);
+    return heightfield;
+}
+
+// Milliseconds per update, after a few updates to warm up. The particles live longer than the run, so the count doesn't change.
+// Without a heightfield, the particles collide with a plane
+double TimeUpdates(std::shared_ptr<const Heightfield> ground, unsigned int particleCount, unsigned int updateCount,
+    bool simdEnabled, AssetLoadQueue* loadQueue)
+{
+    ParticleSystem particleSystem(particleCount);
+    if (ground)
+    {
+        particleSystem.SetGround(ground, glm::vec3(0.0f), GroundSize, SampleDistance, OffsetStrength);
+    }
+    else
+    {
+        particleSystem.SetGround(0.0f);
+    }
+    particleSystem.SetSimdEnabled(simdEnabled);
+
+    // Same particles for every configuration
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-0.5f * GroundSize, 0.5f * GroundSize);
+    std::uniform_real_distribution<float> velocity(-5.0f, 5.0f);
+    for (unsigned int i = 0; i < particleCount; ++i)
+    {
+        particleSystem.Emit(glm::vec3(position(random), 5.0f, position(random)),
+            glm::vec3(velocity(random), std::abs(velocity(random)), velocity(random)), 1000.0f, 0.1f);
+    }
+
+    for (int i = 0; i < 5; ++i)
+    {
+        particleSystem.Update(DeltaTime, loadQueue);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < updateCount; ++i)
+    {
+        particleSystem.Update(DeltaTime, loadQueue);
+    }
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+    return duration.count() / updateCount;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int particleCount = argc > 1 ? static_cast<unsigned int>(std::atoi(argv[1])) : 100000;
+    unsigned int updateCount = argc > 2 ? static_cast<unsigned int>(std::atoi(argv[2])) : 200;
+    if (particleCount == 0 || updateCount == 0)
+    {
+        std::cout << "Usage: particleBenchmark [particle count] [updates]" << std::endl;
+        return 1;
+    }
+
+    std::shared_ptr<const Heightfield> heightfield = CreateGround();
+    AssetLoadQueue loadQueue;
+
+#if !defined(__SSE2__) && !defined(_M_X64)
+    std::cout << "SSE2 is not available, both paths are scalar" << std::endl;
+#endif
+    std::cout << particleCount << " particles, " << updateCount << " updates, "
+        << loadQueue.GetWorkerCount() << " workers" << std::endl;
+
+    // The plane isolates the integration, the heightfield adds the batched ground queries
+    for (std::shared_ptr<const Heightfield> ground : { std::shared_ptr<const Heightfield>(), heightfield })
+    {
+        std::cout << (ground ? "Heightfield ground" : "Plane ground") << std::endl;
+        for (bool simdEnabled : { false, true })
+        {
+            double serial = TimeUpdates(ground, particleCount, updateCount, simdEnabled, nullptr);
+            double parallel = TimeUpdates(ground, particleCount, updateCount, simdEnabled, &loadQueue);
+            std::cout << (simdEnabled ? "  SSE2:   " : "  Scalar: ") << serial << " ms per update, "
+                << parallel << " ms with the load queue" << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+// Times the ways of walking a big scene to feed the renderer, without a window:
+//  - the visitor over a map of nodes by name, the way Scene stored them before the component pools
+//  - the visitor over the node pool of the registry, what Scene::AcceptVisitor does now
+//  - Scene::UpdateWorldMatrices followed by the loop of RendererSceneSystem over the model and transform pools
+// The Renderer needs a GL context, so a draw list stands in for it. It takes what Renderer::AddModel takes, and all the
+// paths pay the same for it. Each frame, a few nodes move, so there are dirty transforms like in the game.
+// Usage: sceneBenchmark [node count] [frames]
+
+#include <ituGL/scene/Scene.h>
+#include <ituGL/scene/SceneModel.h>
+#include <ituGL/scene/SceneVisitor.h>
+#include <ituGL/scene/Transform.h>
+#include <ituGL/geometry/Model.h>
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Fraction of the nodes moved every frame
+const unsigned int MovedNodesStride = 100;
+
+// Models and world matrices added in a frame, like the renderer keeps them
+class DrawList
+{
+public:
+    void Clear()
+    {
+        m_models.clear();
+        m_worldMatrices.clear();
+    }
+
+    void AddModel(const Model& model, const glm::mat4& worldMatrix, unsigned int& lod)
+    {
+        m_models.push_back(&model);
+        m_worldMatrices.push_back(worldMatrix);
+        lod = 0;
+    }
+
+    inline size_t GetModelCount() const { return m_models.size(); }
+
+private:
+    std::vector<const Model*> m_models;
+    std::vector<glm::mat4> m_worldMatrices;
+};
+
+// Same as RendererSceneVisitor::VisitModel
+class DrawListSceneVisitor : public SceneVisitor
+{
+public:
+    DrawListSceneVisitor(DrawList& drawList) : m_drawList(drawList)
+    {
+    }
+
+    void VisitModel(SceneModel& sceneModel) override
+    {
+        unsigned int lod = sceneModel.GetLod();
+        m_drawList.AddModel(*sceneModel.GetModel(), sceneModel.GetTransform()->GetTransformMatrix(), lod);
+        sceneModel.SetLod(lod);
+    }
+
+private:
+    DrawList& m_drawList;
+};
+
+// Same as the model loop of RendererSceneSystem::Render
+void AddSceneModels(Scene& scene, DrawList& drawList)
+{
+    SceneRegistry& registry = scene.GetRegistry();
+    SceneComponentPool<SceneModelComponent>& models = registry.GetModels();
+    const SceneComponentPool<SceneTransformComponent>& transforms = registry.GetTransforms();
+    std::span<const SceneEntity> entities = models.GetEntities();
+    std::span<SceneModelComponent> modelComponents = models.GetComponents();
+    for (size_t i = 0; i < modelComponents.size(); ++i)
+    {
+        if (!transforms.Has(entities[i]))
+        {
+            continue;
+        }
+        SceneModelComponent& model = modelComponents[i];
+        drawList.AddModel(*model.model, transforms.Get(entities[i]).worldMatrix, model.lod);
+    }
+}
+
+// Milliseconds per frame. Each frame moves some nodes, then runs the path
+double TimeFrames(const std::vector<std::shared_ptr<SceneModel>>& sceneModels, unsigned int frameCount, DrawList& drawList,
+    const std::function<void()>& path)
+{
+    auto moveNodes = [&](unsigned int frame)
+    {
+        for (size_t i = frame % MovedNodesStride; i < sceneModels.size(); i += MovedNodesStride)
+        {
+            sceneModels[i]->GetTransform()->SetTranslation(glm::vec3(static_cast<float>(i), static_cast<float>(frame), 0.0f));
+        }
+    };
+
+    // Warm up, and make sure every world matrix is computed once
+    for (unsigned int frame = 0; frame < 3; ++frame)
+    {
+        moveNodes(frame);
+        drawList.Clear();
+        path();
+    }
+
+    std::chrono::duration<double, std::milli> duration(0);
+    for (unsigned int frame = 0; frame < frameCount; ++frame)
+    {
+        moveNodes(frame);
+        drawList.Clear();
+        auto start = std::chrono::steady_clock::now();
+        path();
+        duration += std::chrono::steady_clock::now() - start;
+    }
+    return duration.count() / frameCount;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int nodeCount = argc > 1 ? static_cast<unsigned int>(std::atoi(argv[1])) : 100000;
+    unsigned int frameCount = argc > 2 ? static_cast<unsigned int>(std::atoi(argv[2])) : 50;
+    if (nodeCount == 0 || frameCount == 0)
+    {
+        std::cout << "Usage: sceneBenchmark [node count] [frames]" << std::endl;
+        return 1;
+    }
+
+    // All the nodes share a model without GL objects, each one has its own transform
+    std::shared_ptr<Model> model = std::make_shared<Model>(std::make_shared<Mesh>());
+
+    Scene scene;
+    std::unordered_map<std::string, std::shared_ptr<SceneNode>> nodesByName;
+    std::vector<std::shared_ptr<SceneModel>> sceneModels;
+    for (unsigned int i = 0; i < nodeCount; ++i)
+    {
+        std::shared_ptr<SceneModel> sceneModel = std::make_shared<SceneModel>("Model " + std::to_string(i), model);
+        sceneModel->GetTransform()->SetTranslation(glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+        scene.AddSceneNode(sceneModel);
+        nodesByName[sceneModel->GetName()] = sceneModel;
+        sceneModels.push_back(sceneModel);
+    }
+
+    AssetLoadQueue loadQueue;
+    DrawList drawList;
+    DrawListSceneVisitor visitor(drawList);
+
+    double mapVisitor = TimeFrames(sceneModels, frameCount, drawList, [&]()
+        {
+            for (auto& pair : nodesByName)
+            {
+                pair.second->AcceptVisitor(visitor);
+            }
+        });
+    double poolVisitor = TimeFrames(sceneModels, frameCount, drawList, [&]()
+        {
+            scene.AcceptVisitor(visitor);
+        });
+    double systems = TimeFrames(sceneModels, frameCount, drawList, [&]()
+        {
+            scene.UpdateWorldMatrices();
+            AddSceneModels(scene, drawList);
+        });
+    double parallelSystems = TimeFrames(sceneModels, frameCount, drawList, [&]()
+        {
+            scene.UpdateWorldMatrices(&loadQueue);
+            AddSceneModels(scene, drawList);
+        });
+
+    std::cout << nodeCount << " nodes, " << frameCount << " frames, " << drawList.GetModelCount() << " models drawn, "
+        << loadQueue.GetWorkerCount() << " workers" << std::endl;
+    std::cout << "Visitor over the node map:   " << mapVisitor << " ms per frame" << std::endl;
+    std::cout << "Visitor over the node pool:  " << poolVisitor << " ms per frame" << std::endl;
+    std::cout << "Systems:                     " << systems << " ms per frame" << std::endl;
+    std::cout << "Systems with the load queue: " << parallelSystems << " ms per frame" << std::endl;
+    return 0;
+}
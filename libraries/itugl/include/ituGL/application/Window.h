@@ -7,6 +7,9 @@ class Window
 {
 public:
     Window(int width, int height, const char* title);
+    // Create a window whose context shares objects (textures, buffers, programs, syncs) with the one of another window.
+    // Hidden windows are only useful for their context, for example to upload data from another thread
+    Window(int width, int height, const char* title, const Window& sharedWindow, bool visible);
     ~Window();
 
     // (C++) 1
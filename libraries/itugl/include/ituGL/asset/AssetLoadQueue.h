@@ -0,0 +1,180 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cassert>
+
+class Window;
+
+// Asset that might still be loading. On the GL thread, get it with AssetLoadQueue::Wait, or check if it is ready without blocking
+template<typename T>
+using AssetFuture = std::shared_future<std::shared_ptr<T>>;
+
+// Loads assets in the background. The CPU work (reading files, importing, decoding, packing vertices) runs on a pool of
+// worker threads, and the work that needs the GL context is queued for the thread that owns it, that runs it in ProcessUploads.
+// Optionally, the uploads can run on their own thread, with a context that shares objects with the main one. Then the GL thread
+// only runs the finish part of each upload, once a fence tells that the GPU completed it
+class AssetLoadQueue
+{
+public:
+    using Task = std::function<void()>;
+
+public:
+    // Start the worker threads. By default, one less than the hardware threads, so the GL thread keeps a core
+    AssetLoadQueue(unsigned int workerCount = 0);
+
+    // Wait for the workers to finish their current task. Work and uploads that didn't start are discarded
+    ~AssetLoadQueue();
+
+    // Not copyable or movable, the workers keep a pointer to the queue
+    AssetLoadQueue(const AssetLoadQueue&) = delete;
+    void operator = (const AssetLoadQueue&) = delete;
+
+    // Run a task on a worker thread. Can be called from any thread
+    void SubmitWork(Task task);
+
+    // Run the function for every index in [0, count), on the workers and on this thread, and wait until all are done.
+    // The indices are taken one at a time, so each one should be a good amount of work
+    void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& function);
+
+    // Run a task with a GL context: on the upload thread if it was started, or on the GL thread the next time the uploads are
+    // processed. The optional finish task always runs on the GL thread, after the upload is complete, to publish the results.
+    // Can be called from any thread, without locking
+    void SubmitUpload(Task upload, Task finish = Task());
+
+    // Create an asset with a GL context and set the promise once it can be used from the GL thread
+    template<typename T>
+    void SubmitAssetUpload(std::function<std::shared_ptr<T>()> createAsset, std::shared_ptr<std::promise<std::shared_ptr<T>>> promise);
+
+    // Create a hidden window sharing objects with the main window, and run the uploads with its context on another thread.
+    // Vertex arrays and framebuffers are not shared between contexts, so they must be created in the finish tasks.
+    // Must be called from the GL thread. Returns false if the context couldn't be created
+    bool StartUploadThread(const Window& mainWindow);
+
+    inline bool HasUploadThread() const { return m_uploadThread.joinable(); }
+
+    // Run the queued uploads, or the finish tasks of the completed ones, until the time budget is spent.
+    // At least one task runs, so big uploads still progress. Must be called from the GL thread.
+    // Returns the number of tasks still waiting for the GL thread
+    unsigned int ProcessUploads(double budgetSeconds);
+
+    // Process uploads until the asset is loaded, and return it. Must be called from the GL thread
+    template<typename T>
+    std::shared_ptr<T> Wait(const AssetFuture<T>& future);
+
+    // Process uploads until all the submitted tasks are done. Must be called from the GL thread
+    void WaitAll();
+
+    // Number of submitted tasks that didn't finish yet, both work and uploads
+    inline unsigned int GetPendingCount() const { return m_pendingCount; }
+
+    inline unsigned int GetWorkerCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+    // Wrap an asset that is already loaded in a future
+    template<typename T>
+    static AssetFuture<T> MakeReadyFuture(std::shared_ptr<T> asset);
+
+private:
+    // Node of the list of uploads pushed by the producers
+    struct UploadNode
+    {
+        Task upload;
+        Task finish;
+        UploadNode* next;
+    };
+
+    // Upload done on the upload thread, waiting for the GPU before finishing on the GL thread
+    struct FencedUpload
+    {
+        GLsync fence;
+        Task finish;
+    };
+
+private:
+    void RunWorker();
+    void RunUploadThread();
+
+    // Push a node to the upload list, and wake up the upload thread
+    void PushUpload(UploadNode* node);
+
+    // Move the pushed uploads to the list owned by the consumer, in the order they were pushed
+    void CollectUploads();
+
+    // Run the finish tasks of the uploads that the GPU completed, in order, until the time budget is spent
+    void FinishFencedUploads(std::chrono::steady_clock::time_point startTime, double budgetSeconds);
+
+    // Wait a bit for more uploads, when there is nothing to do but the workers are still busy
+    void WaitForUploads();
+
+private:
+    std::vector<std::thread> m_workers;
+
+    // Work waiting for a worker. Workers take the tasks in order
+    std::deque<Task> m_work;
+    std::mutex m_workMutex;
+    std::condition_variable m_workCondition;
+    bool m_stopping;
+
+    // Uploads pushed by any thread, newest first. Producers only need a compare-exchange, and the GL thread takes all of them at once
+    std::atomic<UploadNode*> m_pushedUploads;
+
+    // Uploads collected by the consumer, oldest first. Only accessed from the GL thread, or from the upload thread if it runs
+    std::deque<UploadNode*> m_uploads;
+
+    // Upload thread, and the hidden window that owns its context
+    std::unique_ptr<Window> m_uploadWindow;
+    std::thread m_uploadThread;
+    std::atomic<bool> m_uploadStopping;
+
+    // Uploads completed by the upload thread, handed to the GL thread
+    std::vector<FencedUpload> m_completedUploads;
+    std::mutex m_completedMutex;
+
+    // Uploads waiting for their fence. Only accessed from the GL thread
+    std::deque<FencedUpload> m_fencedUploads;
+
+    std::atomic<unsigned int> m_pendingCount;
+};
+
+
+template<typename T>
+std::shared_ptr<T> AssetLoadQueue::Wait(const AssetFuture<T>& future)
+{
+    assert(future.valid());
+    while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        // Blocking anyway, so there is no budget
+        ProcessUploads(std::numeric_limits<double>::max());
+        if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            WaitForUploads();
+        }
+    }
+    return future.get();
+}
+
+template<typename T>
+void AssetLoadQueue::SubmitAssetUpload(std::function<std::shared_ptr<T>()> createAsset, std::shared_ptr<std::promise<std::shared_ptr<T>>> promise)
+{
+    // Shared by both tasks, the asset is only published in the finish task
+    std::shared_ptr<std::shared_ptr<T>> asset = std::make_shared<std::shared_ptr<T>>();
+    SubmitUpload([createAsset, asset]() { *asset = createAsset(); }, [asset, promise]() { promise->set_value(*asset); });
+}
+
+template<typename T>
+AssetFuture<T> AssetLoadQueue::MakeReadyFuture(std::shared_ptr<T> asset)
+{
+    std::promise<std::shared_ptr<T>> promise;
+    promise.set_value(asset);
+    return promise.get_future().share();
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <ituGL/asset/AssetLoadQueue.h>
 #include <unordered_map>
 #include <string>
 #include <memory>
@@ -27,15 +28,33 @@ public:
     // Load the asset from a path into the object passed as a parameter
     virtual bool LoadInto(const char* path, T&);
 
+    // Load the asset in the background, using the workers and the upload queue. Assets are shared like in LoadShared.
+    // Returns an empty future if the path is not valid
+    AssetFuture<T> LoadAsync(const char* path, AssetLoadQueue& loadQueue);
+
     inline bool GetKeepShared() const { return m_keepShared; }
     inline void SetKeepShared(bool keepShared) { m_keepShared = keepShared; }
 
+    // Forget the assets kept shared, so the next loads create new ones. Useful on a copy of a loader with other settings
+    void ClearShared();
+
+protected:
+    using Promise = std::shared_ptr<std::promise<std::shared_ptr<T>>>;
+
+    // Start loading the asset, and set the promise when it is ready.
+    // By default, the whole load runs as one upload on the GL thread, so the loader must be alive until then.
+    // Loaders that split the work should copy their settings, so they can be changed or destroyed while loading
+    virtual void SubmitLoad(const std::string& path, AssetLoadQueue& loadQueue, Promise promise);
+
 private:
     // If true, keep a reference to assets loaded as shared, to avoid loading twice
     bool m_keepShared;
 
     // Map of loaded shared assets
     std::unordered_map<std::string, std::shared_ptr<T>> m_sharedAssets;
+
+    // Map of assets loaded in the background. They are kept even when finished, like the shared assets
+    std::unordered_map<std::string, AssetFuture<T>> m_asyncAssets;
 };
 
 template <typename T>
@@ -87,6 +106,13 @@ std::shared_ptr<T> AssetLoader<T>::LoadShared(const char* path)
     return t;
 }
 
+template <typename T>
+void AssetLoader<T>::ClearShared()
+{
+    m_sharedAssets.clear();
+    m_asyncAssets.clear();
+}
+
 template <typename T>
 bool AssetLoader<T>::LoadInto(const char* path, T& t)
 {
@@ -97,3 +123,45 @@ bool AssetLoader<T>::LoadInto(const char* path, T& t)
     }
     return valid;
 }
+
+template <typename T>
+AssetFuture<T> AssetLoader<T>::LoadAsync(const char* path, AssetLoadQueue& loadQueue)
+{
+    AssetFuture<T> future;
+    if (IsValid(path))
+    {
+        // Try to find the asset on the previously loaded, or the ones being loaded
+        std::string pathString(path);
+        auto itAsset = m_sharedAssets.find(pathString);
+        auto itAsyncAsset = m_asyncAssets.find(pathString);
+        if (itAsset != m_sharedAssets.end())
+        {
+            future = AssetLoadQueue::MakeReadyFuture(itAsset->second);
+        }
+        else if (itAsyncAsset != m_asyncAssets.end())
+        {
+            future = itAsyncAsset->second;
+        }
+        else
+        {
+            Promise promise = std::make_shared<std::promise<std::shared_ptr<T>>>();
+            future = promise->get_future().share();
+            SubmitLoad(pathString, loadQueue, promise);
+            if (m_keepShared)
+            {
+                m_asyncAssets.insert(std::make_pair(pathString, future));
+            }
+        }
+    }
+    return future;
+}
+
+template <typename T>
+void AssetLoader<T>::SubmitLoad(const std::string& path, AssetLoadQueue& loadQueue, Promise promise)
+{
+    // Nothing to upload in the other context, the generic loader might create objects that are not shared
+    loadQueue.SubmitUpload([]() {}, [this, path, promise]()
+        {
+            promise->set_value(std::make_shared<T>(Load(path.c_str())));
+        });
+}
@@ -5,11 +5,18 @@
 #include <ituGL/geometry/Model.h>
 #include <ituGL/geometry/Mesh.h>
 #include <ituGL/asset/Texture2DLoader.h>
+#include <ituGL/geometry/VertexFormat.h>
+#include <ituGL/geometry/MeshOptimizer.h>
+#include <ituGL/geometry/MeshSimplifier.h>
+#include <ituGL/texture/TextureMipChain.h>
+#include <ituGL/utils/MappedFile.h>
+#include <glm/vec3.hpp>
 #include <vector>
+#include <string>
+#include <cstdint>
 
 struct aiMesh;
 struct aiMaterial;
-class VertexFormat;
 
 // Asset loader for Models. Contains a pointer to a reference material for loaded submeshes
 class ModelLoader : public AssetLoader<Model>
@@ -18,6 +25,9 @@ public:
     // Enum to read material properties from the file
     enum class MaterialProperty;
 
+    // Enum to choose how compact the vertex attributes are stored
+    enum class VertexQuantization;
+
 public:
     ModelLoader(std::shared_ptr<Material> referenceMaterial = nullptr);
 
@@ -30,6 +40,19 @@ public:
     Texture2DLoader& GetTexture2DLoader();
     const Texture2DLoader& GetTexture2DLoader() const;
 
+    // If enabled, the imported meshes are written to a binary file next to the source, "<path>.mesh", and later loads
+    // map that file and upload the vertex and element data directly, skipping the import
+    inline bool GetUseMeshCache() const { return m_useMeshCache; }
+    inline void SetUseMeshCache(bool useMeshCache) { m_useMeshCache = useMeshCache; }
+
+    inline VertexQuantization GetVertexQuantization() const { return m_vertexQuantization; }
+    inline void SetVertexQuantization(VertexQuantization vertexQuantization) { m_vertexQuantization = vertexQuantization; }
+
+    // Number of simplified levels of detail generated for each triangle submesh, each one with about half the triangles
+    // of the previous one. They index the same vertices, and the model selects them by screen size
+    inline unsigned int GetLodCount() const { return m_lodCount; }
+    inline void SetLodCount(unsigned int lodCount) { m_lodCount = lodCount; }
+
     // Load the model from the path
     Model Load(const char* path) override;
 
@@ -39,19 +62,167 @@ public:
     // Maps a material property to a uniform in the shader program used by the material
     bool SetMaterialProperty(MaterialProperty materialProperty, const char* uniformName);
 
+    // Size and modification time of the model file. The caches built from it are outdated when they change
+    static bool GetSourceStamp(const char* path, uint64_t& sourceSize, int64_t& sourceTime);
+
+protected:
+    // Import the file and decode the textures on a worker thread, upload the buffers and textures with a GL context,
+    // and create the vertex arrays and materials on the GL thread
+    void SubmitLoad(const std::string& path, AssetLoadQueue& loadQueue, Promise promise) override;
+
 private:
-    // Generate a submesh from the loaded mesh data
-    void GenerateSubmesh(Mesh& mesh, const aiMesh& meshData);
+    // Settings copied when a load starts, so background loads don't depend on the loader
+    struct LoadSettings
+    {
+        std::shared_ptr<Material> referenceMaterial;
+        Mesh::SemanticMap materialAttributeMap;
+        std::unordered_map<MaterialProperty, ShaderProgram::Location> materialPropertyMap;
+        bool createMaterials;
+        bool flipTextures;
+        bool generateMipmap;
+        bool useMeshCache;
+        VertexQuantization vertexQuantization;
+        unsigned int lodCount;
+        // Streamer of the texture loader, textures loaded in the background are streamed if set
+        TextureStreamer* textureStreamer;
+    };
+
+    // Vertex and element data of a mesh in the file, packed and ready to upload
+    struct SubmeshData
+    {
+        VertexFormat vertexFormat;
+        // Point to the storage vectors when imported, or to the mapped mesh cache
+        std::span<const GLubyte> vertexData;
+        std::span<const GLubyte> elementData;
+        std::vector<GLubyte> vertexStorage;
+        std::vector<GLubyte> elementStorage;
+        Data::Type elementType;
+        std::vector<Drawcall::Primitive> primitives;
+        std::vector<int> elementCounts;
+        // End of the elements of each coarser level of detail, stored after the full one. Only for single triangle lists
+        std::vector<int> lodElementCounts;
+        unsigned int materialIndex;
+        // Box containing the vertex positions
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        // Buffers in the mesh, once uploaded
+        unsigned int vboIndex = 0;
+        unsigned int eboIndex = 0;
+    };
+
+    // Properties of a material in the file, before they are mapped to the uniforms of the reference material
+    struct MaterialData
+    {
+        // Colors use the 3 components, numbers only the first one
+        std::unordered_map<MaterialProperty, glm::vec3> values;
+        // Texture paths, relative to the folder of the model
+        std::unordered_map<MaterialProperty, std::string> texturePaths;
+    };
+
+    // Value of a material property found in the file
+    struct MaterialValue
+    {
+        MaterialProperty property;
+        ShaderProgram::Location location;
+        // Colors use the 3 components, numbers only the first one
+        glm::vec3 value;
+        // Texture properties store the full path, and the format to load it with
+        std::string texturePath;
+        TextureObject::Format textureFormat;
+        TextureObject::InternalFormat textureInternalFormat;
+    };
+
+    // Everything read from the file that doesn't need the GL context
+    struct ModelData
+    {
+        bool loaded = false;
+        // Mesh cache the submesh data points to, if it was read from there
+        MappedFile meshCache;
+        std::vector<SubmeshData> submeshes;
+        std::vector<std::vector<MaterialValue>> materials;
+        // Textures decoded in the background, by path. Empty when they are loaded through the texture loader
+        std::unordered_map<std::string, TextureData> textures;
+        // Mip chains built in the background instead of the decoded textures, when they are streamed
+        std::unordered_map<std::string, TextureMipChain> mipChains;
+        // Objects created in the upload. Buffers and textures are shared between contexts, so they can be created on the upload thread
+        std::shared_ptr<Mesh> mesh;
+        std::unordered_map<std::string, std::shared_ptr<Texture2DObject>> createdTextures;
+    };
+
+private:
+    // Copy the current settings
+    LoadSettings GetLoadSettings() const;
+
+    // Read the file and pack the vertex data. Doesn't use the loader or the GL context, so it can run on a worker thread
+    static ModelData ImportModel(const char* path, const LoadSettings& settings, bool decodeTextures);
+
+    // Create the buffers of the mesh and the textures from the imported data. If there is a texture loader, textures are loaded
+    // and shared through it, otherwise they are created from the decoded data, that is released afterwards
+    static void UploadModel(ModelData& modelData, const LoadSettings& settings, Texture2DLoader* textureLoader);
+
+    // Create the vertex arrays and materials of the uploaded data. Vertex arrays are not shared, so it must run on the GL thread
+    static Model FinishModel(ModelData& modelData, const LoadSettings& settings);
+
+    // Read the submeshes and materials with assimp
+    static bool ImportScene(const char* path, const LoadSettings& settings, ModelData& modelData, std::vector<MaterialData>& materialDatas);
+
+    // Read the submeshes and materials from the mesh cache, if it is up to date with the source file
+    static bool ReadMeshCache(const char* path, const LoadSettings& settings, ModelData& modelData, std::vector<MaterialData>& materialDatas);
+
+    // Write the submeshes and materials to the mesh cache
+    static void WriteMeshCache(const char* path, const LoadSettings& settings, const ModelData& modelData, const std::vector<MaterialData>& materialDatas);
+
+    // Pack the vertex and element data of a mesh in the file
+    static SubmeshData CollectSubmeshData(const aiMesh& meshData, VertexQuantization vertexQuantization);
 
-    // Generate a material from the loaded material data
-    std::shared_ptr<Material> GenerateMaterial(const aiMaterial& materialData);
+    // Reorder the triangles and vertices of a triangle list for the vertex cache, overdraw and vertex fetch.
+    // Adds the vertex cache statistics before and after, weighted by the number of triangles
+    static void OptimizeSubmeshData(SubmeshData& submeshData, MeshOptimizer::Statistics& before, MeshOptimizer::Statistics& after);
 
-    // Load a texture of the specific type in the location
-    void LoadTexture(const aiMaterial& materialData, int textureType, Material& material, ShaderProgram::Location location,
-        TextureObject::Format format, TextureObject::InternalFormat internalFormat) const;
+    // Simplify the triangle list into coarser levels of detail, appended to the element data.
+    // Adds the number of triangles of each level to lodTriangleCounts
+    static void GenerateSubmeshLods(SubmeshData& submeshData, unsigned int lodCount, std::vector<unsigned int>& lodTriangleCounts);
+
+    // Unpack element data to 32-bit indices
+    static std::vector<uint32_t> UnpackElementData(std::span<const GLubyte> elementData, Data::Type elementType);
+
+    // Pack 32-bit indices to the element type, at the end of the element data
+    static void PackElementData(std::span<const uint32_t> indices, Data::Type elementType, std::vector<GLubyte>& elementData);
+
+    // Upload the packed mesh data to new buffers in the mesh
+    static void UploadSubmeshData(Mesh& mesh, SubmeshData& submeshData);
+
+    // Generate a submesh from the uploaded mesh data
+    static void GenerateSubmesh(Mesh& mesh, SubmeshData& submeshData, const Mesh::SemanticMap& materialAttributeMap);
+
+    // Create the textures used by the materials, once each
+    static void UploadTextures(ModelData& modelData, const LoadSettings& settings, Texture2DLoader* textureLoader);
+
+    // Add the textures with mip chains to the streamer. It can only be used from the GL thread
+    static void CreateStreamedTextures(ModelData& modelData, const LoadSettings& settings);
+
+    // Read the properties of a material in the file
+    static MaterialData CollectMaterialData(const aiMaterial& materialData);
+
+    // Add the path of the texture of the specific type, if the material has one
+    static void CollectTexturePath(const aiMaterial& materialData, int textureType, MaterialProperty materialProperty, MaterialData& data);
+
+    // Read the values of the mapped properties from the material data
+    static std::vector<MaterialValue> CollectMaterialValues(const MaterialData& materialData, const LoadSettings& settings, const std::string& baseFolder);
+
+    // Add a texture value if the material data has a texture for the property
+    static void CollectTextureValue(const MaterialData& materialData, MaterialValue& materialValue,
+        std::vector<MaterialValue>& materialValues, const std::string& baseFolder,
+        TextureObject::Format format, TextureObject::InternalFormat internalFormat);
+
+    // Generate a material from the material values
+    static std::shared_ptr<Material> GenerateMaterial(const std::vector<MaterialValue>& materialValues, const LoadSettings& settings, const ModelData& modelData);
 
     // Build the vertex data from the mesh data
-    static std::vector<GLubyte> CollectVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved);
+    static std::vector<GLubyte> CollectVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved, VertexQuantization vertexQuantization);
+
+    // Convert the values of a float attribute in the mesh data to the packed type of the attribute
+    static void PackVertexAttribute(const aiMesh& meshData, const VertexAttribute& attribute, void* dstBuffer, size_t dstStride);
 
     // Build the element data from the mesh data
     static std::vector<GLubyte> CollectElementData(const aiMesh& meshData, Data::Type& elementType,
@@ -67,9 +238,6 @@ private:
     static Drawcall::Primitive GetPrimitiveType(int elementCount);
 
 private:
-    // Path to the base folder where we are loading the current model
-    std::string m_baseFolder;
-
     // Pointer to the reference material
     std::shared_ptr<Material> m_referenceMaterial;
 
@@ -82,6 +250,15 @@ private:
     // Should create new materials for each submesh or use the reference material
     bool m_createMaterials;
 
+    // Read and write the binary mesh cache next to the source files
+    bool m_useMeshCache;
+
+    // Types used for the vertex attributes of the loaded meshes
+    VertexQuantization m_vertexQuantization;
+
+    // Simplified levels of detail generated for the loaded meshes
+    unsigned int m_lodCount;
+
     // Texture loader to cache already loaded shared textures
     mutable Texture2DLoader m_textureLoader;
 };
@@ -96,3 +273,15 @@ enum class ModelLoader::MaterialProperty
     NormalTexture,
     SpecularTexture,
 };
+
+enum class ModelLoader::VertexQuantization
+{
+    // All the attributes are floats, like in the file
+    None,
+    // Normals, tangents and bitangents in 10-10-10-2 snorm, texture coordinates in unorm16 if they are in [0, 1]
+    // or half floats otherwise. Positions stay floats, so shaders can keep offsetting them in model space
+    Packed,
+    // Like Packed, but without bitangents. The tangent w stores the handedness, and shaders must compute the bitangent
+    // as cross(normal, tangent.xyz) * tangent.w
+    PackedTangentSign,
+};
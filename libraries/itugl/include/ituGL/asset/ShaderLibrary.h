@@ -0,0 +1,133 @@
+#pragma once
+
+#include <ituGL/shader/Shader.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <future>
+#include <span>
+#include <cstdint>
+
+class ShaderProgram;
+
+// Loads shader source files once, expands #include directives, and shares compiled shaders and linked programs.
+// Shaders are identified by the hash of their final preprocessed source, so identical inputs compile only once
+class ShaderLibrary
+{
+public:
+    using Hash = std::uint64_t;
+
+    // Program that might still be compiling. Calling get() waits for it on the calling thread, that must own the GL context
+    using ProgramFuture = std::shared_future<std::shared_ptr<ShaderProgram>>;
+
+    // Counters to measure how much work the library did, and how much it saved
+    struct Stats
+    {
+        unsigned int fileReads = 0;
+        unsigned int shaderCompiles = 0;
+        unsigned int shaderReuses = 0;
+        unsigned int programLinks = 0;
+        unsigned int programReuses = 0;
+        double compileSeconds = 0.0;
+        double linkSeconds = 0.0;
+        double waitSeconds = 0.0;
+    };
+
+public:
+    ShaderLibrary();
+
+    // Not copyable or movable, pending futures keep a pointer to the library
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    void operator = (const ShaderLibrary&) = delete;
+
+    // Get the contents of a source file. The file is only read from disk the first time
+    const std::string& GetFileSource(const std::string& path);
+
+    // Concatenate the source files, expanding #include "file" directives (paths relative to the including file).
+    // Every file is added at most once, so shared headers can be listed and included freely.
+    // Optional defines (for example "#define FOG\n") are inserted right after the #version line
+    std::string Preprocess(std::span<const char*> paths, const std::string& defines = std::string());
+
+    // Get a compiled shader from the list of source files. Shaders with the same preprocessed source are shared
+    std::shared_ptr<const Shader> GetShader(Shader::Type type, std::span<const char*> paths, const std::string& defines = std::string());
+
+    // Get a linked program from the vertex and fragment source files. Programs with the same shaders are shared
+    std::shared_ptr<ShaderProgram> GetProgram(std::span<const char*> vertexShaderPaths, std::span<const char*> fragmentShaderPaths,
+        const std::string& defines = std::string());
+
+    // Start building a program without waiting for the result. Submit all programs first, then wait on the futures,
+    // so the driver can compile them in parallel while the application does other work, like loading textures
+    ProgramFuture SubmitProgram(std::span<const char*> vertexShaderPaths, std::span<const char*> fragmentShaderPaths,
+        const std::string& defines = std::string());
+
+    // Finish the programs that completed in the background, without blocking. Returns how many are still pending.
+    // Without KHR_parallel_shader_compile there is no way to know, so nothing is finished until waited on
+    unsigned int Poll();
+
+    // Wait for all the pending programs
+    void WaitAll();
+
+    // Release all cached files, shaders and programs. Objects still referenced elsewhere stay alive
+    void Clear();
+
+    inline const Stats& GetStats() const { return m_stats; }
+
+    // Print the stats to the console
+    void PrintStats() const;
+
+    // Check if the driver can compile in the background, and report when it is done
+    bool IsParallelCompileSupported();
+
+    // 64-bit FNV-1a hash, used to identify sources
+    static Hash ComputeHash(std::string_view data, Hash seed = 14695981039346656037ull);
+
+private:
+    struct ShaderEntry
+    {
+        std::shared_ptr<Shader> shader;
+        std::string sourceNames;
+        bool finished = false;
+    };
+
+    struct ProgramEntry
+    {
+        std::shared_ptr<ShaderProgram> program;
+        Hash vertexShaderHash = 0;
+        Hash fragmentShaderHash = 0;
+        ProgramFuture future;
+        bool finished = false;
+    };
+
+private:
+    void PreprocessFile(const std::string& path, std::string& output, std::unordered_set<std::string>& includedFiles, int depth,
+        const std::string*& pendingDefines);
+
+    // Start compiling the shader if it is not in the library yet, and return its hash
+    Hash SubmitShader(Shader::Type type, std::span<const char*> paths, const std::string& defines);
+
+    // Query the results, blocking if they are not ready, and report the errors
+    void FinishShader(ShaderEntry& shaderEntry);
+    std::shared_ptr<ShaderProgram> FinishProgram(Hash programHash);
+
+    static const char* GetTypeName(Shader::Type type);
+
+private:
+    // Raw contents of the files that have been read, indexed by path
+    std::unordered_map<std::string, std::string> m_fileSources;
+
+    // Shaders, indexed by the hash of type + preprocessed source
+    std::unordered_map<Hash, ShaderEntry> m_shaders;
+
+    // Programs, indexed by the combined hash of their shaders
+    std::unordered_map<Hash, ProgramEntry> m_programs;
+
+    // Number of programs submitted but not finished
+    unsigned int m_pendingProgramCount;
+
+    // -1 until queried from the device, that might not exist when the library is created
+    int m_parallelCompileSupported;
+
+    Stats m_stats;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <ituGL/asset/ShaderLibrary.h>
+#include <unordered_map>
+#include <functional>
+#include <vector>
+#include <string>
+#include <memory>
+#include <span>
+
+// Set of programs built from the same shader sources, with different features enabled by compile-time keywords.
+// Each keyword adds a #define to the sources, and variants are only compiled the first time they are requested
+class ShaderVariantSet
+{
+public:
+    // Feature keywords. The shader sources can check them with #ifdef
+    enum Keyword : unsigned int
+    {
+        NoKeywords = 0,
+        Fog = 1 << 0,           // FOG
+        ShadowPass = 1 << 1,    // SHADOW_PASS
+        Instanced = 1 << 2,     // INSTANCED
+        NormalMap = 1 << 3,     // NORMAL_MAP
+        VirtualFeedback = 1 << 4 // VIRTUAL_FEEDBACK
+    };
+
+    // Number of different keywords
+    static constexpr unsigned int KeywordCount = 5;
+
+    // Combination of keywords
+    using KeywordMask = unsigned int;
+
+    // Called once for every new variant, for example to register it with the renderer
+    using VariantCreatedFunction = std::function<void(std::shared_ptr<ShaderProgram>, KeywordMask)>;
+
+public:
+    ShaderVariantSet(ShaderLibrary& shaderLibrary, std::span<const char*> vertexShaderPaths, std::span<const char*> fragmentShaderPaths,
+        KeywordMask supportedKeywords);
+
+    // Keywords that the sources react to. Other keywords are ignored when selecting a variant
+    inline KeywordMask GetSupportedKeywords() const { return m_supportedKeywords; }
+
+    // Must be set before getting the first variant
+    void SetVariantCreatedFunction(VariantCreatedFunction variantCreatedFunction);
+
+    // Start compiling a variant, without waiting for it. Useful to prepare the variants that will be needed
+    ShaderLibrary::ProgramFuture SubmitVariant(KeywordMask keywords);
+
+    // Get the program for the keywords, compiling it if needed
+    std::shared_ptr<ShaderProgram> GetVariant(KeywordMask keywords);
+
+    // Get the #define lines for the keywords
+    static std::string GetDefines(KeywordMask keywords);
+
+    // Get the name used in the #define of a single keyword
+    static const char* GetKeywordName(Keyword keyword);
+
+private:
+    struct Variant
+    {
+        ShaderLibrary::ProgramFuture future;
+        bool created = false;
+    };
+
+private:
+    ShaderLibrary& m_shaderLibrary;
+
+    // Paths stored as strings, plus the pointers that the library expects
+    std::vector<std::string> m_sourcePaths;
+    std::vector<const char*> m_vertexShaderPaths;
+    std::vector<const char*> m_fragmentShaderPaths;
+
+    KeywordMask m_supportedKeywords;
+
+    std::unordered_map<KeywordMask, Variant> m_variants;
+
+    VariantCreatedFunction m_variantCreatedFunction;
+};
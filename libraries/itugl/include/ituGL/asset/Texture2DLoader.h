@@ -2,6 +2,9 @@
 
 #include <ituGL/asset/TextureLoader.h>
 #include <ituGL/texture/Texture2DObject.h>
+#include <ituGL/asset/TextureCache.h>
+
+class TextureStreamer;
 
 // Asset loader for Texture2DObject
 class Texture2DLoader : public TextureLoader<Texture2DObject>
@@ -18,11 +21,46 @@ public:
         TextureObject::Format format, TextureObject::InternalFormat internalFormat,
         bool generateMipmap = true, bool flipVertical = false, bool wrapping = true);
 
+    // Helper to easily load a shared texture in the background
+    static AssetFuture<Texture2DObject> LoadTextureSharedAsync(const char* path, AssetLoadQueue& loadQueue,
+        TextureObject::Format format, TextureObject::InternalFormat internalFormat,
+        bool generateMipmap = true, bool flipVertical = false, bool wrapping = true);
+
+    // Helper to easily load a texture in the background, streaming its mip levels
+    static AssetFuture<Texture2DObject> LoadTextureStreamedAsync(const char* path, AssetLoadQueue& loadQueue, TextureStreamer& streamer,
+        TextureObject::Format format, TextureObject::InternalFormat internalFormat,
+        bool flipVertical = false, bool wrapping = true);
+
+    // Create the texture object from the decoded pixels. Requires the GL context
+    static Texture2DObject CreateTexture(const TextureData& textureData,
+        TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool generateMipmap, bool wrapping);
+
     inline bool GetFlipVertical() const { return m_flipVertical; }
     inline void SetFlipVertical(bool flipVertical) { m_flipVertical = flipVertical; }
     inline bool GetWrapping() const { return m_wrap; }
     inline void SetWrapping(bool wrap) { m_wrap = wrap; }
 
+    // If set, textures loaded in the background are streamed: the mip chain is built on the worker, and the texture
+    // is usable once the smallest levels are uploaded. Textures loaded synchronously are not affected
+    inline TextureStreamer* GetStreamer() const { return m_streamer; }
+    inline void SetStreamer(TextureStreamer* streamer) { m_streamer = streamer; }
+
+    // If set, textures are read from the cache, or cooked into it the first time, with their mipmaps built on the CPU.
+    // Textures loaded with a streamer don't use the cache
+    inline TextureCache* GetCache() const { return m_cache; }
+    inline void SetCache(TextureCache* cache) { m_cache = cache; }
+
+    // Block compress the textures stored in the cache
+    inline bool GetCompressed() const { return m_compressed; }
+    inline void SetCompressed(bool compressed) { m_compressed = compressed; }
+
+    // Settings of the loader that change the cached data, to read the same cached file elsewhere
+    TextureCache::Settings GetCacheSettings() const;
+
+protected:
+    // Decode the image on a worker thread, and create the texture on the GL thread
+    void SubmitLoad(const std::string& path, AssetLoadQueue& loadQueue, Promise promise) override;
+
 private:
     // If true, the texture will be flipped vertically on load
     // This option exists because some systems define the vertical origin as "up", and others as "down"
@@ -30,4 +68,13 @@ private:
 
     // If textures aren't supposed to wrap, we need to set some additional import flags.
     bool m_wrap;
+
+    // Streamer of the textures loaded in the background, null if they are uploaded at once
+    TextureStreamer* m_streamer;
+
+    // Cache of converted textures, null if they are decoded on every load
+    TextureCache* m_cache;
+
+    // If the textures in the cache are block compressed
+    bool m_compressed;
 };
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <ituGL/texture/Texture2DObject.h>
+#include <ituGL/utils/MappedFile.h>
+#include <ituGL/core/Data.h>
+#include <string>
+#include <vector>
+#include <span>
+#include <cstdint>
+
+// Cache of 2D textures converted to the layout they are uploaded with: the whole mip chain, built on the CPU,
+// and optionally block compressed. Each texture is stored in its own file, named after the hash of the source image
+// and the load settings, so changing either of them cooks a new file. Cached files are memory mapped and their levels
+// copied straight to the texture, skipping the image decoding and the mipmap generation.
+// It keeps no state besides the folder, so it can be used from several worker threads at the same time
+class TextureCache
+{
+public:
+    // Load settings that change the cached data
+    struct Settings
+    {
+        TextureObject::Format format = TextureObject::FormatInvalid;
+        TextureObject::InternalFormat internalFormat = TextureObject::InternalFormatInvalid;
+        bool flipVertical = false;
+        bool generateMipmap = true;
+        // Compress to the BC format that matches the component count. Only for textures with 8-bit components
+        bool compress = false;
+    };
+
+    // Texture read from the cache, pointing to the mapped file
+    struct CachedTexture
+    {
+        MappedFile file;
+        TextureObject::Format format = TextureObject::FormatInvalid;
+        TextureObject::InternalFormat internalFormat = TextureObject::InternalFormatInvalid;
+        Data::Type dataType = Data::Type::None;
+        int width = 0;
+        int height = 0;
+        // Data of each level, from the full size down
+        std::vector<std::span<const std::byte>> levels;
+    };
+
+public:
+    TextureCache(const char* folder);
+
+    inline const std::string& GetFolder() const { return m_folder; }
+
+    // Map the cached version of the image, cooking it first if there is none. Returns false if the image can't be loaded
+    bool Load(const char* path, const Settings& settings, CachedTexture& cachedTexture) const;
+
+    // Create the texture object with all the cached levels. Requires the GL context
+    static Texture2DObject CreateTexture(const CachedTexture& cachedTexture, bool wrapping);
+
+private:
+    // Path of the cache file for the image contents and the settings
+    std::string GetCachePath(std::span<const std::byte> source, const Settings& settings) const;
+
+    // Decode the image, build the levels and write them to the cache file
+    static bool Cook(const char* path, const Settings& settings, const std::string& cachePath);
+
+    // Map the cache file and check that it is complete
+    static bool Open(const std::string& cachePath, CachedTexture& cachedTexture);
+
+private:
+    // Bumped when the file layout changes, so old files are not read
+    static constexpr uint32_t FileVersion = 1;
+
+    // Layout of the beginning of the file, followed by one LevelHeader per level and the data of the levels
+    struct FileHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t format;
+        uint32_t internalFormat;
+        uint32_t dataType;
+        int32_t width;
+        int32_t height;
+        uint32_t levelCount;
+    };
+
+    // Where the data of each level is, from the beginning of the file
+    struct LevelHeader
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::string m_folder;
+};
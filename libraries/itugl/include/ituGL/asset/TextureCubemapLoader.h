@@ -18,7 +18,21 @@ public:
         TextureObject::Format format, TextureObject::InternalFormat internalFormat,
         bool generateMipmap = true);
 
+    // Helper to easily load a shared texture in the background
+    static AssetFuture<TextureCubemapObject> LoadTextureSharedAsync(const char* path, AssetLoadQueue& loadQueue,
+        TextureObject::Format format, TextureObject::InternalFormat internalFormat,
+        bool generateMipmap = true);
+
+    // Create the texture object from the decoded pixels, with the faces in a horizontal cross. Requires the GL context
+    static TextureCubemapObject CreateTexture(const TextureData& textureData,
+        TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool generateMipmap);
+
+protected:
+    // Decode the image on a worker thread, and create the texture on the GL thread
+    void SubmitLoad(const std::string& path, AssetLoadQueue& loadQueue, Promise promise) override;
+
 private:
-    void LoadFace(TextureCubemapObject& textureCubemap, TextureCubemapObject::Face face, std::span<const std::byte> dataSrc, std::span<std::byte> dataDst, int x, int y, int side, Data::Type dataType);
+    static void LoadFace(TextureCubemapObject& textureCubemap, TextureCubemapObject::Face face, std::span<const std::byte> dataSrc, std::span<std::byte> dataDst, int x, int y, int side,
+        TextureObject::Format format, TextureObject::InternalFormat internalFormat, Data::Type dataType);
 };
 
@@ -5,6 +5,16 @@
 #include <ituGL/texture/TextureObject.h>
 #include <ituGL/core/Data.h>
 
+// Pixels decoded from an image file, before they are copied to a texture object
+struct TextureData
+{
+    int width = 0;
+    int height = 0;
+    Data::Type dataType = Data::Type::None;
+    // Owned by the image library, release with TextureLoaderUtils::FreeTextureData
+    std::span<const std::byte> data;
+};
+
 // Base class for all Texture asset loaders
 template<typename T>
 class TextureLoader : public AssetLoader<T>
@@ -37,13 +47,20 @@ protected:
     bool m_generateMipmap;
 };
 
+// Decoding doesn't use any shared state, so these can be called from worker threads
 class TextureLoaderUtils
 {
 public:
     static std::span<const std::byte> LoadTexture2DData(const char* path, int& width, int& height, Data::Type& dataType, TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool flipVertical);
     static void FreeTexture2DData(std::span<const std::byte> data);
+
+    static TextureData LoadTextureData(const char* path, TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool flipVertical);
+    static void FreeTextureData(TextureData& textureData);
 private:
     static bool IsHDR(TextureObject::InternalFormat internalFormat);
+
+    // Flip the rows of the image in place
+    static void FlipVertical(std::byte* data, int width, int height, int pixelSize);
 };
 
 template<typename T>
@@ -13,6 +13,12 @@ public:
         ArrayBuffer = GL_ARRAY_BUFFER,
         // Element Buffer Object
         ElementArrayBuffer = GL_ELEMENT_ARRAY_BUFFER,
+        // Uniform Buffer Object
+        UniformBuffer = GL_UNIFORM_BUFFER,
+        // Pixel Buffer Object, source of texture uploads
+        PixelUnpackBuffer = GL_PIXEL_UNPACK_BUFFER,
+        // Pixel Buffer Object, destination of pixel reads
+        PixelPackBuffer = GL_PIXEL_PACK_BUFFER,
         // TODO: There are more types, add them when they are supported
     };
 
@@ -55,14 +61,26 @@ public:
     void AllocateData(size_t size, Usage usage);
     void AllocateData(std::span<const std::byte> data, Usage usage);
 
+    // Size in bytes of the last allocation
+    inline size_t GetSize() const { return m_size; }
+
     // Modify the contents of the buffer, starting at offset
     void UpdateData(std::span<const std::byte> data, size_t offset = 0);
 
+    // Map a range of the buffer to access it directly. Access is a combination of GL_MAP_*_BIT flags
+    std::span<std::byte> MapData(size_t offset, size_t size, GLbitfield access);
+
+    // Unmap the buffer. Returns false if the contents were lost, and must be written again
+    bool UnmapData();
+
 protected:
     // Bind the specific target. Used by the Bind() method in derived classes
     void Bind(Target target) const;
     // Unbind the specific target. It is static because we dont need any objects to do it
     static void Unbind(Target target);
+
+private:
+    size_t m_size;
 };
 
 // (C++) 5
@@ -93,14 +111,14 @@ protected:
     // Check if this BufferObject is currently bound to this target
     inline bool IsBound() const override { return s_boundHandle == GetHandle(); }
 
-    // Handle of the buffer object that is currently bound to this target
-    static Handle s_boundHandle;
+    // Handle of the buffer object that is currently bound to this target. Per thread, each thread has its own context
+    static thread_local Handle s_boundHandle;
 #endif
 };
 
 #ifndef NDEBUG
 template<BufferObject::Target T>
-Object::Handle BufferObjectBase<T>::s_boundHandle = Object::NullHandle;
+thread_local Object::Handle BufferObjectBase<T>::s_boundHandle = Object::NullHandle;
 #endif
 
 template<BufferObject::Target T>
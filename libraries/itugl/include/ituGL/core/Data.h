@@ -20,6 +20,9 @@ public:
         UShort = GL_UNSIGNED_SHORT,
         Int = GL_INT,
         UInt = GL_UNSIGNED_INT,
+        // Packed types, with 4 components in 32 bits: 10 bits for x, y and z, and 2 for w
+        Int2101010Rev = GL_INT_2_10_10_10_REV,
+        UInt2101010Rev = GL_UNSIGNED_INT_2_10_10_10_REV,
         // And more...
     };
 
@@ -34,9 +37,12 @@ public:
     template<typename T>
     static Type GetType(const T&);
 
-    // Get size in bytes for each Type
+    // Get size in bytes for each Type. For packed types, it is the size of all the components together
     static unsigned int GetTypeSize(Type type);
 
+    // Check if all the components are packed in a single value of the type
+    static bool IsPackedType(Type type);
+
     // Convert data to a span of bytes
     template <typename T>
     static std::span<std::byte> GetBytes(T& data);
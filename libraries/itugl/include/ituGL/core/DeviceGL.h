@@ -53,6 +53,9 @@ public:
     // enable / disable v-sync
     void SetVSyncEnabled(bool enabled);
 
+    // Check if the current context supports an extension, for example "GL_KHR_parallel_shader_compile"
+    bool IsExtensionSupported(const char* extension) const;
+
 private:
     // Has a context been loaded? We use the context of the current window
     bool m_contextLoaded;
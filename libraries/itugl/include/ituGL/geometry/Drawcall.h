@@ -31,6 +31,10 @@ public:
     // Check if the drawcall is valid
     inline bool IsValid() const { return m_primitive != Primitive::Invalid && m_count > 0; }
 
+    // Number of instances drawn. With more than one, the drawcall is instanced. With none, nothing is drawn
+    inline GLsizei GetInstanceCount() const { return m_instanceCount; }
+    inline void SetInstanceCount(GLsizei instanceCount) { m_instanceCount = instanceCount; }
+
     // Execute the drawcall
     void Draw() const;
 
@@ -46,4 +50,7 @@ private:
 
     // Data type of the elements in the EBO (int, uint, short, byte, etc.). A value of None means no EBO
     Data::Type m_eboType;
+
+    // Number of instances to draw
+    GLsizei m_instanceCount;
 };
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+class Heightfield;
+class AssetLoadQueue;
+
+// Dunes that move slowly with the wind, simulated as a cellular automaton over the texels of a heightfield, in its values.
+// Each tick, the wind lifts sand from the exposed texels and drops it downwind in a few hops. Sand always stays in the
+// texels sheltered behind a crest, and only sometimes on the open sand. Then the slopes steeper than the angle of repose
+// slide down, which rounds the dunes. The map wraps around at the edges, so no sand is lost.
+// Every texel is computed from the previous state of its neighbours, with a random value hashed from the seed, the tick and
+// the texel, so the results are the same for a seed with any number of threads.
+// The ticks run in the background, on the workers of the load queue in bands of tiles, and the inner loops process 4 texels
+// at a time with SSE2, when it is available. The simulation keeps two copies of the map: the one being simulated, and the one
+// published to this thread, which only changes in Update. Tiles are published when they moved enough to be seen
+class DuneSimulation
+{
+public:
+    // Rectangle of texels
+    struct Region
+    {
+        int x, y;
+        int width, height;
+    };
+
+public:
+    // Start from the current values of the heightfield. tileSize is the side of the tiles, in texels
+    DuneSimulation(const Heightfield& heightfield, AssetLoadQueue& loadQueue, unsigned int seed = 0, int tileSize = 16);
+    ~DuneSimulation();
+
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+
+    // Published value of the texel
+    inline float GetValue(int x, int y) const { return m_publishedValues[static_cast<size_t>(y) * m_width + x]; }
+
+    // Ticks per second of the simulation
+    inline void SetTickRate(float tickRate) { m_tickRate = tickRate; }
+    inline float GetTickRate() const { return m_tickRate; }
+
+    // Horizontal size of a texel in the units of the values, to turn the angles into height differences
+    inline void SetTexelSize(float texelSize) { m_texelSize = texelSize; }
+
+    // Direction of the wind on the map, the sand lifted from each exposed texel every tick, and the length of each hop in texels
+    void SetWind(const glm::vec2& direction, float erosion, float hopLength = 3.0f);
+
+    // Slopes, in degrees, of the shadow behind the crests, and of the steepest slope the sand holds
+    inline void SetShadowAngle(float shadowAngle) { m_shadowAngle = shadowAngle; }
+    inline void SetReposeAngle(float reposeAngle) { m_reposeAngle = reposeAngle; }
+
+    // Start the ticks that are due, and publish the last one when it is finished. Returns the regions of texels
+    // that changed in the published values since the last update
+    const std::vector<Region>& Update(float time);
+
+    // Run a tick on this thread, after the one running in the background, and publish both. Returns the regions that changed
+    const std::vector<Region>& Tick();
+
+    inline uint32_t GetTickCount() const { return m_tickCount; }
+
+private:
+    // Parameters of a tick, copied when it starts so they can change while it runs
+    struct TickSettings
+    {
+        uint32_t tick;
+        float erosion;
+        float depositFraction;
+        int hopCount;
+        glm::ivec2 hopOffset;
+        std::vector<glm::ivec2> shadowOffsets;
+        std::vector<float> shadowDrops;
+        float reposeDifference;
+    };
+
+private:
+    TickSettings GetTickSettings() const;
+
+    // Advance the simulated values by one tick
+    void RunTick(const TickSettings& settings);
+
+    // Steps of the tick, on the rows [firstRow, lastRow)
+    void ErodeRows(const TickSettings& settings, int firstRow, int lastRow);
+    void HopRows(const TickSettings& settings, bool lastHop, int firstRow, int lastRow);
+    void AvalancheRows(const TickSettings& settings, int firstRow, int lastRow);
+
+    // Flag the tiles in the row of tiles that moved enough from the published values
+    void FindChangedTiles(int tileY);
+
+    // Copy the changed tiles to the published values, and list them as regions
+    void Publish();
+
+    // Run the function for each band of rows [firstRow, lastRow), one row of tiles each, on the workers and on this thread
+    void ForEachBand(const std::function<void(int, int)>& function);
+
+private:
+    int m_width;
+    int m_height;
+    int m_tileSize;
+    int m_tileCountX;
+    int m_tileCountY;
+
+    AssetLoadQueue& m_loadQueue;
+
+    unsigned int m_seed;
+    uint32_t m_tickCount;
+
+    float m_tickRate;
+    float m_nextTickTime;
+
+    float m_texelSize;
+    glm::vec2 m_windDirection;
+    float m_erosion;
+    float m_hopLength;
+    float m_shadowAngle;
+    float m_reposeAngle;
+
+    // Values of the simulation, only touched by the tick while it runs
+    std::vector<float> m_values;
+    // Scratch values of the tick: sand lifted by the wind, sand still in the air, shadow of each texel, and the values
+    // being written by the step
+    std::vector<float> m_carried;
+    std::vector<float> m_nextCarried;
+    std::vector<float> m_shadow;
+    std::vector<float> m_nextValues;
+
+    // Values seen by this thread, updated in Publish
+    std::vector<float> m_publishedValues;
+
+    // Tiles that moved enough in the last tick to be published
+    std::vector<uint8_t> m_changedTiles;
+
+    // Tick running in the background
+    std::future<void> m_runningTick;
+
+    // Regions of the last update
+    std::vector<Region> m_dirtyRegions;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <ituGL/asset/TextureCache.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+// Copy of a height map kept on the CPU, that samples it the same way as the displacement shaders (depthMapUtils.glsl):
+// bilinear filtering of the full size level with the coordinates clamped to the edge, the 5 sample average of
+// GetHeightFromSample, and the tangent space of GetTangentSpaceVectorsFromSample, with the same operations in the same order.
+// With it, objects standing on the displaced surface get their height and orientation once per frame instead of on every vertex.
+// The batched queries filter 4 points at a time with SSE2, when it is available
+class Heightfield
+{
+public:
+    Heightfield();
+
+    // Copy the full size level of the cached texture, decoding it if it is BC4 compressed, so the values are the ones
+    // the GPU reads. Returns false if the texture is not an 8-bit or BC4 single channel one
+    bool Initialize(const TextureCache::CachedTexture& cachedTexture);
+
+    // Copy an 8-bit single channel image
+    void Initialize(std::span<const unsigned char> data, int width, int height);
+
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+    inline bool IsEmpty() const { return m_values.empty(); }
+
+    // Value of the texel, in [0, 1] for images. Texels can be changed afterwards, to deform the surface
+    inline float GetValue(int x, int y) const { return m_values[static_cast<size_t>(y) * m_width + x]; }
+    void SetValue(int x, int y, float value);
+
+    // Same as texture(depthMap, uv).r
+    float Sample(const glm::vec2& uv) const;
+
+    // Same as GetHeightFromSample
+    float GetHeight(const glm::vec2& uv, float sampleDistance, float offsetStrength) const;
+
+    // Same as GetTangentSpaceVectorsFromSample
+    void GetTangentSpace(const glm::vec2& uv, float sampleDistance, float offsetStrength,
+        glm::vec3& tangent, glm::vec3& bitangent, glm::vec3& normal) const;
+
+    // Batched versions of the queries above. The outputs must have the same size as the coordinates
+    void Sample(std::span<const glm::vec2> uvs, std::span<float> values) const;
+    void GetHeights(std::span<const glm::vec2> uvs, float sampleDistance, float offsetStrength, std::span<float> heights) const;
+    void GetTangentSpaces(std::span<const glm::vec2> uvs, float sampleDistance, float offsetStrength,
+        std::span<glm::vec3> tangents, std::span<glm::vec3> bitangents, std::span<glm::vec3> normals) const;
+
+    // Range of the heights GetHeight can return, to build culling bounds of the displaced surface
+    void GetHeightRange(float offsetStrength, float& minHeight, float& maxHeight) const;
+
+private:
+    // Filter 4 points at once. Every query goes through here, so single and batched queries return the same values
+    void Sample4(const float u[4], const float v[4], float values[4]) const;
+
+private:
+    int m_width;
+    int m_height;
+
+    // Texel values in [0, 1], rows from v = 0 up
+    std::vector<float> m_values;
+
+    // Smallest and biggest texel values. The range only grows when texels change, so bounds built from it stay conservative
+    float m_minValue;
+    float m_maxValue;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <ituGL/texture/Texture2DObject.h>
+#include <glm/vec4.hpp>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <span>
+#include <vector>
+#include <cstdint>
+
+class Heightfield;
+class AssetLoadQueue;
+
+// Bakes what the sand shaders computed from the displacement map on every vertex into one RGBA16F texture, with a texel
+// for each texel of the map: the height of GetHeightFromSample in R, and the normal of GetTangentSpaceVectorsFromSample in GBA.
+// The vertex shaders then need a single fetch. The tangent of GetTangentSpaceVectorsFromSample is always +Z inside the map,
+// so the shaders rebuild the tangent frame from the normal.
+// At the texel centers the baked values are the ones of the shader functions, rounded to half floats; between them they are
+// interpolated. The bake has to run again when the sample distance, the offset strength or the map change. When only some
+// texels of the map change, UpdateRegion bakes again the part of the texture they affect
+class HeightfieldBaker
+{
+public:
+    // Called on the GL thread with each new baked texture
+    using BakedFunction = std::function<void(std::shared_ptr<Texture2DObject>)>;
+
+public:
+    HeightfieldBaker(std::shared_ptr<const Heightfield> heightfield, AssetLoadQueue& loadQueue, BakedFunction bakedFunction);
+
+    // Bake on the workers of the load queue, each one taking a band of rows, and publish the texture once it is uploaded.
+    // The workers bake a copy of the map taken now, the regions passed to UpdateRegion meanwhile are baked again on publishing.
+    // A bake that is still running when a new one starts is abandoned, only the latest one is published
+    void Bake(float sampleDistance, float offsetStrength);
+
+    // Bake on this thread and publish the texture straight away. Requires the GL context
+    void BakeNow(float sampleDistance, float offsetStrength);
+
+    // Bake again the texels affected by a change of the map texels in the region, with the parameters of the last published
+    // bake, and update them in the last published texture. Requires the GL context
+    void UpdateRegion(int x, int y, int width, int height);
+
+    // Last published texture, null until the first bake is published
+    inline std::shared_ptr<Texture2DObject> GetTexture() const { return m_texture; }
+
+    // Bake a region of the map, as 4 half floats per texel, row after row
+    static void BakeRegion(const Heightfield& heightfield, float sampleDistance, float offsetStrength,
+        int x, int y, int width, int height, std::span<uint64_t> output);
+
+    // Create the texture with the baked data. Requires a GL context
+    static std::shared_ptr<Texture2DObject> CreateTexture(int width, int height, std::span<const uint64_t> data);
+
+private:
+    std::shared_ptr<const Heightfield> m_heightfield;
+
+    AssetLoadQueue& m_loadQueue;
+
+    BakedFunction m_bakedFunction;
+
+    // Parameters of the last published bake
+    float m_sampleDistance;
+    float m_offsetStrength;
+
+    // Last published texture
+    std::shared_ptr<Texture2DObject> m_texture;
+
+    // Regions changed since the bake in progress took its copy of the map, as x, y, width and height
+    bool m_bakePending;
+    std::vector<glm::ivec4> m_pendingRegions;
+
+    // Buffer of UpdateRegion, kept to avoid allocating it every time
+    std::vector<uint64_t> m_regionData;
+
+    // Number of the latest bake, shared with the tasks so they can tell if they were replaced
+    std::shared_ptr<std::atomic<unsigned int>> m_generation;
+};
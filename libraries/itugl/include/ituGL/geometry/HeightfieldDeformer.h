@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+class Heightfield;
+
+// Tracks pressed into a Heightfield, that relax back to the original surface over time.
+// The map is divided in square tiles. Stamps lower the texels under their footprint and add the tiles they touch to the
+// current slot of a ring-buffered history, where each slot covers a fixed interval of time and the whole ring covers the
+// relax time. Each update only recomputes the tiles in the history, and reports them as the regions that changed, so the
+// textures built from the heightfield can be updated there alone. The cost follows the area of the recent tracks, not the
+// size of the map
+class HeightfieldDeformer
+{
+public:
+    // Rectangle of texels
+    struct Region
+    {
+        int x, y;
+        int width, height;
+    };
+
+public:
+    // relaxTime is the time, in seconds, for a track to disappear, and slotDuration the time covered by each history slot
+    HeightfieldDeformer(std::shared_ptr<Heightfield> heightfield, float relaxTime = 8.0f, float slotDuration = 0.25f, int tileSize = 16);
+
+    inline float GetRelaxTime() const { return m_relaxTime; }
+
+    // Press a round footprint at the position in texture coordinates, with the radius in texture coordinates and the depth
+    // in heightfield values. Where it overlaps older tracks, the deepest one stays
+    void Stamp(const glm::vec2& uv, float radius, float depth);
+
+    // Change the surface the tracks relax back to, like when the sand moves under them, and apply it to the texel
+    void SetOriginalValue(int x, int y, float value);
+
+    // Relax the tracks to the time, in seconds, and return the regions of texels that changed since the last update
+    const std::vector<Region>& Update(float time);
+
+private:
+    // Set the texels of the tile to their value at the current time
+    void UpdateTile(int tileIndex);
+
+    // Add the tile to the current slot, once
+    void AddTileToHistory(int tileIndex);
+
+    // Index of the slot for the time
+    int64_t GetSlotSequence(float time) const;
+
+private:
+    std::shared_ptr<Heightfield> m_heightfield;
+
+    float m_relaxTime;
+    float m_slotDuration;
+    int m_tileSize;
+    int m_tileCountX;
+    int m_tileCountY;
+
+    // Values of the heightfield before any track
+    std::vector<float> m_originalValues;
+
+    // Depth of the last stamp on each texel, and when it happened
+    std::vector<float> m_stampDepths;
+    std::vector<float> m_stampTimes;
+
+    // Ring-buffered history: the tiles stamped during each interval of time
+    std::vector<std::vector<int>> m_slots;
+    // Sequence number of the current slot, the index in the ring is this modulo the slot count
+    int64_t m_currentSequence;
+
+    // Last sequence each tile was added to, so tiles are only added once per slot
+    std::vector<int64_t> m_tileSequences;
+    // Last update each tile was recomputed in, so tiles in several slots are only recomputed once
+    std::vector<uint32_t> m_tileUpdates;
+    uint32_t m_updateCount;
+
+    float m_time;
+
+    // Regions of the last update
+    std::vector<Region> m_dirtyRegions;
+};
@@ -8,6 +8,7 @@
 #include <ituGL/shader/ShaderProgram.h>
 #include <vector>
 #include <unordered_map>
+#include <memory>
 
 // Class that groups several VBO, EBO and VAO that are part of the same object
 // Can contain several drawcalls using the data in those objects
@@ -27,6 +28,10 @@ public:
     template<typename T>
     unsigned int AddVertexData(std::span<const T> vertices);
 
+    // Replaces the data of a VBO. Meant for data that changes every frame, like per-instance attributes
+    template<typename T>
+    void SetVertexData(unsigned int vboIndex, std::span<const T> vertices);
+
     // Adds a new EBO and initializes it with data
     template<typename T>
     unsigned int AddElementData(std::span<const T> elements);
@@ -46,6 +51,12 @@ public:
     template<typename TIterator>
     unsigned int AddVertexArray(std::span<unsigned int> vboIndices, TIterator& it, const TIterator itEnd, const SemanticMap& locations = SemanticMap());
 
+    // Adds an attribute to an existing VAO, read from a VBO of the mesh, in the location
+    void AddVertexArrayAttribute(unsigned int vaoIndex, unsigned int vboIndex, const VertexAttribute::Layout& attributeLayout, GLuint location);
+
+    // Makes the attribute in location of the VAO advance once every divisor instances, instead of once per vertex
+    void SetVertexArrayDivisor(unsigned int vaoIndex, GLuint location, GLuint divisor);
+
     // Adds a new submesh, with the index of the VAO to be bound, and the Drawcall parameters
     unsigned int AddSubmesh(unsigned int vaoIndex, const Drawcall& drawcall);
 
@@ -106,6 +117,9 @@ public:
     inline unsigned int GetElementBufferCount() const { return static_cast<unsigned int>(m_ebos.size()); }
     inline const ElementBufferObject& GetElementBuffer(unsigned int eboIndex) const { return m_ebos[eboIndex]; }
 
+    // Bytes allocated in all the vertex and element buffers
+    size_t GetBufferSize() const;
+
     inline unsigned int GetVertexArrayCount() const { return static_cast<unsigned int>(m_vaos.size()); }
     inline const VertexArrayObject& GetVertexArray(unsigned int vaoIndex) const { return m_vaos[vaoIndex]; }
 
@@ -113,6 +127,23 @@ public:
     inline const VertexArrayObject& GetSubmeshVertexArray(unsigned int submeshIndex) const { return m_vaos[m_submeshes[submeshIndex].vaoIndex]; }
     inline const Drawcall& GetSubmeshDrawcall(unsigned int submeshIndex) const { return m_submeshes[submeshIndex].drawcall; }
 
+    // Adds the submeshes of another mesh, with new VAOs that read the buffers of that mesh, so both meshes draw the same
+    // data without a copy. Attributes added later to the new VAOs, like instance data, don't change the other mesh.
+    // The other mesh is kept alive by this one, and can't share the buffers of a third one
+    void AddSharedSubmeshes(std::shared_ptr<const Mesh> mesh);
+
+    // Sets how many instances the drawcall of the submesh draws
+    void SetSubmeshInstanceCount(unsigned int submeshIndex, GLsizei instanceCount);
+
+    // Adds a coarser level of detail to a submesh, drawn with the same VAO. Levels must be added from finer to coarser
+    void AddSubmeshLod(unsigned int submeshIndex, const Drawcall& drawcall);
+
+    // Number of levels of detail of the submesh, including the full one
+    inline unsigned int GetSubmeshLodCount(unsigned int submeshIndex) const { return 1 + static_cast<unsigned int>(m_submeshes[submeshIndex].lods.size()); }
+
+    // Drawcall of a level of detail of the submesh. Levels past the coarsest one return the coarsest one
+    const Drawcall& GetSubmeshDrawcall(unsigned int submeshIndex, unsigned int lod) const;
+
     // Draws a submesh
     void DrawSubmesh(int submeshIndex) const;
 
@@ -123,6 +154,25 @@ private:
     {
         unsigned int vaoIndex;
         Drawcall drawcall;
+        // Coarser levels of detail, after the full one in drawcall
+        std::vector<Drawcall> lods;
+    };
+
+    // Attribute set in a VAO, read from a VBO of the mesh
+    struct VertexArrayAttribute
+    {
+        unsigned int vboIndex;
+        VertexAttribute::Layout layout;
+        GLuint location;
+        GLuint divisor;
+    };
+
+    // What was set in a VAO, so AddSharedSubmeshes can set the same in the VAOs of another mesh
+    struct VertexArrayState
+    {
+        std::vector<VertexArrayAttribute> attributes;
+        // Index of the EBO bound to the VAO, if any
+        int eboIndex = -1;
     };
 
 private:
@@ -136,8 +186,9 @@ private:
     inline const Submesh& GetSubmesh(unsigned int submeshIndex) const { return m_submeshes[submeshIndex]; }
     inline Submesh& GetSubmesh(unsigned int submeshIndex) { return m_submeshes[submeshIndex]; }
 
-    // Set a vertex attribute in a VAO, using the specified layout, and increases the location index according to the size of the attribute
-    void SetupVertexAttribute(VertexArrayObject& vao, const VertexAttribute::Layout& attributeLayout, GLuint& location, const SemanticMap& locations);
+    // Set a vertex attribute in a VAO, read from the bound VBO with the index, using the specified layout, and increases the
+    // location index according to the size of the attribute
+    void SetupVertexAttribute(unsigned int vaoIndex, unsigned int vboIndex, const VertexAttribute::Layout& attributeLayout, GLuint& location, const SemanticMap& locations);
 
 private:
     // All the VBOs used in this mesh
@@ -151,6 +202,12 @@ private:
 
     // Submeshes contained in this mesh
     std::vector<Submesh> m_submeshes;
+
+    // State of each VAO, in the same order
+    std::vector<VertexArrayState> m_vertexArrayStates;
+
+    // Meshes whose buffers are read by some of the VAOs
+    std::vector<std::shared_ptr<const Mesh>> m_sharedMeshes;
 };
 
 template<typename T>
@@ -164,6 +221,16 @@ unsigned int Mesh::AddVertexData(std::span<const T> vertices)
     return vboIndex;
 }
 
+template<typename T>
+void Mesh::SetVertexData(unsigned int vboIndex, std::span<const T> vertices)
+{
+    // Allocating again lets the driver give a new buffer instead of waiting for draws that still use the old data
+    VertexBufferObject& vbo = GetVertexBuffer(vboIndex);
+    vbo.Bind();
+    vbo.AllocateData<T>(vertices, BufferObject::StreamDraw);
+    vbo.Unbind();
+}
+
 template<typename T>
 unsigned int Mesh::AddElementData(std::span<const T> elements)
 {
@@ -188,7 +255,7 @@ unsigned int Mesh::AddVertexArray(unsigned int vboIndex, TIterator& it, const TI
     vbo.Bind();
     while (it != itEnd)
     {
-        SetupVertexAttribute(vao, *it, location, locations);
+        SetupVertexAttribute(vaoIndex, vboIndex, *it, location, locations);
         it++;
     }
 
@@ -203,7 +270,7 @@ unsigned int Mesh::AddVertexArray(std::span<unsigned int> vboIndices, TIterator&
 {
     unsigned int vaoIndex = AddVertexArray();
 
-    const VertexArrayObject& vao = GetVertexArray(vaoIndex);
+    VertexArrayObject& vao = GetVertexArray(vaoIndex);
     vao.Bind();
 
     GLuint location = 0;
@@ -218,7 +285,7 @@ unsigned int Mesh::AddVertexArray(std::span<unsigned int> vboIndices, TIterator&
             vbo.Bind();
             i++;
         }
-        SetupVertexAttribute(vao, *it, location, locations);
+        SetupVertexAttribute(vaoIndex, static_cast<unsigned int>(vboIndex), *it, location, locations);
         it++;
     }
 
@@ -258,6 +325,7 @@ unsigned int Mesh::AddSubmesh(Drawcall::Primitive primitive, int firstElement, i
 
     const ElementBufferObject& ebo = GetElementBuffer(eboIndex);
     ebo.Bind();
+    m_vertexArrayStates[vaoIndex].eboIndex = static_cast<int>(eboIndex);
 
     VertexArrayObject::Unbind();
     ElementBufferObject::Unbind();
@@ -277,6 +345,7 @@ unsigned int Mesh::AddSubmesh(Drawcall::Primitive primitive, int firstElement, i
 
     ElementBufferObject& ebo = m_ebos[eboIndex];
     ebo.Bind();
+    m_vertexArrayStates[vaoIndex].eboIndex = static_cast<int>(eboIndex);
 
     VertexArrayObject::Unbind();
     ElementBufferObject::Unbind();
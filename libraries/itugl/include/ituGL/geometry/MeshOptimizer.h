@@ -0,0 +1,41 @@
+#pragma once
+
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// Reorders the triangles and vertices of indexed triangle lists to make better use of the GPU:
+// - Vertex cache: triangles sharing vertices are drawn close together, so fewer vertices are transformed again
+// - Overdraw: groups of triangles facing out of the mesh are drawn first, so early-Z rejects more hidden pixels
+// - Vertex fetch: vertices are stored in the order they are first used, so the reads are sequential
+// Only works on the CPU data, so it can run on worker threads before the upload
+class MeshOptimizer
+{
+public:
+    // Vertex cache efficiency of a triangle list
+    struct Statistics
+    {
+        // Average cache miss ratio: transformed vertices per triangle. 3 is the worst case, 0.5 the best for big grids
+        float acmr = 0.0f;
+        // Average transform to vertex ratio: transformed vertices per vertex. 1 is the best case
+        float atvr = 0.0f;
+    };
+
+public:
+    // Simulate a FIFO post-transform cache of the size, like the ones in the hardware
+    static Statistics AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, int cacheSize = 16);
+
+    // Reorder the triangles for the vertex cache, using the scoring of Tom Forsyth's linear-speed algorithm
+    static void OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+
+    // Reorder clusters of triangles, from the ones facing out of the mesh to the ones facing in. The indices must already
+    // be optimized for the vertex cache; clusters end where the cache is flushed, so they keep most of its efficiency.
+    // The order is only changed if the ACMR stays under threshold times the original one.
+    // Positions are 3 floats at positionOffset inside each vertex
+    static void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const std::byte> vertexData, size_t vertexSize,
+        size_t positionOffset, float threshold = 1.05f);
+
+    // Reorder the vertices in the order they are first used and remap the indices. Unused vertices are removed.
+    // Returns the number of vertices left at the beginning of the data
+    static size_t OptimizeVertexFetch(std::span<uint32_t> indices, std::span<std::byte> vertexData, size_t vertexSize);
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Reduces the triangles of indexed triangle lists to build levels of detail, collapsing edges in the order of the
+// quadric error metric (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics").
+// Collapses move a vertex onto one of its neighbours, so the simplified lists index the same vertex data and the
+// attributes are never interpolated. Vertices on attribute seams (same position, different vertex) and on open
+// borders are kept, so UVs, normals and silhouettes of open parts don't tear.
+// Only works on the CPU data, so it can run on worker threads before the upload
+class MeshSimplifier
+{
+public:
+    // Collapse edges until there are targetIndexCount indices or less, or the next collapse would move the surface more
+    // than maxError, relative to the size of the mesh. Positions are 3 floats at positionOffset inside each vertex.
+    // Returns the new indices, and the error of the worst collapse in error, also relative to the size of the mesh
+    static std::vector<uint32_t> Simplify(std::span<const uint32_t> indices, std::span<const std::byte> vertexData,
+        size_t vertexSize, size_t positionOffset, size_t targetIndexCount, float maxError, float& error);
+};
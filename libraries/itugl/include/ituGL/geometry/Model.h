@@ -1,10 +1,12 @@
 #pragma once
 
+#include <glm/vec3.hpp>
 #include <memory>
 #include <vector>
 
 class Mesh;
 class Material;
+class Impostor;
 
 class ShaderProgram;
 
@@ -33,6 +35,24 @@ public:
     // Clear the list of materials
     void ClearMaterials();
 
+    // Box containing the vertices of all the submeshes, in model space. Zero size if unknown
+    inline const glm::vec3& GetBoundsMin() const { return m_boundsMin; }
+    inline const glm::vec3& GetBoundsMax() const { return m_boundsMax; }
+    inline void SetBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax) { m_boundsMin = boundsMin; m_boundsMax = boundsMax; }
+
+    // Screen sizes below which each coarser level of detail is used, starting with LOD 1. The screen size is the diameter
+    // of the bounding sphere relative to the viewport height. Empty if the mesh has a single level
+    inline const std::vector<float>& GetLodScreenSizes() const { return m_lodScreenSizes; }
+    inline void SetLodScreenSizes(const std::vector<float>& lodScreenSizes) { m_lodScreenSizes = lodScreenSizes; }
+
+    // Level of detail for the screen size, starting from the current one. The level only changes once the size moves
+    // past the threshold by the hysteresis fraction, so models around a threshold don't switch every frame
+    unsigned int SelectLod(float screenSize, unsigned int currentLod, float hysteresis = 0.1f) const;
+
+    // Impostor drawn instead of the model when it is far away, or null to always draw the model
+    inline std::shared_ptr<Impostor> GetImpostor() const { return m_impostor; }
+    inline void SetImpostor(std::shared_ptr<Impostor> impostor) { m_impostor = impostor; }
+
     // Draw all the submeshes of the mesh, each one with a material on the list
     void Draw();
 
@@ -49,4 +69,14 @@ private:
 
     // List of material pointers, one for each submesh
     std::vector<std::shared_ptr<Material>> m_materials;
+
+    // Bounding box of the mesh
+    glm::vec3 m_boundsMin;
+    glm::vec3 m_boundsMax;
+
+    // Screen size thresholds of the levels of detail
+    std::vector<float> m_lodScreenSizes;
+
+    // Replaces the model in the distance
+    std::shared_ptr<Impostor> m_impostor;
 };
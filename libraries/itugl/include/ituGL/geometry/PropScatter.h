@@ -0,0 +1,131 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+class Model;
+class Camera;
+class AssetLoadQueue;
+
+// Props scattered over a square area on the XZ plane of the model, centered on its origin like Terrain, or on another point
+// so several areas can share the space of the model.
+// The placements are generated with Poisson-disk sampling, so no two props are closer than a minimum distance, and are stored
+// as separate arrays for each component, grouped by chunk and by prop type. The area is split in square chunks, that are
+// sampled in parallel and culled together.
+// Each prop type is a model drawn with one instanced drawcall per submesh, for all the visible instances of the type, and the
+// shadow pass draws the same drawcalls. The vertex shader reads the instance data, and adds the height of the surface:
+//   layout (location = N) in vec4 InstanceData; // Position x and z in model space, rotation around Y and scale
+class PropScatter
+{
+public:
+    // Probability, in [0, 1], of keeping a prop at the position, in [0, 1] over the area
+    using DensityFunction = std::function<float(const glm::vec2&)>;
+
+public:
+    // size is the side of the area, chunkSize the side of the chunks, and center the center of the area on the XZ plane
+    PropScatter(float size, float chunkSize, const glm::vec2& center = glm::vec2(0.0f));
+
+    inline float GetSize() const { return m_size; }
+    inline glm::vec2 GetCenter() const { return m_center; }
+    inline float GetChunkSize() const { return m_chunkSize; }
+
+    // Add a type of prop drawn with the model, and set up its mesh for instancing, with the instance data in the location.
+    // Each prop picks a type with a probability proportional to its weight, and a random scale in the range
+    unsigned int AddPropType(std::shared_ptr<Model> model, GLuint instanceLocation, float weight = 1.0f, float minScale = 1.0f, float maxScale = 1.0f);
+
+    inline unsigned int GetPropTypeCount() const { return static_cast<unsigned int>(m_propTypes.size()); }
+    inline std::shared_ptr<Model> GetModel(unsigned int propType) const { return m_propTypes[propType].model; }
+
+    // Replace the props with new ones, at least minDistance apart. The chunks are sampled on the workers of the load queue
+    // and on this thread, which waits for all of them. The chunks must be at least 3 times minDistance wide, so the
+    // chunks sampled at the same time don't touch the same points. The same seed always gives the same props
+    void Generate(float minDistance, unsigned int seed, AssetLoadQueue& loadQueue, const DensityFunction& densityFunction = nullptr);
+
+    // Range of the heights added by the shader, to cull the chunks
+    inline void SetHeightRange(float minHeight, float maxHeight) { m_minHeight = minHeight; m_maxHeight = maxHeight; }
+
+    // Cull the chunks with the camera, and upload the instances of the visible ones. The upload is skipped if the same
+    // chunks were visible in the last update. worldMatrix is the transform of the models
+    void Update(const Camera& camera, const glm::mat4& worldMatrix);
+
+    // Number of props, and of props in the visible chunks
+    inline unsigned int GetInstanceCount() const { return static_cast<unsigned int>(m_positionsX.size()); }
+    inline unsigned int GetVisibleInstanceCount() const { return m_visibleInstanceCount; }
+
+private:
+    struct PropType
+    {
+        std::shared_ptr<Model> model;
+
+        // Index of the VBO with the instance data in the mesh
+        unsigned int instanceVboIndex;
+
+        float weight;
+        float minScale;
+        float maxScale;
+
+        // Distance the model reaches from its origin, at the maximum scale
+        float radius;
+
+        // Instance data of the visible props
+        std::vector<glm::vec4> instances;
+    };
+
+    // Props of one chunk, before they are merged
+    struct ChunkPoints
+    {
+        std::vector<glm::vec2> positions;
+        std::vector<float> rotations;
+        std::vector<float> scales;
+        std::vector<unsigned int> propTypes;
+    };
+
+    // Range of props of a type in a chunk
+    struct Range
+    {
+        unsigned int first;
+        unsigned int count;
+    };
+
+private:
+    // Sample the chunk, checking the points of the neighbour chunks already sampled
+    void GenerateChunk(int chunkX, int chunkY, float minDistance, unsigned int seed,
+        const DensityFunction& densityFunction, std::vector<glm::vec2>& grid, ChunkPoints& points) const;
+
+    // Merge the props of all the chunks, grouped by chunk and by type
+    void MergeChunks(const std::vector<ChunkPoints>& chunkPoints);
+
+private:
+    float m_size;
+    glm::vec2 m_center;
+    float m_chunkSize;
+    int m_chunkCount;
+
+    float m_minHeight;
+    float m_maxHeight;
+
+    std::vector<PropType> m_propTypes;
+
+    // Props of all the chunks, one array per component
+    std::vector<float> m_positionsX;
+    std::vector<float> m_positionsZ;
+    std::vector<float> m_rotations;
+    std::vector<float> m_scales;
+
+    // Props of each type in each chunk, indexed by chunk and then by type
+    std::vector<Range> m_ranges;
+
+    // Chunks visible in the last update, to skip the upload when they don't change
+    std::vector<int> m_visibleChunks;
+    std::vector<int> m_previousVisibleChunks;
+    bool m_instancesDirty;
+
+    unsigned int m_visibleInstanceCount;
+};
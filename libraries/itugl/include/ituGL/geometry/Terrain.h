@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
+#include <vector>
+
+class Model;
+class Mesh;
+class Camera;
+
+// Square terrain drawn with continuous distance-dependent levels of detail (CDLOD, Strugar 2009).
+// A quadtree splits the terrain into patches: near the camera they are small, and they double in size with each range.
+// All the patches are instances of the same grid mesh, so the terrain is a single instanced drawcall with a roughly
+// constant number of triangles, no matter how big it is. Patches outside the frustum are culled.
+// The vertex shader places the grid with the per-instance data, and morphs the vertices to the grid of the next level
+// near the end of each range, so there are no cracks or pops between levels:
+//   layout (location = 0) in vec2 GridPosition; // In [0, 1] inside the patch
+//   layout (location = 1) in vec4 PatchData;    // Corner x and z, size and level of the patch, in model space
+// The terrain is centered on the origin of the model, on the XZ plane. Heights are added by the shader
+class Terrain
+{
+public:
+    // size is the side of the terrain, levelCount the number of sizes of patches, and gridSize the quads per side of a patch
+    Terrain(float size, int levelCount, int gridSize = 16);
+
+    inline float GetSize() const { return m_size; }
+    inline int GetLevelCount() const { return m_levelCount; }
+    inline int GetGridSize() const { return m_gridSize; }
+
+    // Side of the smallest patches
+    float GetLeafSize() const;
+
+    // Range of the heights added by the shader, to cull the patches
+    inline void SetHeightRange(float minHeight, float maxHeight) { m_minHeight = minHeight; m_maxHeight = maxHeight; }
+    inline float GetMinHeight() const { return m_minHeight; }
+    inline float GetMaxHeight() const { return m_maxHeight; }
+
+    // Distance up to which the smallest patches are used. Each level uses twice the range of the previous one.
+    // To avoid cracks, it should be at least 6 times the leaf size, the default
+    inline float GetLodDistance() const { return m_lodDistance; }
+    inline void SetLodDistance(float lodDistance) { m_lodDistance = lodDistance; }
+
+    // Fraction of each range where the vertices start to morph to the next level
+    inline float GetMorphStart() const { return m_morphStart; }
+    inline void SetMorphStart(float morphStart) { m_morphStart = morphStart; }
+
+    // Model with the grid mesh, with one submesh. The material is added by the owner
+    inline std::shared_ptr<Model> GetModel() const { return m_model; }
+
+    // Select the patches seen by the camera and upload their instance data. worldMatrix is the transform of the model
+    void Update(const Camera& camera, const glm::mat4& worldMatrix);
+
+    // Camera position the patches were selected for, in model space. The shader morphs with it, also in the shadow pass
+    inline const glm::vec3& GetViewPosition() const { return m_viewPosition; }
+
+    // Number of patches selected in the last update
+    inline unsigned int GetPatchCount() const { return static_cast<unsigned int>(m_patches.size()); }
+
+private:
+    // Build the shared grid mesh and the instance buffer
+    void InitializeMesh();
+
+    // Add the node, or its children if part of it is in the range of a finer level
+    void SelectNode(const glm::vec2& corner, float nodeSize, int level, const glm::vec4 (&frustumPlanes)[6]);
+
+    // Distance up to which the level is used
+    float GetLodRange(int level) const;
+
+private:
+    float m_size;
+    int m_levelCount;
+    int m_gridSize;
+
+    float m_minHeight;
+    float m_maxHeight;
+
+    float m_lodDistance;
+    float m_morphStart;
+
+    std::shared_ptr<Model> m_model;
+    std::shared_ptr<Mesh> m_mesh;
+
+    // Index of the VBO with the instance data in the mesh
+    unsigned int m_instanceVboIndex;
+
+    glm::vec3 m_viewPosition;
+
+    // Instance data of the selected patches
+    std::vector<glm::vec4> m_patches;
+};
@@ -32,7 +32,7 @@ public:
     inline Semantic GetSemantic() const { return m_semantic; }
 
     // Gets the size of the attribute
-    inline int GetSize() const { return Data::GetTypeSize(m_type) * m_components; }
+    inline int GetSize() const { return Data::IsPackedType(m_type) ? Data::GetTypeSize(m_type) : Data::GetTypeSize(m_type) * m_components; }
 
     // Gets how many location indices the attribute needs (usually 1)
     int GetLocationSize() const;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <random>
+
+class ParticleSystem;
+class Transform;
+
+// Emits particles into a system from a point attached to a transform, like a wheel of the car.
+// The rate grows with the speed of the point, so a still emitter can stay quiet. The particles are spread along
+// the path of the point since the last update, and keep part of its velocity
+class ParticleEmitter
+{
+public:
+    ParticleEmitter(std::shared_ptr<ParticleSystem> particleSystem, std::shared_ptr<Transform> transform);
+
+    // Point and direction of emission, in the space of the transform. The direction also sets the speed of the particles
+    inline void SetLocalPosition(const glm::vec3& position) { m_localPosition = position; }
+    inline void SetLocalVelocity(const glm::vec3& velocity) { m_localVelocity = velocity; }
+
+    // Particles per second, when still and for each unit of speed
+    inline void SetRate(float rate, float ratePerSpeed) { m_rate = rate; m_ratePerSpeed = ratePerSpeed; }
+
+    // Random speed added in every direction, and fraction of the velocity of the point that is kept
+    inline void SetSpread(float spread) { m_spread = spread; }
+    inline void SetInheritVelocity(float inheritVelocity) { m_inheritVelocity = inheritVelocity; }
+
+    // Ranges for the random lifetime and size of the particles
+    inline void SetLifetime(float minLifetime, float maxLifetime) { m_lifetime = glm::vec2(minLifetime, maxLifetime); }
+    inline void SetSize(float minSize, float maxSize) { m_size = glm::vec2(minSize, maxSize); }
+
+    // Emit the particles for the time step. The first update only records the position
+    void Update(float deltaTime);
+
+private:
+    std::shared_ptr<ParticleSystem> m_particleSystem;
+    std::shared_ptr<Transform> m_transform;
+
+    glm::vec3 m_localPosition;
+    glm::vec3 m_localVelocity;
+
+    float m_rate;
+    float m_ratePerSpeed;
+    float m_spread;
+    float m_inheritVelocity;
+    glm::vec2 m_lifetime;
+    glm::vec2 m_size;
+
+    // World position in the last update
+    glm::vec3 m_previousPosition;
+    bool m_hasPreviousPosition;
+
+    // Fraction of a particle left from the last update, so low rates still emit
+    float m_pending;
+
+    std::mt19937 m_random;
+};
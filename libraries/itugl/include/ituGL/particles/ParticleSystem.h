@@ -0,0 +1,117 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <vector>
+
+class Heightfield;
+class AssetLoadQueue;
+class Model;
+class Mesh;
+
+// Particles simulated on the CPU, like the sand thrown by the wheels.
+// The state of the particles is kept in one array per component, so the update processes 4 particles at a time with SSE2,
+// when it is available. The particles are split in chunks, updated in parallel on the workers of a load queue.
+// Particles fall with gravity, slow down with drag, and bounce on the ground: a heightfield placed like the terrain, or a plane.
+// The simulation doesn't need a GL context, so it can run and be timed on its own. For drawing, CreateModel builds a quad that
+// is drawn instanced, one billboard per particle, and UpdateModel uploads the particles with a single buffer update:
+//   layout (location = 0) in vec2 Corner;       // In [-0.5, 0.5] on the quad
+//   layout (location = 1) in vec4 ParticleData; // World position and size
+//   layout (location = 2) in float ParticleAge; // Age relative to the lifetime, in [0, 1]
+class ParticleSystem
+{
+public:
+    // capacity is the maximum number of live particles, new ones are dropped when it is reached
+    ParticleSystem(unsigned int capacity);
+
+    inline unsigned int GetCapacity() const { return m_capacity; }
+    inline unsigned int GetParticleCount() const { return m_count; }
+
+    // Forces on the particles
+    inline void SetGravity(float gravity) { m_gravity = gravity; }
+    inline void SetDrag(float drag) { m_drag = drag; }
+
+    // Fraction of the vertical speed kept when bouncing, and of the horizontal speed
+    inline void SetRestitution(float restitution) { m_restitution = restitution; }
+    inline void SetFriction(float friction) { m_friction = friction; }
+
+    // Collide with the heightfield, centered on origin on the XZ plane with the side size, with the heights of
+    // Heightfield::GetHeights added to origin.y, the same surface as the terrain
+    void SetGround(std::shared_ptr<const Heightfield> heightfield, const glm::vec3& origin, float size, float sampleDistance, float offsetStrength);
+
+    // Collide with the horizontal plane at the height instead
+    void SetGround(float height);
+
+    // Use SSE2 in the update, when it is available. Turning it off runs the scalar path, to compare them
+    inline void SetSimdEnabled(bool enabled) { m_simdEnabled = enabled; }
+    inline bool IsSimdEnabled() const { return m_simdEnabled; }
+
+    // Add a particle, if there is room. size is the side of its billboard
+    bool Emit(const glm::vec3& position, const glm::vec3& velocity, float lifetime, float size);
+
+    // Advance the particles by the time step, and remove the ones past their lifetime.
+    // With a load queue, the chunks are updated in parallel
+    void Update(float deltaTime, AssetLoadQueue* loadQueue = nullptr);
+
+    // Create the model drawn with the particles. Requires a GL context. The material is added by the owner
+    std::shared_ptr<Model> CreateModel();
+
+    // Upload the particles to the model, in a single buffer update. Requires a GL context
+    void UpdateModel();
+
+private:
+    // Data of each billboard
+    struct Instance
+    {
+        glm::vec3 position;
+        float size;
+        float age;
+    };
+
+private:
+    // Integrate and collide the particles in [first, last). first is a multiple of 4
+    void UpdateChunk(unsigned int first, unsigned int last, float deltaTime);
+
+    // Copy the particle from one index to another
+    void MoveParticle(unsigned int from, unsigned int to);
+
+private:
+    unsigned int m_capacity;
+    unsigned int m_count;
+
+    // Particle state, one array per component. The arrays are rounded up to a multiple of 4, so the last group is complete
+    std::vector<float> m_positionsX;
+    std::vector<float> m_positionsY;
+    std::vector<float> m_positionsZ;
+    std::vector<float> m_velocitiesX;
+    std::vector<float> m_velocitiesY;
+    std::vector<float> m_velocitiesZ;
+    std::vector<float> m_ages;
+    std::vector<float> m_lifetimes;
+    std::vector<float> m_sizes;
+
+    float m_gravity;
+    float m_drag;
+    float m_restitution;
+    float m_friction;
+
+    // Ground, the heightfield if there is one, or the plane at the origin height
+    std::shared_ptr<const Heightfield> m_heightfield;
+    glm::vec3 m_groundOrigin;
+    float m_groundSize;
+    float m_sampleDistance;
+    float m_offsetStrength;
+
+    // Coordinates and height of the ground under each particle, filled by the chunks. Kept to avoid allocating them every update
+    std::vector<glm::vec2> m_groundUVs;
+    std::vector<float> m_groundHeights;
+
+    bool m_simdEnabled;
+
+    // Drawing
+    std::shared_ptr<Model> m_model;
+    std::shared_ptr<Mesh> m_mesh;
+    unsigned int m_instanceVboIndex;
+    std::vector<Instance> m_instances;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
+#include <vector>
+
+class Model;
+class Mesh;
+class Material;
+class Renderer;
+class Texture2DObject;
+
+// Impostor of a model, to draw it far away as a single quad. The model is pictured from directions over the upper
+// hemisphere, laid out in an atlas of frameCount x frameCount frames with a hemi-octahedral mapping: the center frame
+// looks from above, and the border of the atlas from the horizon.
+// The frames store what the materials of the model write to the g-buffer, albedo with the coverage in alpha, normal in
+// the view of the frame and the others, plus the depth, so the impostors are lit and cast shadows like the model.
+// The renderer draws the impostor instead of the model past the fade range, and both inside it, where the shaders dither
+// between them. The quad faces the camera, and is drawn instanced for all the models using the impostor in the frame:
+//   layout (location = 0) in vec2 Corner;              // In [-1, 1] on the quad
+//   layout (location = 1) in mat4 InstanceWorldMatrix; // World matrix of the model
+//   layout (location = 5) in float InstanceFade;       // Fraction of the pixels drawn by the impostor
+class Impostor
+{
+public:
+    Impostor(int frameCount = 12, int frameSize = 64);
+
+    // Render the frames of the model with its own materials. Requires the GL context, and the programs of the materials
+    // registered in the renderer. If cachePath is the path of the model file, the frames are read from the cache next to it,
+    // "<path>.impostor", when it is newer than the model, and written there after baking otherwise
+    void Bake(const Model& model, Renderer& renderer, const char* cachePath = nullptr);
+
+    inline int GetFrameCount() const { return m_frameCount; }
+    inline int GetFrameSize() const { return m_frameSize; }
+
+    // Sphere around the model, in model space, that each frame covers
+    inline const glm::vec3& GetCenter() const { return m_center; }
+    inline float GetRadius() const { return m_radius; }
+
+    inline std::shared_ptr<Texture2DObject> GetAlbedoTexture() const { return m_albedoTexture; }
+    inline std::shared_ptr<Texture2DObject> GetNormalTexture() const { return m_normalTexture; }
+    inline std::shared_ptr<Texture2DObject> GetOthersTexture() const { return m_othersTexture; }
+    inline std::shared_ptr<Texture2DObject> GetDepthTexture() const { return m_depthTexture; }
+
+    // Set the atlas and its layout on a material that draws the impostor, or on its shadow replacement
+    void SetMaterialUniforms(Material& material) const;
+
+    // Distances to the camera where the model fades to the impostor
+    inline float GetFadeStart() const { return m_fadeStart; }
+    inline float GetFadeEnd() const { return m_fadeEnd; }
+    inline void SetFadeRange(float fadeStart, float fadeEnd) { m_fadeStart = fadeStart; m_fadeEnd = fadeEnd; }
+
+    // Fraction of the pixels drawn by the impostor at the distance, 0 before the fade range and 1 after it
+    float GetFade(float distance) const;
+
+    // Create the quad drawn with the material, for all the instances
+    std::shared_ptr<Model> CreateModel(std::shared_ptr<Material> material);
+    inline std::shared_ptr<Model> GetModel() const { return m_model; }
+
+    // Instances drawn in this frame, added by the renderer
+    void AddInstance(const glm::mat4& worldMatrix, float fade);
+    inline unsigned int GetInstanceCount() const { return static_cast<unsigned int>(m_instances.size()); }
+    inline void ClearInstances() { m_instances.clear(); }
+
+    // Upload the instances to the model, in a single buffer update
+    void UpdateModel();
+
+private:
+    // Data of each quad
+    struct Instance
+    {
+        glm::mat4 worldMatrix;
+        float fade;
+    };
+
+private:
+    void InitTextures();
+
+    // Direction from the center of the model to the camera of the frame, in model space
+    glm::vec3 GetFrameDirection(int frameX, int frameY) const;
+
+    // Read the frames from the cache if it is up to date with the model file
+    bool ReadCache(const char* path);
+
+    // Write the frames to the cache
+    void WriteCache(const char* path) const;
+
+private:
+    int m_frameCount;
+    int m_frameSize;
+
+    glm::vec3 m_center;
+    float m_radius;
+
+    std::shared_ptr<Texture2DObject> m_albedoTexture;
+    std::shared_ptr<Texture2DObject> m_normalTexture;
+    std::shared_ptr<Texture2DObject> m_othersTexture;
+    std::shared_ptr<Texture2DObject> m_depthTexture;
+
+    float m_fadeStart;
+    float m_fadeEnd;
+
+    std::shared_ptr<Mesh> m_mesh;
+    std::shared_ptr<Model> m_model;
+    unsigned int m_instanceVboIndex;
+
+    std::vector<Instance> m_instances;
+};
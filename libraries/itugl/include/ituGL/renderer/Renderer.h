@@ -4,6 +4,7 @@
 #include <ituGL/renderer/RenderPass.h>
 #include <ituGL/geometry/Drawcall.h>
 #include <ituGL/geometry/Mesh.h>
+#include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 #include <vector>
 #include <unordered_map>
@@ -19,21 +20,35 @@ class VertexArrayObject;
 class Drawcall;
 class Model;
 class FramebufferObject;
+class Impostor;
 
 class Renderer
 {
 public:
     struct DrawcallInfo
     {
-        DrawcallInfo(const Material& material, unsigned int worldMatrixIndex, const VertexArrayObject& vao, const Drawcall& drawcall)
+        DrawcallInfo(const Material& material, unsigned int worldMatrixIndex, const VertexArrayObject& vao, const Drawcall& drawcall,
+            const Mesh* mesh = nullptr, unsigned int submeshIndex = 0, unsigned int lod = 0)
             : material(material), worldMatrixIndex(worldMatrixIndex), vao(vao), drawcall(drawcall)
+            , mesh(mesh), submeshIndex(submeshIndex), lod(lod)
         {
         }
 
+        // Drawcall of the level of detail lodBias levels coarser than the selected one
+        const Drawcall& GetDrawcall(unsigned int lodBias) const
+        {
+            return mesh && lodBias > 0 ? mesh->GetSubmeshDrawcall(submeshIndex, lod + lodBias) : drawcall;
+        }
+
         const Material& material;
         unsigned int worldMatrixIndex;
         const VertexArrayObject& vao;
+        // Drawcall of the selected level of detail
         const Drawcall& drawcall;
+        // Submesh the drawcall comes from, so passes can pick coarser levels. Null if added without a mesh
+        const Mesh* mesh;
+        unsigned int submeshIndex;
+        unsigned int lod;
     };
 
     using DrawcallCollection = std::vector<DrawcallInfo>;
@@ -63,6 +78,15 @@ public:
     std::span<const DrawcallInfo> GetDrawcalls(unsigned int collectionIndex) const;
     void AddModel(const Model& model, const glm::mat4& worldMatrix);
 
+    // Add the model with the level of detail for its size on the screen. lod is the level used in the last frame,
+    // to apply the hysteresis, and it is updated with the selected one.
+    // If the model has an impostor, an instance of it is added instead past its fade range, and both inside it
+    void AddModel(const Model& model, const glm::mat4& worldMatrix, unsigned int& lod);
+
+    // Diameter of the bounding sphere of the model relative to the viewport height, as seen by the camera.
+    // Returns 0 if the model has no bounds or there is no camera yet
+    float GetScreenSize(const Model& model, const glm::mat4& worldMatrix) const;
+
     const Mesh& GetFullscreenMesh() const;
 
     void RegisterShaderProgram(std::shared_ptr<const ShaderProgram> shaderProgramPtr,
@@ -71,6 +95,8 @@ public:
 
     void UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, const glm::mat4& worldMatrix, bool cameraChanged = true) const;
     void UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, unsigned int worldMatrixIndex, bool cameraChanged = true) const;
+    // With a camera other than the current one, to draw outside of the passes
+    void UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged = true) const;
 
     UpdateLightsFunction GetDefaultUpdateLightsFunction(const ShaderProgram& shaderProgram);
     bool UpdateLights(std::shared_ptr<const ShaderProgram> shaderProgramPtr, std::span<const Light* const> lights, unsigned int& lightIndex) const;
@@ -86,6 +112,12 @@ private:
 
     void InitializeFullscreenMesh();
 
+    // Position of the camera for the levels of detail, the current one or the one of the last frame
+    glm::vec3 GetLodViewPosition() const;
+
+    // Upload the impostor instances added in this frame, and add one drawcall for each impostor
+    void AddImpostorDrawcalls();
+
 private:
     DeviceGL& m_device;
 
@@ -100,8 +132,16 @@ private:
 
     std::vector<glm::mat4> m_worldMatrices;
 
+    // Camera position and vertical projection scale used for the levels of detail. They are kept from the last frame,
+    // so models added before the camera still get a level
+    glm::vec3 m_lodViewPosition;
+    float m_lodProjectionScale;
+
     std::vector<DrawcallCollection> m_drawcallCollections;
 
+    // Impostors with instances in this frame
+    std::vector<Impostor*> m_impostors;
+
     std::unordered_map<std::shared_ptr<const ShaderProgram>, UpdateTransformsFunction> m_updateTransformsFunctions;
     std::unordered_map<std::shared_ptr<const ShaderProgram>, UpdateLightsFunction> m_updateLightsFunctions;
 
@@ -22,6 +22,10 @@ public:
 
     void SetVolume(glm::vec3 volumeCenter, glm::vec3 volumeSize);
 
+    // Draw the models this many levels of detail coarser than in the main view. Shadows hide most of the difference
+    inline unsigned int GetLodBias() const { return m_lodBias; }
+    inline void SetLodBias(unsigned int lodBias) { m_lodBias = lodBias; }
+
     void Render() override;
 
 private:
@@ -42,4 +46,6 @@ private:
 
     glm::vec3 m_volumeCenter;
     glm::vec3 m_volumeSize;
+
+    unsigned int m_lodBias;
 };
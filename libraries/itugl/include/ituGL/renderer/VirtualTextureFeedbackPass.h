@@ -0,0 +1,65 @@
+#pragma once
+
+#include <ituGL/renderer/RenderPass.h>
+#include <ituGL/core/BufferObject.h>
+#include <array>
+#include <vector>
+
+class Material;
+class Texture2DObject;
+class VirtualTexture;
+
+// Draws the objects that sample a virtual texture into a small target, with replacement materials that write the page
+// each pixel needs instead of its color. The target is copied to a pixel buffer without waiting, and read a couple of
+// frames later, once the GPU is done, to add the requests to the virtual texture
+class VirtualTextureFeedbackPass : public RenderPass
+{
+public:
+    // The drawcalls with the program of one of the materials are drawn with the replacement at the same index, the rest
+    // are skipped. width and height are the size of the target, usually a fraction of the screen
+    VirtualTextureFeedbackPass(std::shared_ptr<VirtualTexture> virtualTexture, int width, int height,
+        std::shared_ptr<std::vector<std::shared_ptr<const Material>>> materials,
+        std::shared_ptr<std::vector<std::shared_ptr<const Material>>> feedbackMaterials,
+        int drawcallCollectionIndex = 0);
+    ~VirtualTextureFeedbackPass();
+
+    void Render() override;
+
+private:
+    using PixelPackBufferObject = BufferObjectBase<BufferObject::PixelPackBuffer>;
+
+    // Copy of the target in a pixel pack buffer, and the fence that tells when it is complete
+    struct Readback
+    {
+        PixelPackBufferObject buffer;
+        GLsync fence = nullptr;
+    };
+
+private:
+    void InitFramebuffer();
+
+    // Add the readbacks completed by the GPU to the virtual texture, the oldest first
+    void ReadFeedback();
+
+    // Start copying the target to a free readback buffer. Skipped if all of them are busy
+    void StartReadback();
+
+private:
+    static constexpr int ReadbackCount = 3;
+
+    std::shared_ptr<VirtualTexture> m_virtualTexture;
+
+    int m_width;
+    int m_height;
+
+    std::shared_ptr<std::vector<std::shared_ptr<const Material>>> m_materials;
+    std::shared_ptr<std::vector<std::shared_ptr<const Material>>> m_feedbackMaterials;
+
+    int m_drawcallCollectionIndex;
+
+    std::shared_ptr<Texture2DObject> m_feedbackTexture;
+    std::shared_ptr<Texture2DObject> m_depthTexture;
+
+    std::array<Readback, ReadbackCount> m_readbacks;
+    int m_nextReadback;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <ituGL/scene/WorldStreamer.h>
+#include <ituGL/geometry/PropScatter.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <string>
+
+class Model;
+class Transform;
+
+// World tile with props scattered over it. The prop models are loaded once for all the tiles. Each tile draws their buffers
+// through a mesh of its own, with new vertex arrays and the instance data of its props, generated on a worker.
+// The worker shares the scatter, so releasing the tile never waits for it
+class PropScatterTile : public WorldTile
+{
+public:
+    struct PropType
+    {
+        std::string name;
+        // Shared by all the tiles. Types without a valid future are skipped
+        AssetFuture<Model> model;
+        float weight;
+        float minScale;
+        float maxScale;
+    };
+
+    // Shared by all the tiles of a streamer
+    struct Settings
+    {
+        std::vector<PropType> propTypes;
+
+        // Location of the instance data in the vertex shader
+        GLuint instanceLocation = 0;
+
+        // Side of the chunks of the scatter, and distance between the props
+        float chunkSize = 1.0f;
+        float minDistance = 0.5f;
+
+        // Combined with the tile coordinates, so each tile has its own props
+        unsigned int seed = 0;
+
+        // Probability of keeping a prop at a position on the XZ plane of the models. Optional
+        std::function<float(const glm::vec2&)> densityFunction;
+
+        // Transform shared by the models of all the tiles
+        std::shared_ptr<Transform> transform;
+    };
+
+public:
+    // Tile centered on center, with side size. It loads once the models of the settings are loaded
+    PropScatterTile(int tileX, int tileY, const glm::vec2& center, float size, std::shared_ptr<const Settings> settings,
+        AssetLoadQueue& loadQueue);
+
+    bool Load() override;
+
+    // The instance buffers once the models are loaded, and the instances once they are generated
+    size_t GetByteSize() const override { return m_byteSize; }
+
+    // Check if the props are being generated
+    bool IsBusy() const override;
+
+    inline PropScatter& GetPropScatter() { return *m_propScatter; }
+    inline const PropScatter& GetPropScatter() const { return *m_propScatter; }
+
+private:
+    std::shared_ptr<const Settings> m_settings;
+    AssetLoadQueue& m_loadQueue;
+
+    glm::vec2 m_center;
+    float m_size;
+
+    std::shared_ptr<PropScatter> m_propScatter;
+
+    // Index in the settings of each type of the scatter
+    std::vector<unsigned int> m_propTypeIndices;
+
+    // Set when the props are generated
+    std::future<void> m_generated;
+
+    size_t m_byteSize;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+class Renderer;
+class Scene;
+
+// Adds the camera, lights and models of the scene to the renderer, like RendererSceneVisitor, iterating the component
+// pools of the registry. The world matrices must be updated before, see Scene::UpdateWorldMatrices
+class RendererSceneSystem
+{
+public:
+    RendererSceneSystem(Renderer& renderer);
+
+    void Render(Scene& scene);
+
+private:
+    Renderer& m_renderer;
+};
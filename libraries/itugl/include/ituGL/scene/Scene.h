@@ -1,12 +1,16 @@
 #pragma once
 
+#include <ituGL/scene/SceneRegistry.h>
 #include <unordered_map>
 #include <string>
 #include <memory>
 
 class SceneNode;
 class SceneVisitor;
+class AssetLoadQueue;
 
+// Nodes of the scene, by name. Each node is an entity in the registry of the scene, and the systems iterate its
+// component pools instead of visiting the nodes
 class Scene
 {
 public:
@@ -15,14 +19,26 @@ public:
 
     std::shared_ptr<SceneNode> GetSceneNode(const std::string& name) const;
 
+    // Add the node, replacing the one with the same name
     bool AddSceneNode(std::shared_ptr<SceneNode> node);
 
     bool RemoveSceneNode(std::shared_ptr<SceneNode> node);
     bool RemoveSceneNode(const std::string& name);
 
+    // Visit the nodes in the order of the node pool
     void AcceptVisitor(SceneVisitor& visitor);
     void AcceptVisitor(SceneVisitor& visitor) const;
 
+    inline SceneRegistry& GetRegistry() { return m_registry; }
+    inline const SceneRegistry& GetRegistry() const { return m_registry; }
+
+    // Copy the world matrix of each transform into its component. The transforms that are up to date are read on the
+    // workers of the queue, if there is one, the rest update their matrix after that, one at a time
+    void UpdateWorldMatrices(AssetLoadQueue* loadQueue = nullptr);
+
 private:
-    std::unordered_map<std::string, std::shared_ptr<SceneNode>> m_nodes;
+    SceneRegistry m_registry;
+
+    // Entity of each node
+    std::unordered_map<std::string, SceneEntity> m_entities;
 };
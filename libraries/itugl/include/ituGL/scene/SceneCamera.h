@@ -20,6 +20,9 @@ public:
     void MatchCameraToTransform();
     void MatchTransformToCamera();
 
+protected:
+    void AddComponents(SceneRegistry& registry) override;
+
 private:
     std::shared_ptr<Camera> m_camera;
 };
@@ -19,6 +19,9 @@ public:
     void MatchLightToTransform();
     void MatchTransformToLight();
 
+protected:
+    void AddComponents(SceneRegistry& registry) override;
+
 private:
     glm::vec3 GetRotationFromDirection(const glm::vec3& direction) const;
 
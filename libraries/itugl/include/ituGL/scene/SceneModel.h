@@ -14,6 +14,10 @@ public:
     std::shared_ptr<Model> GetModel() const;
     void SetModel(std::shared_ptr<Model> model);
 
+    // Level of detail the model was drawn with in the last frame
+    unsigned int GetLod() const;
+    void SetLod(unsigned int lod);
+
     //glm::mat4 GetWorldMatrix() const override;
     //int GetDrawcallCount() const override;
     //const Drawcall& GetDrawcall(int index, const VertexArrayObject*& vao, const Material*& material) const override;
@@ -25,6 +29,11 @@ public:
     void AcceptVisitor(SceneVisitor& visitor) override;
     void AcceptVisitor(SceneVisitor& visitor) const override;
 
+protected:
+    void AddComponents(SceneRegistry& registry) override;
+
 private:
     std::shared_ptr<Model> m_model;
+
+    unsigned int m_lod;
 };
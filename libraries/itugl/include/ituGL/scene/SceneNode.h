@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ituGL/scene/Bounds.h>
+#include <ituGL/scene/SceneRegistry.h>
 #include <string>
 #include <memory>
 
@@ -8,6 +9,8 @@ class Scene;
 class SceneVisitor;
 class Transform;
 
+// Named object of a scene. In a scene, the node is an entity of its registry, and keeps its components pointing to
+// the objects it holds when they are replaced
 class SceneNode
 {
 public:
@@ -30,13 +33,24 @@ public:
     virtual void AcceptVisitor(SceneVisitor& visitor);
     virtual void AcceptVisitor(SceneVisitor& visitor) const;
 
+    // Entity of the node in the registry of its scene. Not valid if it is in none
+    inline SceneEntity GetEntity() const { return m_entity; }
+
+protected:
+    // Add the components of the node to its entity, when the node is added to a scene
+    virtual void AddComponents(SceneRegistry& registry);
+
+    // Registry of the scene of the node, null if it is in none
+    SceneRegistry* GetRegistry() const;
+
 private:
     friend class Scene;
 
     Scene* GetOwnerScene() const;
-    void SetOwnerScene(Scene* scene);
+    void SetOwnerScene(Scene* scene, SceneEntity entity = SceneEntity());
 
     Scene* m_scene;
+    SceneEntity m_entity;
 
 protected:
     std::string m_name;
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+class Camera;
+class Light;
+class Model;
+class SceneNode;
+class Transform;
+
+// Handle of an entity in a SceneRegistry. When the entity is destroyed, its index is reused with a new generation,
+// so the old handles don't find the new entity
+struct SceneEntity
+{
+    static constexpr uint32_t InvalidIndex = ~0u;
+
+    uint32_t index = InvalidIndex;
+    uint32_t generation = 0;
+
+    inline bool IsValid() const { return index != InvalidIndex; }
+    inline bool operator == (const SceneEntity& other) const { return index == other.index && generation == other.generation; }
+};
+
+// Transform of the node, and the world matrix computed from it by Scene::UpdateWorldMatrices
+struct SceneTransformComponent
+{
+    Transform* transform;
+    glm::mat4 worldMatrix;
+};
+
+// Model of the node, and the level of detail it was drawn with in the last frame
+struct SceneModelComponent
+{
+    Model* model;
+    unsigned int lod;
+};
+
+struct SceneLightComponent
+{
+    Light* light;
+};
+
+struct SceneCameraComponent
+{
+    Camera* camera;
+};
+
+// Sparse set of the components of one type. The components are packed in a dense array, in no particular order, and
+// the sparse array maps the index of each entity to its component. Adding, removing and finding a component take
+// constant time, and the systems iterate the dense array
+template<typename T>
+class SceneComponentPool
+{
+public:
+    inline unsigned int GetSize() const { return static_cast<unsigned int>(m_components.size()); }
+
+    bool Has(SceneEntity entity) const;
+
+    T& Get(SceneEntity entity);
+    const T& Get(SceneEntity entity) const;
+
+    // Add the component to the entity, or replace the one it has
+    T& Add(SceneEntity entity, const T& component);
+
+    // Remove the component of the entity, the last component takes its place. Returns false if it had none
+    bool Remove(SceneEntity entity);
+
+    // Entity of each component, in the same order
+    inline std::span<const SceneEntity> GetEntities() const { return m_entities; }
+
+    inline std::span<T> GetComponents() { return m_components; }
+    inline std::span<const T> GetComponents() const { return m_components; }
+
+private:
+    // Index in the dense arrays, for each entity index
+    std::vector<uint32_t> m_sparse;
+
+    std::vector<SceneEntity> m_entities;
+    std::vector<T> m_components;
+};
+
+// Entities of a scene, and the pools of their components. The scene nodes are the interface to it: each node is an
+// entity, with the components for its transform, model, light or camera pointing to the objects the node keeps
+class SceneRegistry
+{
+public:
+    SceneRegistry();
+
+    SceneEntity CreateEntity();
+
+    // Remove the entity, and all its components
+    void DestroyEntity(SceneEntity entity);
+
+    bool IsAlive(SceneEntity entity) const;
+
+    inline unsigned int GetEntityCount() const { return m_entityCount; }
+
+    inline SceneComponentPool<std::shared_ptr<SceneNode>>& GetNodes() { return m_nodes; }
+    inline const SceneComponentPool<std::shared_ptr<SceneNode>>& GetNodes() const { return m_nodes; }
+
+    inline SceneComponentPool<SceneTransformComponent>& GetTransforms() { return m_transforms; }
+    inline const SceneComponentPool<SceneTransformComponent>& GetTransforms() const { return m_transforms; }
+
+    inline SceneComponentPool<SceneModelComponent>& GetModels() { return m_models; }
+    inline const SceneComponentPool<SceneModelComponent>& GetModels() const { return m_models; }
+
+    inline SceneComponentPool<SceneLightComponent>& GetLights() { return m_lights; }
+    inline const SceneComponentPool<SceneLightComponent>& GetLights() const { return m_lights; }
+
+    inline SceneComponentPool<SceneCameraComponent>& GetCameras() { return m_cameras; }
+    inline const SceneComponentPool<SceneCameraComponent>& GetCameras() const { return m_cameras; }
+
+private:
+    // Current generation of each entity index
+    std::vector<uint32_t> m_generations;
+
+    // Indices of the destroyed entities, to be reused
+    std::vector<uint32_t> m_freeIndices;
+
+    unsigned int m_entityCount;
+
+    // The node that owns each entity
+    SceneComponentPool<std::shared_ptr<SceneNode>> m_nodes;
+
+    SceneComponentPool<SceneTransformComponent> m_transforms;
+    SceneComponentPool<SceneModelComponent> m_models;
+    SceneComponentPool<SceneLightComponent> m_lights;
+    SceneComponentPool<SceneCameraComponent> m_cameras;
+};
+
+template<typename T>
+bool SceneComponentPool<T>::Has(SceneEntity entity) const
+{
+    return entity.index < m_sparse.size() && m_sparse[entity.index] != SceneEntity::InvalidIndex
+        && m_entities[m_sparse[entity.index]] == entity;
+}
+
+template<typename T>
+T& SceneComponentPool<T>::Get(SceneEntity entity)
+{
+    assert(Has(entity));
+    return m_components[m_sparse[entity.index]];
+}
+
+template<typename T>
+const T& SceneComponentPool<T>::Get(SceneEntity entity) const
+{
+    assert(Has(entity));
+    return m_components[m_sparse[entity.index]];
+}
+
+template<typename T>
+T& SceneComponentPool<T>::Add(SceneEntity entity, const T& component)
+{
+    assert(entity.IsValid());
+
+    if (Has(entity))
+    {
+        T& existingComponent = m_components[m_sparse[entity.index]];
+        existingComponent = component;
+        return existingComponent;
+    }
+
+    if (entity.index >= m_sparse.size())
+    {
+        m_sparse.resize(entity.index + 1, SceneEntity::InvalidIndex);
+    }
+    m_sparse[entity.index] = static_cast<uint32_t>(m_components.size());
+    m_entities.push_back(entity);
+    return m_components.emplace_back(component);
+}
+
+template<typename T>
+bool SceneComponentPool<T>::Remove(SceneEntity entity)
+{
+    if (!Has(entity))
+    {
+        return false;
+    }
+
+    // Move the last component to the hole, so the dense arrays stay packed
+    uint32_t denseIndex = m_sparse[entity.index];
+    uint32_t lastIndex = static_cast<uint32_t>(m_components.size()) - 1;
+    if (denseIndex != lastIndex)
+    {
+        m_components[denseIndex] = std::move(m_components[lastIndex]);
+        m_entities[denseIndex] = m_entities[lastIndex];
+        m_sparse[m_entities[denseIndex].index] = denseIndex;
+    }
+    m_components.pop_back();
+    m_entities.pop_back();
+    m_sparse[entity.index] = SceneEntity::InvalidIndex;
+    return true;
+}
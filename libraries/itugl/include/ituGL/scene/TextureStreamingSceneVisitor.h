@@ -0,0 +1,21 @@
+#pragma once
+
+#include <ituGL/scene/SceneVisitor.h>
+
+class TextureStreamer;
+class Camera;
+class SceneModel;
+
+// Requests the mip levels of the textures used by the visible models, from the size of their bounds on screen
+class TextureStreamingSceneVisitor : public SceneVisitor
+{
+public:
+    TextureStreamingSceneVisitor(TextureStreamer& textureStreamer, const Camera& camera, float viewportHeight);
+
+    void VisitModel(SceneModel& sceneModel) override;
+
+private:
+    TextureStreamer& m_textureStreamer;
+    const Camera& m_camera;
+    float m_viewportHeight;
+};
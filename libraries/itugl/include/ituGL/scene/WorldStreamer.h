@@ -0,0 +1,139 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+class Scene;
+class SceneNode;
+
+// Part of the world streamed by WorldStreamer: the scene nodes in a square tile, that are loaded in the background
+class WorldTile
+{
+public:
+    WorldTile(int tileX, int tileY);
+    virtual ~WorldTile();
+
+    inline int GetTileX() const { return m_tileX; }
+    inline int GetTileY() const { return m_tileY; }
+
+    // Continue loading, without blocking. Called on the GL thread once per frame until it returns true, when the tile is ready
+    // to be shown. Releasing the tile while it loads must be safe
+    virtual bool Load() = 0;
+
+    // Bytes of memory held by the tile, as far as it is known while it loads
+    virtual size_t GetByteSize() const = 0;
+
+    // Check if work started by Load is still running in the background. Released tiles are kept until it finishes
+    virtual bool IsBusy() const { return false; }
+
+    // Scene nodes added to the scene while the tile is shown
+    inline const std::vector<std::shared_ptr<SceneNode>>& GetSceneNodes() const { return m_sceneNodes; }
+
+protected:
+    void AddSceneNode(std::shared_ptr<SceneNode> sceneNode);
+
+private:
+    int m_tileX;
+    int m_tileY;
+
+    std::vector<std::shared_ptr<SceneNode>> m_sceneNodes;
+};
+
+// Divides the world on the XZ plane in square tiles, and keeps the tiles around a position loaded.
+// Tiles closer than the load radius are created and loaded in the background, the closest first, and added to the scene
+// once they are ready. Tiles further than the unload radius are removed from the scene and released, so the memory only
+// depends on the radii, wherever the position goes. The unload radius is bigger, so tiles on the border don't load and
+// unload over and over. Only a few loads start and a few tiles are shown each frame, to avoid hitches
+class WorldStreamer
+{
+public:
+    // Create the tile with the coordinates, and start loading it
+    using CreateTileFunction = std::function<std::shared_ptr<WorldTile>(int tileX, int tileY)>;
+
+    struct Stats
+    {
+        unsigned int residentTiles = 0;
+        unsigned int loadingTiles = 0;
+        size_t residentBytes = 0;
+
+        // Held by the tiles still loading, and by the evicted ones that still work in the background
+        size_t loadingBytes = 0;
+
+        // Totals since the start
+        unsigned int shownTiles = 0;
+        unsigned int evictedTiles = 0;
+        unsigned int cancelledTiles = 0;
+    };
+
+public:
+    // The tile (0, 0) starts at origin, and covers tileSize on X and Z
+    WorldStreamer(Scene& scene, const glm::vec3& origin, float tileSize, CreateTileFunction createTileFunction);
+    ~WorldStreamer();
+
+    inline float GetTileSize() const { return m_tileSize; }
+
+    // Distances from the position to the closest point of the tiles, to load and to unload them
+    void SetRadii(float loadRadius, float unloadRadius);
+
+    // Only stream the tiles in [minTile, maxTile]. By default, the world has no limits
+    void SetBounds(const glm::ivec2& minTile, const glm::ivec2& maxTile);
+
+    // Tiles that start loading, and that are added to the scene, in each update
+    inline void SetLoadBudget(unsigned int loadsPerFrame, unsigned int showsPerFrame) { m_loadsPerFrame = loadsPerFrame; m_showsPerFrame = showsPerFrame; }
+
+    // Load and unload the tiles around the position. Once per frame, on the GL thread
+    void Update(const glm::vec3& position);
+
+    // Tiles in the scene
+    inline const std::vector<std::shared_ptr<WorldTile>>& GetResidentTiles() const { return m_residentTiles; }
+
+    inline const Stats& GetStats() const { return m_stats; }
+
+private:
+    struct TileState
+    {
+        std::shared_ptr<WorldTile> tile;
+        bool loaded;
+        bool shown;
+    };
+
+private:
+    // Distance on the XZ plane from the position to the closest point of the tile
+    float GetTileDistance(const glm::vec3& position, int tileX, int tileY) const;
+
+    void ShowTile(TileState& tileState);
+    void HideTile(TileState& tileState);
+
+    static int64_t GetTileKey(int tileX, int tileY);
+
+private:
+    Scene& m_scene;
+    glm::vec3 m_origin;
+    float m_tileSize;
+    CreateTileFunction m_createTileFunction;
+
+    float m_loadRadius;
+    float m_unloadRadius;
+
+    bool m_bounded;
+    glm::ivec2 m_minTile;
+    glm::ivec2 m_maxTile;
+
+    unsigned int m_loadsPerFrame;
+    unsigned int m_showsPerFrame;
+
+    // Tiles loading or shown, by their coordinates
+    std::unordered_map<int64_t, TileState> m_tiles;
+
+    std::vector<std::shared_ptr<WorldTile>> m_residentTiles;
+
+    // Tiles evicted while busy, released once they are done
+    std::vector<std::shared_ptr<WorldTile>> m_cancelledTiles;
+
+    Stats m_stats;
+};
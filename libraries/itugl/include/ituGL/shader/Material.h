@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ituGL/shader/ShaderUniformCollection.h>
+#include <ituGL/asset/ShaderVariantSet.h>
 
 #include <ituGL/core/Color.h>
 #include <functional>
@@ -43,6 +44,17 @@ public:
     Material();
     // Initialize with the shader program, will extract all the properties. Skip the names in filtered uniforms
     Material(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms = NameSet());
+    // Initialize with the variant of the shader variant set selected by the keywords
+    Material(std::shared_ptr<ShaderVariantSet> shaderVariants, ShaderVariantSet::KeywordMask keywords, const NameSet& filteredUniforms = NameSet());
+
+    // The shader variant set, if the material was created from one
+    inline std::shared_ptr<ShaderVariantSet> GetShaderVariants() const { return m_shaderVariants; }
+
+    // Keywords that select the variant of the shader. Changing them switches the shader program, keeping the uniform values
+    inline ShaderVariantSet::KeywordMask GetKeywords() const { return m_keywords; }
+    void SetKeywords(ShaderVariantSet::KeywordMask keywords);
+    inline void EnableKeyword(ShaderVariantSet::Keyword keyword) { SetKeywords(m_keywords | keyword); }
+    inline void DisableKeyword(ShaderVariantSet::Keyword keyword) { SetKeywords(m_keywords & ~keyword); }
 
 
     // The function that will be executed for additional shader program setup
@@ -113,6 +125,10 @@ public:
     // You can skip depth, stencil or blending using the override flags
     void Use(OverrideFlags overrideFlags = OverrideFlags::NoOverride) const;
 
+protected:
+    // Initialize as an instance of the base material, copying its render states. See MaterialInstance
+    Material(std::shared_ptr<const Material> baseMaterial);
+
 private:
     // Set all the properties relative to depth
     void UseDepthTest() const;
@@ -127,6 +143,15 @@ private:
     void UseCulling() const;
 
 private:
+    // Variants to select the shader program from, if any
+    std::shared_ptr<ShaderVariantSet> m_shaderVariants;
+
+    // Keywords of the current variant
+    ShaderVariantSet::KeywordMask m_keywords;
+
+    // Uniforms skipped when extracting them, needed again when changing the variant
+    NameSet m_filteredUniforms;
+
     // Function pointer to prepare the shader used by the material
     ShaderSetupFunction m_shaderSetupFunction;
 
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <ituGL/shader/Material.h>
+
+// Material that shares the shader and the uniform values of a base material, and only stores the values set on it.
+// Render states are copied from the base when created, and can be changed independently.
+// Drawing instances of the same base one after the other only sets the values that differ between them
+class MaterialInstance : public Material
+{
+public:
+    MaterialInstance(std::shared_ptr<const Material> baseMaterial);
+
+    // Get the material that provides the values not set in this instance
+    inline std::shared_ptr<const Material> GetBaseMaterial() const { return m_baseMaterial; }
+
+private:
+    std::shared_ptr<const Material> m_baseMaterial;
+};
@@ -4,6 +4,11 @@
 
 #include <span>
 
+// Query from KHR_parallel_shader_compile, not included in our glad headers
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 // Shader is an OpenGL Object that represents a program that runs on the GPU
 // There are different types, with different requirements. See Lecture 2: Shaders for more information
 class Shader : public Object
@@ -47,6 +52,13 @@ public:
     // Compile the shader source code
     bool Compile();
 
+    // Start compiling the shader source code, without querying the result.
+    // The driver can compile in the background until IsCompiled() is called
+    void CompileAsync();
+
+    // Check, without blocking, if the compilation has finished. Requires KHR_parallel_shader_compile
+    bool IsCompilationComplete() const;
+
     // Check if the shader has been successfully compiled
     bool IsCompiled() const;
 
@@ -71,9 +71,16 @@ public:
         return Build(vertexShader, fragmentShader, tesselationControlShader, &tesselationEvaluationShader, &geometryShader);
     }
 
+    // Attach and start linking vertex and fragment shaders, without querying the result.
+    // The shaders can still be compiling, the driver will wait for them
+    void BuildAsync(const Shader& vertexShader, const Shader& fragmentShader);
+
     // Check if shaders have been linked to create a valid program
     bool IsLinked() const;
 
+    // Check, without blocking, if the linking has finished. Requires KHR_parallel_shader_compile
+    bool IsLinkingComplete() const;
+
     // Get a string with linking error messages
     // The max length of the string returned is determined by the capacity of the span
     void GetLinkingErrors(std::span<char> errors) const;
@@ -90,6 +97,18 @@ public:
     // Get information about a specific uniform
     void GetUniformInfo(unsigned int index, int& size, GLenum& glType, std::span<char> uniformName) const;
 
+    // Get the uniform block of a specific uniform (-1 if it is not in a block), and its layout inside the block
+    void GetUniformBlockInfo(unsigned int index, int& blockIndex, int& offset, int& arrayStride, int& matrixStride) const;
+
+    // Find a uniform block index by name. Returns GL_INVALID_INDEX if it doesn't exist
+    GLuint GetUniformBlockIndex(const char* name) const;
+
+    // Get the size in bytes of the data of a uniform block
+    int GetUniformBlockSize(GLuint blockIndex) const;
+
+    // Set the uniform buffer binding point where the block reads its data from
+    void SetUniformBlockBinding(GLuint blockIndex, GLuint binding) const;
+
     // Template method combinations to simplify getting uniforms
     template<typename T>
     void GetUniform(Location location, T& value) const;
@@ -122,8 +141,8 @@ private:
         const Shader* tesselationControlShader, const Shader* tesselationEvaluationShader,
         const Shader* geometryShader);
 
-    // Attach a shader to be linked
-    void AttachShader(const Shader& shader);
+    // Attach a shader to be linked. Optionally skip checking the compilation, to avoid waiting for it
+    void AttachShader(const Shader& shader, bool checkCompiled = true);
 
     // Link currently attached shaders
     bool Link();
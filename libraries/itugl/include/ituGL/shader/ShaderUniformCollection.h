@@ -1,36 +1,66 @@
 #pragma once
 
-#include <ituGL/shader/ShaderProgram.h>
-#include <ituGL/texture/TextureObject.h>
-#include <ituGL/core/Data.h>
+#include <ituGL/shader/ShaderUniformLayout.h>
+#include <ituGL/shader/UniformBufferObject.h>
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
-#include <string>
+#include <cstring>
+#include <cstddef>
 #include <memory>
 
+// Values of the uniforms of a shader program. The description of the uniforms is shared with every
+// collection using the same program, so each one only stores a buffer with the values and the textures.
+// A collection can also be an instance of a base collection, storing only the values set on it (copy-on-write).
+// Only the values modified since the last time are set to the program, and the properties in the material block
+// are uploaded to a uniform buffer when they change, instead of being set on every use
 class ShaderUniformCollection
 {
 public:
     // Alias for a set of names
-    using NameSet = std::unordered_set<std::string>;
+    using NameSet = ShaderUniformLayout::NameSet;
+
+    // Counters of the data sent to the programs, to check how much the dirty tracking saves
+    struct UploadStats
+    {
+        // Properties set one by one, and their size in bytes
+        unsigned int uniformCount = 0;
+        unsigned int uniformBytes = 0;
+        // Material blocks uploaded to their buffers, and their size in bytes
+        unsigned int blockCount = 0;
+        unsigned int blockBytes = 0;
+    };
 
 public:
     ShaderUniformCollection();
     // Initialize with the shader program, will extract all the properties. Skip the names in filtered uniforms
     ShaderUniformCollection(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms = NameSet());
+    ~ShaderUniformCollection();
+
+    ShaderUniformCollection(const ShaderUniformCollection&) = default;
+    ShaderUniformCollection(ShaderUniformCollection&&) = default;
+    ShaderUniformCollection& operator = (const ShaderUniformCollection&) = default;
+    ShaderUniformCollection& operator = (ShaderUniformCollection&&) = default;
 
     // Get the shader program
     std::shared_ptr<ShaderProgram> GetShaderProgram();
     std::shared_ptr<const ShaderProgram> GetShaderProgram() const;
 
     // Reset the material with a different shader
-    void ChangeShader(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms = NameSet());
+    // If keepValues is set, uniforms with the same name and type in both shaders keep their value
+    void ChangeShader(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms = NameSet(), bool keepValues = false);
+
+    // Get the shared description of the uniforms
+    inline std::shared_ptr<const ShaderUniformLayout> GetLayout() const { return m_layout; }
+
+    // Get the collection that this one is an instance of. Null if it is not an instance
+    inline std::shared_ptr<const ShaderUniformCollection> GetBaseCollection() const { return m_baseCollection; }
+
+    // Check if the instance has its own value for the property, instead of the one in the base collection
+    bool IsUniformOverridden(ShaderProgram::Location location) const;
 
     // Get the vertex attribute location by name
     ShaderProgram::Location GetAttributeLocation(const char* name) const;
 
-    // Get the shader uniform location by name
+    // Get the shader uniform location by name. Properties are found in the layout, others are queried to the program
     ShaderProgram::Location GetUniformLocation(const char* name) const;
 
     // Get uniform value for different types, using the name or the uniform location
@@ -67,72 +97,73 @@ public:
     template<typename T>
     T* GetDataUniformPointer(ShaderProgram::Location location);
 
-    // Set all the properties to the shader. Requires the shader program to be in use
+    // Set all the properties to the shader. Requires the shader program to be in use.
+    // If the previous collection set was an instance of the same base, instances only set the values that differ
     void SetUniforms() const;
 
+    // Get the counters since the last reset. Usually reset once per frame
+    inline static const UploadStats& GetUploadStats() { return s_uploadStats; }
+    inline static void ResetUploadStats() { s_uploadStats = UploadStats(); }
+
+protected:
+    // Initialize as an instance of the base collection. Values are read from the base until they are set
+    ShaderUniformCollection(std::shared_ptr<const ShaderUniformCollection> baseCollection);
+
 private:
-    // Different dimensions of the properties
-    enum class UniformDimension
-    {
-        Scalar,
-        Vector2, Vector3, Vector4,
-        VectorFirst = Vector2, VectorLast = Vector4,
-        Matrix2x2, Matrix2x3, Matrix2x4,
-        Matrix3x2, Matrix3x3, Matrix3x4,
-        Matrix4x2, Matrix4x3, Matrix4x4,
-        MatrixFirst = Matrix2x2, MatrixLast = Matrix4x4,
-    };
+    using UniformDimension = ShaderUniformLayout::UniformDimension;
+    using DataUniform = ShaderUniformLayout::DataUniform;
+    using TextureUniform = ShaderUniformLayout::TextureUniform;
 
-    // Struct to store a data property
-    struct DataUniform
+    // Value of a data property set in an instance
+    struct DataOverride
     {
         // Uniform location
         ShaderProgram::Location location;
-        // Data type
-        Data::Type type;
-        // Dimension of the data (scalar, vector, matrix)
-        UniformDimension dimension;
-        // Number of elements of the property
-        unsigned int count;
-        // Index in the data buffer
-        int index;
+        // Offset in bytes in the value buffer of the instance
+        unsigned int offset;
     };
 
-    // Struct to store a texture property
-    struct TextureUniform
+    // Value of a texture property set in an instance
+    struct TextureOverride
     {
-        // Uniform location
-        ShaderProgram::Location location;
-        // Texture subtype
-        TextureObject::Target target;
+        // Texture unit of the property
+        int unit;
         // Shared pointer to the texture object
         std::shared_ptr<const TextureObject> texture;
     };
 
-private:
-    // Get a data uniform
-    DataUniform& GetDataUniform(ShaderProgram::Location location);
-    const DataUniform& GetDataUniform(ShaderProgram::Location location) const;
-
-    // Get a texture uniform
-    TextureUniform& GetTextureUniform(ShaderProgram::Location location);
-    const TextureUniform& GetTextureUniform(ShaderProgram::Location location) const;
+    // Identifier of the values in a collection. Copies get a new one, because the program doesn't have their values yet
+    struct UploadId
+    {
+        UploadId() : value(++s_lastId) {}
+        UploadId(const UploadId&) : UploadId() {}
+        UploadId& operator = (const UploadId&) { value = ++s_lastId; return *this; }
 
-    // Read all the uniforms in the shader and store them as properties
-    // Can skip by name those in the filteredUniforms
-    void ExtractUniforms(const NameSet& filteredUniforms = NameSet());
+        unsigned int value;
 
-    // Check if an OpenGL type is a data type and, if so, return the data type and dimension
-    static bool IsDataUniform(GLenum glType, Data::Type& type, UniformDimension& dimension);
+        static unsigned int s_lastId;
+    };
 
-    // Check if an OpenGL type is a texture and, if so, return the target type
-    static bool IsTextureUniform(GLenum glType, TextureObject::Target& target);
+    // Uniform buffer with the values of the material block. Copies create their own buffer
+    struct BlockBuffer
+    {
+        BlockBuffer() = default;
+        BlockBuffer(const BlockBuffer&) {}
+        BlockBuffer(BlockBuffer&&) = default;
+        BlockBuffer& operator = (const BlockBuffer&) { dirty = true; return *this; }
+        BlockBuffer& operator = (BlockBuffer&&) = default;
+
+        // Created the first time it is uploaded
+        std::unique_ptr<UniformBufferObject> buffer;
+        // Set when the values in the block change
+        bool dirty = true;
+        // Version of the base collection when it was uploaded, instances also depend on the base values
+        unsigned int baseVersion = 0;
+    };
 
-    // Add uniform property
-    void AddUniform(const DataUniform& uniform);
-    template<typename T>
-    void AddUniform(const DataUniform& uniform);
-    void AddUniform(const TextureUniform& uniform);
+private:
+    // Create the value buffers for the current layout
+    void AllocateValues();
 
     // Use uniform property
     void UseUniform(const DataUniform& uniform) const;
@@ -140,11 +171,36 @@ private:
     void UseUniform(const DataUniform& uniform) const;
     void UseUniform(const TextureUniform& uniform) const;
 
-    // Get the buffer where data values are stored for a certain type
+    // Get the pointer to the values of a data property in the buffer, or in the base buffer if not overridden
     template<typename T>
-    std::vector<T>& GetDataValues();
-    template<typename T>
-    const std::vector<T>& GetDataValues() const;
+    const T* GetDataPointer(const DataUniform& uniform) const;
+
+    // Called before the values of a data property are modified. Instances copy the base value the first time
+    void PrepareDataWrite(ShaderProgram::Location location);
+
+    // Find the values set in an instance. Null if not overridden
+    const DataOverride* FindDataOverride(ShaderProgram::Location location) const;
+    const TextureOverride* FindTextureOverride(int unit) const;
+
+    // Get the texture of a texture property, or the base texture if not overridden
+    const std::shared_ptr<const TextureObject>& GetTextureValue(const TextureUniform& uniform) const;
+
+    // Set the data properties that are not in the material block. If onlyDirty is set, skip the ones not modified
+    void SetDataUniforms(bool onlyDirty) const;
+
+    // Set the data properties of an instance, skipping the base values already set by the previous instance
+    void SetInstanceDataUniforms(ShaderUniformLayout::UploadState& uploadState) const;
+
+    // Bind the buffer of the material block, uploading the values first if they changed.
+    // Instances that don't override any value in the block use the buffer of the base collection
+    void UseMaterialBlock() const;
+    void UpdateMaterialBlock() const;
+
+    // Copy the values of a property to the block data, with the offsets and strides of the block layout
+    void WriteBlockValues(const DataUniform& uniform, std::span<std::byte> blockData) const;
+
+    // Index of the property in the layout list
+    inline std::size_t GetDataUniformIndex(const DataUniform& uniform) const { return &uniform - m_layout->GetDataUniforms().data(); }
 
     // Get a span of values for a specific uniform
     template<typename T>
@@ -160,40 +216,46 @@ private:
     template<typename T, int C, int R>
     void GetDataValues(ShaderProgram::Location location, std::span<const glm::mat<C, R, T>>& values) const;
 
-    // Get the size of a data property
-    int GetDataUniformSize(const DataUniform& uniform) const;
+    // Copy the values of the uniforms that match by name, type and size from another collection
+    void CopyUniformValues(const ShaderUniformCollection& source);
 
     // Delete all the properties and set the shader program to null
     void Reset();
 
-#ifndef NDEBUG
-    bool IsScalar(UniformDimension dimension) const;
-    bool IsVector(UniformDimension dimension) const;
-    bool IsMatrix(UniformDimension dimension) const;
-    bool IsVectorSize(UniformDimension dimension, int size) const;
-    bool IsMatrixSize(UniformDimension dimension, int columns, int rows) const;
-#endif
-
 protected:
     // The shader program
     std::shared_ptr<ShaderProgram> m_shaderProgram;
 
 private:
-    // The list of data properties
-    std::vector<DataUniform> m_dataUniforms;
-    // The list of texture properties
-    std::vector<TextureUniform> m_textureUniforms;
-
-    // Map to find data properties in the data list
-    std::unordered_map<ShaderProgram::Location, int> m_locationDataIndex;
-    // Map to find texture properties in the texture list
-    std::unordered_map<ShaderProgram::Location, int> m_locationTextureIndex;
-
-    // Buffers that store the values for data properties
-    std::vector<int> m_intDataValues;
-    std::vector<unsigned int> m_uintDataValues;
-    std::vector<float> m_floatDataValues;
-    std::vector<double> m_doubleDataValues;
+    // Description of the uniforms, shared by all the collections with the same program
+    std::shared_ptr<const ShaderUniformLayout> m_layout;
+
+    // Values of the data properties, at the offsets given by the layout
+    std::vector<std::byte> m_dataValues;
+
+    // Textures of the texture properties, in the same order as the layout. Empty in instances
+    std::vector<std::shared_ptr<const TextureObject>> m_textureValues;
+
+    // Collection this one is an instance of, if any
+    std::shared_ptr<const ShaderUniformCollection> m_baseCollection;
+
+    // Properties set in the instance. Usually a few, so they are searched linearly
+    std::vector<DataOverride> m_dataOverrides;
+    std::vector<TextureOverride> m_textureOverrides;
+
+    // Incremented every time the data values change, to know if the values set to the shader are still valid
+    unsigned int m_version;
+
+    // Identifies the values of this collection in the upload state of the program
+    UploadId m_uploadId;
+
+    // Properties modified since the last time the values were set, in the same order as the layout
+    mutable std::vector<bool> m_dirtyUniforms;
+
+    // Buffer of the material block, if the program has one
+    mutable BlockBuffer m_blockBuffer;
+
+    static UploadStats s_uploadStats;
 };
 
 
@@ -224,7 +286,7 @@ inline void ShaderUniformCollection::GetUniformValue(const char* name, T& value)
 template<typename T>
 inline void ShaderUniformCollection::GetUniformValue(ShaderProgram::Location location, T& value) const
 {
-    GetUniformValue(location, std::span(&value, 1));
+    GetUniformValues(location, std::span(&value, 1));
 }
 
 template<typename T>
@@ -300,15 +362,22 @@ void ShaderUniformCollection::SetUniformValues(ShaderProgram::Location location,
 }
 
 template<typename T>
-inline std::vector<T>& ShaderUniformCollection::GetDataValues()
+inline const T* ShaderUniformCollection::GetDataPointer(const DataUniform& uniform) const
 {
-    return const_cast<std::vector<T>&>(const_cast<const ShaderUniformCollection*>(this)->GetDataValues<T>());
-}
+    unsigned int offset = uniform.offset;
+    if (m_baseCollection)
+    {
+        const DataOverride* dataOverride = FindDataOverride(uniform.location);
+        if (!dataOverride)
+        {
+            return m_baseCollection->GetDataPointer<T>(uniform);
+        }
+        offset = dataOverride->offset;
+    }
 
-template<> inline const std::vector<int>& ShaderUniformCollection::GetDataValues() const { return m_intDataValues; }
-template<> inline const std::vector<unsigned int>& ShaderUniformCollection::GetDataValues() const { return m_uintDataValues; }
-template<> inline const std::vector<float>& ShaderUniformCollection::GetDataValues() const { return m_floatDataValues; }
-template<> inline const std::vector<double>& ShaderUniformCollection::GetDataValues() const { return m_doubleDataValues; }
+    // The buffer is aligned for any type, and the offsets are aligned to the type size
+    return reinterpret_cast<const T*>(m_dataValues.data() + offset);
+}
 
 template<typename T>
 inline std::span<T> ShaderUniformCollection::GetDataValues(ShaderProgram::Location location)
@@ -328,6 +397,7 @@ std::span<const T> ShaderUniformCollection::GetDataValues(ShaderProgram::Locatio
 template<typename T>
 void ShaderUniformCollection::GetDataValues(ShaderProgram::Location location, std::span<T>& values)
 {
+    PrepareDataWrite(location);
     std::span<const T> v;
     const_cast<const ShaderUniformCollection*>(this)->GetDataValues(location, v);
     values = std::span<T>(const_cast<T*>(v.data()), v.size());
@@ -336,36 +406,30 @@ void ShaderUniformCollection::GetDataValues(ShaderProgram::Location location, st
 template<typename T>
 void ShaderUniformCollection::GetDataValues(ShaderProgram::Location location, std::span<const T>& values) const
 {
-    const DataUniform& uniform = GetDataUniform(location);
+    const DataUniform& uniform = m_layout->GetDataUniform(location);
     assert(uniform.type == Data::GetType<T>());
-    assert(IsScalar(uniform.dimension));
-    const std::vector<T>& allValues = GetDataValues<T>();
-    auto dataPtr = &allValues[uniform.index];
-    values = std::span(dataPtr, uniform.count);
+    assert(ShaderUniformLayout::IsScalar(uniform.dimension));
+    values = std::span(GetDataPointer<T>(uniform), uniform.count);
 }
 
 template<typename T, int N>
 void ShaderUniformCollection::GetDataValues(ShaderProgram::Location location, std::span<const glm::vec<N, T>>& values) const
 {
-    const DataUniform& uniform = GetDataUniform(location);
+    const DataUniform& uniform = m_layout->GetDataUniform(location);
     assert(uniform.type == Data::GetType<T>());
-    assert(IsVector(uniform.dimension));
-    assert(IsVectorSize(uniform.dimension, N));
-    const std::vector<T>& allValues = GetDataValues<T>();
-    auto dataPtr = reinterpret_cast<const glm::vec<N, T>*>(&allValues[uniform.index]);
-    values = std::span(dataPtr, uniform.count);
+    assert(ShaderUniformLayout::IsVector(uniform.dimension));
+    assert(ShaderUniformLayout::IsVectorSize(uniform.dimension, N));
+    values = std::span(GetDataPointer<glm::vec<N, T>>(uniform), uniform.count);
 }
 
 template<typename T, int C, int R>
 void ShaderUniformCollection::GetDataValues(ShaderProgram::Location location, std::span<const glm::mat<C, R, T>>& values) const
 {
-    const DataUniform& uniform = GetDataUniform(location);
+    const DataUniform& uniform = m_layout->GetDataUniform(location);
     assert(uniform.type == Data::GetType<T>());
-    assert(IsMatrix(uniform.dimension));
-    assert(IsMatrixSize(uniform.dimension, C, R));
-    const std::vector<T>& allValues = GetDataValues<T>();
-    auto dataPtr = reinterpret_cast<const glm::mat<C, R, T>*>(&allValues[uniform.index]);
-    values = std::span(dataPtr, uniform.count);
+    assert(ShaderUniformLayout::IsMatrix(uniform.dimension));
+    assert(ShaderUniformLayout::IsMatrixSize(uniform.dimension, C, R));
+    values = std::span(GetDataPointer<glm::mat<C, R, T>>(uniform), uniform.count);
 }
 
 template<typename T>
@@ -379,21 +443,10 @@ T* ShaderUniformCollection::GetDataUniformPointer(const char* name)
 template<typename T>
 T* ShaderUniformCollection::GetDataUniformPointer(ShaderProgram::Location location)
 {
-    const DataUniform& uniform = GetDataUniform(location);
-    std::vector<T>& allValues = GetDataValues<T>();
-    return &allValues[uniform.index];
-}
-
-template<typename T>
-void ShaderUniformCollection::AddUniform(const DataUniform& uniform)
-{
-    m_locationDataIndex.insert(std::make_pair(uniform.location, static_cast<int>(m_dataUniforms.size())));
-    m_dataUniforms.push_back(uniform);
-
-    std::vector<T>& values = GetDataValues<T>();
-    m_dataUniforms.back().index = static_cast<int>(values.size());
-    int size = GetDataUniformSize(uniform);
-    values.insert(values.end(), size, T());
+    // Writes through the pointer can't be tracked, assume they happen before the next SetUniforms
+    PrepareDataWrite(location);
+    const DataUniform& uniform = m_layout->GetDataUniform(location);
+    return const_cast<T*>(GetDataPointer<T>(uniform));
 }
 
 template<>
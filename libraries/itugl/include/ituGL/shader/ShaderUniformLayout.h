@@ -0,0 +1,172 @@
+#pragma once
+
+#include <ituGL/shader/ShaderProgram.h>
+#include <ituGL/texture/TextureObject.h>
+#include <ituGL/core/Data.h>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <memory>
+
+// Reflection data of the uniforms in a shader program: names, locations, types and texture units.
+// It only depends on the program and the filtered names, so it is computed once and shared by all the collections using it.
+// Uniforms declared inside a std140 block named MaterialBlock are stored in a uniform buffer instead of set one by one
+class ShaderUniformLayout
+{
+public:
+    // Alias for a set of names
+    using NameSet = std::unordered_set<std::string>;
+
+    // Name of the uniform block with the material properties, and the binding point where its buffer is bound
+    static constexpr const char* MaterialBlockName = "MaterialBlock";
+    static constexpr GLuint MaterialBlockBinding = 0;
+
+    // Block members don't have a location in the program, so they get pseudo-locations starting here.
+    // The program never returns locations this high, so they can't be confused with the real ones of the filtered uniforms
+    static constexpr ShaderProgram::Location BlockLocationBase = 0x40000000;
+
+    // Different dimensions of the properties
+    enum class UniformDimension
+    {
+        Scalar,
+        Vector2, Vector3, Vector4,
+        VectorFirst = Vector2, VectorLast = Vector4,
+        Matrix2x2, Matrix2x3, Matrix2x4,
+        Matrix3x2, Matrix3x3, Matrix3x4,
+        Matrix4x2, Matrix4x3, Matrix4x4,
+        MatrixFirst = Matrix2x2, MatrixLast = Matrix4x4,
+    };
+
+    // Description of a data property
+    struct DataUniform
+    {
+        // Uniform name, as reported by the program
+        std::string name;
+        // Uniform location
+        ShaderProgram::Location location;
+        // Data type
+        Data::Type type;
+        // Dimension of the data (scalar, vector, matrix)
+        UniformDimension dimension;
+        // Number of elements of the property
+        unsigned int count;
+        // Offset in bytes in the value buffer
+        unsigned int offset;
+        // Offset in bytes in the material block, -1 if it is not in the block
+        int blockOffset;
+        // Distance in bytes between array elements and matrix columns in the material block
+        int arrayStride;
+        int matrixStride;
+    };
+
+    // Description of a texture property
+    struct TextureUniform
+    {
+        // Uniform name, as reported by the program
+        std::string name;
+        // Uniform location
+        ShaderProgram::Location location;
+        // Texture subtype
+        TextureObject::Target target;
+        // Texture unit where it is bound, also the index in the texture list
+        int unit;
+    };
+
+    // Which collection set the current uniform values of the program. Shared by all the layouts of the same program
+    // Collections are identified by number instead of pointer, because they might not exist anymore
+    struct UploadState
+    {
+        // Last collection that set its values, 0 if none
+        unsigned int lastUsedId = 0;
+        // Base collection of the last one, or the same one if it is not an instance
+        unsigned int baseId = 0;
+        // Version of the base collection when the values were set
+        unsigned int baseVersion = 0;
+        // Properties where the last collection set a different value than the base
+        std::vector<ShaderProgram::Location> overriddenLocations;
+    };
+
+public:
+    // Read all the uniforms in the shader. Skip the names in filtered uniforms
+    ShaderUniformLayout(const ShaderProgram& shaderProgram, const NameSet& filteredUniforms);
+
+    // Get the shared layout of the program, creating it the first time
+    static std::shared_ptr<const ShaderUniformLayout> GetLayout(const std::shared_ptr<ShaderProgram>& shaderProgram, const NameSet& filteredUniforms);
+
+    // All the properties
+    inline const std::vector<DataUniform>& GetDataUniforms() const { return m_dataUniforms; }
+    inline const std::vector<TextureUniform>& GetTextureUniforms() const { return m_textureUniforms; }
+
+    // Find the property by location. Returns null if it is not in the layout
+    const DataUniform* FindDataUniform(ShaderProgram::Location location) const;
+    const TextureUniform* FindTextureUniform(ShaderProgram::Location location) const;
+
+    // Get the property by location. It must be in the layout
+    const DataUniform& GetDataUniform(ShaderProgram::Location location) const;
+    const TextureUniform& GetTextureUniform(ShaderProgram::Location location) const;
+
+    // Find the location of a property by name, without querying the program. Returns -1 if it is not in the layout
+    ShaderProgram::Location FindUniformLocation(const char* name) const;
+
+    // Size in bytes needed to store the values of all the data properties
+    inline unsigned int GetDataSize() const { return m_dataSize; }
+
+    // Check if the program declares the material block. Otherwise, all the data properties are set one by one
+    inline bool HasMaterialBlock() const { return m_materialBlockSize > 0; }
+
+    // Size in bytes of the material block, with std140 layout
+    inline unsigned int GetMaterialBlockSize() const { return m_materialBlockSize; }
+
+    // Check if a data property is stored in the material block
+    inline static bool IsInMaterialBlock(const DataUniform& uniform) { return uniform.blockOffset >= 0; }
+
+    // State of the uniform values in the program
+    inline UploadState& GetUploadState() const { return *m_uploadState; }
+
+    // Get the number of scalar elements of a data property
+    static unsigned int GetDataUniformSize(const DataUniform& uniform);
+
+    static bool IsScalar(UniformDimension dimension);
+    static bool IsVector(UniformDimension dimension);
+    static bool IsMatrix(UniformDimension dimension);
+    static bool IsVectorSize(UniformDimension dimension, int size);
+    static bool IsMatrixSize(UniformDimension dimension, int columns, int rows);
+
+private:
+    // Check if an OpenGL type is a data type and, if so, return the data type and dimension
+    static bool IsDataUniform(GLenum glType, Data::Type& type, UniformDimension& dimension);
+
+    // Check if an OpenGL type is a texture and, if so, return the target type
+    static bool IsTextureUniform(GLenum glType, TextureObject::Target& target);
+
+    // Add the property to the lists and index it by location and name
+    void AddUniform(DataUniform&& uniform);
+    void AddUniform(TextureUniform&& uniform);
+    void AddLocation(std::vector<int>& locationIndex, ShaderProgram::Location location, int index);
+    void AddName(const std::string& name, ShaderProgram::Location location);
+
+private:
+    // The list of data properties
+    std::vector<DataUniform> m_dataUniforms;
+    // The list of texture properties
+    std::vector<TextureUniform> m_textureUniforms;
+
+    // Index of the properties in the lists, by location. Locations are small, so a vector is faster than a map. -1 if missing
+    std::vector<int> m_locationDataIndex;
+    std::vector<int> m_locationTextureIndex;
+    // Same for the block members, by pseudo-location minus BlockLocationBase
+    std::vector<int> m_blockLocationDataIndex;
+
+    // Locations by name, to avoid querying the program
+    std::unordered_map<std::string, ShaderProgram::Location> m_nameLocations;
+
+    // Size in bytes of the value buffer
+    unsigned int m_dataSize;
+
+    // Size in bytes of the material block, 0 if the program doesn't have it
+    unsigned int m_materialBlockSize;
+
+    // State of the uniform values in the program
+    std::shared_ptr<UploadState> m_uploadState;
+};
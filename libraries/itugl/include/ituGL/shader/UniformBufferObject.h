@@ -0,0 +1,16 @@
+#pragma once
+
+#include <ituGL/core/BufferObject.h>
+
+// Uniform Buffer Object (UBO) is the common term for a BufferObject when it is used as the data of uniform blocks
+class UniformBufferObject : public BufferObjectBase<BufferObject::UniformBuffer>
+{
+public:
+    UniformBufferObject();
+
+    // Bind a range of the buffer to one of the indexed binding points, where the uniform blocks read from
+    void BindRange(GLuint binding, size_t offset, size_t size) const;
+
+    // Bind the whole buffer to one of the indexed binding points
+    void BindBase(GLuint binding) const;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ituGL/core/BufferObject.h>
+
+// Pixel Buffer Object (PBO) is the common term for a BufferObject when it is used as the source of texture uploads.
+// While it is bound, the data pointer of the texture image functions is an offset in the buffer, and the copy to the
+// texture can happen asynchronously, after the function returns
+class PixelBufferObject : public BufferObjectBase<BufferObject::PixelUnpackBuffer>
+{
+public:
+    PixelBufferObject();
+};
@@ -20,12 +20,41 @@ public:
         GLsizei width, GLsizei height,
         Format format, InternalFormat internalFormat,
         std::span<const T> data, Data::Type type = Data::Type::None);
+
+    // Initialize a level with data that is already block compressed in the internal format
+    void SetCompressedImage(GLint level,
+        GLsizei width, GLsizei height,
+        InternalFormat internalFormat, std::span<const std::byte> data);
+
+    // Copy data to a region of a level that is already initialized
+    template <typename T>
+    void SetSubImage(GLint level, GLint x, GLint y,
+        GLsizei width, GLsizei height, Format format,
+        std::span<const T> data, Data::Type type = Data::Type::None);
+
+    // Copy data to a region of a level from the pixel buffer object that is bound, starting at the offset in the buffer
+    void SetSubImage(GLint level, GLint x, GLint y,
+        GLsizei width, GLsizei height, Format format,
+        Data::Type type, size_t bufferOffset);
+
+    // Copy a whole level to the data, converted to the format and type. Waits for the GPU
+    template <typename T>
+    void GetImage(GLint level, Format format,
+        std::span<T> data, Data::Type type = Data::Type::None) const;
 };
 
 // Set image with data in bytes
 template <>
 void Texture2DObject::SetImage<std::byte>(GLint level, GLsizei width, GLsizei height, Format format, InternalFormat internalFormat, std::span<const std::byte> data, Data::Type type);
 
+// Set subimage with data in bytes
+template <>
+void Texture2DObject::SetSubImage<std::byte>(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, Format format, std::span<const std::byte> data, Data::Type type);
+
+// Get image with data in bytes
+template <>
+void Texture2DObject::GetImage<std::byte>(GLint level, Format format, std::span<std::byte> data, Data::Type type) const;
+
 // Template method to set image with any kind of data
 template <typename T>
 inline void Texture2DObject::SetImage(GLint level, GLsizei width, GLsizei height,
@@ -38,3 +67,25 @@ inline void Texture2DObject::SetImage(GLint level, GLsizei width, GLsizei height
     SetImage(level, width, height, format, internalFormat, Data::GetBytes(data), type);
 }
 
+// Template method to set subimage with any kind of data
+template <typename T>
+inline void Texture2DObject::SetSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+    Format format, std::span<const T> data, Data::Type type)
+{
+    if (type == Data::Type::None)
+    {
+        type = Data::GetType<T>();
+    }
+    SetSubImage(level, x, y, width, height, format, Data::GetBytes(data), type);
+}
+
+// Template method to get image with any kind of data
+template <typename T>
+inline void Texture2DObject::GetImage(GLint level, Format format, std::span<T> data, Data::Type type) const
+{
+    if (type == Data::Type::None)
+    {
+        type = Data::GetType<T>();
+    }
+    GetImage(level, format, Data::GetBytes(data), type);
+}
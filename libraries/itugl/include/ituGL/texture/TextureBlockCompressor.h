@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ituGL/texture/TextureObject.h>
+#include <span>
+#include <cstddef>
+
+// Encoder of the BC1, BC3, BC4 and BC5 block compressed formats (S3TC and RGTC), for images with 8-bit components.
+// Each 4x4 block is fitted to a line between two endpoints, so it is fast enough to compress when the texture is cooked,
+// not at the quality of offline compressors
+class TextureBlockCompressor
+{
+public:
+    // Format for images with this number of components: BC4 for 1, BC5 for 2, BC1 for 3 (no alpha) and BC3 for 4
+    static TextureObject::InternalFormat GetCompressedFormat(int componentCount, bool srgb);
+
+    // Size in bytes of an image compressed in the format
+    static size_t GetCompressedSize(int width, int height, TextureObject::InternalFormat internalFormat);
+
+    // Compress the image to the output, that must have the compressed size. Edge blocks repeat the last row and column
+    static void Compress(std::span<const std::byte> data, int width, int height, int componentCount,
+        TextureObject::InternalFormat internalFormat, std::span<std::byte> output);
+
+    // Decode a BC4 image to values in [0, 1], interpolated in floating point like the GPU does.
+    // The output must have one value per pixel
+    static void DecompressBC4(std::span<const std::byte> data, int width, int height, std::span<float> output);
+
+private:
+    // Pixels of a block, always with 4 components
+    using Block = unsigned char[16][4];
+
+    // Copy the block at the position, filling the missing components with 0 and the alpha with 255
+    static void LoadBlock(const unsigned char* data, int width, int height, int componentCount, int x, int y, Block& block);
+
+    // Encode the RGB components in 8 bytes, with 4 colors interpolated between two 565 endpoints
+    static void EncodeColorBlock(const Block& block, std::byte* output);
+
+    // Encode one component in 8 bytes, with 8 values interpolated between two 8-bit endpoints
+    static void EncodeChannelBlock(const Block& block, int channel, std::byte* output);
+};
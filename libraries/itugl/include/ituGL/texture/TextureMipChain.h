@@ -0,0 +1,61 @@
+#pragma once
+
+#include <ituGL/texture/TextureObject.h>
+#include <ituGL/core/Data.h>
+#include <vector>
+#include <span>
+#include <cstddef>
+
+// Pixels of all the mip levels of a 2D texture, from the full size down to 1x1, stored in a single buffer.
+// Built on the CPU, so the levels can be uploaded in any order, instead of generating them on the GPU from level 0
+class TextureMipChain
+{
+public:
+    // Size of a level, and where its pixels are in the buffer
+    struct Level
+    {
+        int width;
+        int height;
+        size_t offset;
+        size_t size;
+    };
+
+public:
+    TextureMipChain();
+
+    // Build the chain from the pixels of level 0, filtering each level down from the previous one
+    TextureMipChain(std::span<const std::byte> data, int width, int height, TextureObject::Format format, Data::Type dataType);
+
+    inline bool IsEmpty() const { return m_levels.empty(); }
+
+    inline TextureObject::Format GetFormat() const { return m_format; }
+    inline Data::Type GetDataType() const { return m_dataType; }
+
+    // Size in bytes of one pixel
+    inline int GetPixelSize() const { return m_pixelSize; }
+
+    inline int GetLevelCount() const { return static_cast<int>(m_levels.size()); }
+    inline const Level& GetLevel(int level) const { return m_levels[level]; }
+
+    // Pixels of one level
+    inline std::span<const std::byte> GetLevelData(int level) const { return std::span<const std::byte>(m_data).subspan(m_levels[level].offset, m_levels[level].size); }
+
+    // Pixels of all the levels, in order
+    inline std::span<const std::byte> GetData() const { return m_data; }
+
+    // Number of levels of a texture of this size, down to 1x1
+    static int GetLevelCount(int width, int height);
+
+private:
+    // Fill a level with the average of each 2x2 block of the previous one. Odd sizes repeat the last row or column
+    template<typename T>
+    void Downsample(int level);
+
+private:
+    TextureObject::Format m_format;
+    Data::Type m_dataType;
+    int m_pixelSize;
+
+    std::vector<Level> m_levels;
+    std::vector<std::byte> m_data;
+};
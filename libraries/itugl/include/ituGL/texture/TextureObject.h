@@ -75,6 +75,9 @@ public:
     // Get number of components of the data type of the texture (packed components count as 1)
     static int GetDataComponentCount(InternalFormat internalFormat);
 
+    // Get the size in bytes of each 4x4 block of a block compressed format, 0 if it is not block compressed
+    static int GetBlockSize(InternalFormat internalFormat);
+
     // Set active texture unit
     static void SetActiveTexture(GLint textureUnit);
 
@@ -122,14 +125,14 @@ protected:
     // Check if this TextureObject is currently bound to this target
     inline bool IsBound() const override { return s_boundHandle == GetHandle(); }
 
-    // Handle of the TextureObject that is currently bound to this target
-    static Handle s_boundHandle;
+    // Handle of the TextureObject that is currently bound to this target. Per thread, each thread has its own context
+    static thread_local Handle s_boundHandle;
 #endif
 };
 
 #ifndef NDEBUG
 template<TextureObject::Target T>
-Object::Handle TextureObjectBase<T>::s_boundHandle = Object::NullHandle;
+thread_local Object::Handle TextureObjectBase<T>::s_boundHandle = Object::NullHandle;
 #endif
 
 template<TextureObject::Target T>
@@ -229,6 +232,13 @@ enum TextureObject::InternalFormat : GLint
     InternalFormatRGBACompressed = GL_COMPRESSED_RGBA,
     InternalFormatSRGBCompressed = GL_COMPRESSED_SRGB,
     InternalFormatSRGBACompressed = GL_COMPRESSED_SRGB_ALPHA,
+    // Block compressed, for data compressed offline. The S3TC values are from EXT_texture_compression_s3tc, not in the core headers
+    InternalFormatBC1 = 0x83F0, // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    InternalFormatBC1SRGB = 0x8C4C, // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+    InternalFormatBC3 = 0x83F3, // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    InternalFormatBC3SRGB = 0x8C4F, // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+    InternalFormatBC4 = GL_COMPRESSED_RED_RGTC1,
+    InternalFormatBC5 = GL_COMPRESSED_RG_RGTC2,
     // Depth Stencil
     InternalFormatDepth = GL_DEPTH_COMPONENT,
     InternalFormatDepth16 = GL_DEPTH_COMPONENT16,
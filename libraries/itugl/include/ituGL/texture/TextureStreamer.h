@@ -0,0 +1,134 @@
+#pragma once
+
+#include <ituGL/texture/Texture2DObject.h>
+#include <ituGL/texture/TextureMipChain.h>
+#include <ituGL/texture/PixelBufferObject.h>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+
+// Streams the mip levels of 2D textures over several frames. A texture is created with only its smallest levels,
+// so it can be used right away, and the bigger ones are copied to pixel buffer objects and uploaded asynchronously.
+// GL_TEXTURE_BASE_LEVEL is lowered once the GPU completed each upload. The levels needed by each texture come from
+// the screen size of the objects using it, and textures not seen recently lose their top levels when over the budget.
+// All the methods must be called from the GL thread
+class TextureStreamer
+{
+public:
+    // Counters of the last update
+    struct Stats
+    {
+        unsigned int textureCount = 0;
+        // Bytes of the levels that can be sampled, and of the levels in the mip chains kept in memory
+        size_t residentBytes = 0;
+        size_t totalBytes = 0;
+        // Levels uploaded and dropped
+        unsigned int uploadedLevels = 0;
+        size_t uploadedBytes = 0;
+        unsigned int droppedLevels = 0;
+    };
+
+public:
+    // Levels up to residentSize texels per side are uploaded when the texture is added
+    TextureStreamer(size_t budgetBytes = 256 << 20, size_t uploadBytesPerFrame = 8 << 20, int residentSize = 64);
+    ~TextureStreamer();
+
+    // Not copyable, it owns the staging buffers and fences
+    TextureStreamer(const TextureStreamer&) = delete;
+    void operator = (const TextureStreamer&) = delete;
+
+    // Create a texture with the levels of the chain. Only the smallest ones are uploaded now, the rest are streamed in
+    std::shared_ptr<Texture2DObject> AddTexture(TextureMipChain&& mipChain, TextureObject::InternalFormat internalFormat, bool wrapping);
+
+    // Check if the texture was created by the streamer
+    bool IsStreamed(const TextureObject& texture) const;
+
+    // Ask for the levels needed to draw the texture covering screenSize pixels. Marks the texture as seen in this frame.
+    // Textures that are not streamed are ignored
+    void RequestScreenSize(const TextureObject& texture, float screenSize);
+
+    // Ask for a specific level to be resident. Marks the texture as seen in this frame
+    void RequestLevel(const TextureObject& texture, int level);
+
+    // Finish the uploads completed by the GPU, drop levels to stay in budget, and start uploading new levels. Once per frame
+    void Update();
+
+    inline size_t GetBudget() const { return m_budgetBytes; }
+    inline void SetBudget(size_t budgetBytes) { m_budgetBytes = budgetBytes; }
+
+    inline size_t GetUploadBytesPerFrame() const { return m_uploadBytesPerFrame; }
+    inline void SetUploadBytesPerFrame(size_t uploadBytesPerFrame) { m_uploadBytesPerFrame = uploadBytesPerFrame; }
+
+    inline const Stats& GetStats() const { return m_stats; }
+
+    // Level of a texture of textureSize texels that has about one texel per pixel when covering screenSize pixels
+    static int GetRequiredLevel(int textureSize, float screenSize);
+
+private:
+    struct StreamedTexture
+    {
+        std::weak_ptr<Texture2DObject> texture;
+        TextureMipChain mipChain;
+        TextureObject::InternalFormat internalFormat;
+        // First level that can be sampled, the GL_TEXTURE_BASE_LEVEL of the texture
+        int baseLevel;
+        // First level uploaded when the texture was added, it is never dropped
+        int tailLevel;
+        // Level wanted by the objects that use the texture
+        int requestedLevel;
+        // Smallest level requested in the current frame, or the level count if not seen
+        int frameRequestedLevel;
+        // Level being uploaded, -1 if none
+        int uploadingLevel;
+        unsigned int lastSeenFrame;
+    };
+
+    // Staging buffer for one level, and the fence that tells when the GPU finished reading it
+    struct Upload
+    {
+        PixelBufferObject buffer;
+        size_t bufferSize = 0;
+        GLsync fence = nullptr;
+        // Texture and level being uploaded. The buffer is free if the level is -1
+        Object::Handle textureHandle = 0;
+        int level = -1;
+    };
+
+private:
+    // Lower the base level of the textures whose uploads are complete, and release their buffers
+    void FinishUploads();
+
+    // Drop the top levels of the textures seen longest ago until the resident levels fit in the budget
+    void DropLevels();
+
+    // Start uploading the next level of the textures that need more detail
+    void StartUploads();
+
+    // Copy a level to a free staging buffer and start the upload. Returns false if there is no free buffer
+    bool StartUpload(Object::Handle textureHandle, StreamedTexture& streamedTexture, int level);
+
+    void SetBaseLevel(Texture2DObject& texture, int baseLevel);
+
+    // Size in bytes of the levels that can be sampled
+    static size_t GetResidentSize(const StreamedTexture& streamedTexture);
+
+    StreamedTexture* FindTexture(const TextureObject& texture);
+
+private:
+    // Number of staging buffers, the maximum number of levels uploading at the same time
+    static constexpr int UploadBufferCount = 4;
+
+    // Streamed textures, by the handle of the texture object
+    std::unordered_map<Object::Handle, StreamedTexture> m_textures;
+
+    // Staging buffers, reused once the GPU is done with them
+    std::vector<Upload> m_uploads;
+
+    size_t m_budgetBytes;
+    size_t m_uploadBytesPerFrame;
+    int m_residentSize;
+
+    unsigned int m_frame;
+
+    Stats m_stats;
+};
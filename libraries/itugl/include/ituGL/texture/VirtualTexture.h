@@ -0,0 +1,158 @@
+#pragma once
+
+#include <ituGL/texture/Texture2DObject.h>
+#include <glm/vec2.hpp>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+#include <cstdint>
+
+class AssetLoadQueue;
+
+// Software virtual texture: an RGBA8 texture too big to keep in memory, split in square pages for each mip level.
+// Only the pages that are seen are resident, in the slots of a physical atlas, and a page table texture with one texel
+// per page tells the shader where each page is. Pages that are not resident point to their closest resident ancestor,
+// so there is always something to sample, and the page of the last level covers the whole texture and is never evicted.
+// Each frame, a feedback pass writes the pages wanted by the pixels, and they are added here. The missing ones load
+// the coarsest first, and then the most requested, evicting the pages that were not used for the longest time.
+// Pages are filled on the workers of the load queue, and copied to the atlas with the uploads, with a border of texels
+// from the neighbour pages, so the bilinear filter doesn't bleed between slots.
+// The page table texels are (slot x, slot y, level of the page, 255), and the feedback texels (page x, page y, level, 255).
+// All the methods must be called from the GL thread
+class VirtualTexture
+{
+public:
+    // Page to fill. The texel (x, y) of the page, border included, is centered on uvMin + (x + 0.5, y + 0.5) * texelSize
+    struct PageRequest
+    {
+        int level;
+        int pageX;
+        int pageY;
+        // Side of the page in texels, border included
+        int size;
+        glm::vec2 uvMin;
+        float texelSize;
+    };
+
+    // Fill the texels of the page, RGBA8 with red in the low byte, row after row. Called on the workers
+    using PageFunction = std::function<void(const PageRequest&, std::span<uint32_t>)>;
+
+    struct Stats
+    {
+        unsigned int residentPages = 0;
+        unsigned int loadingPages = 0;
+        // Different pages in the last feedback
+        unsigned int requestedPages = 0;
+
+        // Totals since the start
+        unsigned int loadedPages = 0;
+        unsigned int evictedPages = 0;
+    };
+
+public:
+    // pageCount is the number of pages per side of the first level, a power of two up to 256, and pageSize their side in
+    // texels, without the border. The atlas has atlasPages x atlasPages slots. The last page is filled right away
+    VirtualTexture(int pageCount, int pageSize, int border, int atlasPages, AssetLoadQueue& loadQueue, PageFunction pageFunction);
+
+    // Not copyable, it owns the textures
+    VirtualTexture(const VirtualTexture&) = delete;
+    void operator = (const VirtualTexture&) = delete;
+
+    inline int GetPageCount() const { return m_pageCount; }
+    inline int GetPageSize() const { return m_pageSize; }
+    inline int GetBorder() const { return m_border; }
+    inline int GetLevelCount() const { return m_levelCount; }
+
+    // Size in texels of the first level
+    inline int GetSize() const { return m_pageCount * m_pageSize; }
+
+    inline std::shared_ptr<Texture2DObject> GetPageTable() const { return m_pageTable; }
+    inline std::shared_ptr<Texture2DObject> GetAtlas() const { return m_atlas; }
+    inline int GetAtlasSize() const { return m_atlasPages * GetSlotSize(); }
+
+    // Pages that start loading in each update, and pages loading at the same time
+    inline void SetLoadBudget(unsigned int loadsPerFrame, unsigned int maxLoading) { m_loadsPerFrame = loadsPerFrame; m_maxLoading = maxLoading; }
+
+    // Add the texels written by the feedback pass. Texels with alpha 0 are ignored
+    void AddFeedback(std::span<const uint32_t> feedback);
+
+    // Finish the pages that were uploaded, load the ones requested by the feedback, and update the page table. Once per frame
+    void Update();
+
+    inline const Stats& GetStats() const { return m_stats; }
+
+private:
+    enum class PageState : uint8_t
+    {
+        Missing,
+        Loading,
+        Resident
+    };
+
+    struct Page
+    {
+        PageState state = PageState::Missing;
+        int slot = -1;
+        uint32_t lastUsedFrame = 0;
+        // Frame of the last request, and number of feedback texels in that frame
+        uint32_t requestFrame = ~0u;
+        uint32_t requestCount = 0;
+        // Frame the page was added to the candidates
+        uint32_t candidateFrame = ~0u;
+    };
+
+private:
+    inline int GetSlotSize() const { return m_pageSize + 2 * m_border; }
+
+    inline int GetLevelPageCount(int level) const { return m_pageCount >> level; }
+    inline int GetPageIndex(int level, int pageX, int pageY) const { return m_levelOffsets[level] + pageY * GetLevelPageCount(level) + pageX; }
+    void GetPageCoordinates(int pageIndex, int& level, int& pageX, int& pageY) const;
+
+    PageRequest GetPageRequest(int pageIndex) const;
+
+    // Free slot, or the slot of the page used longest ago, but not in this frame. Returns -1 if there is none
+    int FindSlot();
+
+    void LoadPage(int pageIndex, int slot);
+
+    // Rebuild the page table from the level down to the first one, and upload those levels
+    void UpdatePageTable(int fromLevel);
+
+private:
+    int m_pageCount;
+    int m_pageSize;
+    int m_border;
+    int m_atlasPages;
+    int m_levelCount;
+
+    AssetLoadQueue& m_loadQueue;
+    std::shared_ptr<const PageFunction> m_pageFunction;
+
+    std::shared_ptr<Texture2DObject> m_pageTable;
+    std::shared_ptr<Texture2DObject> m_atlas;
+
+    // Pages of all the levels, each level after the previous one, and where each level starts
+    std::vector<Page> m_pages;
+    std::vector<int> m_levelOffsets;
+
+    // Page in each slot of the atlas, or -1 if free
+    std::vector<int> m_slots;
+
+    // Page table texels, in the same order as the pages
+    std::vector<uint32_t> m_pageTableData;
+
+    // Pages requested in this frame, and pages to load
+    std::vector<int> m_requestedPages;
+    std::vector<int> m_candidates;
+
+    // Pages whose upload finished, added on this thread by the finish tasks
+    std::shared_ptr<std::vector<int>> m_completedPages;
+
+    unsigned int m_loadsPerFrame;
+    unsigned int m_maxLoading;
+
+    uint32_t m_frame;
+
+    Stats m_stats;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+#include <cstddef>
+
+// Read-only view of a whole file mapped in memory. Opening it is cheap, the pages are read by the OS when they are accessed
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Not copyable, the mapping is released once
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& mappedFile) noexcept;
+    MappedFile& operator = (MappedFile&& mappedFile) noexcept;
+
+    // Map the file. Returns false if it doesn't exist or is empty
+    bool Open(const char* path);
+
+    // Release the mapping. The data can't be accessed after this
+    void Close();
+
+    inline bool IsOpen() const { return m_data != nullptr; }
+
+    inline std::span<const std::byte> GetData() const { return std::span<const std::byte>(m_data, m_size); }
+
+private:
+    const std::byte* m_data;
+    size_t m_size;
+
+#ifdef _WIN32
+    // Handle of the file mapping object, the view keeps the file open
+    void* m_mappingHandle;
+#endif
+};
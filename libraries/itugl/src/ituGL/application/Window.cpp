@@ -12,6 +12,21 @@ Window::Window(int width, int height, const char* title) : m_window(nullptr)
     m_window = glfwCreateWindow(width, height, title, nullptr, nullptr);
 }
 
+// Same hints, but sharing the context of the other window
+Window::Window(int width, int height, const char* title, const Window& sharedWindow, bool visible) : m_window(nullptr)
+{
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
+    m_window = glfwCreateWindow(width, height, title, nullptr, const_cast<GLFWwindow*>(sharedWindow.GetInternalWindow()));
+
+    // Hints are kept for the next windows
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+}
+
 // If we have an internal GLFW window, destroy it
 Window::~Window()
 {
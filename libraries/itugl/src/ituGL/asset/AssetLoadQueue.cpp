@@ -0,0 +1,320 @@
+#include <ituGL/asset/AssetLoadQueue.h>
+
+#include <ituGL/application/Window.h>
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+AssetLoadQueue::AssetLoadQueue(unsigned int workerCount)
+    : m_stopping(false), m_pushedUploads(nullptr), m_uploadStopping(false), m_pendingCount(0)
+{
+    if (workerCount == 0)
+    {
+        // hardware_concurrency can return 0 if it is unknown
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    m_workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        m_workers.emplace_back(&AssetLoadQueue::RunWorker, this);
+    }
+}
+
+AssetLoadQueue::~AssetLoadQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_workMutex);
+        m_stopping = true;
+        m_work.clear();
+    }
+    m_workCondition.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+
+    if (m_uploadThread.joinable())
+    {
+        // Wake up the upload thread with an empty node. It stops at the flag, and never runs the empty node
+        m_uploadStopping = true;
+        PushUpload(new UploadNode{ Task(), Task(), nullptr });
+        m_uploadThread.join();
+        m_uploadWindow.reset();
+    }
+
+    // Uploads that will never run
+    CollectUploads();
+    for (UploadNode* node : m_uploads)
+    {
+        delete node;
+    }
+
+    // Uploads that will never finish. The syncs are shared, the main context can delete them
+    for (const FencedUpload& fencedUpload : m_completedUploads)
+    {
+        glDeleteSync(fencedUpload.fence);
+    }
+    for (const FencedUpload& fencedUpload : m_fencedUploads)
+    {
+        glDeleteSync(fencedUpload.fence);
+    }
+}
+
+void AssetLoadQueue::SubmitWork(Task task)
+{
+    ++m_pendingCount;
+    {
+        std::lock_guard<std::mutex> lock(m_workMutex);
+        m_work.push_back(std::move(task));
+    }
+    m_workCondition.notify_one();
+}
+
+void AssetLoadQueue::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& function)
+{
+    // Shared with the tasks. A task that only starts once all the indices are taken finds there is nothing left,
+    // and returns without touching the function
+    struct Work
+    {
+        std::atomic<unsigned int> nextIndex = 0;
+        unsigned int doneCount = 0;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    std::shared_ptr<Work> work = std::make_shared<Work>();
+
+    auto runIndices = [work, count, &function]()
+    {
+        for (unsigned int index = work->nextIndex++; index < count; index = work->nextIndex++)
+        {
+            function(index);
+
+            std::lock_guard<std::mutex> lock(work->mutex);
+            if (++work->doneCount == count)
+            {
+                work->condition.notify_all();
+            }
+        }
+    };
+
+    // This thread takes indices too, so it is never only waiting for busy workers
+    unsigned int taskCount = std::min(GetWorkerCount(), count > 0 ? count - 1 : 0);
+    for (unsigned int i = 0; i < taskCount; ++i)
+    {
+        SubmitWork(runIndices);
+    }
+    runIndices();
+
+    std::unique_lock<std::mutex> lock(work->mutex);
+    work->condition.wait(lock, [&]() { return work->doneCount == count; });
+}
+
+void AssetLoadQueue::SubmitUpload(Task upload, Task finish)
+{
+    ++m_pendingCount;
+    PushUpload(new UploadNode{ std::move(upload), std::move(finish), nullptr });
+}
+
+void AssetLoadQueue::PushUpload(UploadNode* node)
+{
+    node->next = m_pushedUploads.load(std::memory_order_relaxed);
+    while (!m_pushedUploads.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+    {
+        // node->next was updated with the current head, try again
+    }
+
+    // Only the upload thread waits on the list
+    m_pushedUploads.notify_one();
+}
+
+bool AssetLoadQueue::StartUploadThread(const Window& mainWindow)
+{
+    assert(!m_uploadThread.joinable());
+
+    // GLFW windows must be created on the main thread, only the context is used on the upload thread
+    m_uploadWindow = std::make_unique<Window>(1, 1, "Upload", mainWindow, false);
+    if (!m_uploadWindow->IsValid())
+    {
+        std::cout << "ERROR::ASSETLOADQUEUE::UPLOAD_CONTEXT_FAILED" << std::endl;
+        m_uploadWindow.reset();
+        return false;
+    }
+
+    // From now on, the upload thread is the only consumer of the upload list
+    m_uploadThread = std::thread(&AssetLoadQueue::RunUploadThread, this);
+    return true;
+}
+
+unsigned int AssetLoadQueue::ProcessUploads(double budgetSeconds)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    if (m_uploadThread.joinable())
+    {
+        FinishFencedUploads(startTime, budgetSeconds);
+        return static_cast<unsigned int>(m_fencedUploads.size());
+    }
+
+    CollectUploads();
+    while (!m_uploads.empty())
+    {
+        UploadNode* node = m_uploads.front();
+        m_uploads.pop_front();
+
+        // Same context, the finish task sees the results of the upload without waiting
+        node->upload();
+        if (node->finish)
+        {
+            node->finish();
+        }
+        delete node;
+        --m_pendingCount;
+
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - startTime;
+        if (duration.count() >= budgetSeconds)
+        {
+            break;
+        }
+    }
+
+    return static_cast<unsigned int>(m_uploads.size());
+}
+
+void AssetLoadQueue::WaitAll()
+{
+    while (m_pendingCount > 0)
+    {
+        // Blocking anyway, so there is no budget
+        ProcessUploads(std::numeric_limits<double>::max());
+        if (m_pendingCount > 0)
+        {
+            WaitForUploads();
+        }
+    }
+}
+
+void AssetLoadQueue::RunWorker()
+{
+    while (true)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_workMutex);
+            m_workCondition.wait(lock, [this]() { return m_stopping || !m_work.empty(); });
+            if (m_stopping)
+            {
+                break;
+            }
+            task = std::move(m_work.front());
+            m_work.pop_front();
+        }
+
+        // Tasks that continue on the GL thread submit their upload before returning, so the pending count doesn't reach 0
+        task();
+        --m_pendingCount;
+    }
+}
+
+void AssetLoadQueue::RunUploadThread()
+{
+    glfwMakeContextCurrent(m_uploadWindow->GetInternalWindow());
+
+    while (true)
+    {
+        m_pushedUploads.wait(nullptr, std::memory_order_acquire);
+        if (m_uploadStopping)
+        {
+            break;
+        }
+
+        // The stop flag is checked again for each node: the destructor may have set it after the check above, and the
+        // rest of the list is left for it to delete
+        CollectUploads();
+        while (!m_uploads.empty() && !m_uploadStopping)
+        {
+            UploadNode* node = m_uploads.front();
+            m_uploads.pop_front();
+
+            // The wake-up node of the destructor has nothing to run
+            if (!node->upload)
+            {
+                delete node;
+                continue;
+            }
+
+            node->upload();
+            if (node->finish)
+            {
+                // Flush, so the fence reaches the GPU and the GL thread doesn't wait for it forever
+                GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                glFlush();
+
+                std::lock_guard<std::mutex> lock(m_completedMutex);
+                m_completedUploads.push_back(FencedUpload{ fence, std::move(node->finish) });
+            }
+            else
+            {
+                --m_pendingCount;
+            }
+            delete node;
+        }
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+void AssetLoadQueue::CollectUploads()
+{
+    UploadNode* node = m_pushedUploads.exchange(nullptr, std::memory_order_acquire);
+
+    // The list is in reverse order, insert each node before the ones collected in this call
+    std::size_t insertIndex = m_uploads.size();
+    while (node)
+    {
+        UploadNode* next = node->next;
+        m_uploads.insert(m_uploads.begin() + insertIndex, node);
+        node = next;
+    }
+}
+
+void AssetLoadQueue::FinishFencedUploads(std::chrono::steady_clock::time_point startTime, double budgetSeconds)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_completedMutex);
+        for (FencedUpload& completedUpload : m_completedUploads)
+        {
+            m_fencedUploads.push_back(std::move(completedUpload));
+        }
+        m_completedUploads.clear();
+    }
+
+    // Fences from the same context signal in order, so stop at the first one that is not signaled
+    while (!m_fencedUploads.empty())
+    {
+        FencedUpload& fencedUpload = m_fencedUploads.front();
+        GLenum result = glClientWaitSync(fencedUpload.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            break;
+        }
+
+        glDeleteSync(fencedUpload.fence);
+        fencedUpload.finish();
+        m_fencedUploads.pop_front();
+        --m_pendingCount;
+
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - startTime;
+        if (duration.count() >= budgetSeconds)
+        {
+            break;
+        }
+    }
+}
+
+void AssetLoadQueue::WaitForUploads()
+{
+    // Workers are still decoding. Sleeping is simpler than signaling from the lock-free queue, and the wait is short
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
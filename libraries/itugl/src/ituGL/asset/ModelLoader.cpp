@@ -1,16 +1,31 @@
 #include <ituGL/asset/ModelLoader.h>
 
 #include <ituGL/geometry/VertexFormat.h>
-#include <ituGL/shader/Material.h>
+#include <ituGL/shader/MaterialInstance.h>
 #include <ituGL/asset/Texture2DLoader.h>
+#include <ituGL/texture/TextureStreamer.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/packing.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
+#include <cstring>
+#include <cmath>
 
 ModelLoader::ModelLoader(std::shared_ptr<Material> referenceMaterial)
     : m_referenceMaterial(referenceMaterial)
     , m_createMaterials(false)
+    , m_useMeshCache(true)
+    , m_vertexQuantization(VertexQuantization::None)
+    , m_lodCount(0)
 {
     m_textureLoader.SetGenerateMipmap(true);
 }
@@ -22,8 +37,9 @@ std::shared_ptr<Material> ModelLoader::GetReferenceMaterial() const
 
 void ModelLoader::SetReferenceMaterial(std::shared_ptr<Material> referenceMaterial)
 {
-    // Clear the previous attribute map
+    // Clear the previous attribute and property maps, their locations belong to the shader of the previous material
     m_materialAttributeMap.clear();
+    m_materialPropertyMap.clear();
 
     m_referenceMaterial = referenceMaterial;
 }
@@ -74,31 +90,532 @@ bool ModelLoader::SetMaterialProperty(MaterialProperty materialProperty, const c
 
 Model ModelLoader::Load(const char* path)
 {
-    Model model;
+    LoadSettings settings = GetLoadSettings();
+    ModelData modelData = ImportModel(path, settings, false);
+    UploadModel(modelData, settings, &m_textureLoader);
+    return FinishModel(modelData, settings);
+}
+
+void ModelLoader::SubmitLoad(const std::string& path, AssetLoadQueue& loadQueue, Promise promise)
+{
+    std::shared_ptr<const LoadSettings> settings = std::make_shared<LoadSettings>(GetLoadSettings());
+
+    loadQueue.SubmitWork([path, settings, promise, &loadQueue]()
+        {
+            std::shared_ptr<ModelData> modelData = std::make_shared<ModelData>(ImportModel(path.c_str(), *settings, true));
+            loadQueue.SubmitUpload([settings, modelData]()
+                {
+                    UploadModel(*modelData, *settings, nullptr);
+                },
+                [settings, promise, modelData]()
+                {
+                    promise->set_value(std::make_shared<Model>(FinishModel(*modelData, *settings)));
+                });
+        });
+}
+
+ModelLoader::LoadSettings ModelLoader::GetLoadSettings() const
+{
+    LoadSettings settings;
+    settings.referenceMaterial = m_referenceMaterial;
+    settings.materialAttributeMap = m_materialAttributeMap;
+    settings.materialPropertyMap = m_materialPropertyMap;
+    settings.createMaterials = m_createMaterials;
+    settings.flipTextures = m_textureLoader.GetFlipVertical();
+    settings.generateMipmap = m_textureLoader.GetGenerateMipmap();
+    settings.useMeshCache = m_useMeshCache;
+    settings.vertexQuantization = m_vertexQuantization;
+    settings.lodCount = m_lodCount;
+    settings.textureStreamer = m_textureLoader.GetStreamer();
+    return settings;
+}
+
+ModelLoader::ModelData ModelLoader::ImportModel(const char* path, const LoadSettings& settings, bool decodeTextures)
+{
+    ModelData modelData;
+
+    std::string baseFolder = path;
+    baseFolder.resize(baseFolder.rfind('/') + 1);
+
+    // Try the mesh cache first, and write it after importing if it was missing or outdated
+    std::vector<MaterialData> materialDatas;
+    modelData.loaded = settings.useMeshCache && ReadMeshCache(path, settings, modelData, materialDatas);
+    if (!modelData.loaded)
+    {
+        modelData.loaded = ImportScene(path, settings, modelData, materialDatas);
+        if (modelData.loaded && settings.useMeshCache)
+        {
+            WriteMeshCache(path, settings, modelData, materialDatas);
+        }
+    }
+
+    if (modelData.loaded)
+    {
+        if (settings.createMaterials)
+        {
+            for (const MaterialData& materialData : materialDatas)
+            {
+                modelData.materials.push_back(CollectMaterialValues(materialData, settings, baseFolder));
+            }
+        }
+
+        // Decode each texture once, even if several materials use it
+        if (decodeTextures)
+        {
+            for (const std::vector<MaterialValue>& materialValues : modelData.materials)
+            {
+                for (const MaterialValue& materialValue : materialValues)
+                {
+                    if (materialValue.texturePath.empty() || modelData.textures.contains(materialValue.texturePath)
+                        || modelData.mipChains.contains(materialValue.texturePath))
+                    {
+                        continue;
+                    }
+
+                    TextureData textureData = TextureLoaderUtils::LoadTextureData(materialValue.texturePath.c_str(),
+                        materialValue.textureFormat, materialValue.textureInternalFormat, settings.flipTextures);
+                    if (settings.textureStreamer && !textureData.data.empty())
+                    {
+                        // Build the levels here, only the small ones are uploaded with the model
+                        modelData.mipChains[materialValue.texturePath] = TextureMipChain(textureData.data, textureData.width, textureData.height,
+                            materialValue.textureFormat, textureData.dataType);
+                        TextureLoaderUtils::FreeTextureData(textureData);
+                    }
+                    else
+                    {
+                        modelData.textures[materialValue.texturePath] = textureData;
+                    }
+                }
+            }
+        }
+    }
+
+    return modelData;
+}
 
+bool ModelLoader::ImportScene(const char* path, const LoadSettings& settings, ModelData& modelData, std::vector<MaterialData>& materialDatas)
+{
     // Read the file using Assimp importer
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(path,
         aiProcess_CalcTangentSpace | aiProcess_GenNormals | aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
 
-    m_baseFolder = path;
-    m_baseFolder.resize(m_baseFolder.rfind('/') + 1);
+    // If the file was loaded, collect all the meshes as submeshes
+    if (!scene)
+    {
+        std::cout << "ERROR::MODELLOADER::IMPORT_FAILED\n" << path << std::endl;
+        return false;
+    }
+
+    // Reserved, so the spans keep pointing to the storage of each submesh
+    modelData.submeshes.reserve(scene->mNumMeshes);
+    MeshOptimizer::Statistics before, after;
+    unsigned int triangleCount = 0;
+    std::vector<unsigned int> lodTriangleCounts;
+    for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; ++meshIndex)
+    {
+        SubmeshData& submeshData = modelData.submeshes.emplace_back(CollectSubmeshData(*scene->mMeshes[meshIndex], settings.vertexQuantization));
+
+        // Assimp splits the meshes by primitive type, only the triangle lists are optimized
+        if (submeshData.primitives.size() == 1 && submeshData.primitives[0] == Drawcall::Primitive::Triangles)
+        {
+            OptimizeSubmeshData(submeshData, before, after);
+            triangleCount += scene->mMeshes[meshIndex]->mNumFaces;
+            GenerateSubmeshLods(submeshData, settings.lodCount, lodTriangleCounts);
+        }
+    }
+
+    if (triangleCount > 0)
+    {
+        std::cout << "ModelLoader: " << path << ", " << triangleCount << " triangles optimized. "
+            << "ACMR " << before.acmr / triangleCount << " -> " << after.acmr / triangleCount << ", "
+            << "ATVR " << before.atvr / triangleCount << " -> " << after.atvr / triangleCount << std::endl;
+    }
+
+    if (!lodTriangleCounts.empty())
+    {
+        std::cout << "ModelLoader: " << path << ", " << lodTriangleCounts.size() << " levels of detail. Triangles " << triangleCount;
+        for (unsigned int lodTriangleCount : lodTriangleCounts)
+        {
+            std::cout << " -> " << lodTriangleCount;
+        }
+        std::cout << std::endl;
+    }
+
+    // Materials are always collected, so the mesh cache doesn't depend on the settings
+    for (unsigned int materialIndex = 0; materialIndex < scene->mNumMaterials; ++materialIndex)
+    {
+        materialDatas.push_back(CollectMaterialData(*scene->mMaterials[materialIndex]));
+    }
+
+    return true;
+}
+
+// Each level of detail keeps this fraction of the triangles of the previous one, and the first one is used below this
+// screen size. Collapses that move the surface more than the max error, relative to the size of the submesh, are skipped
+static constexpr float s_lodTriangleRatio = 0.5f;
+static constexpr float s_lodScreenSize = 0.5f;
+static constexpr float s_lodMaxError = 0.05f;
+
+// Mesh cache layout: a MeshCacheHeader, then each submesh and each material, one after the other.
+// Vertex and element blobs are aligned, so they can be uploaded straight from the mapped file
+static constexpr uint32_t s_meshCacheVersion = 4;
+static constexpr size_t s_meshCacheAlignment = 16;
+
+struct MeshCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    // Size and modification time of the source file, the cache is outdated if they change
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    // Quantization of the vertex data, the cache is ignored if a different one is requested
+    uint32_t vertexQuantization;
+    // Levels of detail requested, the cache is ignored if a different number is requested
+    uint32_t lodCount;
+    uint32_t submeshCount;
+    uint32_t materialCount;
+};
+
+// Appends values to the contents of the mesh cache
+struct MeshCacheWriter
+{
+    std::vector<char> data;
+
+    void WriteBytes(const void* bytes, size_t size)
+    {
+        const char* chars = static_cast<const char*>(bytes);
+        data.insert(data.end(), chars, chars + size);
+    }
+
+    template<typename T>
+    void Write(const T& value)
+    {
+        WriteBytes(&value, sizeof(T));
+    }
+
+    void WriteString(const std::string& string)
+    {
+        Write(static_cast<uint32_t>(string.size()));
+        WriteBytes(string.data(), string.size());
+    }
+
+    void Align()
+    {
+        data.resize((data.size() + s_meshCacheAlignment - 1) / s_meshCacheAlignment * s_meshCacheAlignment);
+    }
+};
+
+// Reads values from the mapped mesh cache. Reading past the end invalidates the reader, instead of failing on each call
+struct MeshCacheReader
+{
+    std::span<const std::byte> data;
+    size_t offset = 0;
+    bool valid = true;
+
+    std::span<const std::byte> ReadBytes(size_t size)
+    {
+        if (!valid || size > data.size() - offset)
+        {
+            valid = false;
+            return {};
+        }
+        std::span<const std::byte> bytes = data.subspan(offset, size);
+        offset += size;
+        return bytes;
+    }
+
+    template<typename T>
+    T Read()
+    {
+        T value{};
+        std::span<const std::byte> bytes = ReadBytes(sizeof(T));
+        if (valid)
+        {
+            std::memcpy(&value, bytes.data(), sizeof(T));
+        }
+        return value;
+    }
+
+    std::string ReadString()
+    {
+        std::span<const std::byte> bytes = ReadBytes(Read<uint32_t>());
+        return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+    void Align()
+    {
+        offset = std::min((offset + s_meshCacheAlignment - 1) / s_meshCacheAlignment * s_meshCacheAlignment, data.size());
+    }
+};
+
+bool ModelLoader::GetSourceStamp(const char* path, uint64_t& sourceSize, int64_t& sourceTime)
+{
+    std::error_code error;
+    sourceSize = std::filesystem::file_size(path, error);
+    if (!error)
+    {
+        sourceTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    }
+    return !error;
+}
+
+bool ModelLoader::ReadMeshCache(const char* path, const LoadSettings& settings, ModelData& modelData, std::vector<MaterialData>& materialDatas)
+{
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    MappedFile file;
+    if (!GetSourceStamp(path, sourceSize, sourceTime) || !file.Open((std::string(path) + ".mesh").c_str()))
+    {
+        return false;
+    }
+
+    MeshCacheReader reader{ file.GetData() };
+    MeshCacheHeader header = reader.Read<MeshCacheHeader>();
+    if (!reader.valid || std::memcmp(header.magic, "IMSH", 4) != 0 || header.version != s_meshCacheVersion
+        || header.sourceSize != sourceSize || header.sourceTime != sourceTime
+        || header.vertexQuantization != static_cast<uint32_t>(settings.vertexQuantization)
+        || header.lodCount != settings.lodCount)
+    {
+        return false;
+    }
+
+    std::vector<SubmeshData> submeshes(header.submeshCount);
+    for (SubmeshData& submeshData : submeshes)
+    {
+        uint32_t attributeCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < attributeCount && reader.valid; ++i)
+        {
+            Data::Type type = static_cast<Data::Type>(reader.Read<uint32_t>());
+            int components = reader.Read<uint32_t>();
+            bool normalized = reader.Read<uint32_t>() != 0;
+            VertexAttribute::Semantic semantic = static_cast<VertexAttribute::Semantic>(reader.Read<uint32_t>());
+            submeshData.vertexFormat.AddVertexAttribute(type, components, normalized, semantic);
+        }
+
+        submeshData.elementType = static_cast<Data::Type>(reader.Read<uint32_t>());
+        submeshData.materialIndex = reader.Read<uint32_t>();
+        uint32_t rangeCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < rangeCount && reader.valid; ++i)
+        {
+            submeshData.primitives.push_back(static_cast<Drawcall::Primitive>(reader.Read<uint32_t>()));
+            submeshData.elementCounts.push_back(reader.Read<int32_t>());
+        }
+        uint32_t lodCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < lodCount && reader.valid; ++i)
+        {
+            submeshData.lodElementCounts.push_back(reader.Read<int32_t>());
+        }
+        submeshData.boundsMin = reader.Read<glm::vec3>();
+        submeshData.boundsMax = reader.Read<glm::vec3>();
+
+        uint64_t vertexSize = reader.Read<uint64_t>();
+        uint64_t elementSize = reader.Read<uint64_t>();
+        reader.Align();
+        std::span<const std::byte> vertexData = reader.ReadBytes(vertexSize);
+        reader.Align();
+        std::span<const std::byte> elementData = reader.ReadBytes(elementSize);
+        submeshData.vertexData = std::span<const GLubyte>(reinterpret_cast<const GLubyte*>(vertexData.data()), vertexData.size());
+        submeshData.elementData = std::span<const GLubyte>(reinterpret_cast<const GLubyte*>(elementData.data()), elementData.size());
+    }
+
+    std::vector<MaterialData> materials(header.materialCount);
+    for (MaterialData& materialData : materials)
+    {
+        uint32_t valueCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < valueCount && reader.valid; ++i)
+        {
+            MaterialProperty property = static_cast<MaterialProperty>(reader.Read<uint32_t>());
+            materialData.values[property] = reader.Read<glm::vec3>();
+        }
+        uint32_t textureCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < textureCount && reader.valid; ++i)
+        {
+            MaterialProperty property = static_cast<MaterialProperty>(reader.Read<uint32_t>());
+            materialData.texturePaths[property] = reader.ReadString();
+        }
+    }
+
+    if (!reader.valid)
+    {
+        std::cout << "ERROR::MODELLOADER::MESH_CACHE_CORRUPTED\n" << path << std::endl;
+        return false;
+    }
+
+    // The spans point to the mapping, that stays valid when the file object is moved
+    modelData.meshCache = std::move(file);
+    modelData.submeshes = std::move(submeshes);
+    materialDatas = std::move(materials);
+    return true;
+}
+
+void ModelLoader::WriteMeshCache(const char* path, const LoadSettings& settings, const ModelData& modelData, const std::vector<MaterialData>& materialDatas)
+{
+    MeshCacheHeader header;
+    std::memcpy(header.magic, "IMSH", 4);
+    header.version = s_meshCacheVersion;
+    if (!GetSourceStamp(path, header.sourceSize, header.sourceTime))
+    {
+        return;
+    }
+    header.vertexQuantization = static_cast<uint32_t>(settings.vertexQuantization);
+    header.lodCount = settings.lodCount;
+    header.submeshCount = static_cast<uint32_t>(modelData.submeshes.size());
+    header.materialCount = static_cast<uint32_t>(materialDatas.size());
+
+    MeshCacheWriter writer;
+    writer.Write(header);
+    for (const SubmeshData& submeshData : modelData.submeshes)
+    {
+        const VertexFormat& vertexFormat = submeshData.vertexFormat;
+        writer.Write(static_cast<uint32_t>(vertexFormat.GetAttributeCount()));
+        for (int i = 0; i < vertexFormat.GetAttributeCount(); ++i)
+        {
+            VertexAttribute attribute = vertexFormat.GetAttribute(i);
+            writer.Write(static_cast<uint32_t>(attribute.GetType()));
+            writer.Write(static_cast<uint32_t>(attribute.GetComponents()));
+            writer.Write(static_cast<uint32_t>(attribute.IsNormalized()));
+            writer.Write(static_cast<uint32_t>(attribute.GetSemantic()));
+        }
+
+        writer.Write(static_cast<uint32_t>(submeshData.elementType));
+        writer.Write(static_cast<uint32_t>(submeshData.materialIndex));
+        writer.Write(static_cast<uint32_t>(submeshData.primitives.size()));
+        for (size_t i = 0; i < submeshData.primitives.size(); ++i)
+        {
+            writer.Write(static_cast<uint32_t>(submeshData.primitives[i]));
+            writer.Write(static_cast<int32_t>(submeshData.elementCounts[i]));
+        }
+        writer.Write(static_cast<uint32_t>(submeshData.lodElementCounts.size()));
+        for (int lodElementCount : submeshData.lodElementCounts)
+        {
+            writer.Write(static_cast<int32_t>(lodElementCount));
+        }
+        writer.Write(submeshData.boundsMin);
+        writer.Write(submeshData.boundsMax);
+
+        writer.Write(static_cast<uint64_t>(submeshData.vertexData.size()));
+        writer.Write(static_cast<uint64_t>(submeshData.elementData.size()));
+        writer.Align();
+        writer.WriteBytes(submeshData.vertexData.data(), submeshData.vertexData.size());
+        writer.Align();
+        writer.WriteBytes(submeshData.elementData.data(), submeshData.elementData.size());
+    }
+
+    for (const MaterialData& materialData : materialDatas)
+    {
+        writer.Write(static_cast<uint32_t>(materialData.values.size()));
+        for (auto& valuePair : materialData.values)
+        {
+            writer.Write(static_cast<uint32_t>(valuePair.first));
+            writer.Write(valuePair.second);
+        }
+        writer.Write(static_cast<uint32_t>(materialData.texturePaths.size()));
+        for (auto& texturePair : materialData.texturePaths)
+        {
+            writer.Write(static_cast<uint32_t>(texturePair.first));
+            writer.WriteString(texturePair.second);
+        }
+    }
+
+    // Write to a temporary file first, so a load running at the same time never maps a partial file.
+    // Each thread writes its own, in case several import the same model at once
+    std::string cachePath = std::string(path) + ".mesh";
+    std::stringstream tempPathStream;
+    tempPathStream << cachePath << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    std::string tempPath = tempPathStream.str();
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(writer.data.data(), writer.data.size());
+        if (!file)
+        {
+            std::cout << "ERROR::MODELLOADER::MESH_CACHE_WRITE_FAILED\n" << cachePath << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::cout << "ERROR::MODELLOADER::MESH_CACHE_WRITE_FAILED\n" << cachePath << std::endl;
+        std::filesystem::remove(tempPath, error);
+    }
+}
+
+void ModelLoader::UploadModel(ModelData& modelData, const LoadSettings& settings, Texture2DLoader* textureLoader)
+{
+    if (modelData.loaded)
+    {
+        modelData.mesh = std::make_shared<Mesh>();
+        for (SubmeshData& submeshData : modelData.submeshes)
+        {
+            UploadSubmeshData(*modelData.mesh, submeshData);
+        }
 
-    // If the file was loaded, load all the meshes as submeshes
-    if (scene)
+        UploadTextures(modelData, settings, textureLoader);
+    }
+
+    // Free decoded data (not needed anymore)
+    for (auto& texturePair : modelData.textures)
+    {
+        TextureLoaderUtils::FreeTextureData(texturePair.second);
+    }
+    modelData.textures.clear();
+}
+
+Model ModelLoader::FinishModel(ModelData& modelData, const LoadSettings& settings)
+{
+    Model model;
+
+    if (modelData.loaded)
     {
-        model.SetMesh(std::make_shared<Mesh>());
+        model.SetMesh(modelData.mesh);
         Mesh& mesh = model.GetMesh();
-        for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; ++meshIndex)
+
+        CreateStreamedTextures(modelData, settings);
+
+        // Model bounds contain the bounds of all the submeshes
+        if (!modelData.submeshes.empty())
+        {
+            glm::vec3 boundsMin = modelData.submeshes[0].boundsMin;
+            glm::vec3 boundsMax = modelData.submeshes[0].boundsMax;
+            for (const SubmeshData& submeshData : modelData.submeshes)
+            {
+                boundsMin = glm::min(boundsMin, submeshData.boundsMin);
+                boundsMax = glm::max(boundsMax, submeshData.boundsMax);
+            }
+            model.SetBounds(boundsMin, boundsMax);
+        }
+
+        // Each level has about half the triangles, so it switches when the model covers about half the area
+        size_t lodCount = 0;
+        for (const SubmeshData& submeshData : modelData.submeshes)
+        {
+            lodCount = std::max(lodCount, submeshData.lodElementCounts.size());
+        }
+        std::vector<float> lodScreenSizes(lodCount);
+        for (size_t lod = 0; lod < lodCount; ++lod)
+        {
+            lodScreenSizes[lod] = s_lodScreenSize * std::pow(std::sqrt(s_lodTriangleRatio), static_cast<float>(lod));
+        }
+        model.SetLodScreenSizes(lodScreenSizes);
+
+        // Create materials, sharing the textures between them
+        std::vector<std::shared_ptr<Material>> materials;
+        for (const std::vector<MaterialValue>& materialValues : modelData.materials)
+        {
+            materials.push_back(GenerateMaterial(materialValues, settings, modelData));
+        }
+
+        for (SubmeshData& submeshData : modelData.submeshes)
         {
-            aiMesh& meshData = *scene->mMeshes[meshIndex];
-            GenerateSubmesh(mesh, meshData);
+            GenerateSubmesh(mesh, submeshData, settings.materialAttributeMap);
 
-            std::shared_ptr<Material> material = m_referenceMaterial;
-            if (m_createMaterials)
+            std::shared_ptr<Material> material = settings.referenceMaterial;
+            if (settings.createMaterials)
             {
-                // Create a new material with the material data
-                material = GenerateMaterial(*scene->mMaterials[meshData.mMaterialIndex]);
+                // Use the new material created with the material data
+                material = materials[submeshData.materialIndex];
             }
             model.AddMaterial(material);
         }
@@ -107,105 +624,361 @@ Model ModelLoader::Load(const char* path)
     return model;
 }
 
-void ModelLoader::GenerateSubmesh(Mesh& mesh, const aiMesh& meshData)
+ModelLoader::SubmeshData ModelLoader::CollectSubmeshData(const aiMesh& meshData, VertexQuantization vertexQuantization)
 {
+    SubmeshData submeshData;
+
     // Collect vertex data
-    VertexFormat vertexFormat;
     bool interleaved = true;
-    std::vector<GLubyte> vertexData = CollectVertexData(meshData, vertexFormat, interleaved);
-    int vboIndex = mesh.AddVertexData<GLubyte>(vertexData);
+    submeshData.vertexStorage = CollectVertexData(meshData, submeshData.vertexFormat, interleaved, vertexQuantization);
+    submeshData.vertexData = submeshData.vertexStorage;
 
     // Collect element data
-    Data::Type elementType;
-    std::vector<Drawcall::Primitive> primitives;
-    std::vector<int> elementCounts;
-    std::vector<GLubyte> elementData = CollectElementData(meshData, elementType, primitives, elementCounts);
-    int eboIndex = mesh.AddElementData<GLubyte>(elementData);
+    submeshData.elementStorage = CollectElementData(meshData, submeshData.elementType, submeshData.primitives, submeshData.elementCounts);
+    submeshData.elementData = submeshData.elementStorage;
+
+    submeshData.materialIndex = meshData.mMaterialIndex;
+
+    submeshData.boundsMin = glm::vec3(0.0f);
+    submeshData.boundsMax = glm::vec3(0.0f);
+    for (unsigned int i = 0; i < meshData.mNumVertices; ++i)
+    {
+        glm::vec3 position(meshData.mVertices[i].x, meshData.mVertices[i].y, meshData.mVertices[i].z);
+        submeshData.boundsMin = i > 0 ? glm::min(submeshData.boundsMin, position) : position;
+        submeshData.boundsMax = i > 0 ? glm::max(submeshData.boundsMax, position) : position;
+    }
+
+    return submeshData;
+}
+
+void ModelLoader::OptimizeSubmeshData(SubmeshData& submeshData, MeshOptimizer::Statistics& before, MeshOptimizer::Statistics& after)
+{
+    size_t vertexSize = submeshData.vertexFormat.GetSize();
+    size_t vertexCount = submeshData.vertexStorage.size() / vertexSize;
+
+    std::vector<uint32_t> indices = UnpackElementData(submeshData.elementStorage, submeshData.elementType);
+    size_t triangleCount = indices.size() / 3;
+    MeshOptimizer::Statistics statistics = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+    before.acmr += statistics.acmr * triangleCount;
+    before.atvr += statistics.atvr * triangleCount;
+
+    // Position is always the first attribute, at the beginning of each vertex
+    std::span<std::byte> vertexData = std::as_writable_bytes(std::span<GLubyte>(submeshData.vertexStorage));
+    MeshOptimizer::OptimizeVertexCache(indices, vertexCount);
+    MeshOptimizer::OptimizeOverdraw(indices, vertexData, vertexSize, 0);
+    vertexCount = MeshOptimizer::OptimizeVertexFetch(indices, vertexData, vertexSize);
+    submeshData.vertexStorage.resize(vertexCount * vertexSize);
+
+    statistics = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+    after.acmr += statistics.acmr * triangleCount;
+    after.atvr += statistics.atvr * triangleCount;
+
+    // Pack the indices again, unused vertices were removed so they might fit in a smaller type
+    submeshData.elementType = ElementBufferObject::GetSmallestType(static_cast<unsigned int>(vertexCount));
+    submeshData.elementStorage.clear();
+    PackElementData(indices, submeshData.elementType, submeshData.elementStorage);
+    submeshData.elementCounts = { static_cast<int>(submeshData.elementStorage.size()) };
+
+    submeshData.vertexData = submeshData.vertexStorage;
+    submeshData.elementData = submeshData.elementStorage;
+}
+
+void ModelLoader::GenerateSubmeshLods(SubmeshData& submeshData, unsigned int lodCount, std::vector<unsigned int>& lodTriangleCounts)
+{
+    size_t vertexSize = submeshData.vertexFormat.GetSize();
+    size_t vertexCount = submeshData.vertexStorage.size() / vertexSize;
+    std::span<const std::byte> vertexData = std::as_bytes(std::span<const GLubyte>(submeshData.vertexStorage));
+
+    // Each level is simplified from the previous one, stopping when the border and seam vertices don't let it shrink more
+    std::vector<uint32_t> indices = UnpackElementData(submeshData.elementStorage, submeshData.elementType);
+    for (unsigned int lod = 0; lod < lodCount; ++lod)
+    {
+        size_t targetIndexCount = static_cast<size_t>(indices.size() / 3 * s_lodTriangleRatio) * 3;
+        float error;
+        std::vector<uint32_t> lodIndices = MeshSimplifier::Simplify(indices, vertexData, vertexSize, 0, targetIndexCount, s_lodMaxError, error);
+        if (lodIndices.empty() || lodIndices.size() > indices.size() * 9 / 10)
+        {
+            break;
+        }
+
+        // Vertices stay where they are, as the full level uses them in order
+        MeshOptimizer::OptimizeVertexCache(lodIndices, vertexCount);
+        PackElementData(lodIndices, submeshData.elementType, submeshData.elementStorage);
+        submeshData.lodElementCounts.push_back(static_cast<int>(submeshData.elementStorage.size()));
+
+        if (lodTriangleCounts.size() <= lod)
+        {
+            lodTriangleCounts.push_back(0);
+        }
+        lodTriangleCounts[lod] += static_cast<unsigned int>(lodIndices.size() / 3);
+        indices = std::move(lodIndices);
+    }
+
+    submeshData.elementData = submeshData.elementStorage;
+}
+
+std::vector<uint32_t> ModelLoader::UnpackElementData(std::span<const GLubyte> elementData, Data::Type elementType)
+{
+    int elementSize = Data::GetTypeSize(elementType);
+    size_t elementCount = elementData.size() / elementSize;
+    std::vector<uint32_t> indices(elementCount);
+    for (size_t i = 0; i < elementCount; ++i)
+    {
+        const GLubyte* element = &elementData[i * elementSize];
+        switch (elementType)
+        {
+        case Data::Type::UByte:
+            indices[i] = *element;
+            break;
+        case Data::Type::UShort:
+            indices[i] = *reinterpret_cast<const GLushort*>(element);
+            break;
+        default:
+            indices[i] = *reinterpret_cast<const GLuint*>(element);
+            break;
+        }
+    }
+    return indices;
+}
+
+void ModelLoader::PackElementData(std::span<const uint32_t> indices, Data::Type elementType, std::vector<GLubyte>& elementData)
+{
+    int elementSize = Data::GetTypeSize(elementType);
+    size_t offset = elementData.size();
+    elementData.resize(offset + indices.size() * elementSize);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        GLubyte* element = &elementData[offset + i * elementSize];
+        switch (elementType)
+        {
+        case Data::Type::UByte:
+            *element = static_cast<GLubyte>(indices[i]);
+            break;
+        case Data::Type::UShort:
+            *reinterpret_cast<GLushort*>(element) = static_cast<GLushort>(indices[i]);
+            break;
+        default:
+            *reinterpret_cast<GLuint*>(element) = indices[i];
+            break;
+        }
+    }
+}
+
+void ModelLoader::UploadSubmeshData(Mesh& mesh, SubmeshData& submeshData)
+{
+    submeshData.vboIndex = mesh.AddVertexData<GLubyte>(submeshData.vertexData);
+    submeshData.eboIndex = mesh.AddElementData<GLubyte>(submeshData.elementData);
+}
+
+void ModelLoader::GenerateSubmesh(Mesh& mesh, SubmeshData& submeshData, const Mesh::SemanticMap& materialAttributeMap)
+{
+    bool interleaved = true;
+    VertexFormat& vertexFormat = submeshData.vertexFormat;
+    unsigned int vboIndex = submeshData.vboIndex;
+    unsigned int eboIndex = submeshData.eboIndex;
+    int elementSize = Data::GetTypeSize(submeshData.elementType);
 
-    // Add submeshes
+    // Add submeshes. The element ranges are in bytes: the drawcall takes the first one as an offset, and the count in elements
     int start = 0;
+    unsigned int submeshIndex = 0;
+    const std::vector<Drawcall::Primitive>& primitives = submeshData.primitives;
+    const std::vector<int>& elementCounts = submeshData.elementCounts;
     assert(primitives.size() == elementCounts.size());
     for (int i = 0; i < primitives.size(); ++i)
     {
         Drawcall::Primitive primitive = primitives[i];
         int end = elementCounts[i];
-        mesh.AddSubmesh(primitive, start, end - start, elementType, eboIndex, vboIndex, vertexFormat.LayoutBegin(static_cast<int>(vertexData.size()), interleaved), vertexFormat.LayoutEnd(), m_materialAttributeMap);
+        submeshIndex = mesh.AddSubmesh(primitive, start, (end - start) / elementSize, submeshData.elementType, vboIndex, eboIndex, vertexFormat.LayoutBegin(static_cast<int>(submeshData.vertexData.size()), interleaved), vertexFormat.LayoutEnd(), materialAttributeMap);
+        start = end;
+    }
+
+    // Levels of detail use the same vertex array, with the elements after the full level
+    for (int end : submeshData.lodElementCounts)
+    {
+        mesh.AddSubmeshLod(submeshIndex, Drawcall(Drawcall::Primitive::Triangles, (end - start) / elementSize, submeshData.elementType, start));
         start = end;
     }
 }
 
-std::shared_ptr<Material> ModelLoader::GenerateMaterial(const aiMaterial& materialData)
+ModelLoader::MaterialData ModelLoader::CollectMaterialData(const aiMaterial& materialData)
 {
-    std::shared_ptr<Material> material = std::make_shared<Material>(*m_referenceMaterial);
+    MaterialData data;
+    aiColor3D color;
     float value;
-    for (auto& materialPropertyPair : m_materialPropertyMap)
+    if (materialData.Get(AI_MATKEY_COLOR_AMBIENT, color) == aiReturn_SUCCESS)
+    {
+        data.values[MaterialProperty::AmbientColor] = glm::vec3(color.r, color.g, color.b);
+    }
+    if (materialData.Get(AI_MATKEY_COLOR_DIFFUSE, color) == aiReturn_SUCCESS)
+    {
+        data.values[MaterialProperty::DiffuseColor] = glm::vec3(color.r, color.g, color.b);
+    }
+    if (materialData.Get(AI_MATKEY_COLOR_SPECULAR, color) == aiReturn_SUCCESS)
+    {
+        data.values[MaterialProperty::SpecularColor] = glm::vec3(color.r, color.g, color.b);
+    }
+    if (materialData.Get(AI_MATKEY_SHININESS, value) == aiReturn_SUCCESS)
+    {
+        data.values[MaterialProperty::SpecularExponent] = glm::vec3(value);
+    }
+    CollectTexturePath(materialData, aiTextureType_DIFFUSE, MaterialProperty::DiffuseTexture, data);
+    CollectTexturePath(materialData, aiTextureType_NORMALS, MaterialProperty::NormalTexture, data);
+    CollectTexturePath(materialData, aiTextureType_SHININESS, MaterialProperty::SpecularTexture, data);
+    return data;
+}
+
+void ModelLoader::CollectTexturePath(const aiMaterial& materialData, int textureTypeValue, MaterialProperty materialProperty, MaterialData& data)
+{
+    aiTextureType textureType = static_cast<aiTextureType>(textureTypeValue);
+    if (materialData.GetTextureCount(textureType) > 0)
     {
-        aiColor3D color;
-        MaterialProperty materialProperty = materialPropertyPair.first;
-        ShaderProgram::Location location = materialPropertyPair.second;
-        switch (materialProperty)
+        assert(materialData.GetTextureCount(textureType) == 1);
+        aiString texturePath;
+        if (materialData.GetTexture(textureType, 0, &texturePath) == aiReturn_SUCCESS)
+        {
+            data.texturePaths[materialProperty] = texturePath.C_Str();
+        }
+    }
+}
+
+std::vector<ModelLoader::MaterialValue> ModelLoader::CollectMaterialValues(const MaterialData& materialData, const LoadSettings& settings, const std::string& baseFolder)
+{
+    std::vector<MaterialValue> materialValues;
+    for (auto& materialPropertyPair : settings.materialPropertyMap)
+    {
+        MaterialValue materialValue;
+        materialValue.property = materialPropertyPair.first;
+        materialValue.location = materialPropertyPair.second;
+        switch (materialValue.property)
         {
         case MaterialProperty::AmbientColor:
-            if (materialData.Get(AI_MATKEY_COLOR_AMBIENT, color) == aiReturn_SUCCESS)
-            {
-                material->SetUniformValue(location, glm::vec3(color.r, color.g, color.b));
-            }
-            break;
         case MaterialProperty::DiffuseColor:
-            if (materialData.Get(AI_MATKEY_COLOR_DIFFUSE, color) == aiReturn_SUCCESS)
-            {
-                material->SetUniformValue(location, glm::vec3(color.r, color.g, color.b));
-            }
-            break;
         case MaterialProperty::SpecularColor:
-            if (materialData.Get(AI_MATKEY_COLOR_SPECULAR, color) == aiReturn_SUCCESS)
-            {
-                material->SetUniformValue(location, glm::vec3(color.r, color.g, color.b));
-            }
-            break;
         case MaterialProperty::SpecularExponent:
-            if (materialData.Get(AI_MATKEY_SHININESS, value) == aiReturn_SUCCESS)
             {
-                material->SetUniformValue(location, value);
+                auto itValue = materialData.values.find(materialValue.property);
+                if (itValue != materialData.values.end())
+                {
+                    materialValue.value = itValue->second;
+                    materialValues.push_back(materialValue);
+                }
             }
             break;
         case MaterialProperty::DiffuseTexture:
-            LoadTexture(materialData, aiTextureType_DIFFUSE, *material, location, TextureObject::FormatRGB, TextureObject::InternalFormatSRGB8);
+            CollectTextureValue(materialData, materialValue, materialValues, baseFolder, TextureObject::FormatRGB, TextureObject::InternalFormatSRGB8);
             break;
         case MaterialProperty::NormalTexture:
-            LoadTexture(materialData, aiTextureType_NORMALS, *material, location, TextureObject::FormatRGB, TextureObject::InternalFormatRGB8);
+            CollectTextureValue(materialData, materialValue, materialValues, baseFolder, TextureObject::FormatRGB, TextureObject::InternalFormatRGB8);
             break;
         case MaterialProperty::SpecularTexture:
-            LoadTexture(materialData, aiTextureType_SHININESS, *material, location, TextureObject::FormatRGB, TextureObject::InternalFormatSRGB8);
+            CollectTextureValue(materialData, materialValue, materialValues, baseFolder, TextureObject::FormatRGB, TextureObject::InternalFormatSRGB8);
             break;
         }
     }
-    return material;
+    return materialValues;
 }
 
-void ModelLoader::LoadTexture(const aiMaterial& materialData, int textureTypeValue, Material& material, ShaderProgram::Location location,
-    TextureObject::Format format, TextureObject::InternalFormat internalFormat) const
+void ModelLoader::CollectTextureValue(const MaterialData& materialData, MaterialValue& materialValue,
+    std::vector<MaterialValue>& materialValues, const std::string& baseFolder,
+    TextureObject::Format format, TextureObject::InternalFormat internalFormat)
 {
-    aiTextureType textureType = static_cast<aiTextureType>(textureTypeValue);
-    if (materialData.GetTextureCount(textureType) > 0)
+    auto itTexturePath = materialData.texturePaths.find(materialValue.property);
+    if (itTexturePath != materialData.texturePaths.end())
     {
-        assert(materialData.GetTextureCount(textureType) == 1);
-        aiString texturePath;
-        if (materialData.GetTexture(textureType, 0, &texturePath) == aiReturn_SUCCESS)
+        materialValue.texturePath = baseFolder + itTexturePath->second;
+        materialValue.textureFormat = format;
+        materialValue.textureInternalFormat = internalFormat;
+        materialValues.push_back(materialValue);
+    }
+}
+
+void ModelLoader::UploadTextures(ModelData& modelData, const LoadSettings& settings, Texture2DLoader* textureLoader)
+{
+    for (const std::vector<MaterialValue>& materialValues : modelData.materials)
+    {
+        for (const MaterialValue& materialValue : materialValues)
+        {
+            if (materialValue.texturePath.empty() || modelData.createdTextures.contains(materialValue.texturePath)
+                || modelData.mipChains.contains(materialValue.texturePath))
+            {
+                continue;
+            }
+
+            std::shared_ptr<Texture2DObject> texture;
+            if (textureLoader)
+            {
+                textureLoader->SetFormat(materialValue.textureFormat);
+                textureLoader->SetInternalFormat(materialValue.textureInternalFormat);
+                texture = textureLoader->LoadShared(materialValue.texturePath.c_str());
+            }
+            else
+            {
+                const TextureData& textureData = modelData.textures[materialValue.texturePath];
+                if (!textureData.data.empty())
+                {
+                    texture = std::make_shared<Texture2DObject>(Texture2DLoader::CreateTexture(textureData,
+                        materialValue.textureFormat, materialValue.textureInternalFormat, settings.generateMipmap, true));
+                }
+            }
+            modelData.createdTextures[materialValue.texturePath] = texture;
+        }
+    }
+}
+
+void ModelLoader::CreateStreamedTextures(ModelData& modelData, const LoadSettings& settings)
+{
+    for (const std::vector<MaterialValue>& materialValues : modelData.materials)
+    {
+        for (const MaterialValue& materialValue : materialValues)
         {
-            texturePath = m_baseFolder + texturePath.C_Str();
-            m_textureLoader.SetFormat(format);
-            m_textureLoader.SetInternalFormat(internalFormat);
-            std::shared_ptr<Texture2DObject> texture = m_textureLoader.LoadShared(texturePath.C_Str());
-            material.SetUniformValue(location, texture);
+            auto itMipChain = modelData.mipChains.find(materialValue.texturePath);
+            if (itMipChain != modelData.mipChains.end())
+            {
+                assert(settings.textureStreamer);
+                modelData.createdTextures[materialValue.texturePath] = settings.textureStreamer->AddTexture(std::move(itMipChain->second),
+                    materialValue.textureInternalFormat, true);
+                modelData.mipChains.erase(itMipChain);
+            }
+        }
+    }
+}
+
+std::shared_ptr<Material> ModelLoader::GenerateMaterial(const std::vector<MaterialValue>& materialValues, const LoadSettings& settings, const ModelData& modelData)
+{
+    // Instances only store the properties found in the material data, the rest are read from the reference
+    std::shared_ptr<Material> material = std::make_shared<MaterialInstance>(settings.referenceMaterial);
+    for (const MaterialValue& materialValue : materialValues)
+    {
+        switch (materialValue.property)
+        {
+        case MaterialProperty::AmbientColor:
+        case MaterialProperty::DiffuseColor:
+        case MaterialProperty::SpecularColor:
+            material->SetUniformValue(materialValue.location, materialValue.value);
+            break;
+        case MaterialProperty::SpecularExponent:
+            material->SetUniformValue(materialValue.location, materialValue.value.x);
+            break;
+        case MaterialProperty::DiffuseTexture:
+        case MaterialProperty::NormalTexture:
+        case MaterialProperty::SpecularTexture:
+            {
+                auto itTexture = modelData.createdTextures.find(materialValue.texturePath);
+                assert(itTexture != modelData.createdTextures.end());
+                material->SetUniformValue(materialValue.location, itTexture->second);
+            }
+            break;
         }
     }
+    return material;
 }
 
-std::vector<GLubyte> ModelLoader::CollectVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved)
+std::vector<GLubyte> ModelLoader::CollectVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved, VertexQuantization vertexQuantization)
 {
     vertexFormat.Clear();
 
+    bool packed = vertexQuantization != VertexQuantization::None;
+
     // Buid the vertex format with the available vertex data
 
     assert(meshData.HasPositions());
@@ -214,12 +987,30 @@ std::vector<GLubyte> ModelLoader::CollectVertexData(const aiMesh& meshData, Vert
     }
     if (meshData.HasNormals())
     {
-        vertexFormat.AddVertexAttribute<float>(3, VertexAttribute::Semantic::Normal);
+        if (packed)
+        {
+            vertexFormat.AddVertexAttribute(Data::Type::Int2101010Rev, 4, true, VertexAttribute::Semantic::Normal);
+        }
+        else
+        {
+            vertexFormat.AddVertexAttribute<float>(3, VertexAttribute::Semantic::Normal);
+        }
     }
     if (meshData.HasTangentsAndBitangents())
     {
-        vertexFormat.AddVertexAttribute<float>(3, VertexAttribute::Semantic::Tangent);
-        vertexFormat.AddVertexAttribute<float>(3, VertexAttribute::Semantic::Bitangent);
+        if (packed)
+        {
+            vertexFormat.AddVertexAttribute(Data::Type::Int2101010Rev, 4, true, VertexAttribute::Semantic::Tangent);
+            if (vertexQuantization != VertexQuantization::PackedTangentSign)
+            {
+                vertexFormat.AddVertexAttribute(Data::Type::Int2101010Rev, 4, true, VertexAttribute::Semantic::Bitangent);
+            }
+        }
+        else
+        {
+            vertexFormat.AddVertexAttribute<float>(3, VertexAttribute::Semantic::Tangent);
+            vertexFormat.AddVertexAttribute<float>(3, VertexAttribute::Semantic::Bitangent);
+        }
     }
     unsigned int colorSemantic = static_cast<unsigned int>(VertexAttribute::Semantic::Color0);
     for (unsigned int colorChannel = 0; colorChannel < meshData.GetNumColorChannels(); ++colorChannel)
@@ -229,7 +1020,29 @@ std::vector<GLubyte> ModelLoader::CollectVertexData(const aiMesh& meshData, Vert
     unsigned int uvSemantic = static_cast<unsigned int>(VertexAttribute::Semantic::TexCoord0);
     for (unsigned int uvChannel = 0; uvChannel < meshData.GetNumUVChannels(); ++uvChannel)
     {
-        vertexFormat.AddVertexAttribute<float>(meshData.mNumUVComponents[uvChannel], static_cast<VertexAttribute::Semantic>(uvSemantic + uvChannel));
+        VertexAttribute::Semantic semantic = static_cast<VertexAttribute::Semantic>(uvSemantic + uvChannel);
+        if (packed && meshData.mNumUVComponents[uvChannel] == 2)
+        {
+            // Unorm16 is more precise than half floats, but can't represent repeating coordinates
+            bool normalized = true;
+            for (unsigned int i = 0; i < meshData.mNumVertices && normalized; ++i)
+            {
+                const aiVector3D& uv = meshData.mTextureCoords[uvChannel][i];
+                normalized = uv.x >= 0.0f && uv.x <= 1.0f && uv.y >= 0.0f && uv.y <= 1.0f;
+            }
+            if (normalized)
+            {
+                vertexFormat.AddVertexAttribute<GLushort>(2, true, semantic);
+            }
+            else
+            {
+                vertexFormat.AddVertexAttribute(Data::Type::Half, 2, false, semantic);
+            }
+        }
+        else
+        {
+            vertexFormat.AddVertexAttribute<float>(meshData.mNumUVComponents[uvChannel], semantic);
+        }
     }
 
     std::vector<GLubyte> vertexData;
@@ -243,15 +1056,63 @@ std::vector<GLubyte> ModelLoader::CollectVertexData(const aiMesh& meshData, Vert
         const VertexAttribute& attribute = it->GetAttribute();
         int dstStride = it->GetStride();
         void* dstBuffer = &vertexData[it->GetOffset()];
-        int srcStride = 0;
-        const void* srcBuffer = GetVertexDataPointer(meshData, attribute.GetSemantic(), srcStride);
-        assert(srcBuffer);
-        CopyBuffer(dstBuffer, dstStride, srcBuffer, srcStride, meshData.mNumVertices, attribute.GetSize());
+        if (attribute.GetType() == Data::Type::Float || attribute.GetType() == Data::Type::UByte)
+        {
+            int srcStride = 0;
+            const void* srcBuffer = GetVertexDataPointer(meshData, attribute.GetSemantic(), srcStride);
+            assert(srcBuffer);
+            CopyBuffer(dstBuffer, dstStride, srcBuffer, srcStride, meshData.mNumVertices, attribute.GetSize());
+        }
+        else
+        {
+            PackVertexAttribute(meshData, attribute, dstBuffer, dstStride);
+        }
     }
 
     return vertexData;
 }
 
+void ModelLoader::PackVertexAttribute(const aiMesh& meshData, const VertexAttribute& attribute, void* dstBuffer, size_t dstStride)
+{
+    auto toVec3 = [](const aiVector3D& vector) { return glm::vec3(vector.x, vector.y, vector.z); };
+
+    VertexAttribute::Semantic semantic = attribute.GetSemantic();
+    unsigned int texCoord0 = static_cast<unsigned int>(VertexAttribute::Semantic::TexCoord0);
+    unsigned int uvChannel = static_cast<unsigned int>(semantic) - texCoord0;
+
+    unsigned char* dstBytes = static_cast<unsigned char*>(dstBuffer);
+    for (unsigned int i = 0; i < meshData.mNumVertices; ++i, dstBytes += dstStride)
+    {
+        GLuint packedValue = 0;
+        switch (semantic)
+        {
+        case VertexAttribute::Semantic::Normal:
+            packedValue = glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(toVec3(meshData.mNormals[i])), 0.0f));
+            break;
+        case VertexAttribute::Semantic::Tangent:
+            {
+                // The handedness of the tangent frame, for the shaders that rebuild the bitangent
+                glm::vec3 normal = toVec3(meshData.mNormals[i]);
+                glm::vec3 tangent = toVec3(meshData.mTangents[i]);
+                float sign = glm::dot(glm::cross(normal, tangent), toVec3(meshData.mBitangents[i])) < 0.0f ? -1.0f : 1.0f;
+                packedValue = glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(tangent), sign));
+            }
+            break;
+        case VertexAttribute::Semantic::Bitangent:
+            packedValue = glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(toVec3(meshData.mBitangents[i])), 0.0f));
+            break;
+        default:
+            {
+                // Texture coordinates, with 2 components
+                const aiVector3D& uv = meshData.mTextureCoords[uvChannel][i];
+                packedValue = attribute.GetType() == Data::Type::UShort ? glm::packUnorm2x16(glm::vec2(uv.x, uv.y)) : glm::packHalf2x16(glm::vec2(uv.x, uv.y));
+            }
+            break;
+        }
+        std::memcpy(dstBytes, &packedValue, sizeof(packedValue));
+    }
+}
+
 std::vector<GLubyte> ModelLoader::CollectElementData(const aiMesh& meshData, Data::Type& elementType,
     std::vector<Drawcall::Primitive>& primitives, std::vector<int>& elementCounts)
 {
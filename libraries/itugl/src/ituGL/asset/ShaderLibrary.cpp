@@ -0,0 +1,331 @@
+#include <ituGL/asset/ShaderLibrary.h>
+
+#include <ituGL/core/DeviceGL.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <array>
+#include <cassert>
+#include <iostream>
+
+// Limit to detect include cycles that are not caught by the include-once rule
+static constexpr int s_maxIncludeDepth = 32;
+
+ShaderLibrary::ShaderLibrary() : m_pendingProgramCount(0), m_parallelCompileSupported(-1)
+{
+}
+
+const std::string& ShaderLibrary::GetFileSource(const std::string& path)
+{
+    auto itFind = m_fileSources.find(path);
+    if (itFind != m_fileSources.end())
+    {
+        return itFind->second;
+    }
+
+    std::string& source = m_fileSources[path];
+    std::ifstream file(path);
+    if (file.is_open())
+    {
+        std::stringstream stringStream;
+        stringStream << file.rdbuf();
+        source = stringStream.str();
+        ++m_stats.fileReads;
+    }
+    else
+    {
+        std::cout << "ERROR::SHADERLIBRARY::FILE_NOT_FOUND\n" << path << std::endl;
+    }
+    return source;
+}
+
+std::string ShaderLibrary::Preprocess(std::span<const char*> paths, const std::string& defines)
+{
+    std::string output;
+    std::unordered_set<std::string> includedFiles;
+    const std::string* pendingDefines = defines.empty() ? nullptr : &defines;
+    for (const char* path : paths)
+    {
+        std::string normalizedPath = std::filesystem::path(path).lexically_normal().generic_string();
+        PreprocessFile(normalizedPath, output, includedFiles, 0, pendingDefines);
+    }
+
+    // No #version line found, defines go first
+    if (pendingDefines)
+    {
+        output.insert(0, *pendingDefines);
+    }
+    return output;
+}
+
+void ShaderLibrary::PreprocessFile(const std::string& path, std::string& output, std::unordered_set<std::string>& includedFiles, int depth,
+    const std::string*& pendingDefines)
+{
+    assert(depth < s_maxIncludeDepth);
+
+    // Each file is only added once, even if it is listed and included
+    if (!includedFiles.insert(path).second)
+    {
+        return;
+    }
+
+    const std::string& source = GetFileSource(path);
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+    std::istringstream stream(source);
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        std::size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+        {
+            // Accept both "file" and <file>, always relative to the including file
+            std::size_t open = line.find_first_of("\"<", start + 8);
+            std::size_t close = open != std::string::npos ? line.find_first_of("\">", open + 1) : std::string::npos;
+            if (close != std::string::npos)
+            {
+                std::string includeName = line.substr(open + 1, close - open - 1);
+                std::string includePath = (directory / includeName).lexically_normal().generic_string();
+                PreprocessFile(includePath, output, includedFiles, depth + 1, pendingDefines);
+            }
+            else
+            {
+                std::cout << "ERROR::SHADERLIBRARY::INVALID_INCLUDE\n" << path << ": " << line << std::endl;
+            }
+            continue;
+        }
+        output += line;
+        output += '\n';
+
+        // Defines must come after #version, that has to be the first statement
+        if (pendingDefines && start != std::string::npos && line.compare(start, 8, "#version") == 0)
+        {
+            output += *pendingDefines;
+            pendingDefines = nullptr;
+        }
+    }
+}
+
+ShaderLibrary::Hash ShaderLibrary::SubmitShader(Shader::Type type, std::span<const char*> paths, const std::string& defines)
+{
+    std::string source = Preprocess(paths, defines);
+
+    // Same source with a different stage is a different shader
+    Hash hash = ComputeHash(source, ComputeHash(GetTypeName(type)));
+
+    if (m_shaders.find(hash) != m_shaders.end())
+    {
+        ++m_stats.shaderReuses;
+        return hash;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    ShaderEntry& shaderEntry = m_shaders[hash];
+    shaderEntry.shader = std::make_shared<Shader>(type);
+    shaderEntry.shader->SetSource(source.c_str());
+    shaderEntry.shader->CompileAsync();
+    for (const char* path : paths)
+    {
+        shaderEntry.sourceNames += path;
+        shaderEntry.sourceNames += ' ';
+    }
+
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - startTime;
+    m_stats.compileSeconds += duration.count();
+    ++m_stats.shaderCompiles;
+
+    return hash;
+}
+
+std::shared_ptr<const Shader> ShaderLibrary::GetShader(Shader::Type type, std::span<const char*> paths, const std::string& defines)
+{
+    ShaderEntry& shaderEntry = m_shaders[SubmitShader(type, paths, defines)];
+    FinishShader(shaderEntry);
+    return shaderEntry.shader;
+}
+
+std::shared_ptr<ShaderProgram> ShaderLibrary::GetProgram(std::span<const char*> vertexShaderPaths, std::span<const char*> fragmentShaderPaths,
+    const std::string& defines)
+{
+    return SubmitProgram(vertexShaderPaths, fragmentShaderPaths, defines).get();
+}
+
+ShaderLibrary::ProgramFuture ShaderLibrary::SubmitProgram(std::span<const char*> vertexShaderPaths, std::span<const char*> fragmentShaderPaths,
+    const std::string& defines)
+{
+    Hash vertexShaderHash = SubmitShader(Shader::VertexShader, vertexShaderPaths, defines);
+    Hash fragmentShaderHash = SubmitShader(Shader::FragmentShader, fragmentShaderPaths, defines);
+
+    // Combine the shader hashes, order matters
+    Hash hash = ComputeHash(std::string_view(reinterpret_cast<const char*>(&fragmentShaderHash), sizeof(Hash)), vertexShaderHash);
+
+    auto itFind = m_programs.find(hash);
+    if (itFind != m_programs.end())
+    {
+        ++m_stats.programReuses;
+        return itFind->second.future;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Linking can start while the shaders are still compiling, the driver takes care of the dependency
+    ProgramEntry& programEntry = m_programs[hash];
+    programEntry.program = std::make_shared<ShaderProgram>();
+    programEntry.vertexShaderHash = vertexShaderHash;
+    programEntry.fragmentShaderHash = fragmentShaderHash;
+    programEntry.program->BuildAsync(*m_shaders[vertexShaderHash].shader, *m_shaders[fragmentShaderHash].shader);
+
+    // Deferred, so the status queries run on the thread that waits for the result
+    programEntry.future = std::async(std::launch::deferred, [this, hash]() { return FinishProgram(hash); }).share();
+
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - startTime;
+    m_stats.linkSeconds += duration.count();
+    ++m_stats.programLinks;
+    ++m_pendingProgramCount;
+
+    return programEntry.future;
+}
+
+unsigned int ShaderLibrary::Poll()
+{
+    if (m_pendingProgramCount > 0 && IsParallelCompileSupported())
+    {
+        for (auto& pair : m_programs)
+        {
+            ProgramEntry& programEntry = pair.second;
+            if (!programEntry.finished && programEntry.program->IsLinkingComplete())
+            {
+                // Runs FinishProgram through the future, so it is marked as ready
+                programEntry.future.wait();
+            }
+        }
+    }
+    return m_pendingProgramCount;
+}
+
+void ShaderLibrary::WaitAll()
+{
+    for (auto& pair : m_programs)
+    {
+        pair.second.future.wait();
+    }
+    assert(m_pendingProgramCount == 0);
+}
+
+void ShaderLibrary::FinishShader(ShaderEntry& shaderEntry)
+{
+    if (shaderEntry.finished)
+    {
+        return;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    Shader& shader = *shaderEntry.shader;
+    if (!shader.IsCompiled())
+    {
+        std::array<char, 512> infoLog;
+        shader.GetCompilationErrors(infoLog);
+        std::cout << "ERROR::SHADER::" << GetTypeName(shader.GetType()) << "::COMPILATION_FAILED\n"
+            << shaderEntry.sourceNames << "\n" << infoLog.data() << std::endl;
+    }
+    shaderEntry.finished = true;
+
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - startTime;
+    m_stats.waitSeconds += duration.count();
+}
+
+std::shared_ptr<ShaderProgram> ShaderLibrary::FinishProgram(Hash programHash)
+{
+    auto itFind = m_programs.find(programHash);
+    assert(itFind != m_programs.end()); // Futures can't be used after Clear()
+    ProgramEntry& programEntry = itFind->second;
+
+    if (!programEntry.finished)
+    {
+        FinishShader(m_shaders[programEntry.vertexShaderHash]);
+        FinishShader(m_shaders[programEntry.fragmentShaderHash]);
+
+        auto startTime = std::chrono::steady_clock::now();
+
+        ShaderProgram& program = *programEntry.program;
+        if (!program.IsLinked())
+        {
+            std::array<char, 512> infoLog;
+            program.GetLinkingErrors(infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog.data() << std::endl;
+        }
+        programEntry.finished = true;
+        --m_pendingProgramCount;
+
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - startTime;
+        m_stats.waitSeconds += duration.count();
+    }
+    return programEntry.program;
+}
+
+void ShaderLibrary::Clear()
+{
+    WaitAll();
+    m_fileSources.clear();
+    m_shaders.clear();
+    m_programs.clear();
+}
+
+void ShaderLibrary::PrintStats() const
+{
+    std::cout << "ShaderLibrary: "
+        << m_stats.shaderCompiles << " shaders compiled (" << m_stats.shaderReuses << " reused), "
+        << m_stats.programLinks << " programs linked (" << m_stats.programReuses << " reused), "
+        << m_stats.fileReads << " files read. "
+        << "Compile submit: " << m_stats.compileSeconds * 1000.0 << " ms, "
+        << "Link submit: " << m_stats.linkSeconds * 1000.0 << " ms, "
+        << "Wait: " << m_stats.waitSeconds * 1000.0 << " ms"
+        << (m_parallelCompileSupported > 0 ? " (parallel compile)" : "") << std::endl;
+}
+
+bool ShaderLibrary::IsParallelCompileSupported()
+{
+    if (m_parallelCompileSupported < 0)
+    {
+        const DeviceGL& device = DeviceGL::GetInstance();
+        m_parallelCompileSupported = device.IsExtensionSupported("GL_KHR_parallel_shader_compile")
+            || device.IsExtensionSupported("GL_ARB_parallel_shader_compile");
+    }
+    return m_parallelCompileSupported > 0;
+}
+
+ShaderLibrary::Hash ShaderLibrary::ComputeHash(std::string_view data, Hash seed)
+{
+    Hash hash = seed;
+    for (char c : data)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+const char* ShaderLibrary::GetTypeName(Shader::Type type)
+{
+    switch (type)
+    {
+    case Shader::ComputeShader:
+        return "COMPUTE";
+    case Shader::VertexShader:
+        return "VERTEX";
+    case Shader::TesselationControlShader:
+        return "TCS";
+    case Shader::TesselationEvaluationShader:
+        return "TES";
+    case Shader::GeometryShader:
+        return "GEOMETRY";
+    case Shader::FragmentShader:
+        return "FRAGMENT";
+    default:
+        return "UNKNOWN";
+    }
+}
@@ -0,0 +1,96 @@
+#include <ituGL/asset/ShaderVariantSet.h>
+
+#include <ituGL/shader/ShaderProgram.h>
+#include <cassert>
+
+ShaderVariantSet::ShaderVariantSet(ShaderLibrary& shaderLibrary, std::span<const char*> vertexShaderPaths, std::span<const char*> fragmentShaderPaths,
+    KeywordMask supportedKeywords)
+    : m_shaderLibrary(shaderLibrary), m_supportedKeywords(supportedKeywords)
+{
+    // Reserve first, so the pointers to the strings stay valid
+    m_sourcePaths.reserve(vertexShaderPaths.size() + fragmentShaderPaths.size());
+    for (const char* path : vertexShaderPaths)
+    {
+        m_vertexShaderPaths.push_back(m_sourcePaths.emplace_back(path).c_str());
+    }
+    for (const char* path : fragmentShaderPaths)
+    {
+        m_fragmentShaderPaths.push_back(m_sourcePaths.emplace_back(path).c_str());
+    }
+}
+
+void ShaderVariantSet::SetVariantCreatedFunction(VariantCreatedFunction variantCreatedFunction)
+{
+    // Set it before getting any variant, otherwise the existing ones are not notified. Submitting is fine
+    for (const auto& pair : m_variants)
+    {
+        assert(!pair.second.created);
+    }
+    m_variantCreatedFunction = variantCreatedFunction;
+}
+
+ShaderLibrary::ProgramFuture ShaderVariantSet::SubmitVariant(KeywordMask keywords)
+{
+    keywords &= m_supportedKeywords;
+
+    Variant& variant = m_variants[keywords];
+    if (!variant.future.valid())
+    {
+        variant.future = m_shaderLibrary.SubmitProgram(m_vertexShaderPaths, m_fragmentShaderPaths, GetDefines(keywords));
+    }
+    return variant.future;
+}
+
+std::shared_ptr<ShaderProgram> ShaderVariantSet::GetVariant(KeywordMask keywords)
+{
+    keywords &= m_supportedKeywords;
+
+    std::shared_ptr<ShaderProgram> shaderProgram = SubmitVariant(keywords).get();
+
+    Variant& variant = m_variants[keywords];
+    if (!variant.created)
+    {
+        variant.created = true;
+        if (m_variantCreatedFunction)
+        {
+            m_variantCreatedFunction(shaderProgram, keywords);
+        }
+    }
+    return shaderProgram;
+}
+
+std::string ShaderVariantSet::GetDefines(KeywordMask keywords)
+{
+    std::string defines;
+    for (unsigned int i = 0; i < KeywordCount; ++i)
+    {
+        Keyword keyword = static_cast<Keyword>(1 << i);
+        if (keywords & keyword)
+        {
+            defines += "#define ";
+            defines += GetKeywordName(keyword);
+            defines += '\n';
+        }
+    }
+    return defines;
+}
+
+const char* ShaderVariantSet::GetKeywordName(Keyword keyword)
+{
+    switch (keyword)
+    {
+    case Fog:
+        return "FOG";
+    case ShadowPass:
+        return "SHADOW_PASS";
+    case Instanced:
+        return "INSTANCED";
+    case NormalMap:
+        return "NORMAL_MAP";
+    case VirtualFeedback:
+        return "VIRTUAL_FEEDBACK";
+    default:
+        assert(false);
+        return "";
+    }
+}
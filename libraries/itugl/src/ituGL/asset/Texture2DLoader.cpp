@@ -1,34 +1,145 @@
 #include <ituGL/asset/Texture2DLoader.h>
 
+#include <ituGL/texture/TextureStreamer.h>
+
 #include <cassert>
 
 Texture2DLoader::Texture2DLoader()
     : m_flipVertical(false)
+    , m_wrap(true)
+    , m_streamer(nullptr)
+    , m_cache(nullptr)
+    , m_compressed(false)
 {
 }
 
 Texture2DLoader::Texture2DLoader(TextureObject::Format format, TextureObject::InternalFormat internalFormat)
     : TextureLoader(format, internalFormat)
     , m_flipVertical(false)
+    , m_wrap(true)
+    , m_streamer(nullptr)
+    , m_cache(nullptr)
+    , m_compressed(false)
 {
 }
 
 
 Texture2DObject Texture2DLoader::Load(const char* path)
 {
-    Texture2DObject texture2D;
+    if (m_cache)
+    {
+        TextureCache::CachedTexture cachedTexture;
+        if (m_cache->Load(path, GetCacheSettings(), cachedTexture))
+        {
+            return TextureCache::CreateTexture(cachedTexture, m_wrap);
+        }
+    }
 
     // Load texture data using stbimage library
-    int width, height;
-    Data::Type dataType;
-    std::span<const std::byte> data = LoadTexture2DData(path, width, height, dataType, m_flipVertical);
+    TextureData textureData = TextureLoaderUtils::LoadTextureData(path, m_format, m_internalFormat, m_flipVertical);
 
     // If data was loaded, copy it to the texture object
+    Texture2DObject texture2D = CreateTexture(textureData, m_format, m_internalFormat, m_generateMipmap, m_wrap);
+
+    // Free loaded data (not needed anymore)
+    TextureLoaderUtils::FreeTextureData(textureData);
+
+    return texture2D;
+}
+
+void Texture2DLoader::SubmitLoad(const std::string& path, AssetLoadQueue& loadQueue, Promise promise)
+{
+    // Copy the settings, the loader is not used after this
+    TextureObject::Format format = m_format;
+    TextureObject::InternalFormat internalFormat = m_internalFormat;
+    bool generateMipmap = m_generateMipmap;
+    bool flipVertical = m_flipVertical;
+    bool wrapping = m_wrap;
+
+    if (m_streamer)
+    {
+        TextureStreamer* streamer = m_streamer;
+        loadQueue.SubmitWork([=, &loadQueue]()
+            {
+                TextureData textureData = TextureLoaderUtils::LoadTextureData(path.c_str(), format, internalFormat, flipVertical);
+                std::shared_ptr<TextureMipChain> mipChain = std::make_shared<TextureMipChain>(textureData.data, textureData.width, textureData.height, format, textureData.dataType);
+                TextureLoaderUtils::FreeTextureData(textureData);
+
+                // The streamer is only used from the GL thread, so there is nothing to do in the upload context
+                loadQueue.SubmitUpload([]() {}, [=]()
+                    {
+                        promise->set_value(streamer->AddTexture(std::move(*mipChain), internalFormat, wrapping));
+                    });
+            });
+        return;
+    }
+
+    if (m_cache)
+    {
+        const TextureCache* cache = m_cache;
+        TextureCache::Settings cacheSettings = GetCacheSettings();
+        loadQueue.SubmitWork([=, &loadQueue]()
+            {
+                // Cooking, if needed, also happens here on the worker
+                std::shared_ptr<TextureCache::CachedTexture> cachedTexture = std::make_shared<TextureCache::CachedTexture>();
+                if (cache->Load(path.c_str(), cacheSettings, *cachedTexture))
+                {
+                    loadQueue.SubmitAssetUpload<Texture2DObject>([=]()
+                        {
+                            return std::make_shared<Texture2DObject>(TextureCache::CreateTexture(*cachedTexture, wrapping));
+                        }, promise);
+                    return;
+                }
+
+                // Fall back to decoding the image without the cache
+                TextureData textureData = TextureLoaderUtils::LoadTextureData(path.c_str(), format, internalFormat, flipVertical);
+                loadQueue.SubmitAssetUpload<Texture2DObject>([=]() mutable
+                    {
+                        std::shared_ptr<Texture2DObject> texture = std::make_shared<Texture2DObject>(CreateTexture(textureData, format, internalFormat, generateMipmap, wrapping));
+                        TextureLoaderUtils::FreeTextureData(textureData);
+                        return texture;
+                    }, promise);
+            });
+        return;
+    }
+
+    loadQueue.SubmitWork([=, &loadQueue]()
+        {
+            TextureData textureData = TextureLoaderUtils::LoadTextureData(path.c_str(), format, internalFormat, flipVertical);
+            loadQueue.SubmitAssetUpload<Texture2DObject>([=]() mutable
+                {
+                    std::shared_ptr<Texture2DObject> texture = std::make_shared<Texture2DObject>(CreateTexture(textureData, format, internalFormat, generateMipmap, wrapping));
+                    TextureLoaderUtils::FreeTextureData(textureData);
+                    return texture;
+                }, promise);
+        });
+}
+
+TextureCache::Settings Texture2DLoader::GetCacheSettings() const
+{
+    TextureCache::Settings settings;
+    settings.format = m_format;
+    settings.internalFormat = m_internalFormat;
+    settings.flipVertical = m_flipVertical;
+    settings.generateMipmap = m_generateMipmap;
+    settings.compress = m_compressed;
+    return settings;
+}
+
+Texture2DObject Texture2DLoader::CreateTexture(const TextureData& textureData,
+    TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool generateMipmap, bool wrapping)
+{
+    Texture2DObject texture2D;
+
+    int width = textureData.width;
+    int height = textureData.height;
+    std::span<const std::byte> data = textureData.data;
+
     assert(!data.empty());
     if (!data.empty())
     {
         texture2D.Bind();
-        texture2D.SetImage<std::byte>(0, width, height, m_format, m_internalFormat, data, dataType);
+        texture2D.SetImage<std::byte>(0, width, height, format, internalFormat, data, textureData.dataType);
 
         texture2D.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR);
         texture2D.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
@@ -38,14 +149,14 @@ Texture2DObject Texture2DLoader::Load(const char* path)
         // --------------------
         // If the Texture Isn't supposed to wrap, then we need to clamp to edge so that
         // the color on the opposite edge doesn't bleed over.
-        if (!m_wrap) {
+        if (!wrapping) {
             texture2D.SetParameter(TextureObject::ParameterEnum::WrapR, GL_CLAMP_TO_EDGE);
             texture2D.SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
             texture2D.SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
         }
 
         // Generate mipmap if needed
-        if (m_generateMipmap)
+        if (generateMipmap)
         {
             texture2D.GenerateMipmap();
             texture2D.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR_MIPMAP_LINEAR);
@@ -57,9 +168,6 @@ Texture2DObject Texture2DLoader::Load(const char* path)
         }
 
         texture2D.Unbind();
-
-        // Free loaded data (not needed anymore)
-        FreeTexture2DData(data);
     }
     return texture2D;
 }
@@ -73,3 +181,23 @@ std::shared_ptr<Texture2DObject> Texture2DLoader::LoadTextureShared(const char*
     loader.SetWrapping(wrapping);
     return loader.LoadShared(path);
 }
+
+AssetFuture<Texture2DObject> Texture2DLoader::LoadTextureSharedAsync(const char* path, AssetLoadQueue& loadQueue,
+    TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool generateMipmap, bool flipVertical, bool wrapping)
+{
+    Texture2DLoader loader(format, internalFormat);
+    loader.SetGenerateMipmap(generateMipmap);
+    loader.SetFlipVertical(flipVertical);
+    loader.SetWrapping(wrapping);
+    return loader.LoadAsync(path, loadQueue);
+}
+
+AssetFuture<Texture2DObject> Texture2DLoader::LoadTextureStreamedAsync(const char* path, AssetLoadQueue& loadQueue, TextureStreamer& streamer,
+    TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool flipVertical, bool wrapping)
+{
+    Texture2DLoader loader(format, internalFormat);
+    loader.SetFlipVertical(flipVertical);
+    loader.SetWrapping(wrapping);
+    loader.SetStreamer(&streamer);
+    return loader.LoadAsync(path, loadQueue);
+}
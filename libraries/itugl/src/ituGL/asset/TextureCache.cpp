@@ -0,0 +1,246 @@
+#include <ituGL/asset/TextureCache.h>
+
+#include <ituGL/asset/TextureLoader.h>
+#include <ituGL/texture/TextureMipChain.h>
+#include <ituGL/texture/TextureBlockCompressor.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <cstring>
+#include <cassert>
+
+TextureCache::TextureCache(const char* folder) : m_folder(folder)
+{
+}
+
+bool TextureCache::Load(const char* path, const Settings& settings, CachedTexture& cachedTexture) const
+{
+    // The key is the content of the source, not its date, so copying the files around doesn't invalidate the cache
+    std::string cachePath;
+    {
+        MappedFile source;
+        if (!source.Open(path))
+        {
+            std::cout << "ERROR::TEXTURECACHE::SOURCE_NOT_FOUND: " << path << std::endl;
+            return false;
+        }
+        cachePath = GetCachePath(source.GetData(), settings);
+    }
+
+    if (Open(cachePath, cachedTexture))
+    {
+        return true;
+    }
+
+    return Cook(path, settings, cachePath) && Open(cachePath, cachedTexture);
+}
+
+Texture2DObject TextureCache::CreateTexture(const CachedTexture& cachedTexture, bool wrapping)
+{
+    Texture2DObject texture2D;
+
+    int levelCount = static_cast<int>(cachedTexture.levels.size());
+    bool compressed = TextureObject::GetBlockSize(cachedTexture.internalFormat) > 0;
+
+    texture2D.Bind();
+
+    // Rows of the small levels are not aligned to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    int width = cachedTexture.width;
+    int height = cachedTexture.height;
+    for (int level = 0; level < levelCount; ++level)
+    {
+        if (compressed)
+        {
+            texture2D.SetCompressedImage(level, width, height, cachedTexture.internalFormat, cachedTexture.levels[level]);
+        }
+        else
+        {
+            texture2D.SetImage<std::byte>(level, width, height, cachedTexture.format, cachedTexture.internalFormat,
+                cachedTexture.levels[level], cachedTexture.dataType);
+        }
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    texture2D.SetParameter(TextureObject::ParameterInt::MaxLevel, levelCount - 1);
+    texture2D.SetParameter(TextureObject::ParameterEnum::MinFilter, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    texture2D.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+    if (!wrapping)
+    {
+        texture2D.SetParameter(TextureObject::ParameterEnum::WrapR, GL_CLAMP_TO_EDGE);
+        texture2D.SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+        texture2D.SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+    }
+
+    texture2D.Unbind();
+    return texture2D;
+}
+
+std::string TextureCache::GetCachePath(std::span<const std::byte> source, const Settings& settings) const
+{
+    // 64-bit FNV-1a of the source bytes followed by the settings
+    uint64_t hash = 14695981039346656037ull;
+    auto hashBytes = [&hash](const void* bytes, size_t size)
+    {
+        const unsigned char* data = static_cast<const unsigned char*>(bytes);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        }
+    };
+    hashBytes(source.data(), source.size_bytes());
+
+    uint32_t settingsKey[] = { static_cast<uint32_t>(settings.format), static_cast<uint32_t>(settings.internalFormat),
+        settings.flipVertical, settings.generateMipmap, settings.compress, FileVersion };
+    hashBytes(settingsKey, sizeof(settingsKey));
+
+    std::stringstream stream;
+    stream << m_folder << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".tex";
+    return stream.str();
+}
+
+bool TextureCache::Cook(const char* path, const Settings& settings, const std::string& cachePath)
+{
+    TextureData textureData = TextureLoaderUtils::LoadTextureData(path, settings.format, settings.internalFormat, settings.flipVertical);
+    if (textureData.data.empty())
+    {
+        return false;
+    }
+
+    int componentCount = TextureObject::GetComponentCount(settings.format);
+    TextureObject::InternalFormat internalFormat = settings.internalFormat;
+    bool compress = settings.compress;
+    if (compress && textureData.dataType != Data::Type::UByte)
+    {
+        std::cout << "ERROR::TEXTURECACHE::COMPRESSION_NOT_SUPPORTED: Only 8-bit textures are compressed, " << path << std::endl;
+        compress = false;
+    }
+    if (compress)
+    {
+        bool srgb = internalFormat == TextureObject::InternalFormatSRGB8 || internalFormat == TextureObject::InternalFormatSRGBA8;
+        internalFormat = TextureBlockCompressor::GetCompressedFormat(componentCount, srgb);
+    }
+
+    // The chain has a single level if the mipmaps are not needed
+    TextureMipChain mipChain;
+    int levelCount = 1;
+    if (settings.generateMipmap)
+    {
+        mipChain = TextureMipChain(textureData.data, textureData.width, textureData.height, settings.format, textureData.dataType);
+        levelCount = mipChain.GetLevelCount();
+    }
+
+    std::vector<LevelHeader> levelHeaders(levelCount);
+    std::vector<std::vector<std::byte>> compressedLevels(compress ? levelCount : 0);
+    uint64_t offset = sizeof(FileHeader) + sizeof(LevelHeader) * levelCount;
+    int width = textureData.width;
+    int height = textureData.height;
+    for (int level = 0; level < levelCount; ++level)
+    {
+        std::span<const std::byte> levelData = settings.generateMipmap ? mipChain.GetLevelData(level) : textureData.data;
+        if (compress)
+        {
+            compressedLevels[level].resize(TextureBlockCompressor::GetCompressedSize(width, height, internalFormat));
+            TextureBlockCompressor::Compress(levelData, width, height, componentCount, internalFormat, compressedLevels[level]);
+            levelData = compressedLevels[level];
+        }
+        levelHeaders[level] = LevelHeader{ offset, levelData.size_bytes() };
+        offset += levelData.size_bytes();
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, "ITEX", 4);
+    header.version = FileVersion;
+    header.format = static_cast<uint32_t>(settings.format);
+    header.internalFormat = static_cast<uint32_t>(internalFormat);
+    header.dataType = static_cast<uint32_t>(textureData.dataType);
+    header.width = textureData.width;
+    header.height = textureData.height;
+    header.levelCount = levelCount;
+
+    // Write to a temporary file first, so other threads and processes never map a partial file
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+    std::stringstream tempPath;
+    tempPath << cachePath << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    {
+        std::ofstream file(tempPath.str(), std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(levelHeaders.data()), sizeof(LevelHeader) * levelCount);
+        for (int level = 0; level < levelCount; ++level)
+        {
+            std::span<const std::byte> levelData = settings.generateMipmap ? mipChain.GetLevelData(level) : textureData.data;
+            if (compress)
+            {
+                levelData = compressedLevels[level];
+            }
+            file.write(reinterpret_cast<const char*>(levelData.data()), levelData.size_bytes());
+        }
+        error = file ? std::error_code() : std::make_error_code(std::errc::io_error);
+    }
+    TextureLoaderUtils::FreeTextureData(textureData);
+
+    if (!error)
+    {
+        std::filesystem::rename(tempPath.str(), cachePath, error);
+    }
+    if (error)
+    {
+        std::cout << "ERROR::TEXTURECACHE::WRITE_FAILED: " << cachePath << std::endl;
+        std::filesystem::remove(tempPath.str(), error);
+        return false;
+    }
+    return true;
+}
+
+bool TextureCache::Open(const std::string& cachePath, CachedTexture& cachedTexture)
+{
+    MappedFile file;
+    if (!file.Open(cachePath.c_str()))
+    {
+        return false;
+    }
+
+    std::span<const std::byte> data = file.GetData();
+    if (data.size_bytes() < sizeof(FileHeader))
+    {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, "ITEX", 4) != 0 || header.version != FileVersion ||
+        data.size_bytes() < sizeof(FileHeader) + sizeof(LevelHeader) * header.levelCount)
+    {
+        return false;
+    }
+
+    cachedTexture.format = static_cast<TextureObject::Format>(header.format);
+    cachedTexture.internalFormat = static_cast<TextureObject::InternalFormat>(header.internalFormat);
+    cachedTexture.dataType = static_cast<Data::Type>(header.dataType);
+    cachedTexture.width = header.width;
+    cachedTexture.height = header.height;
+    cachedTexture.levels.clear();
+    for (uint32_t level = 0; level < header.levelCount; ++level)
+    {
+        LevelHeader levelHeader;
+        std::memcpy(&levelHeader, data.data() + sizeof(FileHeader) + sizeof(LevelHeader) * level, sizeof(levelHeader));
+        if (levelHeader.offset + levelHeader.size > data.size_bytes())
+        {
+            return false;
+        }
+        cachedTexture.levels.push_back(data.subspan(levelHeader.offset, levelHeader.size));
+    }
+
+    // The spans point to the mapping, that stays valid when the file object is moved
+    cachedTexture.file = std::move(file);
+    return true;
+}
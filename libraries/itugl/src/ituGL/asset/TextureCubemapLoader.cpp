@@ -13,12 +13,45 @@ TextureCubemapLoader::TextureCubemapLoader(TextureObject::Format format, Texture
 }
 
 TextureCubemapObject TextureCubemapLoader::Load(const char* path)
+{
+    TextureData textureData = TextureLoaderUtils::LoadTextureData(path, m_format, m_internalFormat, false);
+
+    TextureCubemapObject textureCubemap = CreateTexture(textureData, m_format, m_internalFormat, m_generateMipmap);
+
+    // Free loaded data (not needed anymore)
+    TextureLoaderUtils::FreeTextureData(textureData);
+
+    return textureCubemap;
+}
+
+void TextureCubemapLoader::SubmitLoad(const std::string& path, AssetLoadQueue& loadQueue, Promise promise)
+{
+    // Copy the settings, the loader is not used after this
+    TextureObject::Format format = m_format;
+    TextureObject::InternalFormat internalFormat = m_internalFormat;
+    bool generateMipmap = m_generateMipmap;
+
+    loadQueue.SubmitWork([=, &loadQueue]()
+        {
+            TextureData textureData = TextureLoaderUtils::LoadTextureData(path.c_str(), format, internalFormat, false);
+            loadQueue.SubmitAssetUpload<TextureCubemapObject>([=]() mutable
+                {
+                    std::shared_ptr<TextureCubemapObject> texture = std::make_shared<TextureCubemapObject>(CreateTexture(textureData, format, internalFormat, generateMipmap));
+                    TextureLoaderUtils::FreeTextureData(textureData);
+                    return texture;
+                }, promise);
+        });
+}
+
+TextureCubemapObject TextureCubemapLoader::CreateTexture(const TextureData& textureData,
+    TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool generateMipmap)
 {
     TextureCubemapObject textureCubemap;
 
-    int width, height;
-    Data::Type dataType;
-    std::span<const std::byte> data = LoadTexture2DData(path, width, height, dataType);
+    int width = textureData.width;
+    int height = textureData.height;
+    Data::Type dataType = textureData.dataType;
+    std::span<const std::byte> data = textureData.data;
 
     // If data was loaded, copy it to the texture object
     assert(!data.empty());
@@ -32,20 +65,20 @@ TextureCubemapObject TextureCubemapLoader::Load(const char* path)
 
         textureCubemap.Bind();
 
-        int pixelSize = TextureObject::GetComponentCount(m_format) * Data::GetTypeSize(dataType);
+        int pixelSize = TextureObject::GetComponentCount(format) * Data::GetTypeSize(dataType);
         std::vector<std::byte> faceData(side * side * pixelSize);
-        LoadFace(textureCubemap, TextureCubemapObject::Face::Left,   data, faceData, 0, 1, side, dataType);
-        LoadFace(textureCubemap, TextureCubemapObject::Face::Right,  data, faceData, 2, 1, side, dataType);
-        LoadFace(textureCubemap, TextureCubemapObject::Face::Bottom, data, faceData, 1, 2, side, dataType);
-        LoadFace(textureCubemap, TextureCubemapObject::Face::Top,    data, faceData, 1, 0, side, dataType);
-        LoadFace(textureCubemap, TextureCubemapObject::Face::Front,  data, faceData, 3, 1, side, dataType);
-        LoadFace(textureCubemap, TextureCubemapObject::Face::Back,   data, faceData, 1, 1, side, dataType);
+        LoadFace(textureCubemap, TextureCubemapObject::Face::Left,   data, faceData, 0, 1, side, format, internalFormat, dataType);
+        LoadFace(textureCubemap, TextureCubemapObject::Face::Right,  data, faceData, 2, 1, side, format, internalFormat, dataType);
+        LoadFace(textureCubemap, TextureCubemapObject::Face::Bottom, data, faceData, 1, 2, side, format, internalFormat, dataType);
+        LoadFace(textureCubemap, TextureCubemapObject::Face::Top,    data, faceData, 1, 0, side, format, internalFormat, dataType);
+        LoadFace(textureCubemap, TextureCubemapObject::Face::Front,  data, faceData, 3, 1, side, format, internalFormat, dataType);
+        LoadFace(textureCubemap, TextureCubemapObject::Face::Back,   data, faceData, 1, 1, side, format, internalFormat, dataType);
 
         textureCubemap.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR);
         textureCubemap.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
 
         // Generate mipmap if needed
-        if (m_generateMipmap)
+        if (generateMipmap)
         {
             textureCubemap.GenerateMipmap();
             textureCubemap.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR_MIPMAP_LINEAR);
@@ -62,9 +95,6 @@ TextureCubemapObject TextureCubemapLoader::Load(const char* path)
         textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
 
         textureCubemap.Unbind();
-
-        // Free loaded data (not needed anymore)
-        FreeTexture2DData(data);
     }
     return textureCubemap;
 }
@@ -77,9 +107,18 @@ std::shared_ptr<TextureCubemapObject> TextureCubemapLoader::LoadTextureShared(co
     return loader.LoadShared(path);
 }
 
-void TextureCubemapLoader::LoadFace(TextureCubemapObject& textureCubemap, TextureCubemapObject::Face face, std::span<const std::byte> dataSrc, std::span<std::byte> dataDst, int x, int y, int side, Data::Type dataType)
+AssetFuture<TextureCubemapObject> TextureCubemapLoader::LoadTextureSharedAsync(const char* path, AssetLoadQueue& loadQueue,
+    TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool generateMipmap)
+{
+    TextureCubemapLoader loader(format, internalFormat);
+    loader.SetGenerateMipmap(generateMipmap);
+    return loader.LoadAsync(path, loadQueue);
+}
+
+void TextureCubemapLoader::LoadFace(TextureCubemapObject& textureCubemap, TextureCubemapObject::Face face, std::span<const std::byte> dataSrc, std::span<std::byte> dataDst, int x, int y, int side,
+    TextureObject::Format format, TextureObject::InternalFormat internalFormat, Data::Type dataType)
 {
-    int pixelSize = TextureObject::GetComponentCount(m_format) * Data::GetTypeSize(dataType);
+    int pixelSize = TextureObject::GetComponentCount(format) * Data::GetTypeSize(dataType);
     int rowSize = side * pixelSize;
     int stride = 4 * rowSize;
     int srcOffset = y * side * stride + x * rowSize;
@@ -93,5 +132,5 @@ void TextureCubemapLoader::LoadFace(TextureCubemapObject& textureCubemap, Textur
         dstOffset += rowSize;
     }
 
-    textureCubemap.SetImage<std::byte>(0, face, side, m_format, m_internalFormat, dataDst, dataType);
+    textureCubemap.SetImage<std::byte>(0, face, side, format, internalFormat, dataDst, dataType);
 }
@@ -3,6 +3,9 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <vector>
+
 std::span<const std::byte> TextureLoaderUtils::LoadTexture2DData(const char* path, int& width, int& height, Data::Type& dataType, TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool flipVertical)
 {
     std::span<const std::byte> dataSpan;
@@ -10,9 +13,7 @@ std::span<const std::byte> TextureLoaderUtils::LoadTexture2DData(const char* pat
     int componentCount = TextureObject::GetComponentCount(format);
     int originalComponentCount;
 
-    // Set flip vertical on load if needed
-    stbi_set_flip_vertically_on_load(flipVertical ? 1 : 0);
-
+    // The flip option of stb_image is global, so the rows are flipped here instead, to be able to decode in several threads
     if (IsHDR(internalFormat))
     {
         float* data = stbi_loadf(path, &width, &height, &originalComponentCount, componentCount);
@@ -27,9 +28,36 @@ std::span<const std::byte> TextureLoaderUtils::LoadTexture2DData(const char* pat
         dataSpan = Data::GetBytes(dataSpanByte);
         dataType = Data::Type::UByte;
     }
+
+    if (flipVertical && !dataSpan.empty())
+    {
+        FlipVertical(const_cast<std::byte*>(dataSpan.data()), width, height, componentCount * Data::GetTypeSize(dataType));
+    }
     return dataSpan;
 }
 
+TextureData TextureLoaderUtils::LoadTextureData(const char* path, TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool flipVertical)
+{
+    TextureData textureData;
+    textureData.data = LoadTexture2DData(path, textureData.width, textureData.height, textureData.dataType, format, internalFormat, flipVertical);
+    return textureData;
+}
+
+void TextureLoaderUtils::FreeTextureData(TextureData& textureData)
+{
+    FreeTexture2DData(textureData.data);
+    textureData.data = std::span<const std::byte>();
+}
+
+void TextureLoaderUtils::FlipVertical(std::byte* data, int width, int height, int pixelSize)
+{
+    std::size_t rowSize = static_cast<std::size_t>(width) * pixelSize;
+    for (int top = 0, bottom = height - 1; top < bottom; ++top, --bottom)
+    {
+        std::swap_ranges(data + top * rowSize, data + (top + 1) * rowSize, data + bottom * rowSize);
+    }
+}
+
 void TextureLoaderUtils::FreeTexture2DData(std::span<const std::byte> data)
 {
     const void* dataPtr = data.data();
@@ -3,7 +3,7 @@
 #include <cassert>
 
 // Create the object initially null, get object handle and generate 1 buffer
-BufferObject::BufferObject() : Object(NullHandle)
+BufferObject::BufferObject() : Object(NullHandle), m_size(0)
 {
     Handle& handle = GetHandle();
     glGenBuffers(1, &handle);
@@ -16,13 +16,16 @@ BufferObject::~BufferObject()
     glDeleteBuffers(1, &handle);
 }
 
-BufferObject::BufferObject(BufferObject&& bufferObject) noexcept : Object(std::move(bufferObject))
+BufferObject::BufferObject(BufferObject&& bufferObject) noexcept : Object(std::move(bufferObject)), m_size(bufferObject.m_size)
 {
+    bufferObject.m_size = 0;
 }
 
 BufferObject& BufferObject::operator = (BufferObject&& bufferObject) noexcept
 {
     Object::operator=(std::move(bufferObject));
+    m_size = bufferObject.m_size;
+    bufferObject.m_size = 0;
     return *this;
 }
 
@@ -46,6 +49,7 @@ void BufferObject::AllocateData(size_t size, Usage usage)
     assert(IsBound());
     Target target = GetTarget();
     glBufferData(target, size, nullptr, usage);
+    m_size = size;
 }
 
 // Get buffer Target and allocate buffer data
@@ -54,6 +58,7 @@ void BufferObject::AllocateData(std::span<const std::byte> data, Usage usage)
     assert(IsBound());
     Target target = GetTarget();
     glBufferData(target, data.size_bytes(), data.data(), usage);
+    m_size = data.size_bytes();
 }
 
 // Get buffer Target and set buffer subdata
@@ -63,3 +68,20 @@ void BufferObject::UpdateData(std::span<const std::byte> data, size_t offset)
     Target target = GetTarget();
     glBufferSubData(target, offset, data.size_bytes(), data.data());
 }
+
+// Get buffer Target and map a range of the buffer
+std::span<std::byte> BufferObject::MapData(size_t offset, size_t size, GLbitfield access)
+{
+    assert(IsBound());
+    Target target = GetTarget();
+    void* data = glMapBufferRange(target, offset, size, access);
+    return data ? std::span<std::byte>(static_cast<std::byte*>(data), size) : std::span<std::byte>();
+}
+
+// Get buffer Target and unmap the buffer
+bool BufferObject::UnmapData()
+{
+    assert(IsBound());
+    Target target = GetTarget();
+    return glUnmapBuffer(target) == GL_TRUE;
+}
@@ -123,3 +123,10 @@ void DeviceGL::SetVSyncEnabled(bool enabled)
 {
     glfwSwapInterval(enabled ? 1 : 0);
 }
+
+// Check if the current context supports an extension
+bool DeviceGL::IsExtensionSupported(const char* extension) const
+{
+    assert(m_contextLoaded);
+    return glfwExtensionSupported(extension) == GLFW_TRUE;
+}
@@ -5,7 +5,7 @@
 #include <cassert>
 
 Drawcall::Drawcall()
-    : m_primitive(Primitive::Invalid), m_first(0), m_count(0), m_eboType(Data::Type::None)
+    : m_primitive(Primitive::Invalid), m_first(0), m_count(0), m_eboType(Data::Type::None), m_instanceCount(1)
 {
 }
 
@@ -15,7 +15,7 @@ Drawcall::Drawcall(Primitive primitive, GLsizei count, GLint first)
 }
 
 Drawcall::Drawcall(Primitive primitive, GLsizei count, Data::Type eboType, GLint first)
-    : m_primitive(primitive), m_first(first), m_count(count), m_eboType(eboType)
+    : m_primitive(primitive), m_first(first), m_count(count), m_eboType(eboType), m_instanceCount(1)
 {
     assert(primitive != Primitive::Invalid);
     assert(first >= 0);
@@ -28,17 +28,36 @@ void Drawcall::Draw() const
     assert(IsValid());
     assert(VertexArrayObject::IsAnyBound());
 
+    if (m_instanceCount <= 0)
+    {
+        return;
+    }
+
     GLenum primitive = static_cast<GLenum>(m_primitive);
     if (m_eboType == Data::Type::None)
     {
         // If no EBO is present, use glDrawArrays
-        glDrawArrays(primitive, m_first, m_count);
+        if (m_instanceCount == 1)
+        {
+            glDrawArrays(primitive, m_first, m_count);
+        }
+        else
+        {
+            glDrawArraysInstanced(primitive, m_first, m_count, m_instanceCount);
+        }
     }
     else
     {
         // If there is an EBO, use glDrawElements
         assert(ElementBufferObject::IsSupportedType(m_eboType));
         const char* basePointer = nullptr; // Actual element pointer is in VAO
-        glDrawElements(primitive, m_count, static_cast<GLenum>(m_eboType), basePointer + m_first);
+        if (m_instanceCount == 1)
+        {
+            glDrawElements(primitive, m_count, static_cast<GLenum>(m_eboType), basePointer + m_first);
+        }
+        else
+        {
+            glDrawElementsInstanced(primitive, m_count, static_cast<GLenum>(m_eboType), basePointer + m_first, m_instanceCount);
+        }
     }
 }
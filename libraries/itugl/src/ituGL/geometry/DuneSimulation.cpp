@@ -0,0 +1,427 @@
+#include <ituGL/geometry/DuneSimulation.h>
+
+#include <ituGL/geometry/Heightfield.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Smallest change of a texel that gets published, in heightfield values
+static constexpr float s_publishThreshold = 1.0f / 1024.0f;
+
+// Fraction of the sand in the air that lands on open sand on each hop. The shadow catches all of it
+static constexpr float s_depositFraction = 0.4f;
+
+// Hops before the sand lands anyway
+static constexpr int s_hopCount = 4;
+
+// Relaxation passes of the slopes per tick, and fraction of the excess difference moved to each neighbour on each pass
+static constexpr int s_avalancheIterations = 4;
+static constexpr float s_avalancheRate = 0.2f;
+
+// Length of the shadow search upwind, in texels
+static constexpr int s_shadowLength = 12;
+
+static int Wrap(int value, int size)
+{
+    value %= size;
+    return value < 0 ? value + size : value;
+}
+
+// Random value in [0, 1) for the texel in the tick, the same whichever thread computes it
+static float Hash(uint32_t seed, uint32_t tick, uint32_t index)
+{
+    uint32_t hash = index * 0x9E3779B1u ^ tick * 0x85EBCA77u ^ seed * 0xC2B2AE3Du;
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    hash *= 0x846CA68Bu;
+    hash ^= hash >> 16;
+    return (hash >> 8) * (1.0f / 16777216.0f);
+}
+
+// Copy the row shifted to the right, wrapping around: output[x] = source[x - shift]
+static void CopyShiftedRow(const float* source, int width, int shift, float* output)
+{
+    shift = Wrap(shift, width);
+    std::memcpy(output + shift, source, sizeof(float) * (width - shift));
+    std::memcpy(output, source + width - shift, sizeof(float) * shift);
+}
+
+DuneSimulation::DuneSimulation(const Heightfield& heightfield, AssetLoadQueue& loadQueue, unsigned int seed, int tileSize)
+    : m_width(heightfield.GetWidth())
+    , m_height(heightfield.GetHeight())
+    , m_tileSize(tileSize)
+    , m_tileCountX(0)
+    , m_tileCountY(0)
+    , m_loadQueue(loadQueue)
+    , m_seed(seed)
+    , m_tickCount(0)
+    , m_tickRate(4.0f)
+    , m_nextTickTime(0.0f)
+    , m_texelSize(1.0f)
+    , m_windDirection(1.0f, 0.0f)
+    , m_erosion(0.002f)
+    , m_hopLength(3.0f)
+    , m_shadowAngle(15.0f)
+    , m_reposeAngle(34.0f)
+{
+    assert(!heightfield.IsEmpty());
+    assert(tileSize > 0);
+
+    m_values.reserve(static_cast<size_t>(m_width) * m_height);
+    for (int y = 0; y < m_height; ++y)
+    {
+        for (int x = 0; x < m_width; ++x)
+        {
+            m_values.push_back(heightfield.GetValue(x, y));
+        }
+    }
+    m_publishedValues = m_values;
+    for (std::vector<float>* buffer : { &m_carried, &m_nextCarried, &m_shadow, &m_nextValues })
+    {
+        buffer->resize(m_values.size(), 0.0f);
+    }
+
+    m_tileCountX = (m_width + tileSize - 1) / tileSize;
+    m_tileCountY = (m_height + tileSize - 1) / tileSize;
+    m_changedTiles.resize(static_cast<size_t>(m_tileCountX) * m_tileCountY, 0);
+}
+
+DuneSimulation::~DuneSimulation()
+{
+    // The tick uses the buffers, it has to finish first
+    if (m_runningTick.valid())
+    {
+        m_runningTick.wait();
+    }
+}
+
+void DuneSimulation::SetWind(const glm::vec2& direction, float erosion, float hopLength)
+{
+    assert(glm::length(direction) > 0.0f);
+    m_windDirection = glm::normalize(direction);
+    m_erosion = erosion;
+    m_hopLength = hopLength;
+}
+
+const std::vector<DuneSimulation::Region>& DuneSimulation::Update(float time)
+{
+    m_dirtyRegions.clear();
+
+    // Publish the tick that finished, the published values stay the same until then
+    if (m_runningTick.valid())
+    {
+        if (m_runningTick.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            return m_dirtyRegions;
+        }
+        m_runningTick.get();
+        Publish();
+    }
+
+    // Start the next tick when it is due. A slow tick delays the next ones instead of piling them up
+    if (m_tickRate > 0.0f && time >= m_nextTickTime)
+    {
+        m_nextTickTime = std::max(m_nextTickTime + 1.0f / m_tickRate, time);
+
+        std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+        m_runningTick = promise->get_future();
+        m_loadQueue.SubmitWork([this, promise, settings = GetTickSettings()]()
+            {
+                RunTick(settings);
+                promise->set_value();
+            });
+    }
+
+    return m_dirtyRegions;
+}
+
+const std::vector<DuneSimulation::Region>& DuneSimulation::Tick()
+{
+    m_dirtyRegions.clear();
+    if (m_runningTick.valid())
+    {
+        m_runningTick.get();
+        Publish();
+    }
+
+    RunTick(GetTickSettings());
+    Publish();
+    return m_dirtyRegions;
+}
+
+DuneSimulation::TickSettings DuneSimulation::GetTickSettings() const
+{
+    TickSettings settings;
+    settings.tick = m_tickCount;
+    settings.erosion = m_erosion;
+    settings.depositFraction = s_depositFraction;
+    settings.hopCount = s_hopCount;
+
+    // Each hop lands on a texel, at least one texel away
+    glm::vec2 hop = glm::round(m_windDirection * std::max(m_hopLength, 1.0f));
+    settings.hopOffset = glm::ivec2(hop);
+    if (settings.hopOffset == glm::ivec2(0))
+    {
+        settings.hopOffset = glm::abs(m_windDirection.x) > glm::abs(m_windDirection.y)
+            ? glm::ivec2(m_windDirection.x > 0.0f ? 1 : -1, 0) : glm::ivec2(0, m_windDirection.y > 0.0f ? 1 : -1);
+    }
+
+    // Texels upwind, and how much higher they can be before they shelter the texel
+    float shadowSlope = std::tan(glm::radians(m_shadowAngle)) * m_texelSize;
+    for (int step = 1; step <= s_shadowLength; ++step)
+    {
+        glm::ivec2 offset = glm::ivec2(glm::round(-m_windDirection * static_cast<float>(step)));
+        if (settings.shadowOffsets.empty() || settings.shadowOffsets.back() != offset)
+        {
+            settings.shadowOffsets.push_back(offset);
+            settings.shadowDrops.push_back(shadowSlope * glm::length(glm::vec2(offset)));
+        }
+    }
+
+    settings.reposeDifference = std::tan(glm::radians(m_reposeAngle)) * m_texelSize;
+    return settings;
+}
+
+void DuneSimulation::RunTick(const TickSettings& settings)
+{
+    // Lift the sand from the exposed texels
+    ForEachBand([&](int firstRow, int lastRow) { ErodeRows(settings, firstRow, lastRow); });
+
+    // Carry it downwind. Every hop reads where the sand was after the previous one
+    for (int hop = 1; hop <= settings.hopCount; ++hop)
+    {
+        bool lastHop = hop == settings.hopCount;
+        ForEachBand([&](int firstRow, int lastRow) { HopRows(settings, lastHop, firstRow, lastRow); });
+        m_carried.swap(m_nextCarried);
+    }
+    m_values.swap(m_nextValues);
+
+    // Let the steep slopes slide
+    for (int iteration = 0; iteration < s_avalancheIterations; ++iteration)
+    {
+        ForEachBand([&](int firstRow, int lastRow) { AvalancheRows(settings, firstRow, lastRow); });
+        m_values.swap(m_nextValues);
+    }
+
+    ForEachBand([&](int firstRow, int /*lastRow*/) { FindChangedTiles(firstRow / m_tileSize); });
+}
+
+void DuneSimulation::ErodeRows(const TickSettings& settings, int firstRow, int lastRow)
+{
+    std::vector<float> upwind(m_width);
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+        size_t rowStart = static_cast<size_t>(y) * m_width;
+        const float* values = &m_values[rowStart];
+        float* shadow = &m_shadow[rowStart];
+        std::fill(shadow, shadow + m_width, 0.0f);
+
+        // In the shadow if any texel upwind rises above the shadow slope
+        for (size_t step = 0; step < settings.shadowOffsets.size(); ++step)
+        {
+            glm::ivec2 offset = settings.shadowOffsets[step];
+            const float* sourceRow = &m_values[static_cast<size_t>(Wrap(y + offset.y, m_height)) * m_width];
+            CopyShiftedRow(sourceRow, m_width, -offset.x, upwind.data());
+
+            float drop = settings.shadowDrops[step];
+            int x = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+            const __m128 dropGroup = _mm_set1_ps(drop);
+            const __m128 one = _mm_set1_ps(1.0f);
+            for (; x + 4 <= m_width; x += 4)
+            {
+                __m128 rise = _mm_sub_ps(_mm_loadu_ps(&upwind[x]), _mm_loadu_ps(&values[x]));
+                __m128 sheltered = _mm_and_ps(_mm_cmpgt_ps(rise, dropGroup), one);
+                _mm_storeu_ps(&shadow[x], _mm_max_ps(_mm_loadu_ps(&shadow[x]), sheltered));
+            }
+#endif
+            for (; x < m_width; ++x)
+            {
+                if (upwind[x] - values[x] > drop)
+                {
+                    shadow[x] = 1.0f;
+                }
+            }
+        }
+
+        // The exposed texels lose a random amount of sand, never more than they have
+        float* nextValues = &m_nextValues[rowStart];
+        float* carried = &m_carried[rowStart];
+        for (int x = 0; x < m_width; ++x)
+        {
+            float random = Hash(m_seed, settings.tick, static_cast<uint32_t>(rowStart + x));
+            float erosion = (1.0f - shadow[x]) * std::min(settings.erosion * (0.5f + random), std::max(values[x], 0.0f));
+            nextValues[x] = values[x] - erosion;
+            carried[x] = erosion;
+        }
+    }
+}
+
+void DuneSimulation::HopRows(const TickSettings& settings, bool lastHop, int firstRow, int lastRow)
+{
+    std::vector<float> arriving(m_width);
+    float depositFraction = lastHop ? 1.0f : settings.depositFraction;
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+        // The sand arriving here comes from one hop upwind
+        size_t rowStart = static_cast<size_t>(y) * m_width;
+        const float* sourceRow = &m_carried[static_cast<size_t>(Wrap(y - settings.hopOffset.y, m_height)) * m_width];
+        CopyShiftedRow(sourceRow, m_width, settings.hopOffset.x, arriving.data());
+
+        const float* shadow = &m_shadow[rowStart];
+        float* nextValues = &m_nextValues[rowStart];
+        float* nextCarried = &m_nextCarried[rowStart];
+        int x = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128 depositGroup = _mm_set1_ps(depositFraction);
+        for (; x + 4 <= m_width; x += 4)
+        {
+            __m128 sand = _mm_loadu_ps(&arriving[x]);
+            __m128 deposited = _mm_mul_ps(sand, _mm_max_ps(_mm_loadu_ps(&shadow[x]), depositGroup));
+            _mm_storeu_ps(&nextValues[x], _mm_add_ps(_mm_loadu_ps(&nextValues[x]), deposited));
+            _mm_storeu_ps(&nextCarried[x], _mm_sub_ps(sand, deposited));
+        }
+#endif
+        for (; x < m_width; ++x)
+        {
+            float deposited = arriving[x] * std::max(shadow[x], depositFraction);
+            nextValues[x] += deposited;
+            nextCarried[x] = arriving[x] - deposited;
+        }
+    }
+}
+
+void DuneSimulation::AvalancheRows(const TickSettings& settings, int firstRow, int lastRow)
+{
+    // The row with a copy of the texel on the other side at each end, so the left and right neighbours are next to it
+    std::vector<float> paddedRow(static_cast<size_t>(m_width) + 2);
+    float repose = settings.reposeDifference;
+
+    // Sand moved from the neighbour, by the part of the difference above the angle of repose. The flow between two texels
+    // is the same with the opposite sign, seen from each of them, so no sand is lost
+    auto flow = [repose](float neighbour, float value)
+    {
+        float difference = neighbour - value;
+        return std::max(difference - repose, 0.0f) - std::max(-difference - repose, 0.0f);
+    };
+
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+        size_t rowStart = static_cast<size_t>(y) * m_width;
+        const float* values = &m_values[rowStart];
+        const float* below = &m_values[static_cast<size_t>(Wrap(y - 1, m_height)) * m_width];
+        const float* above = &m_values[static_cast<size_t>(Wrap(y + 1, m_height)) * m_width];
+        std::memcpy(&paddedRow[1], values, sizeof(float) * m_width);
+        paddedRow[0] = values[m_width - 1];
+        paddedRow[m_width + 1] = values[0];
+
+        float* nextValues = &m_nextValues[rowStart];
+        int x = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128 reposeGroup = _mm_set1_ps(repose);
+        const __m128 rateGroup = _mm_set1_ps(s_avalancheRate);
+        const __m128 zero = _mm_setzero_ps();
+        auto flowGroup = [&](__m128 neighbour, __m128 value)
+        {
+            __m128 difference = _mm_sub_ps(neighbour, value);
+            __m128 inflow = _mm_max_ps(_mm_sub_ps(difference, reposeGroup), zero);
+            __m128 outflow = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(zero, difference), reposeGroup), zero);
+            return _mm_sub_ps(inflow, outflow);
+        };
+        for (; x + 4 <= m_width; x += 4)
+        {
+            __m128 value = _mm_loadu_ps(&values[x]);
+            __m128 total = _mm_add_ps(
+                _mm_add_ps(flowGroup(_mm_loadu_ps(&paddedRow[x]), value), flowGroup(_mm_loadu_ps(&paddedRow[x + 2]), value)),
+                _mm_add_ps(flowGroup(_mm_loadu_ps(&below[x]), value), flowGroup(_mm_loadu_ps(&above[x]), value)));
+            _mm_storeu_ps(&nextValues[x], _mm_add_ps(value, _mm_mul_ps(total, rateGroup)));
+        }
+#endif
+        for (; x < m_width; ++x)
+        {
+            float value = values[x];
+            float total = (flow(paddedRow[x], value) + flow(paddedRow[x + 2], value)) + (flow(below[x], value) + flow(above[x], value));
+            nextValues[x] = value + total * s_avalancheRate;
+        }
+    }
+}
+
+void DuneSimulation::FindChangedTiles(int tileY)
+{
+    int firstRow = tileY * m_tileSize;
+    int lastRow = std::min(firstRow + m_tileSize, m_height);
+    for (int tileX = 0; tileX < m_tileCountX; ++tileX)
+    {
+        int firstColumn = tileX * m_tileSize;
+        int lastColumn = std::min(firstColumn + m_tileSize, m_width);
+        bool changed = false;
+        for (int y = firstRow; y < lastRow && !changed; ++y)
+        {
+            size_t rowStart = static_cast<size_t>(y) * m_width;
+            for (int x = firstColumn; x < lastColumn; ++x)
+            {
+                if (std::abs(m_values[rowStart + x] - m_publishedValues[rowStart + x]) > s_publishThreshold)
+                {
+                    changed = true;
+                    break;
+                }
+            }
+        }
+        m_changedTiles[static_cast<size_t>(tileY) * m_tileCountX + tileX] = changed;
+    }
+}
+
+void DuneSimulation::Publish()
+{
+    ++m_tickCount;
+
+    // Copy the changed tiles, merging the ones next to each other in the same row
+    for (int tileY = 0; tileY < m_tileCountY; ++tileY)
+    {
+        for (int tileX = 0; tileX < m_tileCountX; )
+        {
+            if (!m_changedTiles[static_cast<size_t>(tileY) * m_tileCountX + tileX])
+            {
+                ++tileX;
+                continue;
+            }
+
+            int firstTileX = tileX;
+            while (tileX < m_tileCountX && m_changedTiles[static_cast<size_t>(tileY) * m_tileCountX + tileX])
+            {
+                ++tileX;
+            }
+
+            Region region;
+            region.x = firstTileX * m_tileSize;
+            region.y = tileY * m_tileSize;
+            region.width = std::min(tileX * m_tileSize, m_width) - region.x;
+            region.height = std::min(m_tileSize, m_height - region.y);
+            for (int y = region.y; y < region.y + region.height; ++y)
+            {
+                size_t start = static_cast<size_t>(y) * m_width + region.x;
+                std::copy_n(&m_values[start], region.width, &m_publishedValues[start]);
+            }
+            m_dirtyRegions.push_back(region);
+        }
+    }
+}
+
+void DuneSimulation::ForEachBand(const std::function<void(int, int)>& function)
+{
+    m_loadQueue.ParallelFor(m_tileCountY, [&](unsigned int tileY)
+        {
+            int firstRow = static_cast<int>(tileY) * m_tileSize;
+            function(firstRow, std::min(firstRow + m_tileSize, m_height));
+        });
+}
@@ -0,0 +1,295 @@
+#include <ituGL/geometry/Heightfield.h>
+
+#include <ituGL/texture/TextureBlockCompressor.h>
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Same as Ease in depthMapUtils.glsl, they must be kept in sync. GetHeightRange expects it to keep the order of the values
+static float Ease(float value)
+{
+    return value;
+}
+
+Heightfield::Heightfield() : m_width(0), m_height(0), m_minValue(0.0f), m_maxValue(0.0f)
+{
+}
+
+bool Heightfield::Initialize(const TextureCache::CachedTexture& cachedTexture)
+{
+    if (cachedTexture.levels.empty() || cachedTexture.format != TextureObject::FormatR)
+    {
+        std::cout << "ERROR::HEIGHTFIELD::UNSUPPORTED_FORMAT" << std::endl;
+        return false;
+    }
+
+    int width = cachedTexture.width;
+    int height = cachedTexture.height;
+    std::span<const std::byte> data = cachedTexture.levels[0];
+    if (cachedTexture.internalFormat == TextureObject::InternalFormatBC4)
+    {
+        m_width = width;
+        m_height = height;
+        m_values.resize(static_cast<size_t>(width) * height);
+        TextureBlockCompressor::DecompressBC4(data, width, height, m_values);
+        auto range = std::minmax_element(m_values.begin(), m_values.end());
+        m_minValue = *range.first;
+        m_maxValue = *range.second;
+    }
+    else if (cachedTexture.dataType == Data::Type::UByte)
+    {
+        Initialize(std::span(reinterpret_cast<const unsigned char*>(data.data()), data.size_bytes()), width, height);
+    }
+    else
+    {
+        std::cout << "ERROR::HEIGHTFIELD::UNSUPPORTED_FORMAT" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Heightfield::Initialize(std::span<const unsigned char> data, int width, int height)
+{
+    assert(data.size() == static_cast<size_t>(width) * height);
+
+    m_width = width;
+    m_height = height;
+    m_values.resize(data.size());
+    std::transform(data.begin(), data.end(), m_values.begin(), [](unsigned char value) { return value / 255.0f; });
+    auto range = std::minmax_element(m_values.begin(), m_values.end());
+    m_minValue = *range.first;
+    m_maxValue = *range.second;
+}
+
+void Heightfield::SetValue(int x, int y, float value)
+{
+    assert(x >= 0 && x < m_width && y >= 0 && y < m_height);
+
+    m_values[static_cast<size_t>(y) * m_width + x] = value;
+    m_minValue = std::min(m_minValue, value);
+    m_maxValue = std::max(m_maxValue, value);
+}
+
+float Heightfield::Sample(const glm::vec2& uv) const
+{
+    float value;
+    Sample(std::span(&uv, 1), std::span(&value, 1));
+    return value;
+}
+
+float Heightfield::GetHeight(const glm::vec2& uv, float sampleDistance, float offsetStrength) const
+{
+    float height;
+    GetHeights(std::span(&uv, 1), sampleDistance, offsetStrength, std::span(&height, 1));
+    return height;
+}
+
+void Heightfield::GetTangentSpace(const glm::vec2& uv, float sampleDistance, float offsetStrength,
+    glm::vec3& tangent, glm::vec3& bitangent, glm::vec3& normal) const
+{
+    GetTangentSpaces(std::span(&uv, 1), sampleDistance, offsetStrength,
+        std::span(&tangent, 1), std::span(&bitangent, 1), std::span(&normal, 1));
+}
+
+void Heightfield::Sample(std::span<const glm::vec2> uvs, std::span<float> values) const
+{
+    assert(values.size() == uvs.size());
+
+    for (size_t first = 0; first < uvs.size(); first += 4)
+    {
+        size_t count = std::min<size_t>(4, uvs.size() - first);
+        float u[4], v[4], samples[4];
+        for (size_t i = 0; i < 4; ++i)
+        {
+            // Missing points at the end repeat the last one
+            const glm::vec2& uv = uvs[first + std::min(i, count - 1)];
+            u[i] = uv.x;
+            v[i] = uv.y;
+        }
+        Sample4(u, v, samples);
+        std::copy(samples, samples + count, values.begin() + first);
+    }
+}
+
+void Heightfield::GetHeights(std::span<const glm::vec2> uvs, float sampleDistance, float offsetStrength, std::span<float> heights) const
+{
+    assert(heights.size() == uvs.size());
+
+    // The center and the 4 neighbours averaged by GetHeightFromSample, in the same order
+    const glm::vec2 directions[5] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(-1, 0), glm::vec2(0, 1), glm::vec2(0, -1) };
+
+    for (size_t first = 0; first < uvs.size(); first += 4)
+    {
+        size_t count = std::min<size_t>(4, uvs.size() - first);
+        float samples[5][4];
+        for (int tap = 0; tap < 5; ++tap)
+        {
+            float u[4], v[4];
+            for (size_t i = 0; i < 4; ++i)
+            {
+                glm::vec2 uv = uvs[first + std::min(i, count - 1)] + directions[tap] * sampleDistance;
+                u[i] = uv.x;
+                v[i] = uv.y;
+            }
+            Sample4(u, v, samples[tap]);
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            float depthSample = (samples[0][i] + samples[1][i] + samples[2][i] + samples[3][i] + samples[4][i]) / 5;
+            heights[first + i] = Ease(depthSample * offsetStrength);
+        }
+    }
+}
+
+void Heightfield::GetTangentSpaces(std::span<const glm::vec2> uvs, float sampleDistance, float offsetStrength,
+    std::span<glm::vec3> tangents, std::span<glm::vec3> bitangents, std::span<glm::vec3> normals) const
+{
+    assert(tangents.size() == uvs.size() && bitangents.size() == uvs.size() && normals.size() == uvs.size());
+
+    for (size_t first = 0; first < uvs.size(); first += 4)
+    {
+        size_t count = std::min<size_t>(4, uvs.size() - first);
+
+        // North, south, east and west, clamped to the texture like GetTangentSpaceVectorsFromSample does
+        glm::vec2 tapUVs[4][4];
+        for (size_t i = 0; i < 4; ++i)
+        {
+            glm::vec2 uv = uvs[first + std::min(i, count - 1)];
+            tapUVs[0][i] = glm::min(uv + glm::vec2(0, 1) * sampleDistance, glm::vec2(1, 1));
+            tapUVs[1][i] = glm::max(uv + glm::vec2(0, -1) * sampleDistance, glm::vec2(0, 0));
+            tapUVs[2][i] = glm::min(uv + glm::vec2(1, 0) * sampleDistance, glm::vec2(1, 1));
+            tapUVs[3][i] = glm::max(uv + glm::vec2(-1, 0) * sampleDistance, glm::vec2(0, 0));
+        }
+
+        float samples[4][4];
+        for (int tap = 0; tap < 4; ++tap)
+        {
+            float u[4], v[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                u[i] = tapUVs[tap][i].x;
+                v[i] = tapUVs[tap][i].y;
+            }
+            Sample4(u, v, samples[tap]);
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const glm::vec2& northUV = tapUVs[0][i];
+            const glm::vec2& southUV = tapUVs[1][i];
+            const glm::vec2& eastUV = tapUVs[2][i];
+            const glm::vec2& westUV = tapUVs[3][i];
+            float depthSampleNorth = Ease(samples[0][i]);
+            float depthSampleSouth = Ease(samples[1][i]);
+            float depthSampleEast = Ease(samples[2][i]);
+            float depthSampleWest = Ease(samples[3][i]);
+
+            float deltaX = (depthSampleEast - depthSampleWest) / (eastUV.x - westUV.x);
+            float deltaY = (depthSampleNorth - depthSampleSouth) / (northUV.y - southUV.y);
+
+            glm::vec3 normal = glm::normalize(glm::vec3(-deltaX, 1 / (sampleDistance * sampleDistance + 0.1f) + offsetStrength, -deltaY));
+            glm::vec3 tangent = glm::normalize(glm::vec3(northUV.x, depthSampleNorth, northUV.y) - glm::vec3(southUV.x, depthSampleNorth, southUV.y));
+            normals[first + i] = normal;
+            tangents[first + i] = tangent;
+            bitangents[first + i] = glm::normalize(glm::cross(normal, tangent));
+        }
+    }
+}
+
+void Heightfield::GetHeightRange(float offsetStrength, float& minHeight, float& maxHeight) const
+{
+    // Filtered and averaged values never leave the range of the texels
+    float height0 = Ease(m_minValue * offsetStrength);
+    float height1 = Ease(m_maxValue * offsetStrength);
+    minHeight = std::min(height0, height1);
+    maxHeight = std::max(height0, height1);
+}
+
+void Heightfield::Sample4(const float u[4], const float v[4], float values[4]) const
+{
+    assert(!IsEmpty());
+
+    // Coordinates in texels, with the texel centers on the integers. Both texels of each axis are clamped to the edge.
+    // Past one texel out of the map, both are the edge texel, so the coordinates are clamped there first. Further away,
+    // they would be out of the int range of the conversions
+    int x0[4], x1[4], y0[4], y1[4];
+    float fractionX[4], fractionY[4];
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    const __m128 width = _mm_set1_ps(static_cast<float>(m_width));
+    const __m128 height = _mm_set1_ps(static_cast<float>(m_height));
+    const __m128 maxX = _mm_set1_ps(static_cast<float>(m_width - 1));
+    const __m128 maxY = _mm_set1_ps(static_cast<float>(m_height - 1));
+
+    __m128 x = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(u), width), half);
+    __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(v), height), half);
+    x = _mm_min_ps(_mm_max_ps(x, minusOne), width);
+    y = _mm_min_ps(_mm_max_ps(y, minusOne), height);
+
+    // SSE2 has no floor: truncate, then step down the values that were rounded up
+    __m128 floorX = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    __m128 floorY = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+    floorX = _mm_sub_ps(floorX, _mm_and_ps(_mm_cmpgt_ps(floorX, x), one));
+    floorY = _mm_sub_ps(floorY, _mm_and_ps(_mm_cmpgt_ps(floorY, y), one));
+    _mm_storeu_ps(fractionX, _mm_sub_ps(x, floorX));
+    _mm_storeu_ps(fractionY, _mm_sub_ps(y, floorY));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(x0), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(floorX, zero), maxX)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(x1), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(floorX, one), zero), maxX)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y0), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(floorY, zero), maxY)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y1), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(floorY, one), zero), maxY)));
+#else
+    for (int i = 0; i < 4; ++i)
+    {
+        float x = std::clamp(u[i] * static_cast<float>(m_width) - 0.5f, -1.0f, static_cast<float>(m_width));
+        float y = std::clamp(v[i] * static_cast<float>(m_height) - 0.5f, -1.0f, static_cast<float>(m_height));
+        float floorX = std::floor(x);
+        float floorY = std::floor(y);
+        fractionX[i] = x - floorX;
+        fractionY[i] = y - floorY;
+        x0[i] = static_cast<int>(std::clamp(floorX, 0.0f, static_cast<float>(m_width - 1)));
+        x1[i] = static_cast<int>(std::clamp(floorX + 1.0f, 0.0f, static_cast<float>(m_width - 1)));
+        y0[i] = static_cast<int>(std::clamp(floorY, 0.0f, static_cast<float>(m_height - 1)));
+        y1[i] = static_cast<int>(std::clamp(floorY + 1.0f, 0.0f, static_cast<float>(m_height - 1)));
+    }
+#endif
+
+    // There is no gather in SSE2, the texels are read one by one
+    float texel00[4], texel10[4], texel01[4], texel11[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        const float* row0 = &m_values[static_cast<size_t>(y0[i]) * m_width];
+        const float* row1 = &m_values[static_cast<size_t>(y1[i]) * m_width];
+        texel00[i] = row0[x0[i]];
+        texel10[i] = row0[x1[i]];
+        texel01[i] = row1[x0[i]];
+        texel11[i] = row1[x1[i]];
+    }
+
+    // Interpolate along x, then along y
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128 weightX = _mm_loadu_ps(fractionX);
+    __m128 weightY = _mm_loadu_ps(fractionY);
+    __m128 bottom = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(texel00), _mm_sub_ps(one, weightX)), _mm_mul_ps(_mm_loadu_ps(texel10), weightX));
+    __m128 top = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(texel01), _mm_sub_ps(one, weightX)), _mm_mul_ps(_mm_loadu_ps(texel11), weightX));
+    _mm_storeu_ps(values, _mm_add_ps(_mm_mul_ps(bottom, _mm_sub_ps(one, weightY)), _mm_mul_ps(top, weightY)));
+#else
+    for (int i = 0; i < 4; ++i)
+    {
+        float bottom = texel00[i] * (1.0f - fractionX[i]) + texel10[i] * fractionX[i];
+        float top = texel01[i] * (1.0f - fractionX[i]) + texel11[i] * fractionX[i];
+        values[i] = bottom * (1.0f - fractionY[i]) + top * fractionY[i];
+    }
+#endif
+}
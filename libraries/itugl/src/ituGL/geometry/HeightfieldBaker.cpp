@@ -0,0 +1,188 @@
+#include <ituGL/geometry/HeightfieldBaker.h>
+
+#include <ituGL/geometry/Heightfield.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <cassert>
+
+HeightfieldBaker::HeightfieldBaker(std::shared_ptr<const Heightfield> heightfield, AssetLoadQueue& loadQueue, BakedFunction bakedFunction)
+    : m_heightfield(heightfield)
+    , m_loadQueue(loadQueue)
+    , m_bakedFunction(bakedFunction)
+    , m_sampleDistance(0.0f)
+    , m_offsetStrength(0.0f)
+    , m_bakePending(false)
+    , m_generation(std::make_shared<std::atomic<unsigned int>>(0))
+{
+    assert(m_heightfield && !m_heightfield->IsEmpty());
+}
+
+void HeightfieldBaker::Bake(float sampleDistance, float offsetStrength)
+{
+    unsigned int generation = ++*m_generation;
+
+    // The map keeps changing on this thread while the workers read it, so they bake a copy.
+    // The regions changed after this point are recorded by UpdateRegion and baked again before publishing
+    std::shared_ptr<const Heightfield> snapshot = std::make_shared<const Heightfield>(*m_heightfield);
+    m_bakePending = true;
+    m_pendingRegions.clear();
+
+    int width = snapshot->GetWidth();
+    int height = snapshot->GetHeight();
+
+    // A few bands per worker, so the ones that start late still finish together
+    int bandCount = std::max(static_cast<int>(m_loadQueue.GetWorkerCount()), 1) * 4;
+    int bandRows = std::max((height + bandCount - 1) / bandCount, 1);
+    bandCount = (height + bandRows - 1) / bandRows;
+
+    std::shared_ptr<std::vector<uint64_t>> data = std::make_shared<std::vector<uint64_t>>(static_cast<size_t>(width) * height);
+    std::shared_ptr<std::atomic<int>> remainingBands = std::make_shared<std::atomic<int>>(bandCount);
+    for (int firstRow = 0; firstRow < height; firstRow += bandRows)
+    {
+        int rowCount = std::min(bandRows, height - firstRow);
+        m_loadQueue.SubmitWork([=, this, latestGeneration = m_generation, bakedFunction = m_bakedFunction, &loadQueue = m_loadQueue]()
+            {
+                // Skip the bands of a bake that was replaced
+                if (*latestGeneration != generation)
+                {
+                    return;
+                }
+
+                std::span<uint64_t> output = std::span(*data).subspan(static_cast<size_t>(firstRow) * width, static_cast<size_t>(rowCount) * width);
+                BakeRegion(*snapshot, sampleDistance, offsetStrength, 0, firstRow, width, rowCount, output);
+
+                // The last band uploads the texture
+                if (--*remainingBands == 0)
+                {
+                    std::shared_ptr<std::shared_ptr<Texture2DObject>> texture = std::make_shared<std::shared_ptr<Texture2DObject>>();
+                    loadQueue.SubmitUpload([=]()
+                        {
+                            *texture = CreateTexture(width, height, *data);
+                        },
+                        [=, this]()
+                        {
+                            if (*latestGeneration == generation)
+                            {
+                                m_texture = *texture;
+                                m_sampleDistance = sampleDistance;
+                                m_offsetStrength = offsetStrength;
+
+                                // Catch up with the changes to the map that the snapshot missed
+                                m_bakePending = false;
+                                for (const glm::ivec4& region : m_pendingRegions)
+                                {
+                                    UpdateRegion(region.x, region.y, region.z, region.w);
+                                }
+                                m_pendingRegions.clear();
+
+                                bakedFunction(*texture);
+                            }
+                        });
+                }
+            });
+    }
+}
+
+void HeightfieldBaker::BakeNow(float sampleDistance, float offsetStrength)
+{
+    // Abandon the bakes that are still running
+    ++*m_generation;
+    m_bakePending = false;
+    m_pendingRegions.clear();
+    m_sampleDistance = sampleDistance;
+    m_offsetStrength = offsetStrength;
+
+    int width = m_heightfield->GetWidth();
+    int height = m_heightfield->GetHeight();
+    std::vector<uint64_t> data(static_cast<size_t>(width) * height);
+    BakeRegion(*m_heightfield, sampleDistance, offsetStrength, 0, 0, width, height, data);
+    m_texture = CreateTexture(width, height, data);
+    m_bakedFunction(m_texture);
+}
+
+void HeightfieldBaker::UpdateRegion(int x, int y, int width, int height)
+{
+    // The bake in progress doesn't see this change, it has to be applied again to its texture
+    if (m_bakePending)
+    {
+        m_pendingRegions.emplace_back(x, y, width, height);
+    }
+
+    if (!m_texture)
+    {
+        return;
+    }
+
+    // The filters of the shader functions reach texels up to the sample distance away, and the bilinear filter one more
+    int mapWidth = m_heightfield->GetWidth();
+    int mapHeight = m_heightfield->GetHeight();
+    int reachX = static_cast<int>(std::ceil(m_sampleDistance * mapWidth)) + 1;
+    int reachY = static_cast<int>(std::ceil(m_sampleDistance * mapHeight)) + 1;
+    int minX = std::max(x - reachX, 0);
+    int minY = std::max(y - reachY, 0);
+    int maxX = std::min(x + width + reachX, mapWidth);
+    int maxY = std::min(y + height + reachY, mapHeight);
+    if (minX >= maxX || minY >= maxY)
+    {
+        return;
+    }
+
+    m_regionData.resize(static_cast<size_t>(maxX - minX) * (maxY - minY));
+    BakeRegion(*m_heightfield, m_sampleDistance, m_offsetStrength, minX, minY, maxX - minX, maxY - minY, m_regionData);
+
+    m_texture->Bind();
+    m_texture->SetSubImage<std::byte>(0, minX, minY, maxX - minX, maxY - minY, TextureObject::FormatRGBA,
+        std::as_bytes(std::span(m_regionData)), Data::Type::Half);
+    m_texture->Unbind();
+}
+
+void HeightfieldBaker::BakeRegion(const Heightfield& heightfield, float sampleDistance, float offsetStrength,
+    int x, int y, int width, int height, std::span<uint64_t> output)
+{
+    assert(x >= 0 && y >= 0 && x + width <= heightfield.GetWidth() && y + height <= heightfield.GetHeight());
+    assert(output.size() == static_cast<size_t>(width) * height);
+
+    // A row at a time through the batched queries, most groups of 4 points are full
+    std::vector<glm::vec2> uvs(width);
+    std::vector<float> heights(width);
+    std::vector<glm::vec3> tangents(width), bitangents(width), normals(width);
+    for (int row = 0; row < height; ++row)
+    {
+        // Texel centers
+        float v = (y + row + 0.5f) / heightfield.GetHeight();
+        for (int column = 0; column < width; ++column)
+        {
+            uvs[column] = glm::vec2((x + column + 0.5f) / heightfield.GetWidth(), v);
+        }
+
+        heightfield.GetHeights(uvs, sampleDistance, offsetStrength, heights);
+        heightfield.GetTangentSpaces(uvs, sampleDistance, offsetStrength, tangents, bitangents, normals);
+
+        uint64_t* rowOutput = &output[static_cast<size_t>(row) * width];
+        for (int column = 0; column < width; ++column)
+        {
+            rowOutput[column] = glm::packHalf4x16(glm::vec4(heights[column], normals[column]));
+        }
+    }
+}
+
+std::shared_ptr<Texture2DObject> HeightfieldBaker::CreateTexture(int width, int height, std::span<const uint64_t> data)
+{
+    assert(data.size() == static_cast<size_t>(width) * height);
+
+    std::shared_ptr<Texture2DObject> texture = std::make_shared<Texture2DObject>();
+    texture->Bind();
+    texture->SetImage<std::byte>(0, width, height, TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA16F,
+        std::as_bytes(data), Data::Type::Half);
+
+    // Only the full size level, sampled from the vertex shaders
+    texture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR);
+    texture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+    texture->SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+    texture->SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+    texture->Unbind();
+    return texture;
+}
@@ -0,0 +1,214 @@
+#include <ituGL/geometry/HeightfieldDeformer.h>
+
+#include <ituGL/geometry/Heightfield.h>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+HeightfieldDeformer::HeightfieldDeformer(std::shared_ptr<Heightfield> heightfield, float relaxTime, float slotDuration, int tileSize)
+    : m_heightfield(heightfield)
+    , m_relaxTime(relaxTime)
+    , m_slotDuration(slotDuration)
+    , m_tileSize(tileSize)
+    , m_tileCountX(0)
+    , m_tileCountY(0)
+    , m_currentSequence(0)
+    , m_updateCount(0)
+    , m_time(0.0f)
+{
+    assert(m_heightfield && !m_heightfield->IsEmpty());
+    assert(relaxTime > 0.0f && slotDuration > 0.0f && tileSize > 0);
+
+    int width = m_heightfield->GetWidth();
+    int height = m_heightfield->GetHeight();
+    m_originalValues.reserve(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            m_originalValues.push_back(m_heightfield->GetValue(x, y));
+        }
+    }
+    m_stampDepths.resize(m_originalValues.size(), 0.0f);
+    m_stampTimes.resize(m_originalValues.size(), 0.0f);
+
+    m_tileCountX = (width + tileSize - 1) / tileSize;
+    m_tileCountY = (height + tileSize - 1) / tileSize;
+    m_tileSequences.resize(static_cast<size_t>(m_tileCountX) * m_tileCountY, -1);
+    m_tileUpdates.resize(m_tileSequences.size(), 0);
+
+    // A tile stays in the ring at least the relax time after its last stamp, even if it was at the start of its slot
+    int slotCount = static_cast<int>(std::ceil(relaxTime / slotDuration)) + 1;
+    m_slots.resize(slotCount);
+    m_currentSequence = GetSlotSequence(m_time);
+}
+
+void HeightfieldDeformer::Stamp(const glm::vec2& uv, float radius, float depth)
+{
+    int width = m_heightfield->GetWidth();
+    int height = m_heightfield->GetHeight();
+
+    // Footprint in texels, with the texel centers on the integers
+    float centerX = uv.x * width - 0.5f;
+    float centerY = uv.y * height - 0.5f;
+    float radiusX = radius * width;
+    float radiusY = radius * height;
+    if (radiusX <= 0.0f || radiusY <= 0.0f || depth <= 0.0f)
+    {
+        return;
+    }
+    int minX = std::max(static_cast<int>(std::floor(centerX - radiusX)), 0);
+    int minY = std::max(static_cast<int>(std::floor(centerY - radiusY)), 0);
+    int maxX = std::min(static_cast<int>(std::ceil(centerX + radiusX)), width - 1);
+    int maxY = std::min(static_cast<int>(std::ceil(centerY + radiusY)), height - 1);
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            float dx = (x - centerX) / radiusX;
+            float dy = (y - centerY) / radiusY;
+            float distanceSquared = dx * dx + dy * dy;
+            if (distanceSquared >= 1.0f)
+            {
+                continue;
+            }
+
+            // Smooth rim, deepest in the center
+            float falloff = 1.0f - distanceSquared;
+            float stampDepth = depth * falloff * falloff;
+
+            size_t index = static_cast<size_t>(y) * width + x;
+            float relax = std::max(1.0f - (m_time - m_stampTimes[index]) / m_relaxTime, 0.0f);
+            if (stampDepth > m_stampDepths[index] * relax)
+            {
+                m_stampDepths[index] = stampDepth;
+                m_stampTimes[index] = m_time;
+            }
+        }
+    }
+
+    for (int tileY = minY / m_tileSize; tileY <= maxY / m_tileSize; ++tileY)
+    {
+        for (int tileX = minX / m_tileSize; tileX <= maxX / m_tileSize; ++tileX)
+        {
+            AddTileToHistory(tileY * m_tileCountX + tileX);
+        }
+    }
+}
+
+void HeightfieldDeformer::SetOriginalValue(int x, int y, float value)
+{
+    size_t index = static_cast<size_t>(y) * m_heightfield->GetWidth() + x;
+    m_originalValues[index] = value;
+
+    float relax = std::max(1.0f - (m_time - m_stampTimes[index]) / m_relaxTime, 0.0f);
+    m_heightfield->SetValue(x, y, value - m_stampDepths[index] * relax);
+}
+
+const std::vector<HeightfieldDeformer::Region>& HeightfieldDeformer::Update(float time)
+{
+    m_time = time;
+    m_dirtyRegions.clear();
+    ++m_updateCount;
+
+    std::vector<int> tiles;
+    auto updateTile = [&](int tileIndex)
+    {
+        if (m_tileUpdates[tileIndex] != m_updateCount)
+        {
+            m_tileUpdates[tileIndex] = m_updateCount;
+            UpdateTile(tileIndex);
+            tiles.push_back(tileIndex);
+        }
+    };
+
+    // The slots that leave the ring get a last update, where their tracks are completely relaxed.
+    // Tiles stamped again later are still in a newer slot
+    int64_t slotCount = static_cast<int64_t>(m_slots.size());
+    int64_t sequence = GetSlotSequence(time);
+    int64_t firstRecycled = std::max(m_currentSequence + 1, sequence - slotCount + 1);
+    for (int64_t recycled = firstRecycled; recycled <= sequence; ++recycled)
+    {
+        std::vector<int>& slot = m_slots[recycled % slotCount];
+        for (int tileIndex : slot)
+        {
+            updateTile(tileIndex);
+        }
+        slot.clear();
+    }
+    m_currentSequence = std::max(m_currentSequence, sequence);
+
+    // Tiles with tracks that are still relaxing
+    for (const std::vector<int>& slot : m_slots)
+    {
+        for (int tileIndex : slot)
+        {
+            updateTile(tileIndex);
+        }
+    }
+
+    // Merge the tiles next to each other in the same row
+    std::sort(tiles.begin(), tiles.end());
+    int width = m_heightfield->GetWidth();
+    int height = m_heightfield->GetHeight();
+    for (size_t i = 0; i < tiles.size(); )
+    {
+        int tileY = tiles[i] / m_tileCountX;
+        int firstTileX = tiles[i] % m_tileCountX;
+        size_t end = i + 1;
+        while (end < tiles.size() && tiles[end] == tiles[end - 1] + 1 && tiles[end] / m_tileCountX == tileY)
+        {
+            ++end;
+        }
+        int x = firstTileX * m_tileSize;
+        int y = tileY * m_tileSize;
+        int regionWidth = std::min(static_cast<int>(end - i) * m_tileSize, width - x);
+        int regionHeight = std::min(m_tileSize, height - y);
+        m_dirtyRegions.push_back(Region{ x, y, regionWidth, regionHeight });
+        i = end;
+    }
+
+    return m_dirtyRegions;
+}
+
+void HeightfieldDeformer::UpdateTile(int tileIndex)
+{
+    int width = m_heightfield->GetWidth();
+    int height = m_heightfield->GetHeight();
+    int minX = (tileIndex % m_tileCountX) * m_tileSize;
+    int minY = (tileIndex / m_tileCountX) * m_tileSize;
+    int maxX = std::min(minX + m_tileSize, width);
+    int maxY = std::min(minY + m_tileSize, height);
+    for (int y = minY; y < maxY; ++y)
+    {
+        for (int x = minX; x < maxX; ++x)
+        {
+            size_t index = static_cast<size_t>(y) * width + x;
+            float relax = std::max(1.0f - (m_time - m_stampTimes[index]) / m_relaxTime, 0.0f);
+            if (relax == 0.0f)
+            {
+                m_stampDepths[index] = 0.0f;
+            }
+            m_heightfield->SetValue(x, y, m_originalValues[index] - m_stampDepths[index] * relax);
+        }
+    }
+}
+
+void HeightfieldDeformer::AddTileToHistory(int tileIndex)
+{
+    if (m_tileSequences[tileIndex] != m_currentSequence)
+    {
+        m_tileSequences[tileIndex] = m_currentSequence;
+        m_slots[m_currentSequence % static_cast<int64_t>(m_slots.size())].push_back(tileIndex);
+    }
+}
+
+int64_t HeightfieldDeformer::GetSlotSequence(float time) const
+{
+    return static_cast<int64_t>(std::floor(time / m_slotDuration));
+}
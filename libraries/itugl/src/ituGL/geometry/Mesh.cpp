@@ -1,5 +1,8 @@
 #include <ituGL/geometry/Mesh.h>
 
+#include <algorithm>
+#include <cassert>
+
 Mesh::Mesh()
 {
 }
@@ -17,9 +20,40 @@ unsigned int Mesh::AddVertexArray()
 {
     unsigned int vaoIndex = GetVertexArrayCount();
     m_vaos.emplace_back();
+    m_vertexArrayStates.emplace_back();
     return vaoIndex;
 }
 
+void Mesh::AddVertexArrayAttribute(unsigned int vaoIndex, unsigned int vboIndex, const VertexAttribute::Layout& attributeLayout, GLuint location)
+{
+    VertexArrayObject& vao = GetVertexArray(vaoIndex);
+    vao.Bind();
+
+    const VertexBufferObject& vbo = GetVertexBuffer(vboIndex);
+    vbo.Bind();
+    vao.SetAttribute(location, attributeLayout.GetAttribute(), attributeLayout.GetOffset(), attributeLayout.GetStride());
+    m_vertexArrayStates[vaoIndex].attributes.push_back({ vboIndex, attributeLayout, location, 0 });
+
+    VertexBufferObject::Unbind();
+    VertexArrayObject::Unbind();
+}
+
+void Mesh::SetVertexArrayDivisor(unsigned int vaoIndex, GLuint location, GLuint divisor)
+{
+    VertexArrayObject& vao = GetVertexArray(vaoIndex);
+    vao.Bind();
+    vao.SetAttributeDivisor(location, divisor);
+    VertexArrayObject::Unbind();
+
+    for (VertexArrayAttribute& attribute : m_vertexArrayStates[vaoIndex].attributes)
+    {
+        if (attribute.location == location)
+        {
+            attribute.divisor = divisor;
+        }
+    }
+}
+
 unsigned int Mesh::AddSubmesh(unsigned int vaoIndex, const Drawcall& drawcall)
 {
     unsigned int submeshIndex = GetSubmeshCount();
@@ -35,6 +69,83 @@ unsigned int Mesh::AddSubmesh(unsigned int vaoIndex,
     return AddSubmesh(vaoIndex, Drawcall(primitive, count, eboType, first));
 }
 
+void Mesh::AddSharedSubmeshes(std::shared_ptr<const Mesh> mesh)
+{
+    assert(mesh && mesh.get() != this);
+    assert(mesh->m_sharedMeshes.empty());
+
+    // Same attributes and EBO in new VAOs, read from the buffers of the other mesh
+    unsigned int firstVaoIndex = GetVertexArrayCount();
+    for (const VertexArrayState& state : mesh->m_vertexArrayStates)
+    {
+        VertexArrayObject& vao = GetVertexArray(AddVertexArray());
+        vao.Bind();
+        for (const VertexArrayAttribute& attribute : state.attributes)
+        {
+            mesh->GetVertexBuffer(attribute.vboIndex).Bind();
+            vao.SetAttribute(attribute.location, attribute.layout.GetAttribute(), attribute.layout.GetOffset(), attribute.layout.GetStride());
+            if (attribute.divisor != 0)
+            {
+                vao.SetAttributeDivisor(attribute.location, attribute.divisor);
+            }
+        }
+        if (state.eboIndex >= 0)
+        {
+            mesh->GetElementBuffer(static_cast<unsigned int>(state.eboIndex)).Bind();
+        }
+        VertexArrayObject::Unbind();
+        VertexBufferObject::Unbind();
+        ElementBufferObject::Unbind();
+    }
+
+    for (const Submesh& submesh : mesh->m_submeshes)
+    {
+        Submesh& sharedSubmesh = m_submeshes.emplace_back(submesh);
+        sharedSubmesh.vaoIndex += firstVaoIndex;
+    }
+
+    m_sharedMeshes.push_back(mesh);
+}
+
+void Mesh::SetSubmeshInstanceCount(unsigned int submeshIndex, GLsizei instanceCount)
+{
+    Submesh& submesh = GetSubmesh(submeshIndex);
+    submesh.drawcall.SetInstanceCount(instanceCount);
+    for (Drawcall& lod : submesh.lods)
+    {
+        lod.SetInstanceCount(instanceCount);
+    }
+}
+
+void Mesh::AddSubmeshLod(unsigned int submeshIndex, const Drawcall& drawcall)
+{
+    GetSubmesh(submeshIndex).lods.push_back(drawcall);
+}
+
+const Drawcall& Mesh::GetSubmeshDrawcall(unsigned int submeshIndex, unsigned int lod) const
+{
+    const Submesh& submesh = GetSubmesh(submeshIndex);
+    if (lod == 0 || submesh.lods.empty())
+    {
+        return submesh.drawcall;
+    }
+    return submesh.lods[std::min(lod, static_cast<unsigned int>(submesh.lods.size())) - 1];
+}
+
+size_t Mesh::GetBufferSize() const
+{
+    size_t size = 0;
+    for (const VertexBufferObject& vbo : m_vbos)
+    {
+        size += vbo.GetSize();
+    }
+    for (const ElementBufferObject& ebo : m_ebos)
+    {
+        size += ebo.GetSize();
+    }
+    return size;
+}
+
 // Bind the VAO and render the drawcall of the submesh
 void Mesh::DrawSubmesh(int submeshIndex) const
 {
@@ -45,8 +156,9 @@ void Mesh::DrawSubmesh(int submeshIndex) const
     //VertexArrayObject::Unbind(); // No need to unbind
 }
 
-void Mesh::SetupVertexAttribute(VertexArrayObject& vao, const VertexAttribute::Layout& attributeLayout, GLuint& location, const SemanticMap& locations)
+void Mesh::SetupVertexAttribute(unsigned int vaoIndex, unsigned int vboIndex, const VertexAttribute::Layout& attributeLayout, GLuint& location, const SemanticMap& locations)
 {
+    VertexArrayObject& vao = GetVertexArray(vaoIndex);
     const VertexAttribute& attribute = attributeLayout.GetAttribute();
 
     auto itLocation = locations.find(attribute.GetSemantic());
@@ -56,5 +168,6 @@ void Mesh::SetupVertexAttribute(VertexArrayObject& vao, const VertexAttribute::L
     }
 
     vao.SetAttribute(location, attribute, attributeLayout.GetOffset(), attributeLayout.GetStride());
+    m_vertexArrayStates[vaoIndex].attributes.push_back({ vboIndex, attributeLayout, location, 0 });
     location += attribute.GetLocationSize();
 }
@@ -0,0 +1,346 @@
+#include <ituGL/geometry/MeshOptimizer.h>
+
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+// Parameters of the vertex scores, from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static constexpr int s_scoreCacheSize = 32;
+static constexpr float s_cacheDecayPower = 1.5f;
+static constexpr float s_lastTriangleScore = 0.75f;
+static constexpr float s_valenceBoostScale = 2.0f;
+static constexpr float s_valenceBoostPower = 0.5f;
+
+// Vertices in the cache score higher, and so do vertices with few triangles left, to finish them before they are evicted
+static float GetVertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // Vertices of the last triangle get a fixed score, so the next one doesn't just reuse the same edge
+            score = s_lastTriangleScore;
+        }
+        else
+        {
+            float scaler = 1.0f / (s_scoreCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, s_cacheDecayPower);
+        }
+    }
+    score += s_valenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -s_valenceBoostPower);
+    return score;
+}
+
+// Number of vertices transformed by each triangle, with a FIFO cache
+static std::vector<int> SimulateVertexCache(std::span<const uint32_t> indices, size_t vertexCount, int cacheSize)
+{
+    std::vector<int> triangleMisses(indices.size() / 3, 0);
+
+    // A vertex is in the cache if fewer than cacheSize vertices were added after it
+    std::vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        uint32_t vertex = indices[i];
+        if (time - timestamps[vertex] > static_cast<unsigned int>(cacheSize))
+        {
+            timestamps[vertex] = time++;
+            ++triangleMisses[i / 3];
+        }
+    }
+    return triangleMisses;
+}
+
+MeshOptimizer::Statistics MeshOptimizer::AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, int cacheSize)
+{
+    Statistics statistics;
+    if (indices.empty())
+    {
+        return statistics;
+    }
+
+    std::vector<int> triangleMisses = SimulateVertexCache(indices, vertexCount, cacheSize);
+    int misses = std::accumulate(triangleMisses.begin(), triangleMisses.end(), 0);
+
+    std::vector<bool> usedVertices(vertexCount, false);
+    for (uint32_t vertex : indices)
+    {
+        usedVertices[vertex] = true;
+    }
+    size_t usedVertexCount = std::count(usedVertices.begin(), usedVertices.end(), true);
+
+    statistics.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    statistics.atvr = static_cast<float>(misses) / usedVertexCount;
+    return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount)
+{
+    assert(indices.size() % 3 == 0);
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles using each vertex, packed in a single array. The not emitted ones are kept at the beginning of each range
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (uint32_t vertex : indices)
+    {
+        ++remainingTriangles[vertex];
+    }
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+    std::partial_sum(remainingTriangles.begin(), remainingTriangles.end(), triangleOffsets.begin() + 1);
+    std::vector<uint32_t> vertexTriangles(indices.size());
+    {
+        std::vector<uint32_t> fillOffsets(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            vertexTriangles[fillOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        vertexScores[vertex] = GetVertexScore(-1, remainingTriangles[vertex]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        const uint32_t* triangleIndices = &indices[triangle * 3];
+        triangleScores[triangle] = vertexScores[triangleIndices[0]] + vertexScores[triangleIndices[1]] + vertexScores[triangleIndices[2]];
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    std::vector<bool> emitted(triangleCount, false);
+
+    // The cache can have up to 3 extra vertices while it is updated
+    uint32_t cache[s_scoreCacheSize + 3];
+    int cacheCount = 0;
+
+    // Start with the best triangle, and then pick the best one among the triangles of the vertices in the cache
+    size_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+    size_t nextTriangle = 0;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        if (bestTriangle == triangleCount)
+        {
+            // No triangle left around the cache, continue with the next one in the original order
+            while (emitted[nextTriangle])
+            {
+                ++nextTriangle;
+            }
+            bestTriangle = nextTriangle;
+        }
+
+        const uint32_t* triangleIndices = &indices[bestTriangle * 3];
+        emitted[bestTriangle] = true;
+        output.insert(output.end(), triangleIndices, triangleIndices + 3);
+
+        // Remove the triangle from the lists of its vertices
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t vertex = triangleIndices[k];
+            uint32_t* begin = &vertexTriangles[triangleOffsets[vertex]];
+            uint32_t* end = begin + remainingTriangles[vertex];
+            std::iter_swap(std::find(begin, end, static_cast<uint32_t>(bestTriangle)), end - 1);
+            --remainingTriangles[vertex];
+        }
+
+        // Move the vertices of the triangle to the front of the cache
+        uint32_t newCache[s_scoreCacheSize + 3];
+        int newCacheCount = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            newCache[newCacheCount++] = triangleIndices[k];
+        }
+        for (int i = 0; i < cacheCount; ++i)
+        {
+            uint32_t vertex = cache[i];
+            if (vertex != triangleIndices[0] && vertex != triangleIndices[1] && vertex != triangleIndices[2])
+            {
+                newCache[newCacheCount++] = vertex;
+            }
+        }
+
+        // Update the scores of the vertices in the cache, and of the evicted ones, and of their triangles
+        for (int i = 0; i < newCacheCount; ++i)
+        {
+            uint32_t vertex = newCache[i];
+            cachePositions[vertex] = i < s_scoreCacheSize ? i : -1;
+            float score = GetVertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+            float scoreDelta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+
+            const uint32_t* begin = &vertexTriangles[triangleOffsets[vertex]];
+            const uint32_t* end = begin + remainingTriangles[vertex];
+            for (const uint32_t* it = begin; it != end; ++it)
+            {
+                triangleScores[*it] += scoreDelta;
+            }
+        }
+
+        // Find the best triangle around the cache, once all the scores are updated
+        float bestScore = -1.0f;
+        bestTriangle = triangleCount;
+        for (int i = 0; i < newCacheCount; ++i)
+        {
+            uint32_t vertex = newCache[i];
+            const uint32_t* begin = &vertexTriangles[triangleOffsets[vertex]];
+            const uint32_t* end = begin + remainingTriangles[vertex];
+            for (const uint32_t* it = begin; it != end; ++it)
+            {
+                if (triangleScores[*it] > bestScore)
+                {
+                    bestScore = triangleScores[*it];
+                    bestTriangle = *it;
+                }
+            }
+        }
+
+        cacheCount = std::min(newCacheCount, s_scoreCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const std::byte> vertexData, size_t vertexSize,
+    size_t positionOffset, float threshold)
+{
+    assert(indices.size() % 3 == 0);
+    size_t triangleCount = indices.size() / 3;
+    size_t vertexCount = vertexData.size() / vertexSize;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Clusters start where a triangle misses the 3 vertices, there is nothing in the cache to lose there
+    const int cacheSize = 16;
+    std::vector<int> triangleMisses = SimulateVertexCache(indices, vertexCount, cacheSize);
+    std::vector<size_t> clusterStarts;
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        if (triangle == 0 || triangleMisses[triangle] == 3)
+        {
+            clusterStarts.push_back(triangle);
+        }
+    }
+    size_t clusterCount = clusterStarts.size();
+    clusterStarts.push_back(triangleCount);
+    if (clusterCount < 2)
+    {
+        return;
+    }
+
+    auto getPosition = [&](uint32_t vertex)
+    {
+        glm::vec3 position;
+        std::memcpy(&position, vertexData.data() + vertex * vertexSize + positionOffset, sizeof(position));
+        return position;
+    };
+
+    // Area weighted center and normal of each cluster, and the center of the whole mesh
+    std::vector<glm::vec3> clusterCenters(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        float clusterArea = 0.0f;
+        for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; ++triangle)
+        {
+            glm::vec3 p0 = getPosition(indices[triangle * 3 + 0]);
+            glm::vec3 p1 = getPosition(indices[triangle * 3 + 1]);
+            glm::vec3 p2 = getPosition(indices[triangle * 3 + 2]);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal) * 0.5f;
+            clusterCenters[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormals[cluster] += normal;
+            clusterArea += area;
+        }
+        meshCenter += clusterCenters[cluster];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f)
+        {
+            clusterCenters[cluster] /= clusterArea;
+        }
+    }
+    if (meshArea > 0.0f)
+    {
+        meshCenter /= meshArea;
+    }
+
+    // Clusters further out along their normal are more likely to occlude the rest, so they are drawn first
+    std::vector<float> clusterScores(clusterCount, 0.0f);
+    for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        float normalLength = glm::length(clusterNormals[cluster]);
+        if (normalLength > 0.0f)
+        {
+            clusterScores[cluster] = glm::dot(clusterCenters[cluster] - meshCenter, clusterNormals[cluster] / normalLength);
+        }
+    }
+    std::vector<size_t> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](size_t a, size_t b) { return clusterScores[a] > clusterScores[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (size_t cluster : clusterOrder)
+    {
+        output.insert(output.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+    }
+
+    // Keep the new order only if it doesn't cost too much vertex cache efficiency
+    float acmr = AnalyzeVertexCache(indices, vertexCount, cacheSize).acmr;
+    float newAcmr = AnalyzeVertexCache(output, vertexCount, cacheSize).acmr;
+    if (newAcmr <= acmr * threshold)
+    {
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(std::span<uint32_t> indices, std::span<std::byte> vertexData, size_t vertexSize)
+{
+    size_t vertexCount = vertexData.size() / vertexSize;
+
+    // New index of each vertex, in order of first use
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertexCount, unused);
+    uint32_t usedVertexCount = 0;
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = usedVertexCount++;
+        }
+        index = remap[index];
+    }
+
+    std::vector<std::byte> sourceData(vertexData.begin(), vertexData.end());
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        if (remap[vertex] != unused)
+        {
+            std::memcpy(vertexData.data() + remap[vertex] * vertexSize, sourceData.data() + vertex * vertexSize, vertexSize);
+        }
+    }
+    return usedVertexCount;
+}
@@ -0,0 +1,296 @@
+#include <ituGL/geometry/MeshSimplifier.h>
+
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+// Sum of the squared distances to a set of planes, as a symmetric 4x4 matrix. Only the upper triangle is stored
+struct Quadric
+{
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+    double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+    double a22 = 0.0, a23 = 0.0;
+    double a33 = 0.0;
+
+    // Add the plane dot(normal, p) + d = 0, scaled by the weight
+    void AddPlane(const glm::vec3& normal, float d, double weight)
+    {
+        double x = normal.x, y = normal.y, z = normal.z, w = d;
+        a00 += weight * x * x; a01 += weight * x * y; a02 += weight * x * z; a03 += weight * x * w;
+        a11 += weight * y * y; a12 += weight * y * z; a13 += weight * y * w;
+        a22 += weight * z * z; a23 += weight * z * w;
+        a33 += weight * w * w;
+    }
+
+    void Add(const Quadric& other)
+    {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+        a11 += other.a11; a12 += other.a12; a13 += other.a13;
+        a22 += other.a22; a23 += other.a23;
+        a33 += other.a33;
+    }
+
+    // Weighted sum of the squared distances from the point to the planes
+    double Evaluate(const glm::vec3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        return a00 * x * x + a11 * y * y + a22 * z * z + a33
+            + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z + a03 * x + a13 * y + a23 * z);
+    }
+};
+
+// Moving the source vertex to the position of the target
+struct Collapse
+{
+    uint32_t source;
+    uint32_t target;
+    double cost;
+};
+
+static uint64_t GetEdgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(std::span<const uint32_t> indices, std::span<const std::byte> vertexData,
+    size_t vertexSize, size_t positionOffset, size_t targetIndexCount, float maxError, float& error)
+{
+    assert(indices.size() % 3 == 0);
+    assert(vertexSize >= positionOffset + sizeof(glm::vec3));
+
+    error = 0.0f;
+    size_t vertexCount = vertexData.size_bytes() / vertexSize;
+    std::vector<uint32_t> result(indices.begin(), indices.end());
+    if (vertexCount == 0 || result.size() <= targetIndexCount)
+    {
+        return result;
+    }
+
+    // Positions scaled to the unit box, so the errors don't depend on the size of the mesh
+    std::vector<glm::vec3> positions(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        std::memcpy(&positions[i], vertexData.data() + i * vertexSize + positionOffset, sizeof(glm::vec3));
+    }
+    glm::vec3 boundsMin = positions[0];
+    glm::vec3 boundsMax = positions[0];
+    for (const glm::vec3& position : positions)
+    {
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+    glm::vec3 extent = boundsMax - boundsMin;
+    float size = std::max({ extent.x, extent.y, extent.z });
+    float scale = size > 0.0f ? 1.0f / size : 1.0f;
+    for (glm::vec3& position : positions)
+    {
+        position = (position - boundsMin) * scale;
+    }
+
+    // Vertices with the same position share the topology, the first one of them stands for all the others.
+    // Found by sorting the vertices by position, so equal ones end up next to each other
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint32_t> twinCount(vertexCount, 0);
+    {
+        std::vector<uint32_t> order(vertexCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&positions](uint32_t a, uint32_t b)
+            {
+                const glm::vec3& pa = positions[a];
+                const glm::vec3& pb = positions[b];
+                return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+            });
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            bool twin = i > 0 && positions[order[i]] == positions[order[i - 1]];
+            remap[order[i]] = twin ? remap[order[i - 1]] : order[i];
+            twinCount[remap[order[i]]]++;
+        }
+    }
+
+    // Vertices on seams and on edges without exactly 2 triangles (borders and non-manifold edges) never move
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::unordered_map<uint64_t, int> edgeCounts;
+        edgeCounts.reserve(result.size());
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                edgeCounts[GetEdgeKey(remap[result[i + k]], remap[result[i + (k + 1) % 3]])]++;
+            }
+        }
+        for (const auto& edgeCount : edgeCounts)
+        {
+            if (edgeCount.second != 2)
+            {
+                locked[edgeCount.first >> 32] = true;
+                locked[edgeCount.first & 0xFFFFFFFF] = true;
+            }
+        }
+    }
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        if (twinCount[remap[i]] > 1)
+        {
+            locked[remap[i]] = true;
+        }
+    }
+
+    // Each vertex starts with the planes of its triangles, weighted by area so small triangles matter less
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        uint32_t v0 = remap[result[i]], v1 = remap[result[i + 1]], v2 = remap[result[i + 2]];
+        glm::vec3 normal = glm::cross(positions[v1] - positions[v0], positions[v2] - positions[v0]);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normal /= length;
+            float d = -glm::dot(normal, positions[v0]);
+            quadrics[v0].AddPlane(normal, d, length * 0.5);
+            quadrics[v1].AddPlane(normal, d, length * 0.5);
+            quadrics[v2].AddPlane(normal, d, length * 0.5);
+        }
+    }
+
+    // Only single vertices move, and only onto single vertices, so the original index of both ends is known
+    auto canMove = [&](uint32_t v) { return !locked[v] && twinCount[remap[v]] == 1; };
+    auto canReceive = [&](uint32_t v) { return twinCount[remap[v]] == 1; };
+
+    // Collapses are done in passes, each one takes the cheapest edges that don't touch the triangles changed before
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<uint32_t> collapses(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<Collapse> candidates;
+    double maxCost = static_cast<double>(maxError) * maxError;
+    double worstCost = 0.0;
+    while (result.size() > targetIndexCount)
+    {
+        size_t triangleCount = result.size() / 3;
+
+        // Triangles around each vertex
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result)
+        {
+            adjacencyOffsets[remap[index] + 1]++;
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.size());
+        std::vector<uint32_t> adjacencyEnds(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            adjacency[adjacencyEnds[remap[result[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        candidates.clear();
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            uint32_t a = result[i];
+            uint32_t b = result[i - i % 3 + (i + 1) % 3];
+            for (int direction = 0; direction < 2; ++direction)
+            {
+                if (canMove(a) && canReceive(b))
+                {
+                    double cost = quadrics[a].Evaluate(positions[b]) + quadrics[b].Evaluate(positions[b]);
+                    if (cost <= maxCost)
+                    {
+                        candidates.push_back(Collapse{ a, b, cost });
+                    }
+                }
+                std::swap(a, b);
+            }
+        }
+        if (candidates.empty())
+        {
+            break;
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::iota(collapses.begin(), collapses.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t targetRemoved = triangleCount - std::min(triangleCount, targetIndexCount / 3);
+        size_t removed = 0;
+        for (const Collapse& collapse : candidates)
+        {
+            if (removed >= targetRemoved)
+            {
+                break;
+            }
+            if (touched[collapse.source] || touched[collapse.target])
+            {
+                continue;
+            }
+
+            // The triangles that stay must not turn around or become slivers
+            bool flips = false;
+            const glm::vec3& targetPosition = positions[collapse.target];
+            for (uint32_t i = adjacencyOffsets[collapse.source]; i < adjacencyOffsets[collapse.source + 1] && !flips; ++i)
+            {
+                const uint32_t* triangle = &result[adjacency[i] * 3];
+                glm::vec3 corners[3] = { positions[remap[triangle[0]]], positions[remap[triangle[1]]], positions[remap[triangle[2]]] };
+                if (remap[triangle[0]] == collapse.target || remap[triangle[1]] == collapse.target || remap[triangle[2]] == collapse.target)
+                {
+                    continue;
+                }
+                glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                for (int k = 0; k < 3; ++k)
+                {
+                    if (triangle[k] == collapse.source)
+                    {
+                        corners[k] = targetPosition;
+                    }
+                }
+                glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                flips = glm::dot(before, after) < 0.25f * glm::length(before) * glm::length(after);
+            }
+            if (flips)
+            {
+                continue;
+            }
+
+            collapses[collapse.source] = collapse.target;
+            quadrics[collapse.target].Add(quadrics[collapse.source]);
+            worstCost = std::max(worstCost, collapse.cost);
+            for (uint32_t i = adjacencyOffsets[collapse.source]; i < adjacencyOffsets[collapse.source + 1]; ++i)
+            {
+                const uint32_t* triangle = &result[adjacency[i] * 3];
+                bool hasTarget = false;
+                for (int k = 0; k < 3; ++k)
+                {
+                    touched[remap[triangle[k]]] = true;
+                    hasTarget |= triangle[k] == collapse.target;
+                }
+                removed += hasTarget ? 1 : 0;
+            }
+        }
+        if (removed == 0)
+        {
+            break;
+        }
+
+        // Apply the collapses, dropping the triangles that lost an edge
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            uint32_t i0 = collapses[result[i]], i1 = collapses[result[i + 1]], i2 = collapses[result[i + 2]];
+            if (i0 != i1 && i1 != i2 && i0 != i2)
+            {
+                result[writeIndex++] = i0;
+                result[writeIndex++] = i1;
+                result[writeIndex++] = i2;
+            }
+        }
+        result.resize(writeIndex);
+    }
+
+    error = static_cast<float>(std::sqrt(worstCost));
+    return result;
+}
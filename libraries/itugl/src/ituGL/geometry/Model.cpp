@@ -4,8 +4,12 @@
 #include <ituGL/shader/Material.h>
 
 #include <ituGL/geometry/VertexFormat.h>
+#include <ituGL/geometry/MeshOptimizer.h>
+#include <glm/packing.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
 
-Model::Model(std::shared_ptr<Mesh> mesh) : m_mesh(mesh)
+Model::Model(std::shared_ptr<Mesh> mesh) : m_mesh(mesh), m_boundsMin(0.0f), m_boundsMax(0.0f)
 {
 }
 
@@ -58,6 +62,23 @@ void Model::ClearMaterials()
     m_materials.clear();
 }
 
+unsigned int Model::SelectLod(float screenSize, unsigned int currentLod, float hysteresis) const
+{
+    unsigned int lodCount = static_cast<unsigned int>(m_lodScreenSizes.size());
+    unsigned int lod = std::min(currentLod, lodCount);
+
+    // Coarser while the size is clearly below the threshold of the next level, finer while clearly above the current one
+    while (lod < lodCount && screenSize < m_lodScreenSizes[lod] * (1.0f - hysteresis))
+    {
+        ++lod;
+    }
+    while (lod > 0 && screenSize > m_lodScreenSizes[lod - 1] * (1.0f + hysteresis))
+    {
+        --lod;
+    }
+    return lod;
+}
+
 void Model::Draw()
 {
     if (m_mesh)
@@ -85,25 +106,30 @@ std::shared_ptr<Model> Model::GeneratePlane(float length, float width, int rows,
     int vertexCount = rows * collumns;
 
     // 2. Define the vertex structure
+    // Directions are packed in 10-10-10-2 snorm and the UVs in unorm16: 28 bytes per vertex instead of 56
     struct Vertex
     {
         Vertex() = default;
         Vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& tangent, const glm::vec3& bitangent, const glm::vec2& texCoord)
-            : position(position), normal(normal), tangent(tangent), bitangent(bitangent), texCoord(texCoord) {}
+            : position(position)
+            , normal(glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f)))
+            , tangent(glm::packSnorm3x10_1x2(glm::vec4(tangent, 0.0f)))
+            , bitangent(glm::packSnorm3x10_1x2(glm::vec4(bitangent, 0.0f)))
+            , texCoord(glm::packUnorm2x16(texCoord)) {}
         glm::vec3 position;
-        glm::vec3 normal;
-        glm::vec3 tangent;
-        glm::vec3 bitangent;
-        glm::vec2 texCoord;  // texture UV coordinate
+        GLuint normal;
+        GLuint tangent;
+        GLuint bitangent;
+        GLuint texCoord;  // texture UV coordinate
     };
 
     // 3. Define the vertex format matching vertex structure
     VertexFormat vertexFormat;
     vertexFormat.AddVertexAttribute<float>(3);
-    vertexFormat.AddVertexAttribute<float>(3);
-    vertexFormat.AddVertexAttribute<float>(3);
-    vertexFormat.AddVertexAttribute<float>(3);
-    vertexFormat.AddVertexAttribute<float>(2);
+    vertexFormat.AddVertexAttribute(Data::Type::Int2101010Rev, 4, true, VertexAttribute::Semantic::Unknown);
+    vertexFormat.AddVertexAttribute(Data::Type::Int2101010Rev, 4, true, VertexAttribute::Semantic::Unknown);
+    vertexFormat.AddVertexAttribute(Data::Type::Int2101010Rev, 4, true, VertexAttribute::Semantic::Unknown);
+    vertexFormat.AddVertexAttribute<GLushort>(2, true);
 
     // Initialize VBO and EBO
     std::vector<Vertex> vertices; // VBO
@@ -168,6 +194,13 @@ std::shared_ptr<Model> Model::GeneratePlane(float length, float width, int rows,
         }
     }
 
+    // 6.1 Reorder the triangles for the vertex cache, and the vertices in the order they are used.
+    // The plane is flat, so there is no overdraw to optimize
+    std::vector<uint32_t> optimizedIndices(indices.begin(), indices.end());
+    MeshOptimizer::OptimizeVertexCache(optimizedIndices, vertices.size());
+    MeshOptimizer::OptimizeVertexFetch(optimizedIndices, std::as_writable_bytes(std::span<Vertex>(vertices)), sizeof(Vertex));
+    std::copy(optimizedIndices.begin(), optimizedIndices.end(), indices.begin());
+
     // 7. Create the new model with all the data
     std::shared_ptr planeMesh = std::make_shared<Mesh>();
     planeMesh->AddSubmesh<Vertex, unsigned short, VertexFormat::LayoutIterator>(Drawcall::Primitive::Triangles, vertices, indices,
@@ -175,6 +208,7 @@ std::shared_ptr<Model> Model::GeneratePlane(float length, float width, int rows,
 
     // 8. Assign model to a model and give it a material.
     std::shared_ptr<Model> planeModel = std::make_shared<Model>(planeMesh);
+    planeModel->SetBounds(glm::vec3(-length / 2, 0, -width / 2), glm::vec3(length / 2, 0, width / 2));
     //planeModel->AddMaterial(defaultMaterial);
 
     return planeModel;
@@ -0,0 +1,352 @@
+#include <ituGL/geometry/PropScatter.h>
+
+#include <ituGL/geometry/Model.h>
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/geometry/VertexAttribute.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <ituGL/camera/Camera.h>
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+#include <glm/matrix.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <random>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+// Candidates tried around each point before it stops being active, as in Bridson's algorithm
+static constexpr int s_candidateAttempts = 30;
+
+// Random seeds tried in each chunk, the ones that don't land in a gap are discarded
+static constexpr int s_seedAttempts = 30;
+
+// Grid cells without a point
+static const glm::vec2 s_emptyCell(std::numeric_limits<float>::lowest());
+
+PropScatter::PropScatter(float size, float chunkSize, const glm::vec2& center)
+    : m_size(size)
+    , m_center(center)
+    , m_chunkSize(chunkSize)
+    , m_chunkCount(0)
+    , m_minHeight(0.0f)
+    , m_maxHeight(0.0f)
+    , m_instancesDirty(true)
+    , m_visibleInstanceCount(0)
+{
+    assert(size > 0.0f && chunkSize > 0.0f);
+    m_chunkCount = static_cast<int>(std::ceil(size / chunkSize));
+}
+
+unsigned int PropScatter::AddPropType(std::shared_ptr<Model> model, GLuint instanceLocation, float weight, float minScale, float maxScale)
+{
+    assert(model && weight >= 0.0f && minScale <= maxScale);
+
+    PropType& propType = m_propTypes.emplace_back();
+    propType.model = model;
+    propType.weight = weight;
+    propType.minScale = minScale;
+    propType.maxScale = maxScale;
+    propType.radius = std::max(glm::length(model->GetBoundsMin()), glm::length(model->GetBoundsMax())) * maxScale;
+
+    // Every VAO of the mesh reads the instance data from the same VBO, advancing once per instance
+    Mesh& mesh = model->GetMesh();
+    propType.instanceVboIndex = mesh.AddVertexData(sizeof(glm::vec4));
+    VertexAttribute::Layout instanceLayout(VertexAttribute(Data::Type::Float, 4), 0, 0);
+    for (unsigned int vaoIndex = 0; vaoIndex < mesh.GetVertexArrayCount(); ++vaoIndex)
+    {
+        mesh.AddVertexArrayAttribute(vaoIndex, propType.instanceVboIndex, instanceLayout, instanceLocation);
+        mesh.SetVertexArrayDivisor(vaoIndex, instanceLocation, 1);
+    }
+    for (unsigned int submeshIndex = 0; submeshIndex < mesh.GetSubmeshCount(); ++submeshIndex)
+    {
+        mesh.SetSubmeshInstanceCount(submeshIndex, 0);
+    }
+
+    m_instancesDirty = true;
+
+    return static_cast<unsigned int>(m_propTypes.size() - 1);
+}
+
+void PropScatter::Generate(float minDistance, unsigned int seed, AssetLoadQueue& loadQueue, const DensityFunction& densityFunction)
+{
+    assert(minDistance > 0.0f && m_chunkSize >= 3.0f * minDistance);
+    assert(!m_propTypes.empty());
+
+    // Background grid with at most one point per cell, shared by all the chunks
+    float cellSize = minDistance / std::sqrt(2.0f);
+    int gridSize = static_cast<int>(std::ceil(m_size / cellSize));
+    std::vector<glm::vec2> grid(static_cast<size_t>(gridSize) * gridSize, s_emptyCell);
+
+    std::vector<ChunkPoints> chunkPoints(static_cast<size_t>(m_chunkCount) * m_chunkCount);
+
+    // Chunks with the same parity in both axes are a whole chunk apart, so they can be sampled at the same time.
+    // Each phase sees the points of the previous ones, and the result doesn't depend on the order within a phase
+    for (int phase = 0; phase < 4; ++phase)
+    {
+        std::vector<int> chunks;
+        for (int chunkY = phase / 2; chunkY < m_chunkCount; chunkY += 2)
+        {
+            for (int chunkX = phase % 2; chunkX < m_chunkCount; chunkX += 2)
+            {
+                chunks.push_back(chunkY * m_chunkCount + chunkX);
+            }
+        }
+
+        loadQueue.ParallelFor(static_cast<unsigned int>(chunks.size()), [&](unsigned int i)
+            {
+                int chunkIndex = chunks[i];
+                GenerateChunk(chunkIndex % m_chunkCount, chunkIndex / m_chunkCount, minDistance, seed, densityFunction, grid, chunkPoints[chunkIndex]);
+            });
+    }
+
+    MergeChunks(chunkPoints);
+}
+
+void PropScatter::GenerateChunk(int chunkX, int chunkY, float minDistance, unsigned int seed,
+    const DensityFunction& densityFunction, std::vector<glm::vec2>& grid, ChunkPoints& points) const
+{
+    float halfSize = 0.5f * m_size;
+    glm::vec2 chunkMin = m_center - halfSize + glm::vec2(chunkX, chunkY) * m_chunkSize;
+    glm::vec2 chunkMax = glm::min(chunkMin + m_chunkSize, m_center + halfSize);
+
+    float cellSize = minDistance / std::sqrt(2.0f);
+    int gridSize = static_cast<int>(std::ceil(m_size / cellSize));
+    auto getCell = [&](const glm::vec2& position)
+    {
+        glm::ivec2 cell = glm::ivec2(glm::floor((position - m_center + halfSize) / cellSize));
+        return glm::clamp(cell, 0, gridSize - 1);
+    };
+
+    // Points closer than minDistance are at most 2 cells away
+    float minDistanceSquared = minDistance * minDistance;
+    auto isFree = [&](const glm::vec2& position)
+    {
+        glm::ivec2 cell = getCell(position);
+        for (int y = std::max(cell.y - 2, 0); y <= std::min(cell.y + 2, gridSize - 1); ++y)
+        {
+            for (int x = std::max(cell.x - 2, 0); x <= std::min(cell.x + 2, gridSize - 1); ++x)
+            {
+                const glm::vec2& point = grid[static_cast<size_t>(y) * gridSize + x];
+                glm::vec2 offset = point - position;
+                if (point != s_emptyCell && glm::dot(offset, offset) < minDistanceSquared)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    // Each chunk has its own generator, so the props don't depend on which thread sampled it
+    std::seed_seq seedSequence{ seed, static_cast<unsigned int>(chunkX), static_cast<unsigned int>(chunkY) };
+    std::mt19937 generator(seedSequence);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    float totalWeight = 0.0f;
+    for (const PropType& propType : m_propTypes)
+    {
+        totalWeight += propType.weight;
+    }
+
+    std::vector<glm::vec2> activePoints;
+    auto addPoint = [&](const glm::vec2& position)
+    {
+        glm::ivec2 cell = getCell(position);
+        grid[static_cast<size_t>(cell.y) * gridSize + cell.x] = position;
+        activePoints.push_back(position);
+
+        // The discarded points still keep the others away, so the density mask thins the props without clumping them
+        glm::vec2 uv = (position - m_center) / m_size + 0.5f;
+        if (densityFunction && uniform(generator) >= densityFunction(uv))
+        {
+            return;
+        }
+
+        float typeValue = uniform(generator) * totalWeight;
+        unsigned int propTypeIndex = 0;
+        while (propTypeIndex + 1 < m_propTypes.size() && typeValue >= m_propTypes[propTypeIndex].weight)
+        {
+            typeValue -= m_propTypes[propTypeIndex].weight;
+            ++propTypeIndex;
+        }
+        const PropType& propType = m_propTypes[propTypeIndex];
+
+        points.positions.push_back(position);
+        points.rotations.push_back(uniform(generator) * glm::two_pi<float>());
+        points.scales.push_back(glm::mix(propType.minScale, propType.maxScale, uniform(generator)));
+        points.propTypes.push_back(propTypeIndex);
+    };
+
+    for (int seedAttempt = 0; seedAttempt < s_seedAttempts; ++seedAttempt)
+    {
+        glm::vec2 seedPosition = glm::mix(chunkMin, chunkMax, glm::vec2(uniform(generator), uniform(generator)));
+        if (!isFree(seedPosition))
+        {
+            continue;
+        }
+        addPoint(seedPosition);
+
+        // Grow from the active points, with candidates between 1 and 2 times the distance away
+        while (!activePoints.empty())
+        {
+            size_t activeIndex = std::min(static_cast<size_t>(uniform(generator) * activePoints.size()), activePoints.size() - 1);
+            glm::vec2 activePosition = activePoints[activeIndex];
+
+            bool found = false;
+            for (int attempt = 0; attempt < s_candidateAttempts && !found; ++attempt)
+            {
+                float angle = uniform(generator) * glm::two_pi<float>();
+                float distance = minDistance * std::sqrt(1.0f + 3.0f * uniform(generator));
+                glm::vec2 candidate = activePosition + distance * glm::vec2(std::cos(angle), std::sin(angle));
+                if (glm::all(glm::greaterThanEqual(candidate, chunkMin)) && glm::all(glm::lessThan(candidate, chunkMax)) && isFree(candidate))
+                {
+                    addPoint(candidate);
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                activePoints[activeIndex] = activePoints.back();
+                activePoints.pop_back();
+            }
+        }
+    }
+}
+
+void PropScatter::MergeChunks(const std::vector<ChunkPoints>& chunkPoints)
+{
+    size_t totalCount = 0;
+    for (const ChunkPoints& points : chunkPoints)
+    {
+        totalCount += points.positions.size();
+    }
+
+    m_positionsX.clear();
+    m_positionsZ.clear();
+    m_rotations.clear();
+    m_scales.clear();
+    m_positionsX.reserve(totalCount);
+    m_positionsZ.reserve(totalCount);
+    m_rotations.reserve(totalCount);
+    m_scales.reserve(totalCount);
+
+    unsigned int propTypeCount = GetPropTypeCount();
+    m_ranges.assign(chunkPoints.size() * propTypeCount, Range{ 0, 0 });
+    for (size_t chunkIndex = 0; chunkIndex < chunkPoints.size(); ++chunkIndex)
+    {
+        const ChunkPoints& points = chunkPoints[chunkIndex];
+        for (unsigned int propTypeIndex = 0; propTypeIndex < propTypeCount; ++propTypeIndex)
+        {
+            Range& range = m_ranges[chunkIndex * propTypeCount + propTypeIndex];
+            range.first = static_cast<unsigned int>(m_positionsX.size());
+            for (size_t i = 0; i < points.positions.size(); ++i)
+            {
+                if (points.propTypes[i] == propTypeIndex)
+                {
+                    m_positionsX.push_back(points.positions[i].x);
+                    m_positionsZ.push_back(points.positions[i].y);
+                    m_rotations.push_back(points.rotations[i]);
+                    m_scales.push_back(points.scales[i]);
+                }
+            }
+            range.count = static_cast<unsigned int>(m_positionsX.size()) - range.first;
+        }
+    }
+
+    m_instancesDirty = true;
+}
+
+void PropScatter::Update(const Camera& camera, const glm::mat4& worldMatrix)
+{
+    // Frustum planes in model space, from the rows of the world-view-projection matrix
+    glm::mat4 matrix = glm::transpose(camera.GetViewProjectionMatrix() * worldMatrix);
+    glm::vec4 frustumPlanes[6];
+    for (int i = 0; i < 3; ++i)
+    {
+        frustumPlanes[i * 2] = matrix[3] + matrix[i];
+        frustumPlanes[i * 2 + 1] = matrix[3] - matrix[i];
+    }
+
+    // The props can reach out of their chunk as far as the biggest one
+    float reach = 0.0f;
+    for (const PropType& propType : m_propTypes)
+    {
+        reach = std::max(reach, propType.radius);
+    }
+
+    m_visibleChunks.clear();
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    float halfSize = 0.5f * m_size;
+    for (int chunkY = 0; chunkY < m_chunkCount; ++chunkY)
+    {
+        for (int chunkX = 0; chunkX < m_chunkCount; ++chunkX)
+        {
+            glm::vec2 chunkMin = m_center - halfSize + glm::vec2(chunkX, chunkY) * m_chunkSize;
+            glm::vec2 chunkMax = glm::min(chunkMin + m_chunkSize, m_center + halfSize);
+            glm::vec3 boxMin(chunkMin.x - reach, m_minHeight - reach, chunkMin.y - reach);
+            glm::vec3 boxMax(chunkMax.x + reach, m_maxHeight + reach, chunkMax.y + reach);
+
+            // Culled if the corner of the box furthest along the normal of any plane is behind it
+            bool visible = true;
+            for (const glm::vec4& plane : frustumPlanes)
+            {
+                glm::vec3 farCorner = glm::mix(boxMin, boxMax, glm::greaterThanEqual(glm::vec3(plane), glm::vec3(0.0f)));
+                if (glm::dot(glm::vec3(plane), farCorner) + plane.w < 0.0f)
+                {
+                    visible = false;
+                    break;
+                }
+            }
+
+            if (visible)
+            {
+                m_visibleChunks.push_back(chunkY * m_chunkCount + chunkX);
+                boundsMin = glm::min(boundsMin, boxMin);
+                boundsMax = glm::max(boundsMax, boxMax);
+            }
+        }
+    }
+    if (m_visibleChunks.empty())
+    {
+        boundsMin = boundsMax = glm::vec3(0.0f);
+    }
+
+    if (!m_instancesDirty && m_visibleChunks == m_previousVisibleChunks)
+    {
+        return;
+    }
+    m_previousVisibleChunks = m_visibleChunks;
+    m_instancesDirty = false;
+
+    // Gather the instance data of the visible chunks, that are contiguous for each type
+    unsigned int propTypeCount = GetPropTypeCount();
+    m_visibleInstanceCount = 0;
+    for (unsigned int propTypeIndex = 0; propTypeIndex < propTypeCount; ++propTypeIndex)
+    {
+        PropType& propType = m_propTypes[propTypeIndex];
+        propType.instances.clear();
+        if (!m_ranges.empty())
+        {
+            for (int chunkIndex : m_visibleChunks)
+            {
+                const Range& range = m_ranges[static_cast<size_t>(chunkIndex) * propTypeCount + propTypeIndex];
+                for (unsigned int i = range.first; i < range.first + range.count; ++i)
+                {
+                    propType.instances.push_back(glm::vec4(m_positionsX[i], m_positionsZ[i], m_rotations[i], m_scales[i]));
+                }
+            }
+        }
+        m_visibleInstanceCount += static_cast<unsigned int>(propType.instances.size());
+
+        Mesh& mesh = propType.model->GetMesh();
+        mesh.SetVertexData<glm::vec4>(propType.instanceVboIndex, propType.instances);
+        for (unsigned int submeshIndex = 0; submeshIndex < mesh.GetSubmeshCount(); ++submeshIndex)
+        {
+            mesh.SetSubmeshInstanceCount(submeshIndex, static_cast<GLsizei>(propType.instances.size()));
+        }
+        propType.model->SetBounds(boundsMin, boundsMax);
+    }
+}
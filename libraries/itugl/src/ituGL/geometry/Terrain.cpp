@@ -0,0 +1,148 @@
+#include <ituGL/geometry/Terrain.h>
+
+#include <ituGL/geometry/Model.h>
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/geometry/MeshOptimizer.h>
+#include <ituGL/geometry/VertexAttribute.h>
+#include <ituGL/camera/Camera.h>
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+#include <glm/matrix.hpp>
+#include <cmath>
+#include <cassert>
+
+Terrain::Terrain(float size, int levelCount, int gridSize)
+    : m_size(size)
+    , m_levelCount(levelCount)
+    , m_gridSize(gridSize)
+    , m_minHeight(0.0f)
+    , m_maxHeight(0.0f)
+    , m_lodDistance(0.0f)
+    , m_morphStart(0.75f)
+    , m_instanceVboIndex(0)
+    , m_viewPosition(0.0f)
+{
+    assert(levelCount > 0);
+    // Indices must fit in 16 bits
+    assert(gridSize > 0 && gridSize < 256);
+
+    m_lodDistance = 6.0f * GetLeafSize();
+
+    InitializeMesh();
+}
+
+float Terrain::GetLeafSize() const
+{
+    return std::ldexp(m_size, 1 - m_levelCount);
+}
+
+void Terrain::InitializeMesh()
+{
+    // Grid of gridSize x gridSize quads covering [0, 1] in both axes
+    int rowSize = m_gridSize + 1;
+    std::vector<glm::vec2> vertices;
+    vertices.reserve(rowSize * rowSize);
+    for (int z = 0; z <= m_gridSize; ++z)
+    {
+        for (int x = 0; x <= m_gridSize; ++x)
+        {
+            vertices.push_back(glm::vec2(x, z) / static_cast<float>(m_gridSize));
+        }
+    }
+
+    // Counter-clockwise seen from above
+    std::vector<uint32_t> indices;
+    indices.reserve(m_gridSize * m_gridSize * 6);
+    for (int z = 0; z < m_gridSize; ++z)
+    {
+        for (int x = 0; x < m_gridSize; ++x)
+        {
+            uint32_t a = z * rowSize + x;
+            uint32_t b = a + 1;
+            uint32_t c = a + rowSize;
+            uint32_t d = c + 1;
+            indices.insert(indices.end(), { a, c, b, b, c, d });
+        }
+    }
+    MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+    std::vector<unsigned short> elements(indices.begin(), indices.end());
+
+    m_mesh = std::make_shared<Mesh>();
+    unsigned int gridVboIndex = m_mesh->AddVertexData<glm::vec2>(vertices);
+    m_instanceVboIndex = m_mesh->AddVertexData(sizeof(glm::vec4));
+    unsigned int eboIndex = m_mesh->AddElementData<unsigned short>(elements);
+
+    // Grid position from the first VBO, per-instance patch data from the second one
+    std::vector<VertexAttribute::Layout> layouts = {
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 2, VertexAttribute::Semantic::Position), 0, 0),
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 4), 0, 0)
+    };
+    unsigned int vboIndices[] = { gridVboIndex, m_instanceVboIndex };
+    m_mesh->AddSubmesh(Drawcall::Primitive::Triangles, 0, static_cast<int>(elements.size()), Data::Type::UShort,
+        std::span<unsigned int>(vboIndices), eboIndex, layouts.begin(), layouts.end());
+    m_mesh->SetVertexArrayDivisor(m_mesh->GetVertexArrayCount() - 1, 1, 1);
+    m_mesh->SetSubmeshInstanceCount(0, 0);
+
+    m_model = std::make_shared<Model>(m_mesh);
+}
+
+void Terrain::Update(const Camera& camera, const glm::mat4& worldMatrix)
+{
+    m_viewPosition = glm::inverse(worldMatrix) * glm::vec4(camera.ExtractTranslation(), 1.0f);
+
+    // Frustum planes in model space, from the rows of the world-view-projection matrix
+    glm::mat4 matrix = glm::transpose(camera.GetViewProjectionMatrix() * worldMatrix);
+    glm::vec4 frustumPlanes[6];
+    for (int i = 0; i < 3; ++i)
+    {
+        frustumPlanes[i * 2] = matrix[3] + matrix[i];
+        frustumPlanes[i * 2 + 1] = matrix[3] - matrix[i];
+    }
+
+    m_patches.clear();
+    float halfSize = 0.5f * m_size;
+    SelectNode(glm::vec2(-halfSize), m_size, m_levelCount - 1, frustumPlanes);
+
+    m_mesh->SetVertexData<glm::vec4>(m_instanceVboIndex, m_patches);
+    m_mesh->SetSubmeshInstanceCount(0, static_cast<GLsizei>(m_patches.size()));
+    m_model->SetBounds(glm::vec3(-halfSize, m_minHeight, -halfSize), glm::vec3(halfSize, m_maxHeight, halfSize));
+}
+
+void Terrain::SelectNode(const glm::vec2& corner, float nodeSize, int level, const glm::vec4 (&frustumPlanes)[6])
+{
+    glm::vec3 boxMin(corner.x, m_minHeight, corner.y);
+    glm::vec3 boxMax(corner.x + nodeSize, m_maxHeight, corner.y + nodeSize);
+
+    // Culled if the corner of the box furthest along the normal of any plane is behind it
+    for (const glm::vec4& plane : frustumPlanes)
+    {
+        glm::vec3 farCorner = glm::mix(boxMin, boxMax, glm::greaterThanEqual(glm::vec3(plane), glm::vec3(0.0f)));
+        if (glm::dot(glm::vec3(plane), farCorner) + plane.w < 0.0f)
+        {
+            return;
+        }
+    }
+
+    // Split the node if any part of it is in the range of the next finer level. The children outside that range
+    // are drawn at the finer level anyway, but their vertices are completely morphed to the grid of this one
+    if (level > 0)
+    {
+        glm::vec3 closestPoint = glm::clamp(m_viewPosition, boxMin, boxMax);
+        if (glm::distance(closestPoint, m_viewPosition) < GetLodRange(level - 1))
+        {
+            float childSize = 0.5f * nodeSize;
+            SelectNode(corner, childSize, level - 1, frustumPlanes);
+            SelectNode(corner + glm::vec2(childSize, 0.0f), childSize, level - 1, frustumPlanes);
+            SelectNode(corner + glm::vec2(0.0f, childSize), childSize, level - 1, frustumPlanes);
+            SelectNode(corner + glm::vec2(childSize, childSize), childSize, level - 1, frustumPlanes);
+            return;
+        }
+    }
+
+    m_patches.push_back(glm::vec4(corner, nodeSize, static_cast<float>(level)));
+}
+
+float Terrain::GetLodRange(int level) const
+{
+    return std::ldexp(m_lodDistance, level);
+}
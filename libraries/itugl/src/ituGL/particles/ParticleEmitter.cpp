@@ -0,0 +1,68 @@
+#include <ituGL/particles/ParticleEmitter.h>
+
+#include <ituGL/particles/ParticleSystem.h>
+#include <ituGL/scene/Transform.h>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat3x3.hpp>
+#include <cassert>
+
+ParticleEmitter::ParticleEmitter(std::shared_ptr<ParticleSystem> particleSystem, std::shared_ptr<Transform> transform)
+    : m_particleSystem(particleSystem)
+    , m_transform(transform)
+    , m_localPosition(0.0f)
+    , m_localVelocity(0.0f, 1.0f, 0.0f)
+    , m_rate(0.0f)
+    , m_ratePerSpeed(10.0f)
+    , m_spread(0.5f)
+    , m_inheritVelocity(0.5f)
+    , m_lifetime(1.0f, 1.0f)
+    , m_size(0.1f, 0.1f)
+    , m_previousPosition(0.0f)
+    , m_hasPreviousPosition(false)
+    , m_pending(0.0f)
+{
+    assert(m_particleSystem);
+    assert(m_transform);
+}
+
+void ParticleEmitter::Update(float deltaTime)
+{
+    glm::mat4 worldMatrix = m_transform->GetTransformMatrix();
+    glm::vec3 position = worldMatrix * glm::vec4(m_localPosition, 1.0f);
+    if (!m_hasPreviousPosition || deltaTime <= 0.0f)
+    {
+        m_previousPosition = position;
+        m_hasPreviousPosition = true;
+        return;
+    }
+
+    glm::vec3 emitterVelocity = (position - m_previousPosition) / deltaTime;
+    float speed = glm::length(emitterVelocity);
+
+    // Only rotate the velocity: the scale of the transform shouldn't change the speed of the particles
+    glm::mat3 rotation(glm::normalize(glm::vec3(worldMatrix[0])), glm::normalize(glm::vec3(worldMatrix[1])), glm::normalize(glm::vec3(worldMatrix[2])));
+    glm::vec3 baseVelocity = rotation * m_localVelocity + emitterVelocity * m_inheritVelocity;
+
+    m_pending += (m_rate + m_ratePerSpeed * speed) * deltaTime;
+    unsigned int count = static_cast<unsigned int>(m_pending);
+    m_pending -= count;
+
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        // Spread over the path, so fast emitters leave a trail instead of clumps
+        float t = (i + unit(m_random)) / count;
+        glm::vec3 spawnPosition = glm::mix(m_previousPosition, position, t);
+        glm::vec3 velocity = baseVelocity + glm::vec3(direction(m_random), direction(m_random), direction(m_random)) * m_spread;
+        float lifetime = glm::mix(m_lifetime.x, m_lifetime.y, unit(m_random));
+        float size = glm::mix(m_size.x, m_size.y, unit(m_random));
+        if (!m_particleSystem->Emit(spawnPosition, velocity, lifetime, size))
+        {
+            break;
+        }
+    }
+
+    m_previousPosition = position;
+}
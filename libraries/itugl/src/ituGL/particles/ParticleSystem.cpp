@@ -0,0 +1,282 @@
+#include <ituGL/particles/ParticleSystem.h>
+
+#include <ituGL/geometry/Heightfield.h>
+#include <ituGL/geometry/Model.h>
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/geometry/VertexAttribute.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <algorithm>
+#include <span>
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Particles updated by each task. A multiple of 4, so every chunk starts at a complete group
+static constexpr unsigned int s_chunkSize = 2048;
+
+ParticleSystem::ParticleSystem(unsigned int capacity)
+    : m_capacity(capacity)
+    , m_count(0)
+    , m_gravity(9.81f)
+    , m_drag(1.0f)
+    , m_restitution(0.3f)
+    , m_friction(0.6f)
+    , m_groundOrigin(0.0f)
+    , m_groundSize(1.0f)
+    , m_sampleDistance(0.0f)
+    , m_offsetStrength(0.0f)
+    , m_simdEnabled(true)
+    , m_instanceVboIndex(0)
+{
+    // Round up to complete groups of 4. The extra particles are updated with the rest, but never used
+    size_t paddedCapacity = (static_cast<size_t>(capacity) + 3) & ~static_cast<size_t>(3);
+    for (std::vector<float>* component : { &m_positionsX, &m_positionsY, &m_positionsZ, &m_velocitiesX, &m_velocitiesY, &m_velocitiesZ,
+        &m_ages, &m_lifetimes, &m_sizes, &m_groundHeights })
+    {
+        component->resize(paddedCapacity, 0.0f);
+    }
+    m_groundUVs.resize(paddedCapacity, glm::vec2(0.0f));
+}
+
+void ParticleSystem::SetGround(std::shared_ptr<const Heightfield> heightfield, const glm::vec3& origin, float size, float sampleDistance, float offsetStrength)
+{
+    assert(size > 0.0f);
+    m_heightfield = heightfield && !heightfield->IsEmpty() ? heightfield : nullptr;
+    m_groundOrigin = origin;
+    m_groundSize = size;
+    m_sampleDistance = sampleDistance;
+    m_offsetStrength = offsetStrength;
+}
+
+void ParticleSystem::SetGround(float height)
+{
+    m_heightfield = nullptr;
+    m_groundOrigin = glm::vec3(0.0f, height, 0.0f);
+}
+
+bool ParticleSystem::Emit(const glm::vec3& position, const glm::vec3& velocity, float lifetime, float size)
+{
+    if (m_count == m_capacity)
+    {
+        return false;
+    }
+
+    unsigned int index = m_count++;
+    m_positionsX[index] = position.x;
+    m_positionsY[index] = position.y;
+    m_positionsZ[index] = position.z;
+    m_velocitiesX[index] = velocity.x;
+    m_velocitiesY[index] = velocity.y;
+    m_velocitiesZ[index] = velocity.z;
+    m_ages[index] = 0.0f;
+    m_lifetimes[index] = lifetime;
+    m_sizes[index] = size;
+    return true;
+}
+
+void ParticleSystem::Update(float deltaTime, AssetLoadQueue* loadQueue)
+{
+    unsigned int chunkCount = (m_count + s_chunkSize - 1) / s_chunkSize;
+    auto updateChunk = [&](unsigned int chunkIndex)
+    {
+        unsigned int first = chunkIndex * s_chunkSize;
+        UpdateChunk(first, std::min(first + s_chunkSize, m_count), deltaTime);
+    };
+    if (loadQueue && chunkCount > 1)
+    {
+        loadQueue->ParallelFor(chunkCount, updateChunk);
+    }
+    else
+    {
+        for (unsigned int chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+        {
+            updateChunk(chunkIndex);
+        }
+    }
+
+    // Replace the dead particles with the last ones
+    for (unsigned int index = 0; index < m_count; )
+    {
+        if (m_ages[index] >= m_lifetimes[index])
+        {
+            MoveParticle(--m_count, index);
+        }
+        else
+        {
+            ++index;
+        }
+    }
+}
+
+void ParticleSystem::UpdateChunk(unsigned int first, unsigned int last, float deltaTime)
+{
+    assert(first % 4 == 0);
+
+    // Whole groups of 4, the padding of the arrays makes room for the last one
+    unsigned int end = (last + 3) & ~3u;
+    float damping = std::max(1.0f - m_drag * deltaTime, 0.0f);
+    float gravityStep = m_gravity * deltaTime;
+
+    // Integrate the velocities, then the positions
+#if defined(__SSE2__) || defined(_M_X64)
+    if (m_simdEnabled)
+    {
+        const __m128 dampingGroup = _mm_set1_ps(damping);
+        const __m128 gravityGroup = _mm_set1_ps(gravityStep);
+        const __m128 deltaGroup = _mm_set1_ps(deltaTime);
+        for (unsigned int i = first; i < end; i += 4)
+        {
+            __m128 velocityX = _mm_mul_ps(_mm_loadu_ps(&m_velocitiesX[i]), dampingGroup);
+            __m128 velocityY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&m_velocitiesY[i]), gravityGroup), dampingGroup);
+            __m128 velocityZ = _mm_mul_ps(_mm_loadu_ps(&m_velocitiesZ[i]), dampingGroup);
+            _mm_storeu_ps(&m_velocitiesX[i], velocityX);
+            _mm_storeu_ps(&m_velocitiesY[i], velocityY);
+            _mm_storeu_ps(&m_velocitiesZ[i], velocityZ);
+            _mm_storeu_ps(&m_positionsX[i], _mm_add_ps(_mm_loadu_ps(&m_positionsX[i]), _mm_mul_ps(velocityX, deltaGroup)));
+            _mm_storeu_ps(&m_positionsY[i], _mm_add_ps(_mm_loadu_ps(&m_positionsY[i]), _mm_mul_ps(velocityY, deltaGroup)));
+            _mm_storeu_ps(&m_positionsZ[i], _mm_add_ps(_mm_loadu_ps(&m_positionsZ[i]), _mm_mul_ps(velocityZ, deltaGroup)));
+            _mm_storeu_ps(&m_ages[i], _mm_add_ps(_mm_loadu_ps(&m_ages[i]), deltaGroup));
+        }
+    }
+    else
+#endif
+    {
+        for (unsigned int i = first; i < end; ++i)
+        {
+            m_velocitiesX[i] *= damping;
+            m_velocitiesY[i] = (m_velocitiesY[i] - gravityStep) * damping;
+            m_velocitiesZ[i] *= damping;
+            m_positionsX[i] += m_velocitiesX[i] * deltaTime;
+            m_positionsY[i] += m_velocitiesY[i] * deltaTime;
+            m_positionsZ[i] += m_velocitiesZ[i] * deltaTime;
+            m_ages[i] += deltaTime;
+        }
+    }
+
+    // Ground under the new positions, with the batched heightfield queries
+    std::span<float> groundHeights(&m_groundHeights[first], end - first);
+    if (m_heightfield)
+    {
+        std::span<glm::vec2> groundUVs(&m_groundUVs[first], end - first);
+        for (unsigned int i = first; i < end; ++i)
+        {
+            m_groundUVs[i] = glm::vec2(m_positionsX[i] - m_groundOrigin.x, m_positionsZ[i] - m_groundOrigin.z) / m_groundSize + 0.5f;
+        }
+        m_heightfield->GetHeights(groundUVs, m_sampleDistance, m_offsetStrength, groundHeights);
+    }
+    else
+    {
+        std::fill(groundHeights.begin(), groundHeights.end(), 0.0f);
+    }
+
+    // Particles under the ground are put back on it, bouncing up and losing some of their horizontal speed
+#if defined(__SSE2__) || defined(_M_X64)
+    if (m_simdEnabled)
+    {
+        const __m128 originGroup = _mm_set1_ps(m_groundOrigin.y);
+        const __m128 restitutionGroup = _mm_set1_ps(-m_restitution);
+        const __m128 frictionGroup = _mm_set1_ps(m_friction);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 zero = _mm_setzero_ps();
+        for (unsigned int i = first; i < end; i += 4)
+        {
+            __m128 ground = _mm_add_ps(_mm_loadu_ps(&m_groundHeights[i]), originGroup);
+            __m128 positionY = _mm_loadu_ps(&m_positionsY[i]);
+            __m128 velocityY = _mm_loadu_ps(&m_velocitiesY[i]);
+            __m128 below = _mm_cmplt_ps(positionY, ground);
+            __m128 falling = _mm_and_ps(below, _mm_cmplt_ps(velocityY, zero));
+            __m128 friction = _mm_or_ps(_mm_and_ps(below, frictionGroup), _mm_andnot_ps(below, one));
+
+            _mm_storeu_ps(&m_positionsY[i], _mm_max_ps(positionY, ground));
+            _mm_storeu_ps(&m_velocitiesY[i], _mm_or_ps(_mm_and_ps(falling, _mm_mul_ps(velocityY, restitutionGroup)), _mm_andnot_ps(falling, velocityY)));
+            _mm_storeu_ps(&m_velocitiesX[i], _mm_mul_ps(_mm_loadu_ps(&m_velocitiesX[i]), friction));
+            _mm_storeu_ps(&m_velocitiesZ[i], _mm_mul_ps(_mm_loadu_ps(&m_velocitiesZ[i]), friction));
+        }
+    }
+    else
+#endif
+    {
+        for (unsigned int i = first; i < end; ++i)
+        {
+            float ground = m_groundHeights[i] + m_groundOrigin.y;
+            if (m_positionsY[i] < ground)
+            {
+                m_positionsY[i] = ground;
+                if (m_velocitiesY[i] < 0.0f)
+                {
+                    m_velocitiesY[i] *= -m_restitution;
+                }
+                m_velocitiesX[i] *= m_friction;
+                m_velocitiesZ[i] *= m_friction;
+            }
+        }
+    }
+}
+
+void ParticleSystem::MoveParticle(unsigned int from, unsigned int to)
+{
+    for (std::vector<float>* component : { &m_positionsX, &m_positionsY, &m_positionsZ, &m_velocitiesX, &m_velocitiesY, &m_velocitiesZ,
+        &m_ages, &m_lifetimes, &m_sizes })
+    {
+        (*component)[to] = (*component)[from];
+    }
+}
+
+std::shared_ptr<Model> ParticleSystem::CreateModel()
+{
+    // Quad facing the camera, expanded by the vertex shader
+    const glm::vec2 corners[] = { glm::vec2(-0.5f, -0.5f), glm::vec2(0.5f, -0.5f), glm::vec2(-0.5f, 0.5f), glm::vec2(0.5f, 0.5f) };
+    const unsigned short elements[] = { 0, 1, 2, 2, 1, 3 };
+
+    m_mesh = std::make_shared<Mesh>();
+    unsigned int cornerVboIndex = m_mesh->AddVertexData<glm::vec2>(corners);
+    m_instanceVboIndex = m_mesh->AddVertexData(sizeof(Instance));
+    unsigned int eboIndex = m_mesh->AddElementData<unsigned short>(elements);
+
+    // Corner from the first VBO, per-instance position, size and age from the second one
+    std::vector<VertexAttribute::Layout> layouts = {
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 2, VertexAttribute::Semantic::Position), 0, 0),
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 4), offsetof(Instance, position), sizeof(Instance)),
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 1), offsetof(Instance, age), sizeof(Instance))
+    };
+    unsigned int vboIndices[] = { cornerVboIndex, m_instanceVboIndex, m_instanceVboIndex };
+    m_mesh->AddSubmesh(Drawcall::Primitive::Triangles, 0, static_cast<int>(std::size(elements)), Data::Type::UShort,
+        std::span<unsigned int>(vboIndices), eboIndex, layouts.begin(), layouts.end());
+    unsigned int vaoIndex = m_mesh->GetVertexArrayCount() - 1;
+    m_mesh->SetVertexArrayDivisor(vaoIndex, 1, 1);
+    m_mesh->SetVertexArrayDivisor(vaoIndex, 2, 1);
+    m_mesh->SetSubmeshInstanceCount(0, 0);
+
+    m_model = std::make_shared<Model>(m_mesh);
+    return m_model;
+}
+
+void ParticleSystem::UpdateModel()
+{
+    assert(m_mesh);
+
+    glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+    float maxSize = 0.0f;
+    m_instances.resize(m_count);
+    for (unsigned int i = 0; i < m_count; ++i)
+    {
+        Instance& instance = m_instances[i];
+        instance.position = glm::vec3(m_positionsX[i], m_positionsY[i], m_positionsZ[i]);
+        instance.size = m_sizes[i];
+        instance.age = m_ages[i] / m_lifetimes[i];
+
+        boundsMin = i > 0 ? glm::min(boundsMin, instance.position) : instance.position;
+        boundsMax = i > 0 ? glm::max(boundsMax, instance.position) : instance.position;
+        maxSize = std::max(maxSize, instance.size);
+    }
+
+    // The shader may grow the billboards, up to their size in every direction
+    boundsMin -= maxSize;
+    boundsMax += maxSize;
+
+    m_mesh->SetVertexData<Instance>(m_instanceVboIndex, m_instances);
+    m_mesh->SetSubmeshInstanceCount(0, static_cast<GLsizei>(m_count));
+    m_model->SetBounds(boundsMin, boundsMax);
+}
@@ -0,0 +1,353 @@
+#include <ituGL/renderer/Impostor.h>
+
+#include <ituGL/renderer/Renderer.h>
+#include <ituGL/asset/ModelLoader.h>
+#include <ituGL/camera/Camera.h>
+#include <ituGL/geometry/Model.h>
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/geometry/VertexArrayObject.h>
+#include <ituGL/shader/Material.h>
+#include <ituGL/texture/Texture2DObject.h>
+#include <ituGL/texture/FramebufferObject.h>
+#include <ituGL/utils/MappedFile.h>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// Impostor cache layout: an ImpostorCacheHeader, then the first level of each texture of the atlas, in the order of
+// GetCacheLayers. Texels are 4 bytes in all of them
+static constexpr uint32_t s_impostorCacheVersion = 1;
+static constexpr size_t s_impostorTexelSize = 4;
+
+struct ImpostorCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    // Size and modification time of the model file, the cache is outdated if they change
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    // Layout of the atlas, the cache is ignored if a different one is requested
+    uint32_t frameCount;
+    uint32_t frameSize;
+    // Sphere the frames cover
+    glm::vec3 center;
+    float radius;
+};
+
+// Texture of the atlas, with its format and the format of the data in the cache
+struct ImpostorCacheLayer
+{
+    std::shared_ptr<Texture2DObject> texture;
+    TextureObject::Format format;
+    TextureObject::InternalFormat internalFormat;
+    Data::Type type;
+};
+
+// The same formats as the g-buffer, so the materials of the model write the same values
+static std::array<ImpostorCacheLayer, 4> GetCacheLayers(const Impostor& impostor)
+{
+    return { {
+        { impostor.GetAlbedoTexture(), TextureObject::FormatRGBA, TextureObject::InternalFormatSRGBA8, Data::Type::UByte },
+        { impostor.GetNormalTexture(), TextureObject::FormatRG, TextureObject::InternalFormatRG16F, Data::Type::Half },
+        { impostor.GetOthersTexture(), TextureObject::FormatRGBA, TextureObject::InternalFormatSRGBA8, Data::Type::UByte },
+        { impostor.GetDepthTexture(), TextureObject::FormatDepth, TextureObject::InternalFormatDepth32F, Data::Type::Float },
+    } };
+}
+
+// Up vector of the camera of a frame. Must match the one in the impostor shader
+static glm::vec3 GetFrameUp(const glm::vec3& direction)
+{
+    return std::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+Impostor::Impostor(int frameCount, int frameSize)
+    : m_frameCount(frameCount)
+    , m_frameSize(frameSize)
+    , m_center(0.0f)
+    , m_radius(1.0f)
+    , m_fadeStart(0.0f)
+    , m_fadeEnd(0.0f)
+    , m_instanceVboIndex(0)
+{
+    // The border of the atlas is the horizon, and the frames in it must reach both corners
+    assert(frameCount >= 2);
+    assert(frameSize > 0);
+}
+
+void Impostor::InitTextures()
+{
+    m_albedoTexture = std::make_shared<Texture2DObject>();
+    m_normalTexture = std::make_shared<Texture2DObject>();
+    m_othersTexture = std::make_shared<Texture2DObject>();
+    m_depthTexture = std::make_shared<Texture2DObject>();
+
+    int atlasSize = m_frameCount * m_frameSize;
+    for (const ImpostorCacheLayer& layer : GetCacheLayers(*this))
+    {
+        layer.texture->Bind();
+        layer.texture->SetImage(0, atlasSize, atlasSize, layer.format, layer.internalFormat);
+        layer.texture->SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+        layer.texture->SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+        layer.texture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_NEAREST);
+        layer.texture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_NEAREST);
+    }
+    Texture2DObject::Unbind();
+}
+
+void Impostor::Bake(const Model& model, Renderer& renderer, const char* cachePath)
+{
+    // Sphere around the bounding box
+    m_center = 0.5f * (model.GetBoundsMin() + model.GetBoundsMax());
+    m_radius = std::max(0.5f * glm::length(model.GetBoundsMax() - model.GetBoundsMin()), 0.001f);
+
+    InitTextures();
+
+    if (!cachePath || !ReadCache(cachePath))
+    {
+        FramebufferObject framebuffer;
+        framebuffer.Bind();
+        framebuffer.SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Depth, *m_depthTexture);
+        framebuffer.SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Color0, *m_albedoTexture);
+        framebuffer.SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Color1, *m_normalTexture);
+        framebuffer.SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Color2, *m_othersTexture);
+        framebuffer.SetDrawBuffers(std::array<FramebufferObject::Attachment, 3>(
+            {
+                FramebufferObject::Attachment::Color0,
+                FramebufferObject::Attachment::Color1,
+                FramebufferObject::Attachment::Color2
+            }));
+
+        DeviceGL& device = renderer.GetDevice();
+
+        // Backup current viewport
+        glm::ivec4 currentViewport;
+        device.GetViewport(currentViewport.x, currentViewport.y, currentViewport.z, currentViewport.w);
+
+        // Nothing covered, and the depth at the back of the sphere
+        device.Clear(true, Color(0.0f, 0.0f, 0.0f, 0.0f), true, 1.0f);
+
+        // Each frame looks at the center from the surface of the sphere, with an orthographic projection covering it
+        const Mesh& mesh = model.GetMesh();
+        for (int frameY = 0; frameY < m_frameCount; ++frameY)
+        {
+            for (int frameX = 0; frameX < m_frameCount; ++frameX)
+            {
+                glm::vec3 direction = GetFrameDirection(frameX, frameY);
+                Camera camera;
+                camera.SetViewMatrix(m_center + direction * m_radius, m_center, GetFrameUp(direction));
+                camera.SetOrthographicProjectionMatrix(glm::vec3(-m_radius, -m_radius, 0.0f), glm::vec3(m_radius, m_radius, 2.0f * m_radius));
+
+                device.SetViewport(frameX * m_frameSize, frameY * m_frameSize, m_frameSize, m_frameSize);
+
+                for (unsigned int submeshIndex = 0; submeshIndex < mesh.GetSubmeshCount(); ++submeshIndex)
+                {
+                    const Material& material = model.GetMaterial(submeshIndex);
+                    material.Use();
+                    renderer.UpdateTransforms(material.GetShaderProgram(), glm::mat4(1.0f), camera);
+                    mesh.GetSubmeshVertexArray(submeshIndex).Bind();
+                    mesh.GetSubmeshDrawcall(submeshIndex).Draw();
+                }
+            }
+        }
+
+        // Restore viewport, and the framebuffer the renderer expects
+        device.SetViewport(currentViewport.x, currentViewport.y, currentViewport.z, currentViewport.w);
+        FramebufferObject::Unbind();
+        if (std::shared_ptr<const FramebufferObject> currentFramebuffer = renderer.GetCurrentFramebuffer())
+        {
+            currentFramebuffer->Bind();
+        }
+
+        if (cachePath)
+        {
+            WriteCache(cachePath);
+        }
+    }
+
+    // Far away the frames are small, the color textures are filtered with mipmaps. The depth is read as it is
+    for (std::shared_ptr<Texture2DObject> texture : { m_albedoTexture, m_normalTexture, m_othersTexture })
+    {
+        texture->Bind();
+        texture->GenerateMipmap();
+        texture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR_MIPMAP_LINEAR);
+        texture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+    }
+    Texture2DObject::Unbind();
+}
+
+glm::vec3 Impostor::GetFrameDirection(int frameX, int frameY) const
+{
+    // Hemi-octahedral mapping: the atlas is the pyramid over the upper hemisphere, rotated 45 degrees.
+    // Must match the one in the impostor shader
+    glm::vec2 octahedral = glm::vec2(frameX, frameY) / static_cast<float>(m_frameCount - 1) * 2.0f - 1.0f;
+    glm::vec2 xz = 0.5f * glm::vec2(octahedral.x + octahedral.y, octahedral.x - octahedral.y);
+    return glm::normalize(glm::vec3(xz.x, 1.0f - std::abs(xz.x) - std::abs(xz.y), xz.y));
+}
+
+void Impostor::SetMaterialUniforms(Material& material) const
+{
+    material.SetUniformValue("ImpostorAlbedoTexture", m_albedoTexture);
+    material.SetUniformValue("ImpostorNormalTexture", m_normalTexture);
+    material.SetUniformValue("ImpostorOthersTexture", m_othersTexture);
+    material.SetUniformValue("ImpostorDepthTexture", m_depthTexture);
+    material.SetUniformValue("ImpostorFrameCount", static_cast<float>(m_frameCount));
+    material.SetUniformValue("ImpostorCenter", m_center);
+    material.SetUniformValue("ImpostorRadius", m_radius);
+}
+
+float Impostor::GetFade(float distance) const
+{
+    if (m_fadeEnd <= m_fadeStart)
+    {
+        return distance >= m_fadeEnd ? 1.0f : 0.0f;
+    }
+    return std::clamp((distance - m_fadeStart) / (m_fadeEnd - m_fadeStart), 0.0f, 1.0f);
+}
+
+std::shared_ptr<Model> Impostor::CreateModel(std::shared_ptr<Material> material)
+{
+    // Quad facing the camera, expanded by the vertex shader
+    const glm::vec2 corners[] = { glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f), glm::vec2(-1.0f, 1.0f), glm::vec2(1.0f, 1.0f) };
+    const unsigned short elements[] = { 0, 1, 2, 2, 1, 3 };
+
+    m_mesh = std::make_shared<Mesh>();
+    unsigned int cornerVboIndex = m_mesh->AddVertexData<glm::vec2>(corners);
+    m_instanceVboIndex = m_mesh->AddVertexData(sizeof(Instance));
+    unsigned int eboIndex = m_mesh->AddElementData<unsigned short>(elements);
+
+    // Corner from the first VBO, per-instance world matrix, one column per location, and fade from the second one
+    std::vector<VertexAttribute::Layout> layouts = {
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 2, VertexAttribute::Semantic::Position), 0, 0),
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 4), offsetof(Instance, worldMatrix), sizeof(Instance)),
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 4), offsetof(Instance, worldMatrix) + sizeof(glm::vec4), sizeof(Instance)),
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 4), offsetof(Instance, worldMatrix) + 2 * sizeof(glm::vec4), sizeof(Instance)),
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 4), offsetof(Instance, worldMatrix) + 3 * sizeof(glm::vec4), sizeof(Instance)),
+        VertexAttribute::Layout(VertexAttribute(Data::Type::Float, 1), offsetof(Instance, fade), sizeof(Instance))
+    };
+    unsigned int vboIndices[] = { cornerVboIndex, m_instanceVboIndex, m_instanceVboIndex, m_instanceVboIndex, m_instanceVboIndex, m_instanceVboIndex };
+    m_mesh->AddSubmesh(Drawcall::Primitive::Triangles, 0, static_cast<int>(std::size(elements)), Data::Type::UShort,
+        std::span<unsigned int>(vboIndices), eboIndex, layouts.begin(), layouts.end());
+    unsigned int vaoIndex = m_mesh->GetVertexArrayCount() - 1;
+    for (GLuint location = 1; location < layouts.size(); ++location)
+    {
+        m_mesh->SetVertexArrayDivisor(vaoIndex, location, 1);
+    }
+    m_mesh->SetSubmeshInstanceCount(0, 0);
+
+    m_model = std::make_shared<Model>(m_mesh);
+    m_model->AddMaterial(material);
+    return m_model;
+}
+
+void Impostor::AddInstance(const glm::mat4& worldMatrix, float fade)
+{
+    Instance& instance = m_instances.emplace_back();
+    instance.worldMatrix = worldMatrix;
+    instance.fade = fade;
+}
+
+void Impostor::UpdateModel()
+{
+    assert(m_mesh);
+
+    m_mesh->SetVertexData<Instance>(m_instanceVboIndex, m_instances);
+    m_mesh->SetSubmeshInstanceCount(0, static_cast<GLsizei>(m_instances.size()));
+}
+
+bool Impostor::ReadCache(const char* path)
+{
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    MappedFile file;
+    if (!ModelLoader::GetSourceStamp(path, sourceSize, sourceTime) || !file.Open((std::string(path) + ".impostor").c_str()))
+    {
+        return false;
+    }
+
+    std::span<const std::byte> data = file.GetData();
+    ImpostorCacheHeader header;
+    if (data.size() < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, "IIMP", 4) != 0 || header.version != s_impostorCacheVersion
+        || header.sourceSize != sourceSize || header.sourceTime != sourceTime
+        || header.frameCount != static_cast<uint32_t>(m_frameCount) || header.frameSize != static_cast<uint32_t>(m_frameSize))
+    {
+        return false;
+    }
+
+    int atlasSize = m_frameCount * m_frameSize;
+    size_t layerSize = static_cast<size_t>(atlasSize) * atlasSize * s_impostorTexelSize;
+    std::array<ImpostorCacheLayer, 4> layers = GetCacheLayers(*this);
+    if (data.size() != sizeof(header) + layers.size() * layerSize)
+    {
+        std::cout << "ERROR::IMPOSTOR::CACHE_CORRUPTED\n" << path << std::endl;
+        return false;
+    }
+
+    size_t offset = sizeof(header);
+    for (const ImpostorCacheLayer& layer : layers)
+    {
+        layer.texture->Bind();
+        layer.texture->SetImage<std::byte>(0, atlasSize, atlasSize, layer.format, layer.internalFormat, data.subspan(offset, layerSize), layer.type);
+        offset += layerSize;
+    }
+    Texture2DObject::Unbind();
+
+    m_center = header.center;
+    m_radius = header.radius;
+    return true;
+}
+
+void Impostor::WriteCache(const char* path) const
+{
+    ImpostorCacheHeader header;
+    std::memcpy(header.magic, "IIMP", 4);
+    header.version = s_impostorCacheVersion;
+    if (!ModelLoader::GetSourceStamp(path, header.sourceSize, header.sourceTime))
+    {
+        return;
+    }
+    header.frameCount = static_cast<uint32_t>(m_frameCount);
+    header.frameSize = static_cast<uint32_t>(m_frameSize);
+    header.center = m_center;
+    header.radius = m_radius;
+
+    int atlasSize = m_frameCount * m_frameSize;
+    std::vector<std::byte> layerData(static_cast<size_t>(atlasSize) * atlasSize * s_impostorTexelSize);
+
+    // Write to a temporary file first, so a load running at the same time never maps a partial file
+    std::string cachePath = std::string(path) + ".impostor";
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const ImpostorCacheLayer& layer : GetCacheLayers(*this))
+        {
+            layer.texture->Bind();
+            layer.texture->GetImage<std::byte>(0, layer.format, layerData, layer.type);
+            file.write(reinterpret_cast<const char*>(layerData.data()), layerData.size());
+        }
+        Texture2DObject::Unbind();
+        if (!file)
+        {
+            std::cout << "ERROR::IMPOSTOR::CACHE_WRITE_FAILED\n" << cachePath << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::cout << "ERROR::IMPOSTOR::CACHE_WRITE_FAILED\n" << cachePath << std::endl;
+        std::filesystem::remove(tempPath, error);
+    }
+}
@@ -8,7 +8,10 @@
 #include <ituGL/geometry/Model.h>
 #include <ituGL/lighting/Light.h>
 #include <ituGL/texture/FramebufferObject.h>
+#include <ituGL/camera/Camera.h>
 #include <ituGL/renderer/RenderPass.h>
+#include <ituGL/renderer/Impostor.h>
+#include <glm/geometric.hpp>
 #include <span>
 #include <algorithm>
 #include <cassert>
@@ -18,6 +21,8 @@ Renderer::Renderer(DeviceGL& device)
     , m_currentCamera(nullptr)
     , m_defaultFramebuffer(FramebufferObject::GetDefault())
     , m_currentFramebuffer(m_defaultFramebuffer)
+    , m_lodViewPosition(0.0f)
+    , m_lodProjectionScale(0.0f)
     , m_drawcallCollections(1)
 {
     InitializeFullscreenMesh();
@@ -73,6 +78,12 @@ void Renderer::Render()
 {
     assert(m_currentCamera);
 
+    // Passes can change the camera, keep the main one for the levels of detail of the next frame
+    m_lodViewPosition = m_currentCamera->ExtractTranslation();
+    m_lodProjectionScale = m_currentCamera->GetProjectionMatrix()[1][1];
+
+    AddImpostorDrawcalls();
+
     for (auto& pass : m_passes)
     {
         SetCurrentFramebuffer(pass->GetTargetFramebuffer());
@@ -91,6 +102,12 @@ void Renderer::Reset()
         collection.clear();
     }
 
+    for (Impostor* impostor : m_impostors)
+    {
+        impostor->ClearInstances();
+    }
+    m_impostors.clear();
+
     m_currentCamera = nullptr;
 }
 
@@ -127,11 +144,16 @@ void Renderer::UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgr
 }
 
 void Renderer::UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, const glm::mat4& worldMatrix, bool cameraChanged) const
+{
+    UpdateTransforms(shaderProgramPtr, worldMatrix, *m_currentCamera, cameraChanged);
+}
+
+void Renderer::UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged) const
 {
     const auto& itFind = m_updateTransformsFunctions.find(shaderProgramPtr);
     if (itFind != m_updateTransformsFunctions.end())
     {
-        itFind->second(*shaderProgramPtr, worldMatrix, *m_currentCamera, cameraChanged);
+        itFind->second(*shaderProgramPtr, worldMatrix, camera, cameraChanged);
     }
 }
 
@@ -212,14 +234,47 @@ std::span<const Renderer::DrawcallInfo> Renderer::GetDrawcalls(unsigned int coll
 
 void Renderer::AddModel(const Model& model, const glm::mat4& worldMatrix)
 {
+    unsigned int lod = 0;
+    AddModel(model, worldMatrix, lod);
+}
+
+void Renderer::AddModel(const Model& model, const glm::mat4& worldMatrix, unsigned int& lod)
+{
+    // The fade depends on the distance to the origin of the model, that the shaders can also compute
+    if (Impostor* impostor = model.GetImpostor().get())
+    {
+        float fade = impostor->GetFade(glm::distance(glm::vec3(worldMatrix[3]), GetLodViewPosition()));
+        if (fade > 0.0f)
+        {
+            if (impostor->GetInstanceCount() == 0)
+            {
+                m_impostors.push_back(impostor);
+            }
+            impostor->AddInstance(worldMatrix, fade);
+        }
+        if (fade >= 1.0f)
+        {
+            return;
+        }
+    }
+
     unsigned int worldMatrixIndex = static_cast<unsigned int>(m_worldMatrices.size());
     m_worldMatrices.push_back(worldMatrix);
 
+    if (!model.GetLodScreenSizes().empty())
+    {
+        float screenSize = GetScreenSize(model, worldMatrix);
+        if (screenSize > 0.0f)
+        {
+            lod = model.SelectLod(screenSize, lod);
+        }
+    }
+
     const Mesh& mesh = model.GetMesh();
     for (unsigned int submeshIndex = 0; submeshIndex < mesh.GetSubmeshCount(); ++submeshIndex)
     {
         DrawcallInfo drawcallInfo(model.GetMaterial(submeshIndex), worldMatrixIndex,
-            mesh.GetSubmeshVertexArray(submeshIndex), mesh.GetSubmeshDrawcall(submeshIndex));
+            mesh.GetSubmeshVertexArray(submeshIndex), mesh.GetSubmeshDrawcall(submeshIndex, lod), &mesh, submeshIndex, lod);
 
         for (DrawcallCollection& collection : m_drawcallCollections)
         {
@@ -228,6 +283,25 @@ void Renderer::AddModel(const Model& model, const glm::mat4& worldMatrix)
     }
 }
 
+float Renderer::GetScreenSize(const Model& model, const glm::mat4& worldMatrix) const
+{
+    glm::vec3 viewPosition = GetLodViewPosition();
+    float projectionScale = m_currentCamera ? m_currentCamera->GetProjectionMatrix()[1][1] : m_lodProjectionScale;
+
+    // Sphere around the bounding box, scaled by the largest axis of the world matrix
+    glm::vec3 center = worldMatrix * glm::vec4(0.5f * (model.GetBoundsMin() + model.GetBoundsMax()), 1.0f);
+    float scale = std::max({ glm::length(glm::vec3(worldMatrix[0])), glm::length(glm::vec3(worldMatrix[1])), glm::length(glm::vec3(worldMatrix[2])) });
+    float radius = 0.5f * glm::length(model.GetBoundsMax() - model.GetBoundsMin()) * scale;
+    if (radius <= 0.0f || projectionScale <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    // Inside the sphere, the model covers the whole screen
+    float distance = std::max(glm::distance(center, viewPosition), radius);
+    return radius / distance * projectionScale;
+}
+
 void Renderer::PrepareDrawcall(const DrawcallInfo& drawcallInfo)
 {
     std::shared_ptr<const ShaderProgram> shaderProgram = drawcallInfo.material.GetShaderProgram();
@@ -254,6 +328,24 @@ void Renderer::SetLightingRenderStates(bool firstPass)
     glBlendFunc(GL_ONE, GL_ONE);
 }
 
+glm::vec3 Renderer::GetLodViewPosition() const
+{
+    return m_currentCamera ? m_currentCamera->ExtractTranslation() : m_lodViewPosition;
+}
+
+void Renderer::AddImpostorDrawcalls()
+{
+    // All the instances are known now, each impostor is drawn with a single instanced drawcall
+    for (Impostor* impostor : m_impostors)
+    {
+        if (std::shared_ptr<const Model> impostorModel = impostor->GetModel())
+        {
+            impostor->UpdateModel();
+            AddModel(*impostorModel, glm::mat4(1.0f));
+        }
+    }
+}
+
 void Renderer::InitializeFullscreenMesh()
 {
     VertexFormat vertexFormat;
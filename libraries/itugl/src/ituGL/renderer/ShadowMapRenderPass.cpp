@@ -18,6 +18,7 @@ ShadowMapRenderPass::ShadowMapRenderPass(std::shared_ptr<Light> light, std::shar
     , m_drawcallCollectionIndex(drawcallCollectionIndex)
     , m_volumeCenter(0.0f)
     , m_volumeSize(1.0f)
+    , m_lodBias(0)
 {
     InitFramebuffer();
 }
@@ -31,6 +32,7 @@ ShadowMapRenderPass::ShadowMapRenderPass(std::shared_ptr<Light> light, std::shar
     , m_drawcallCollectionIndex(drawcallCollectionIndex)
     , m_volumeCenter(0.0f)
     , m_volumeSize(1.0f)
+    , m_lodBias(0)
 {
     InitFramebuffer();
 }
@@ -95,7 +97,7 @@ void ShadowMapRenderPass::Render()
         // if no unique materials are defined, use the default one.
         if (m_uniqueMaterials == nullptr) {
             renderer.UpdateTransforms(shaderProgram, drawcallInfo.worldMatrixIndex, first);
-            drawcallInfo.drawcall.Draw();
+            drawcallInfo.GetDrawcall(m_lodBias).Draw();
             first = false;
             continue;
         }
@@ -103,16 +105,23 @@ void ShadowMapRenderPass::Render()
 
         //// Set up object matrix
         // check if the material uses a non-default shadow material.
+        // A replacement for the same material wins over one for the same program, so materials that share a program
+        // but have their own textures can have their own replacements
         bool drawcallShouldUseReplacementMaterial = false;
         int shadowIndex = 0;
         for (size_t i = 0; i < m_uniqueMaterials->size(); i++)
         {
-            drawcallShouldUseReplacementMaterial = drawcallInfo.material.GetShaderProgram() == m_uniqueMaterials->at(i)->GetShaderProgram();
-
-            if (drawcallShouldUseReplacementMaterial) {
+            if (&drawcallInfo.material == m_uniqueMaterials->at(i).get())
+            {
+                drawcallShouldUseReplacementMaterial = true;
                 shadowIndex = i;
                 break;
             }
+            if (!drawcallShouldUseReplacementMaterial && drawcallInfo.material.GetShaderProgram() == m_uniqueMaterials->at(i)->GetShaderProgram())
+            {
+                drawcallShouldUseReplacementMaterial = true;
+                shadowIndex = i;
+            }
         }
 
         // Use unique material if nessecary 
@@ -120,13 +129,13 @@ void ShadowMapRenderPass::Render()
             std::shared_ptr<const Material> replacementMaterial = m_replacementMaterials->at(shadowIndex);
             replacementMaterial->Use();
             renderer.UpdateTransforms(replacementMaterial->GetShaderProgram(), drawcallInfo.worldMatrixIndex, first);
-            drawcallInfo.drawcall.Draw();
+            drawcallInfo.GetDrawcall(m_lodBias).Draw();
             m_material->Use();
         }
         // else use the default empty shader program.
         else {
             renderer.UpdateTransforms(shaderProgram, drawcallInfo.worldMatrixIndex, first);
-            drawcallInfo.drawcall.Draw();
+            drawcallInfo.GetDrawcall(m_lodBias).Draw();
         }
         
         // Render drawcall
@@ -0,0 +1,165 @@
+#include <ituGL/renderer/VirtualTextureFeedbackPass.h>
+
+#include <ituGL/renderer/Renderer.h>
+#include <ituGL/shader/Material.h>
+#include <ituGL/geometry/VertexArrayObject.h>
+#include <ituGL/texture/Texture2DObject.h>
+#include <ituGL/texture/FramebufferObject.h>
+#include <ituGL/texture/VirtualTexture.h>
+#include <cassert>
+
+VirtualTextureFeedbackPass::VirtualTextureFeedbackPass(std::shared_ptr<VirtualTexture> virtualTexture, int width, int height,
+    std::shared_ptr<std::vector<std::shared_ptr<const Material>>> materials,
+    std::shared_ptr<std::vector<std::shared_ptr<const Material>>> feedbackMaterials,
+    int drawcallCollectionIndex)
+    : m_virtualTexture(virtualTexture)
+    , m_width(width)
+    , m_height(height)
+    , m_materials(materials)
+    , m_feedbackMaterials(feedbackMaterials)
+    , m_drawcallCollectionIndex(drawcallCollectionIndex)
+    , m_nextReadback(0)
+{
+    assert(m_virtualTexture);
+    assert(m_materials && m_feedbackMaterials && m_materials->size() == m_feedbackMaterials->size());
+    InitFramebuffer();
+}
+
+VirtualTextureFeedbackPass::~VirtualTextureFeedbackPass()
+{
+    for (Readback& readback : m_readbacks)
+    {
+        if (readback.fence)
+        {
+            glDeleteSync(readback.fence);
+        }
+    }
+}
+
+void VirtualTextureFeedbackPass::InitFramebuffer()
+{
+    // Page requests, alpha 0 where nothing was drawn
+    m_feedbackTexture = std::make_shared<Texture2DObject>();
+    m_feedbackTexture->Bind();
+    m_feedbackTexture->SetImage(0, m_width, m_height, TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA8);
+    m_feedbackTexture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_NEAREST);
+    m_feedbackTexture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_NEAREST);
+
+    // Depth, so only the visible surfaces ask for pages
+    m_depthTexture = std::make_shared<Texture2DObject>();
+    m_depthTexture->Bind();
+    m_depthTexture->SetImage(0, m_width, m_height, TextureObject::FormatDepth, TextureObject::InternalFormatDepth);
+    m_depthTexture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_NEAREST);
+    m_depthTexture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_NEAREST);
+    Texture2DObject::Unbind();
+
+    std::shared_ptr<FramebufferObject> targetFramebuffer = std::make_shared<FramebufferObject>();
+    targetFramebuffer->Bind();
+    targetFramebuffer->SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Depth, *m_depthTexture);
+    targetFramebuffer->SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Color0, *m_feedbackTexture);
+    FramebufferObject::Unbind();
+
+    m_targetFramebuffer = targetFramebuffer;
+}
+
+void VirtualTextureFeedbackPass::Render()
+{
+    Renderer& renderer = GetRenderer();
+    DeviceGL& device = renderer.GetDevice();
+
+    // The copies started a couple of frames ago are usually complete by now
+    ReadFeedback();
+
+    const auto& drawcallCollection = renderer.GetDrawcalls(m_drawcallCollectionIndex);
+
+    device.Clear(true, Color(0.0f, 0.0f, 0.0f, 0.0f), true, 1.0f);
+
+    // Backup current viewport
+    glm::ivec4 currentViewport;
+    device.GetViewport(currentViewport.x, currentViewport.y, currentViewport.z, currentViewport.w);
+    device.SetViewport(0, 0, m_width, m_height);
+
+    bool first = true;
+    for (const Renderer::DrawcallInfo& drawcallInfo : drawcallCollection)
+    {
+        // Only the drawcalls that sample the virtual texture
+        size_t materialIndex = 0;
+        while (materialIndex < m_materials->size() && drawcallInfo.material.GetShaderProgram() != m_materials->at(materialIndex)->GetShaderProgram())
+        {
+            ++materialIndex;
+        }
+        if (materialIndex == m_materials->size())
+        {
+            continue;
+        }
+
+        std::shared_ptr<const Material> feedbackMaterial = m_feedbackMaterials->at(materialIndex);
+        feedbackMaterial->Use();
+        drawcallInfo.vao.Bind();
+        renderer.UpdateTransforms(feedbackMaterial->GetShaderProgram(), drawcallInfo.worldMatrixIndex, first);
+        drawcallInfo.drawcall.Draw();
+        first = false;
+    }
+
+    StartReadback();
+
+    // Restore viewport
+    device.SetViewport(currentViewport.x, currentViewport.y, currentViewport.z, currentViewport.w);
+
+    // Restore default framebuffer to avoid drawing to the feedback target
+    renderer.SetCurrentFramebuffer(renderer.GetDefaultFramebuffer());
+}
+
+void VirtualTextureFeedbackPass::ReadFeedback()
+{
+    size_t size = static_cast<size_t>(m_width) * m_height * sizeof(uint32_t);
+    for (int i = 0; i < ReadbackCount; ++i)
+    {
+        Readback& readback = m_readbacks[(m_nextReadback + i) % ReadbackCount];
+        if (!readback.fence)
+        {
+            continue;
+        }
+
+        // The later ones can't be complete either
+        GLenum result = glClientWaitSync(readback.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            break;
+        }
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+
+        readback.buffer.Bind();
+        std::span<std::byte> data = readback.buffer.MapData(0, size, GL_MAP_READ_BIT);
+        if (!data.empty())
+        {
+            m_virtualTexture->AddFeedback(std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(data.data()), data.size() / sizeof(uint32_t)));
+            readback.buffer.UnmapData();
+        }
+        PixelPackBufferObject::Unbind();
+    }
+}
+
+void VirtualTextureFeedbackPass::StartReadback()
+{
+    Readback& readback = m_readbacks[m_nextReadback];
+    if (readback.fence)
+    {
+        return;
+    }
+
+    size_t size = static_cast<size_t>(m_width) * m_height * sizeof(uint32_t);
+    readback.buffer.Bind();
+    if (readback.buffer.GetSize() < size)
+    {
+        readback.buffer.AllocateData(size, BufferObject::StreamRead);
+    }
+
+    // The target is bound, while the pack buffer is bound the copy goes to it and the call returns right away
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    PixelPackBufferObject::Unbind();
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_nextReadback = (m_nextReadback + 1) % ReadbackCount;
+}
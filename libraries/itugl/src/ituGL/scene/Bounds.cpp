@@ -1,5 +1,7 @@
 #include <ituGL/scene/Bounds.h>
 
+#include <glm/geometric.hpp>
+
 SphereBounds::SphereBounds(const Bounds& bounds) : Bounds(bounds.GetCenter()), m_radius(0.0f)
 {
     switch (bounds.GetType())
@@ -8,10 +10,10 @@ SphereBounds::SphereBounds(const Bounds& bounds) : Bounds(bounds.GetCenter()), m
         m_radius = static_cast<const SphereBounds&>(bounds).GetRadius();
         break;
     case Type::AABB:
-        m_radius = static_cast<const AabbBounds&>(bounds).GetSize().length();
+        m_radius = glm::length(static_cast<const AabbBounds&>(bounds).GetSize());
         break;
     case Type::Box:
-        m_radius = static_cast<const BoxBounds&>(bounds).GetSize().length();
+        m_radius = glm::length(static_cast<const BoxBounds&>(bounds).GetSize());
         break;
     default:
         assert(false);
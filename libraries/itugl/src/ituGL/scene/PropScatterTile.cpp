@@ -0,0 +1,108 @@
+#include <ituGL/scene/PropScatterTile.h>
+
+#include <ituGL/geometry/Model.h>
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/scene/SceneModel.h>
+#include <ituGL/scene/Transform.h>
+#include <cassert>
+
+PropScatterTile::PropScatterTile(int tileX, int tileY, const glm::vec2& center, float size, std::shared_ptr<const Settings> settings,
+    AssetLoadQueue& loadQueue)
+    : WorldTile(tileX, tileY)
+    , m_settings(settings)
+    , m_loadQueue(loadQueue)
+    , m_center(center)
+    , m_size(size)
+    , m_byteSize(0)
+{
+    assert(m_settings);
+}
+
+bool PropScatterTile::Load()
+{
+    if (!m_propScatter)
+    {
+        for (const PropType& propType : m_settings->propTypes)
+        {
+            if (propType.model.valid() && propType.model.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                return false;
+            }
+        }
+
+        // The model of each type is copied with a mesh that reads the shared buffers, so the scatter adds the instance
+        // data to the tile only. The byte size of the tile is then its instance buffers
+        m_propScatter = std::make_shared<PropScatter>(m_size, m_settings->chunkSize, m_center);
+        for (unsigned int i = 0; i < m_settings->propTypes.size(); ++i)
+        {
+            const PropType& propType = m_settings->propTypes[i];
+            std::shared_ptr<Model> sharedModel = propType.model.valid() ? propType.model.get() : nullptr;
+            if (!sharedModel)
+            {
+                continue;
+            }
+
+            std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+            mesh->AddSharedSubmeshes(std::shared_ptr<const Mesh>(sharedModel, &sharedModel->GetMesh()));
+            std::shared_ptr<Model> model = std::make_shared<Model>(*sharedModel);
+            model->SetMesh(mesh);
+            m_propScatter->AddPropType(model, m_settings->instanceLocation, propType.weight, propType.minScale, propType.maxScale);
+            m_propTypeIndices.push_back(i);
+        }
+
+        // Nothing to scatter if none of the models loaded
+        if (m_propScatter->GetPropTypeCount() == 0)
+        {
+            return true;
+        }
+
+        // Generate the props on a worker. The density is given over the tile, and the settings over the models
+        PropScatter::DensityFunction densityFunction;
+        if (m_settings->densityFunction)
+        {
+            glm::vec2 tileMin = m_center - 0.5f * m_size;
+            float size = m_size;
+            std::shared_ptr<const Settings> settings = m_settings;
+            densityFunction = [settings, tileMin, size](const glm::vec2& uv) { return settings->densityFunction(tileMin + uv * size); };
+        }
+
+        unsigned int seed = m_settings->seed ^ (static_cast<unsigned int>(GetTileX()) * 73856093u) ^ (static_cast<unsigned int>(GetTileY()) * 19349663u);
+        std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+        m_generated = promise->get_future();
+        AssetLoadQueue* loadQueue = &m_loadQueue;
+        float minDistance = m_settings->minDistance;
+        m_loadQueue.SubmitWork([propScatter = m_propScatter, minDistance, seed, loadQueue, densityFunction, promise]() mutable
+            {
+                propScatter->Generate(minDistance, seed, *loadQueue, densityFunction);
+
+                // The tile might be gone, and the models must not be released on the worker.
+                // The finish task takes the last reference to the GL thread
+                loadQueue->SubmitUpload([]() {}, [propScatter = std::move(propScatter), promise]()
+                    {
+                        promise->set_value();
+                    });
+            });
+        return false;
+    }
+
+    if (m_generated.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        return false;
+    }
+    m_generated.get();
+
+    // One scene model per type, with a name unique to the tile
+    std::string suffix = " (" + std::to_string(GetTileX()) + ", " + std::to_string(GetTileY()) + ")";
+    m_byteSize += static_cast<size_t>(m_propScatter->GetInstanceCount()) * (4 * sizeof(float));
+    for (unsigned int i = 0; i < m_propScatter->GetPropTypeCount(); ++i)
+    {
+        const PropType& propType = m_settings->propTypes[m_propTypeIndices[i]];
+        AddSceneNode(std::make_shared<SceneModel>(propType.name + suffix, m_propScatter->GetModel(i), m_settings->transform));
+    }
+    return true;
+}
+
+bool PropScatterTile::IsBusy() const
+{
+    return m_generated.valid() && m_generated.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
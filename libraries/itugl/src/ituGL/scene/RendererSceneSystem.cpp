@@ -0,0 +1,42 @@
+#include <ituGL/scene/RendererSceneSystem.h>
+
+#include <ituGL/renderer/Renderer.h>
+#include <ituGL/scene/Scene.h>
+#include <cassert>
+
+RendererSceneSystem::RendererSceneSystem(Renderer& renderer) : m_renderer(renderer)
+{
+}
+
+void RendererSceneSystem::Render(Scene& scene)
+{
+    SceneRegistry& registry = scene.GetRegistry();
+
+    // The camera first, the models choose their level of detail from it
+    for (const SceneCameraComponent& camera : registry.GetCameras().GetComponents())
+    {
+        assert(!m_renderer.HasCamera()); // Currently, only one camera per scene supported
+        m_renderer.SetCurrentCamera(*camera.camera);
+    }
+
+    for (const SceneLightComponent& light : registry.GetLights().GetComponents())
+    {
+        m_renderer.AddLight(*light.light);
+    }
+
+    // The transform is found through the sparse array of the transform pool. A node can drop its transform and keep the
+    // model, with SceneNode::SetTransform, and then it isn't drawn
+    SceneComponentPool<SceneModelComponent>& models = registry.GetModels();
+    const SceneComponentPool<SceneTransformComponent>& transforms = registry.GetTransforms();
+    std::span<const SceneEntity> entities = models.GetEntities();
+    std::span<SceneModelComponent> modelComponents = models.GetComponents();
+    for (size_t i = 0; i < modelComponents.size(); ++i)
+    {
+        if (!transforms.Has(entities[i]))
+        {
+            continue;
+        }
+        SceneModelComponent& model = modelComponents[i];
+        m_renderer.AddModel(*model.model, transforms.Get(entities[i]).worldMatrix, model.lod);
+    }
+}
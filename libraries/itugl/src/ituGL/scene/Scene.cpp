@@ -2,26 +2,32 @@
 
 #include <ituGL/scene/SceneNode.h>
 #include <ituGL/scene/SceneVisitor.h>
+#include <ituGL/scene/Transform.h>
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <algorithm>
 #include <cassert>
 
+// Transforms read by each task of UpdateWorldMatrices
+static constexpr unsigned int s_chunkSize = 4096;
+
 Scene::Scene()
 {
 }
 
 Scene::~Scene()
 {
-    for (auto& pair : m_nodes)
+    for (const std::shared_ptr<SceneNode>& node : m_registry.GetNodes().GetComponents())
     {
-        pair.second->SetOwnerScene(nullptr);
+        node->SetOwnerScene(nullptr);
     }
 }
 
 std::shared_ptr<SceneNode> Scene::GetSceneNode(const std::string& name) const
 {
-    auto it = m_nodes.find(name);
-    if (it != m_nodes.end())
+    auto it = m_entities.find(name);
+    if (it != m_entities.end())
     {
-        return it->second;
+        return m_registry.GetNodes().Get(it->second);
     }
     return nullptr;
 }
@@ -29,26 +35,34 @@ std::shared_ptr<SceneNode> Scene::GetSceneNode(const std::string& name) const
 bool Scene::AddSceneNode(std::shared_ptr<SceneNode> node)
 {
     assert(node);
-    m_nodes[node->GetName()] = node;
-    node->SetOwnerScene(this);
+    RemoveSceneNode(node->GetName());
+
+    SceneEntity entity = m_registry.CreateEntity();
+    m_registry.GetNodes().Add(entity, node);
+    m_entities[node->GetName()] = entity;
+    node->SetOwnerScene(this, entity);
+    node->AddComponents(m_registry);
     return true;
 }
 
 bool Scene::RemoveSceneNode(std::shared_ptr<SceneNode> node)
 {
-    assert(m_nodes.find(node->GetName()) == m_nodes.end() || m_nodes.find(node->GetName())->second == node);
+    assert(GetSceneNode(node->GetName()) == nullptr || GetSceneNode(node->GetName()) == node);
     return RemoveSceneNode(node->GetName());
 }
 
 bool Scene::RemoveSceneNode(const std::string& name)
 {
-    auto it = m_nodes.find(name);
-    if (it != m_nodes.end())
+    auto it = m_entities.find(name);
+    if (it != m_entities.end())
     {
-        assert(it->second);
-        assert(it->second->GetOwnerScene() == this);
-        it->second->SetOwnerScene(nullptr);
-        m_nodes.erase(it);
+        // Keep the node alive until it is detached, the registry may have the last reference
+        std::shared_ptr<SceneNode> node = m_registry.GetNodes().Get(it->second);
+        assert(node);
+        assert(node->GetOwnerScene() == this);
+        m_registry.DestroyEntity(it->second);
+        m_entities.erase(it);
+        node->SetOwnerScene(nullptr);
         return true;
     }
     return false;
@@ -56,16 +70,63 @@ bool Scene::RemoveSceneNode(const std::string& name)
 
 void Scene::AcceptVisitor(SceneVisitor& visitor)
 {
-    for (auto& pair : m_nodes)
+    for (const std::shared_ptr<SceneNode>& node : m_registry.GetNodes().GetComponents())
     {
-        pair.second->AcceptVisitor(visitor);
+        node->AcceptVisitor(visitor);
     }
 }
 
 void Scene::AcceptVisitor(SceneVisitor& visitor) const
 {
-    for (auto& pair : m_nodes)
+    for (const std::shared_ptr<SceneNode>& node : m_registry.GetNodes().GetComponents())
+    {
+        node->AcceptVisitor(visitor);
+    }
+}
+
+void Scene::UpdateWorldMatrices(AssetLoadQueue* loadQueue)
+{
+    std::span<SceneTransformComponent> transforms = m_registry.GetTransforms().GetComponents();
+    unsigned int count = static_cast<unsigned int>(transforms.size());
+    unsigned int chunkCount = (count + s_chunkSize - 1) / s_chunkSize;
+
+    // Reading the cached matrix of a transform that is up to date changes nothing, so the chunks can run in parallel.
+    // The dirty ones write their cache and the cache of their parents, that other nodes may share
+    std::vector<std::vector<unsigned int>> dirtyIndices(chunkCount);
+    auto updateChunk = [&](unsigned int chunkIndex)
+    {
+        unsigned int first = chunkIndex * s_chunkSize;
+        unsigned int last = std::min(first + s_chunkSize, count);
+        for (unsigned int index = first; index < last; ++index)
+        {
+            const Transform& transform = *transforms[index].transform;
+            if (transform.IsDirty())
+            {
+                dirtyIndices[chunkIndex].push_back(index);
+            }
+            else
+            {
+                transforms[index].worldMatrix = transform.GetTransformMatrix();
+            }
+        }
+    };
+    if (loadQueue && chunkCount > 1)
+    {
+        loadQueue->ParallelFor(chunkCount, updateChunk);
+    }
+    else
+    {
+        for (unsigned int chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+        {
+            updateChunk(chunkIndex);
+        }
+    }
+
+    for (const std::vector<unsigned int>& chunkDirtyIndices : dirtyIndices)
     {
-        pair.second->AcceptVisitor(visitor);
+        for (unsigned int index : chunkDirtyIndices)
+        {
+            transforms[index].worldMatrix = transforms[index].transform->GetTransformMatrix();
+        }
     }
 }
@@ -29,6 +29,26 @@ std::shared_ptr<const Camera> SceneCamera::GetCamera() const
 void SceneCamera::SetCamera(std::shared_ptr<Camera> camera)
 {
     m_camera = camera;
+    if (SceneRegistry* registry = GetRegistry())
+    {
+        if (m_camera)
+        {
+            registry->GetCameras().Add(GetEntity(), { m_camera.get() });
+        }
+        else
+        {
+            registry->GetCameras().Remove(GetEntity());
+        }
+    }
+}
+
+void SceneCamera::AddComponents(SceneRegistry& registry)
+{
+    SceneNode::AddComponents(registry);
+    if (m_camera)
+    {
+        registry.GetCameras().Add(GetEntity(), { m_camera.get() });
+    }
 }
 
 void SceneCamera::AcceptVisitor(SceneVisitor& visitor)
@@ -24,6 +24,26 @@ std::shared_ptr<Light> SceneLight::GetLight() const
 void SceneLight::SetLight(std::shared_ptr<Light> light)
 {
     m_light = light;
+    if (SceneRegistry* registry = GetRegistry())
+    {
+        if (m_light)
+        {
+            registry->GetLights().Add(GetEntity(), { m_light.get() });
+        }
+        else
+        {
+            registry->GetLights().Remove(GetEntity());
+        }
+    }
+}
+
+void SceneLight::AddComponents(SceneRegistry& registry)
+{
+    SceneNode::AddComponents(registry);
+    if (m_light)
+    {
+        registry.GetLights().Add(GetEntity(), { m_light.get() });
+    }
 }
 
 void SceneLight::AcceptVisitor(SceneVisitor& visitor)
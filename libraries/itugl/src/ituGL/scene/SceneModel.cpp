@@ -6,11 +6,11 @@
 #include <ituGL/scene/SceneVisitor.h>
 #include <cassert>
 
-SceneModel::SceneModel(const std::string& name, std::shared_ptr<Model> model) : SceneNode(name), m_model(model)
+SceneModel::SceneModel(const std::string& name, std::shared_ptr<Model> model) : SceneNode(name), m_model(model), m_lod(0)
 {
 }
 
-SceneModel::SceneModel(const std::string& name, std::shared_ptr<Model> model, std::shared_ptr<Transform> transform) : SceneNode(name, transform), m_model(model)
+SceneModel::SceneModel(const std::string& name, std::shared_ptr<Model> model, std::shared_ptr<Transform> transform) : SceneNode(name, transform), m_model(model), m_lod(0)
 {
 }
 
@@ -22,6 +22,44 @@ std::shared_ptr<Model> SceneModel::GetModel() const
 void SceneModel::SetModel(std::shared_ptr<Model> model)
 {
     m_model = model;
+    m_lod = 0;
+    if (SceneRegistry* registry = GetRegistry())
+    {
+        if (m_model)
+        {
+            registry->GetModels().Add(GetEntity(), { m_model.get(), m_lod });
+        }
+        else
+        {
+            registry->GetModels().Remove(GetEntity());
+        }
+    }
+}
+
+unsigned int SceneModel::GetLod() const
+{
+    // RendererSceneSystem writes it in the component
+    SceneRegistry* registry = GetRegistry();
+    return registry && registry->GetModels().Has(GetEntity()) ? registry->GetModels().Get(GetEntity()).lod : m_lod;
+}
+
+void SceneModel::SetLod(unsigned int lod)
+{
+    m_lod = lod;
+    SceneRegistry* registry = GetRegistry();
+    if (registry && registry->GetModels().Has(GetEntity()))
+    {
+        registry->GetModels().Get(GetEntity()).lod = lod;
+    }
+}
+
+void SceneModel::AddComponents(SceneRegistry& registry)
+{
+    SceneNode::AddComponents(registry);
+    if (m_model)
+    {
+        registry.GetModels().Add(GetEntity(), { m_model.get(), m_lod });
+    }
 }
 
 /*glm::mat4 SceneModel::GetWorldMatrix() const
@@ -49,6 +49,30 @@ std::shared_ptr<const Transform> SceneNode::GetTransform() const
 void SceneNode::SetTransform(std::shared_ptr<Transform> transform)
 {
     m_transform = transform;
+    if (SceneRegistry* registry = GetRegistry())
+    {
+        if (m_transform)
+        {
+            registry->GetTransforms().Add(m_entity, { m_transform.get(), m_transform->GetTransformMatrix() });
+        }
+        else
+        {
+            registry->GetTransforms().Remove(m_entity);
+        }
+    }
+}
+
+void SceneNode::AddComponents(SceneRegistry& registry)
+{
+    if (m_transform)
+    {
+        registry.GetTransforms().Add(m_entity, { m_transform.get(), m_transform->GetTransformMatrix() });
+    }
+}
+
+SceneRegistry* SceneNode::GetRegistry() const
+{
+    return m_scene ? &m_scene->GetRegistry() : nullptr;
 }
 
 Scene* SceneNode::GetOwnerScene() const
@@ -56,9 +80,10 @@ Scene* SceneNode::GetOwnerScene() const
     return m_scene;
 }
 
-void SceneNode::SetOwnerScene(Scene* scene)
+void SceneNode::SetOwnerScene(Scene* scene, SceneEntity entity)
 {
     m_scene = scene;
+    m_entity = entity;
 }
 
 SphereBounds SceneNode::GetSphereBounds() const
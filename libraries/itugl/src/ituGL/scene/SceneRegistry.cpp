@@ -0,0 +1,47 @@
+#include <ituGL/scene/SceneRegistry.h>
+
+SceneRegistry::SceneRegistry() : m_entityCount(0)
+{
+}
+
+SceneEntity SceneRegistry::CreateEntity()
+{
+    SceneEntity entity;
+    if (!m_freeIndices.empty())
+    {
+        entity.index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    else
+    {
+        entity.index = static_cast<uint32_t>(m_generations.size());
+        m_generations.push_back(0);
+    }
+    entity.generation = m_generations[entity.index];
+    ++m_entityCount;
+    return entity;
+}
+
+void SceneRegistry::DestroyEntity(SceneEntity entity)
+{
+    if (!IsAlive(entity))
+    {
+        return;
+    }
+
+    m_nodes.Remove(entity);
+    m_transforms.Remove(entity);
+    m_models.Remove(entity);
+    m_lights.Remove(entity);
+    m_cameras.Remove(entity);
+
+    // The handles to the old entity are not alive anymore
+    ++m_generations[entity.index];
+    m_freeIndices.push_back(entity.index);
+    --m_entityCount;
+}
+
+bool SceneRegistry::IsAlive(SceneEntity entity) const
+{
+    return entity.index < m_generations.size() && m_generations[entity.index] == entity.generation;
+}
@@ -0,0 +1,65 @@
+#include <ituGL/scene/TextureStreamingSceneVisitor.h>
+
+#include <ituGL/texture/TextureStreamer.h>
+#include <ituGL/camera/Camera.h>
+#include <ituGL/scene/SceneModel.h>
+#include <ituGL/geometry/Model.h>
+#include <ituGL/shader/Material.h>
+#include <glm/geometric.hpp>
+#include <algorithm>
+
+TextureStreamingSceneVisitor::TextureStreamingSceneVisitor(TextureStreamer& textureStreamer, const Camera& camera, float viewportHeight)
+    : m_textureStreamer(textureStreamer), m_camera(camera), m_viewportHeight(viewportHeight)
+{
+}
+
+void TextureStreamingSceneVisitor::VisitModel(SceneModel& sceneModel)
+{
+    std::shared_ptr<Model> model = sceneModel.GetModel();
+    if (!model || !sceneModel.GetTransform())
+    {
+        return;
+    }
+
+    SphereBounds bounds = sceneModel.GetSphereBounds();
+    glm::vec4 center(bounds.GetCenter(), 1.0f);
+    float radius = bounds.GetRadius();
+
+    // Skip the model if the sphere is outside any of the frustum planes, extracted from the rows of the view-projection matrix
+    glm::mat4 viewProjMatrix = glm::transpose(m_camera.GetViewProjectionMatrix());
+    for (int i = 0; i < 3; ++i)
+    {
+        for (float sign : { 1.0f, -1.0f })
+        {
+            glm::vec4 plane = viewProjMatrix[3] + sign * viewProjMatrix[i];
+            if (glm::dot(plane, center) < -radius * glm::length(glm::vec3(plane)))
+            {
+                return;
+            }
+        }
+    }
+
+    // Projected diameter in pixels. Close to the camera, the distance is clamped to the radius
+    float distance = std::max(-(m_camera.GetViewMatrix() * center).z, radius);
+    float screenSize = radius / distance * m_camera.GetProjectionMatrix()[1][1] * m_viewportHeight;
+
+    for (unsigned int i = 0; i < model->GetMaterialCount(); ++i)
+    {
+        const Material& material = model->GetMaterial(i);
+        std::shared_ptr<const ShaderUniformLayout> layout = material.GetLayout();
+        if (!layout)
+        {
+            continue;
+        }
+
+        for (const ShaderUniformLayout::TextureUniform& textureUniform : layout->GetTextureUniforms())
+        {
+            std::shared_ptr<const TextureObject> texture;
+            material.GetUniformValue(textureUniform.location, texture);
+            if (texture)
+            {
+                m_textureStreamer.RequestScreenSize(*texture, screenSize);
+            }
+        }
+    }
+}
@@ -0,0 +1,204 @@
+#include <ituGL/scene/WorldStreamer.h>
+
+#include <ituGL/scene/Scene.h>
+#include <ituGL/scene/SceneNode.h>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cassert>
+
+WorldTile::WorldTile(int tileX, int tileY) : m_tileX(tileX), m_tileY(tileY)
+{
+}
+
+WorldTile::~WorldTile()
+{
+}
+
+void WorldTile::AddSceneNode(std::shared_ptr<SceneNode> sceneNode)
+{
+    assert(sceneNode);
+    m_sceneNodes.push_back(sceneNode);
+}
+
+WorldStreamer::WorldStreamer(Scene& scene, const glm::vec3& origin, float tileSize, CreateTileFunction createTileFunction)
+    : m_scene(scene)
+    , m_origin(origin)
+    , m_tileSize(tileSize)
+    , m_createTileFunction(createTileFunction)
+    , m_loadRadius(tileSize)
+    , m_unloadRadius(2.0f * tileSize)
+    , m_bounded(false)
+    , m_minTile(std::numeric_limits<int>::min())
+    , m_maxTile(std::numeric_limits<int>::max())
+    , m_loadsPerFrame(2)
+    , m_showsPerFrame(1)
+{
+    assert(tileSize > 0.0f);
+    assert(m_createTileFunction);
+}
+
+WorldStreamer::~WorldStreamer()
+{
+    for (auto& tilePair : m_tiles)
+    {
+        HideTile(tilePair.second);
+    }
+}
+
+void WorldStreamer::SetRadii(float loadRadius, float unloadRadius)
+{
+    assert(loadRadius >= 0.0f && unloadRadius >= loadRadius);
+    m_loadRadius = loadRadius;
+    m_unloadRadius = unloadRadius;
+}
+
+void WorldStreamer::SetBounds(const glm::ivec2& minTile, const glm::ivec2& maxTile)
+{
+    assert(minTile.x <= maxTile.x && minTile.y <= maxTile.y);
+    m_bounded = true;
+    m_minTile = minTile;
+    m_maxTile = maxTile;
+}
+
+void WorldStreamer::Update(const glm::vec3& position)
+{
+    // Evict the tiles that are too far, shown or not. The ones still loading are released, and finish on their own
+    for (auto it = m_tiles.begin(); it != m_tiles.end(); )
+    {
+        TileState& tileState = it->second;
+        if (GetTileDistance(position, tileState.tile->GetTileX(), tileState.tile->GetTileY()) > m_unloadRadius)
+        {
+            if (tileState.shown)
+            {
+                HideTile(tileState);
+                ++m_stats.evictedTiles;
+            }
+            else
+            {
+                ++m_stats.cancelledTiles;
+                if (tileState.tile->IsBusy())
+                {
+                    m_cancelledTiles.push_back(tileState.tile);
+                }
+            }
+            it = m_tiles.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    std::erase_if(m_cancelledTiles, [](const std::shared_ptr<WorldTile>& tile) { return !tile->IsBusy(); });
+
+    // Tiles in the load radius that are missing, the closest first
+    glm::vec2 local = glm::vec2(position.x - m_origin.x, position.z - m_origin.z) / m_tileSize;
+    float tileRadius = m_loadRadius / m_tileSize;
+    glm::ivec2 minTile = glm::ivec2(glm::floor(local - tileRadius));
+    glm::ivec2 maxTile = glm::ivec2(glm::floor(local + tileRadius));
+    if (m_bounded)
+    {
+        minTile = glm::max(minTile, m_minTile);
+        maxTile = glm::min(maxTile, m_maxTile);
+    }
+
+    std::vector<std::pair<float, glm::ivec2>> missingTiles;
+    for (int tileY = minTile.y; tileY <= maxTile.y; ++tileY)
+    {
+        for (int tileX = minTile.x; tileX <= maxTile.x; ++tileX)
+        {
+            float distance = GetTileDistance(position, tileX, tileY);
+            if (distance <= m_loadRadius && m_tiles.find(GetTileKey(tileX, tileY)) == m_tiles.end())
+            {
+                missingTiles.emplace_back(distance, glm::ivec2(tileX, tileY));
+            }
+        }
+    }
+    std::sort(missingTiles.begin(), missingTiles.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    unsigned int loadCount = std::min(static_cast<unsigned int>(missingTiles.size()), m_loadsPerFrame);
+    for (unsigned int i = 0; i < loadCount; ++i)
+    {
+        glm::ivec2 tile = missingTiles[i].second;
+        std::shared_ptr<WorldTile> worldTile = m_createTileFunction(tile.x, tile.y);
+        if (worldTile)
+        {
+            m_tiles[GetTileKey(tile.x, tile.y)] = TileState{ worldTile, false, false };
+        }
+    }
+
+    // Continue the loads, and show the tiles that are ready, up to the budget
+    unsigned int showCount = 0;
+    m_stats.loadingTiles = 0;
+    m_stats.loadingBytes = 0;
+    for (auto& tilePair : m_tiles)
+    {
+        TileState& tileState = tilePair.second;
+        if (!tileState.loaded)
+        {
+            tileState.loaded = tileState.tile->Load();
+        }
+        if (tileState.loaded && !tileState.shown && showCount < m_showsPerFrame)
+        {
+            ShowTile(tileState);
+            ++showCount;
+            ++m_stats.shownTiles;
+        }
+        if (!tileState.shown)
+        {
+            ++m_stats.loadingTiles;
+            m_stats.loadingBytes += tileState.tile->GetByteSize();
+        }
+    }
+    for (const std::shared_ptr<WorldTile>& tile : m_cancelledTiles)
+    {
+        m_stats.loadingBytes += tile->GetByteSize();
+    }
+
+    m_stats.residentTiles = static_cast<unsigned int>(m_residentTiles.size());
+    m_stats.residentBytes = 0;
+    for (const std::shared_ptr<WorldTile>& tile : m_residentTiles)
+    {
+        m_stats.residentBytes += tile->GetByteSize();
+    }
+}
+
+float WorldStreamer::GetTileDistance(const glm::vec3& position, int tileX, int tileY) const
+{
+    glm::vec2 tileMin = glm::vec2(m_origin.x, m_origin.z) + glm::vec2(tileX, tileY) * m_tileSize;
+    glm::vec2 point(position.x, position.z);
+    return glm::distance(point, glm::clamp(point, tileMin, tileMin + m_tileSize));
+}
+
+void WorldStreamer::ShowTile(TileState& tileState)
+{
+    for (const std::shared_ptr<SceneNode>& sceneNode : tileState.tile->GetSceneNodes())
+    {
+        m_scene.AddSceneNode(sceneNode);
+    }
+    m_residentTiles.push_back(tileState.tile);
+    tileState.shown = true;
+}
+
+void WorldStreamer::HideTile(TileState& tileState)
+{
+    if (!tileState.shown)
+    {
+        return;
+    }
+
+    for (const std::shared_ptr<SceneNode>& sceneNode : tileState.tile->GetSceneNodes())
+    {
+        m_scene.RemoveSceneNode(sceneNode);
+    }
+    m_residentTiles.erase(std::find(m_residentTiles.begin(), m_residentTiles.end(), tileState.tile));
+    tileState.shown = false;
+}
+
+int64_t WorldStreamer::GetTileKey(int tileX, int tileY)
+{
+    return (static_cast<int64_t>(tileY) << 32) | static_cast<uint32_t>(tileX);
+}
@@ -2,12 +2,14 @@
 #include <ituGL/core/DeviceGL.h>
 #include <cassert>
 
-Material::Material() : Material(nullptr)
+Material::Material() : Material(std::shared_ptr<ShaderProgram>())
 {
 }
 
 Material::Material(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms)
     : ShaderUniformCollection(shaderProgram, filteredUniforms)
+    , m_keywords(ShaderVariantSet::NoKeywords)
+    , m_filteredUniforms(filteredUniforms)
     , m_depthTestFunction(TestFunction::Less)
     , m_depthWrite(true)
     , m_stencilTestFunctions{ TestFunction::Never, TestFunction::Never }
@@ -22,6 +24,44 @@ Material::Material(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet&
 {
 }
 
+Material::Material(std::shared_ptr<ShaderVariantSet> shaderVariants, ShaderVariantSet::KeywordMask keywords, const NameSet& filteredUniforms)
+    : Material(shaderVariants->GetVariant(keywords), filteredUniforms)
+{
+    m_shaderVariants = shaderVariants;
+    m_keywords = keywords & shaderVariants->GetSupportedKeywords();
+}
+
+Material::Material(std::shared_ptr<const Material> baseMaterial)
+    : ShaderUniformCollection(std::static_pointer_cast<const ShaderUniformCollection>(baseMaterial))
+    , m_keywords(baseMaterial->m_keywords)
+    , m_shaderSetupFunction(baseMaterial->m_shaderSetupFunction)
+    , m_depthTestFunction(baseMaterial->m_depthTestFunction)
+    , m_depthWrite(baseMaterial->m_depthWrite)
+    , m_stencilTestFunctions(baseMaterial->m_stencilTestFunctions)
+    , m_stencilRefValues(baseMaterial->m_stencilRefValues)
+    , m_stencilMasks(baseMaterial->m_stencilMasks)
+    , m_stencilFail(baseMaterial->m_stencilFail)
+    , m_stencilDepthFail(baseMaterial->m_stencilDepthFail)
+    , m_stencilDepthPass(baseMaterial->m_stencilDepthPass)
+    , m_blendEquations(baseMaterial->m_blendEquations)
+    , m_blendParams(baseMaterial->m_blendParams)
+    , m_cullMode(baseMaterial->m_cullMode)
+    , m_blendColor(baseMaterial->m_blendColor)
+{
+    // The variant set is not copied, instances can't change the shader of their base
+}
+
+void Material::SetKeywords(ShaderVariantSet::KeywordMask keywords)
+{
+    assert(m_shaderVariants);
+    keywords &= m_shaderVariants->GetSupportedKeywords();
+    if (keywords != m_keywords)
+    {
+        ChangeShader(m_shaderVariants->GetVariant(keywords), m_filteredUniforms, true);
+        m_keywords = keywords;
+    }
+}
+
 void Material::SetShaderSetupFunction(ShaderSetupFunction shaderSetupFunction)
 {
     m_shaderSetupFunction = shaderSetupFunction;
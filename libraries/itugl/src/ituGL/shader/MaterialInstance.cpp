@@ -0,0 +1,6 @@
+#include <ituGL/shader/MaterialInstance.h>
+
+MaterialInstance::MaterialInstance(std::shared_ptr<const Material> baseMaterial)
+    : Material(baseMaterial), m_baseMaterial(baseMaterial)
+{
+}
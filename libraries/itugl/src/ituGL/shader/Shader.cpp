@@ -62,6 +62,24 @@ bool Shader::Compile()
     return IsCompiled();
 }
 
+// Start compiling the shader source code, without querying the result
+void Shader::CompileAsync()
+{
+    assert(IsValid());
+
+    glCompileShader(GetHandle());
+}
+
+// Check, without blocking, if the compilation has finished
+bool Shader::IsCompilationComplete() const
+{
+    assert(IsValid());
+
+    GLint complete;
+    glGetShaderiv(GetHandle(), GL_COMPLETION_STATUS_KHR, &complete);
+    return complete;
+}
+
 // Check if the shader has been successfully compiled
 bool Shader::IsCompiled() const
 {
@@ -82,13 +82,23 @@ bool ShaderProgram::Build(const Shader& vertexShader, const Shader& fragmentShad
     return Link();
 }
 
+// Attach and start linking vertex and fragment shaders, without querying the result
+void ShaderProgram::BuildAsync(const Shader& vertexShader, const Shader& fragmentShader)
+{
+    AttachShader(vertexShader, false);
+    AttachShader(fragmentShader, false);
+
+    assert(IsValid());
+    glLinkProgram(GetHandle());
+}
+
 // Attach a shader to be linked
-void ShaderProgram::AttachShader(const Shader& shader)
+void ShaderProgram::AttachShader(const Shader& shader, bool checkCompiled)
 {
     assert(IsValid());
-    assert(!IsLinked());
     assert(shader.IsValid());
-    assert(shader.IsCompiled());
+    assert(!checkCompiled || !IsLinked());
+    assert(!checkCompiled || shader.IsCompiled());
     glAttachShader(GetHandle(), shader.GetHandle());
 }
 
@@ -110,6 +120,16 @@ bool ShaderProgram::IsLinked() const
     return success;
 }
 
+// Check, without blocking, if the linking has finished
+bool ShaderProgram::IsLinkingComplete() const
+{
+    assert(IsValid());
+
+    GLint complete;
+    glGetProgramiv(GetHandle(), GL_COMPLETION_STATUS_KHR, &complete);
+    return complete;
+}
+
 // Get a string with linking error messages
 // The max length of the string returned is determined by the capacity of the span
 void ShaderProgram::GetLinkingErrors(std::span<char> errors) const
@@ -160,6 +180,33 @@ void ShaderProgram::GetUniformInfo(unsigned int index, int& size, GLenum& glType
     glGetActiveUniform(GetHandle(), index, uniformName.size(), nullptr, &size, &glType, uniformName.data());
 }
 
+// Get the block and layout of a specific uniform
+void ShaderProgram::GetUniformBlockInfo(unsigned int index, int& blockIndex, int& offset, int& arrayStride, int& matrixStride) const
+{
+    GLuint uniformIndex = index;
+    glGetActiveUniformsiv(GetHandle(), 1, &uniformIndex, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+    glGetActiveUniformsiv(GetHandle(), 1, &uniformIndex, GL_UNIFORM_OFFSET, &offset);
+    glGetActiveUniformsiv(GetHandle(), 1, &uniformIndex, GL_UNIFORM_ARRAY_STRIDE, &arrayStride);
+    glGetActiveUniformsiv(GetHandle(), 1, &uniformIndex, GL_UNIFORM_MATRIX_STRIDE, &matrixStride);
+}
+
+GLuint ShaderProgram::GetUniformBlockIndex(const char* name) const
+{
+    return glGetUniformBlockIndex(GetHandle(), name);
+}
+
+int ShaderProgram::GetUniformBlockSize(GLuint blockIndex) const
+{
+    GLint size;
+    glGetActiveUniformBlockiv(GetHandle(), blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    return size;
+}
+
+void ShaderProgram::SetUniformBlockBinding(GLuint blockIndex, GLuint binding) const
+{
+    glUniformBlockBinding(GetHandle(), blockIndex, binding);
+}
+
 // All the different combinations of Get/SetUniform
 template<>
 void ShaderProgram::GetUniform<GLint>(Location location, std::span<GLint> value) const
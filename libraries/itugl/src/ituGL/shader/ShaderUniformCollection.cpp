@@ -1,14 +1,39 @@
 #include <ituGL/shader/ShaderUniformCollection.h>
 #include <cassert>
 #include <array>
+#include <algorithm>
 
-ShaderUniformCollection::ShaderUniformCollection() : m_shaderProgram(nullptr)
+unsigned int ShaderUniformCollection::UploadId::s_lastId = 0;
+ShaderUniformCollection::UploadStats ShaderUniformCollection::s_uploadStats;
+
+ShaderUniformCollection::ShaderUniformCollection() : m_shaderProgram(nullptr), m_version(0)
 {
 }
 
-ShaderUniformCollection::ShaderUniformCollection(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms) : m_shaderProgram(shaderProgram)
+ShaderUniformCollection::ShaderUniformCollection(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms)
+    : m_shaderProgram(shaderProgram), m_version(0)
+{
+    if (m_shaderProgram)
+    {
+        m_layout = ShaderUniformLayout::GetLayout(m_shaderProgram, filteredUniforms);
+        AllocateValues();
+    }
+}
+
+ShaderUniformCollection::ShaderUniformCollection(std::shared_ptr<const ShaderUniformCollection> baseCollection)
+    : m_shaderProgram(baseCollection->m_shaderProgram)
+    , m_layout(baseCollection->m_layout)
+    , m_baseCollection(baseCollection)
+    , m_version(0)
+{
+    // Instances of instances would need to search several levels, point to the root instead
+    assert(!baseCollection->m_baseCollection);
+
+    m_dirtyUniforms.assign(m_layout->GetDataUniforms().size(), false);
+}
+
+ShaderUniformCollection::~ShaderUniformCollection()
 {
-    ExtractUniforms(filteredUniforms);
 }
 
 std::shared_ptr<ShaderProgram> ShaderUniformCollection::GetShaderProgram()
@@ -21,11 +46,30 @@ std::shared_ptr<const ShaderProgram> ShaderUniformCollection::GetShaderProgram()
     return m_shaderProgram;
 }
 
-void ShaderUniformCollection::ChangeShader(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms)
+void ShaderUniformCollection::ChangeShader(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms, bool keepValues)
 {
+    // Instances must use the same program as their base
+    assert(!m_baseCollection);
+
+    // Keep the current uniforms aside, to copy their values later
+    ShaderUniformCollection previous;
+    if (keepValues)
+    {
+        previous = std::move(*this);
+    }
+
     Reset();
     m_shaderProgram = shaderProgram;
-    ExtractUniforms(filteredUniforms);
+    m_layout = ShaderUniformLayout::GetLayout(m_shaderProgram, filteredUniforms);
+    AllocateValues();
+
+    if (previous.m_shaderProgram)
+    {
+        CopyUniformValues(previous);
+    }
+
+    // The values are new to the program
+    m_uploadId = UploadId();
 }
 
 ShaderProgram::Location ShaderUniformCollection::GetAttributeLocation(const char* name) const
@@ -35,272 +79,272 @@ ShaderProgram::Location ShaderUniformCollection::GetAttributeLocation(const char
 
 ShaderProgram::Location ShaderUniformCollection::GetUniformLocation(const char* name) const
 {
-    return m_shaderProgram->GetUniformLocation(name);
+    ShaderProgram::Location location = m_layout ? m_layout->FindUniformLocation(name) : -1;
+    return location >= 0 ? location : m_shaderProgram->GetUniformLocation(name);
 }
 
-ShaderUniformCollection::DataUniform& ShaderUniformCollection::GetDataUniform(ShaderProgram::Location location)
+bool ShaderUniformCollection::IsUniformOverridden(ShaderProgram::Location location) const
 {
-    return const_cast<DataUniform&>(const_cast<const ShaderUniformCollection*>(this)->GetDataUniform(location));
+    if (!m_baseCollection)
+    {
+        return false;
+    }
+    if (const TextureUniform* uniform = m_layout->FindTextureUniform(location))
+    {
+        return FindTextureOverride(uniform->unit) != nullptr;
+    }
+    return FindDataOverride(location) != nullptr;
 }
 
-const ShaderUniformCollection::DataUniform& ShaderUniformCollection::GetDataUniform(ShaderProgram::Location location) const
+void ShaderUniformCollection::AllocateValues()
 {
-    int uniformIndex = m_locationDataIndex.at(location);
-    const DataUniform& uniform = m_dataUniforms[uniformIndex];
-    assert(uniform.location == location);
-    return uniform;
+    m_dataValues.assign(m_layout->GetDataSize(), std::byte(0));
+    m_textureValues.assign(m_layout->GetTextureUniforms().size(), nullptr);
+    m_dirtyUniforms.assign(m_layout->GetDataUniforms().size(), false);
+    m_blockBuffer.dirty = true;
 }
 
-ShaderUniformCollection::TextureUniform& ShaderUniformCollection::GetTextureUniform(ShaderProgram::Location location)
+void ShaderUniformCollection::PrepareDataWrite(ShaderProgram::Location location)
 {
-    return const_cast<TextureUniform&>(const_cast<const ShaderUniformCollection*>(this)->GetTextureUniform(location));
+    ++m_version;
+
+    const DataUniform& uniform = m_layout->GetDataUniform(location);
+    if (ShaderUniformLayout::IsInMaterialBlock(uniform))
+    {
+        m_blockBuffer.dirty = true;
+    }
+    else
+    {
+        m_dirtyUniforms[GetDataUniformIndex(uniform)] = true;
+    }
+
+    if (m_baseCollection && !FindDataOverride(location))
+    {
+        // Copy on write: the first time, append a copy of the base value to the instance buffer
+        unsigned int size = ShaderUniformLayout::GetDataUniformSize(uniform) * Data::GetTypeSize(uniform.type);
+        unsigned int offset = (static_cast<unsigned int>(m_dataValues.size()) + 7) / 8 * 8;
+        m_dataValues.resize(offset + size);
+        std::memcpy(m_dataValues.data() + offset, m_baseCollection->GetDataPointer<std::byte>(uniform), size);
+        m_dataOverrides.push_back(DataOverride{ location, offset });
+    }
 }
 
-const ShaderUniformCollection::TextureUniform& ShaderUniformCollection::GetTextureUniform(ShaderProgram::Location location) const
+const ShaderUniformCollection::DataOverride* ShaderUniformCollection::FindDataOverride(ShaderProgram::Location location) const
 {
-    int uniformIndex = m_locationTextureIndex.at(location);
-    const TextureUniform& uniform = m_textureUniforms[uniformIndex];
-    assert(uniform.location == location);
-    return uniform;
+    for (const DataOverride& dataOverride : m_dataOverrides)
+    {
+        if (dataOverride.location == location)
+        {
+            return &dataOverride;
+        }
+    }
+    return nullptr;
 }
 
-void ShaderUniformCollection::ExtractUniforms(const NameSet& filteredUniforms)
+const ShaderUniformCollection::TextureOverride* ShaderUniformCollection::FindTextureOverride(int unit) const
 {
-    assert(m_shaderProgram);
+    for (const TextureOverride& textureOverride : m_textureOverrides)
+    {
+        if (textureOverride.unit == unit)
+        {
+            return &textureOverride;
+        }
+    }
+    return nullptr;
+}
 
-    ShaderProgram& shaderProgram = *m_shaderProgram;
+const std::shared_ptr<const TextureObject>& ShaderUniformCollection::GetTextureValue(const TextureUniform& uniform) const
+{
+    if (m_baseCollection)
+    {
+        const TextureOverride* textureOverride = FindTextureOverride(uniform.unit);
+        return textureOverride ? textureOverride->texture : m_baseCollection->GetTextureValue(uniform);
+    }
+    return m_textureValues[uniform.unit];
+}
 
-    unsigned int uniformCount = shaderProgram.GetUniformCount();
+void ShaderUniformCollection::SetUniforms() const
+{
+    if (!m_layout)
+    {
+        return;
+    }
 
-    // Loop over all the uniforms
-    for (unsigned int i = 0; i < uniformCount; ++i)
+    ShaderUniformLayout::UploadState& uploadState = m_layout->GetUploadState();
+    if (m_baseCollection)
     {
-        // Get the information of uniform in position i
-        int size;
-        GLenum glType;
-        char uniformName[256];
-        shaderProgram.GetUniformInfo(i, size, glType, std::span(uniformName, sizeof(uniformName)));
+        SetInstanceDataUniforms(uploadState);
+    }
+    else
+    {
+        // If this collection set the values last time, the program only needs the ones modified since then
+        SetDataUniforms(uploadState.lastUsedId == m_uploadId.value);
+        uploadState.baseId = m_uploadId.value;
+        uploadState.baseVersion = m_version;
+        uploadState.overriddenLocations.clear();
+    }
+    uploadState.lastUsedId = m_uploadId.value;
+    std::fill(m_dirtyUniforms.begin(), m_dirtyUniforms.end(), false);
 
-        // If the named is in the filtered list, skip
-        if (filteredUniforms.contains(uniformName))
-            continue;
+    if (m_layout->HasMaterialBlock())
+    {
+        UseMaterialBlock();
+    }
 
-        // Get the uniform location
-        ShaderProgram::Location location = GetUniformLocation(uniformName);
-        assert(location >= 0);
+    // Texture units are shared by all the programs, so textures are always bound
+    for (const TextureUniform& uniform : m_layout->GetTextureUniforms())
+    {
+        UseUniform(uniform);
+    }
+}
 
-        Data::Type type;
-        UniformDimension dimension;
-        TextureObject::Target target;
-        if (IsDataUniform(glType, type, dimension))
-        {
-            // If it is a data property, store as data
-            DataUniform uniform;
-            uniform.location = location;
-            uniform.type = type;
-            uniform.dimension = dimension;
-            uniform.count = size;
-            AddUniform(uniform);
-        }
-        else if (IsTextureUniform(glType, target))
-        {
-            // If it is a texture property, store as property
-            TextureUniform uniform;
-            uniform.location = location;
-            uniform.target = target;
-            AddUniform(uniform);
-        }
-        else
+void ShaderUniformCollection::SetDataUniforms(bool onlyDirty) const
+{
+    const std::vector<DataUniform>& dataUniforms = m_layout->GetDataUniforms();
+    for (std::size_t i = 0; i < dataUniforms.size(); ++i)
+    {
+        if ((!onlyDirty || m_dirtyUniforms[i]) && !ShaderUniformLayout::IsInMaterialBlock(dataUniforms[i]))
         {
-            // Unsupported uniform type
-            assert(false);
+            UseUniform(dataUniforms[i]);
         }
     }
 }
 
-bool ShaderUniformCollection::IsDataUniform(GLenum glType, Data::Type& type, UniformDimension& dimension)
+void ShaderUniformCollection::SetInstanceDataUniforms(ShaderUniformLayout::UploadState& uploadState) const
 {
-    // Type
-    switch (glType)
-    {
-    case GL_BOOL:
-    case GL_INT:
-    case GL_INT_VEC2:
-    case GL_INT_VEC3:
-    case GL_INT_VEC4:
-        type = Data::Type::Int;
-        break;
-    case GL_UNSIGNED_INT:
-    case GL_UNSIGNED_INT_VEC2:
-    case GL_UNSIGNED_INT_VEC3:
-    case GL_UNSIGNED_INT_VEC4:
-        type = Data::Type::UInt;
-        break;
-    case GL_FLOAT:
-    case GL_FLOAT_VEC2:
-    case GL_FLOAT_VEC3:
-    case GL_FLOAT_VEC4:
-    case GL_FLOAT_MAT2:
-    case GL_FLOAT_MAT2x3:
-    case GL_FLOAT_MAT2x4:
-    case GL_FLOAT_MAT3x2:
-    case GL_FLOAT_MAT3:
-    case GL_FLOAT_MAT3x4:
-    case GL_FLOAT_MAT4x2:
-    case GL_FLOAT_MAT4x3:
-    case GL_FLOAT_MAT4:
-        type = Data::Type::Float;
-        break;
-    case GL_DOUBLE:
-    case GL_DOUBLE_VEC2:
-    case GL_DOUBLE_VEC3:
-    case GL_DOUBLE_VEC4:
-        type = Data::Type::Int;
-        break;
-    default:
-        return false;
+    const ShaderUniformCollection& baseCollection = *m_baseCollection;
+
+    // The program keeps the values set by the last collection. If it was the base, or an instance of the same base,
+    // and the base didn't change since, only the values overridden by any of the two instances need to be set
+    bool baseValuesSet = uploadState.baseId == baseCollection.m_uploadId.value && uploadState.baseVersion == baseCollection.m_version;
+
+    if (!baseValuesSet)
+    {
+        SetDataUniforms(false);
+    }
+    else if (uploadState.lastUsedId == m_uploadId.value)
+    {
+        SetDataUniforms(true);
+    }
+    else
+    {
+        // Restore the base values overridden by the previous instance, but not by this one
+        for (ShaderProgram::Location location : uploadState.overriddenLocations)
+        {
+            if (!FindDataOverride(location))
+            {
+                UseUniform(m_layout->GetDataUniform(location));
+            }
+        }
+        for (const DataOverride& dataOverride : m_dataOverrides)
+        {
+            const DataUniform& uniform = m_layout->GetDataUniform(dataOverride.location);
+            if (!ShaderUniformLayout::IsInMaterialBlock(uniform))
+            {
+                UseUniform(uniform);
+            }
+        }
     }
 
-    // UniformDimension
-    switch (glType)
+    uploadState.baseId = baseCollection.m_uploadId.value;
+    uploadState.baseVersion = baseCollection.m_version;
+    uploadState.overriddenLocations.clear();
+    for (const DataOverride& dataOverride : m_dataOverrides)
     {
-    case GL_BOOL:
-    case GL_INT:
-    case GL_UNSIGNED_INT:
-    case GL_FLOAT:
-    case GL_DOUBLE:
-        dimension = UniformDimension::Scalar;
-        break;
-    case GL_INT_VEC2:
-    case GL_UNSIGNED_INT_VEC2:
-    case GL_FLOAT_VEC2:
-    case GL_DOUBLE_VEC2:
-        dimension = UniformDimension::Vector2;
-        break;
-    case GL_INT_VEC3:
-    case GL_UNSIGNED_INT_VEC3:
-    case GL_FLOAT_VEC3:
-    case GL_DOUBLE_VEC3:
-        dimension = UniformDimension::Vector3;
-        break;
-    case GL_INT_VEC4:
-    case GL_UNSIGNED_INT_VEC4:
-    case GL_FLOAT_VEC4:
-    case GL_DOUBLE_VEC4:
-        dimension = UniformDimension::Vector4;
-        break;
-    case GL_FLOAT_MAT2:
-        dimension = UniformDimension::Matrix2x2;
-        break;
-    case GL_FLOAT_MAT2x3:
-        dimension = UniformDimension::Matrix2x3;
-        break;
-    case GL_FLOAT_MAT2x4:
-        dimension = UniformDimension::Matrix2x4;
-        break;
-    case GL_FLOAT_MAT3x2:
-        dimension = UniformDimension::Matrix3x2;
-        break;
-    case GL_FLOAT_MAT3:
-        dimension = UniformDimension::Matrix3x3;
-        break;
-    case GL_FLOAT_MAT3x4:
-        dimension = UniformDimension::Matrix3x4;
-        break;
-    case GL_FLOAT_MAT4x2:
-        dimension = UniformDimension::Matrix4x2;
-        break;
-    case GL_FLOAT_MAT4x3:
-        dimension = UniformDimension::Matrix4x3;
-        break;
-    case GL_FLOAT_MAT4:
-        dimension = UniformDimension::Matrix4x4;
-        break;
-    default:
-        return false;
+        if (!ShaderUniformLayout::IsInMaterialBlock(m_layout->GetDataUniform(dataOverride.location)))
+        {
+            uploadState.overriddenLocations.push_back(dataOverride.location);
+        }
     }
-    return true;
 }
 
-bool ShaderUniformCollection::IsTextureUniform(GLenum glType, TextureObject::Target& target)
+void ShaderUniformCollection::UseMaterialBlock() const
 {
-    switch (glType)
+    const ShaderUniformCollection* blockCollection = this;
+    if (m_baseCollection)
     {
-    case GL_SAMPLER_1D:
-        target = TextureObject::Target::Texture1D;
-        break;
-    case GL_SAMPLER_1D_ARRAY:
-        target = TextureObject::Target::Texture1DArray;
-        break;
-    case GL_SAMPLER_2D:
-    case GL_SAMPLER_2D_SHADOW:
-        target = TextureObject::Target::Texture2D;
-        break;
-    case GL_SAMPLER_2D_ARRAY:
-        target = TextureObject::Target::Texture2DArray;
-        break;
-    case GL_SAMPLER_2D_MULTISAMPLE:
-        target = TextureObject::Target::Texture2DMultisample;
-        break;
-    case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
-        target = TextureObject::Target::Texture2DMultisampleArray;
-        break;
-    case GL_SAMPLER_3D:
-        target = TextureObject::Target::Texture3D;
-        break;
-    case GL_SAMPLER_CUBE:
-        target = TextureObject::Target::TextureCubemap;
-        break;
-    case GL_SAMPLER_CUBE_MAP_ARRAY:
-        target = TextureObject::Target::TextureCubemapArray;
-        break;
-    default:
-        return false;
+        bool blockOverridden = std::any_of(m_dataOverrides.begin(), m_dataOverrides.end(), [&](const DataOverride& dataOverride)
+            {
+                return ShaderUniformLayout::IsInMaterialBlock(m_layout->GetDataUniform(dataOverride.location));
+            });
+        if (!blockOverridden)
+        {
+            blockCollection = m_baseCollection.get();
+        }
     }
-    return true;
+
+    blockCollection->UpdateMaterialBlock();
+    blockCollection->m_blockBuffer.buffer->BindRange(ShaderUniformLayout::MaterialBlockBinding, 0, m_layout->GetMaterialBlockSize());
 }
 
-void ShaderUniformCollection::AddUniform(const DataUniform& uniform)
+void ShaderUniformCollection::UpdateMaterialBlock() const
 {
-    switch (uniform.type)
+    // Instances also have to upload when the base values they don't override change
+    unsigned int baseVersion = m_baseCollection ? m_baseCollection->m_version : 0;
+    if (m_blockBuffer.buffer && !m_blockBuffer.dirty && m_blockBuffer.baseVersion == baseVersion)
     {
-    case Data::Type::Int:
-        AddUniform<int>(uniform);
-        break;
-    case Data::Type::UInt:
-        AddUniform<unsigned int>(uniform);
-        break;
-    case Data::Type::Float:
-        AddUniform<float>(uniform);
-        break;
-    case Data::Type::Double:
-        AddUniform<double>(uniform);
-        break;
-    default:
-        assert(false);
+        return;
     }
-}
 
-void ShaderUniformCollection::AddUniform(const TextureUniform& uniform)
-{
-    m_locationTextureIndex.insert(std::make_pair(uniform.location, static_cast<int>(m_textureUniforms.size())));
-    m_textureUniforms.push_back(uniform);
+    std::vector<std::byte> blockData(m_layout->GetMaterialBlockSize(), std::byte(0));
+    for (const DataUniform& uniform : m_layout->GetDataUniforms())
+    {
+        if (ShaderUniformLayout::IsInMaterialBlock(uniform))
+        {
+            WriteBlockValues(uniform, blockData);
+        }
+    }
+
+    if (!m_blockBuffer.buffer)
+    {
+        m_blockBuffer.buffer = std::make_unique<UniformBufferObject>();
+        m_blockBuffer.buffer->Bind();
+        m_blockBuffer.buffer->AllocateData(std::span<const std::byte>(blockData), BufferObject::DynamicDraw);
+    }
+    else
+    {
+        m_blockBuffer.buffer->Bind();
+        m_blockBuffer.buffer->UpdateData(std::span<const std::byte>(blockData));
+    }
+
+    m_blockBuffer.dirty = false;
+    m_blockBuffer.baseVersion = baseVersion;
+
+    ++s_uploadStats.blockCount;
+    s_uploadStats.blockBytes += static_cast<unsigned int>(blockData.size());
 }
 
-void ShaderUniformCollection::SetUniforms() const
+void ShaderUniformCollection::WriteBlockValues(const DataUniform& uniform, std::span<std::byte> blockData) const
 {
-    for (const DataUniform& uniform : m_dataUniforms)
+    const std::byte* values = GetDataPointer<std::byte>(uniform);
+    unsigned int typeSize = Data::GetTypeSize(uniform.type);
+    unsigned int elementSize = ShaderUniformLayout::GetDataUniformSize(uniform) / uniform.count;
+
+    // Values are tightly packed, but std140 aligns array elements and matrix columns to vec4
+    unsigned int columns = 1;
+    if (ShaderUniformLayout::IsMatrix(uniform.dimension))
     {
-        UseUniform(uniform);
+        columns = (static_cast<int>(uniform.dimension) - static_cast<int>(UniformDimension::MatrixFirst)) / 3 + 2;
     }
-    for (const TextureUniform& uniform : m_textureUniforms)
+    unsigned int columnSize = elementSize / columns * typeSize;
+
+    for (unsigned int element = 0; element < uniform.count; ++element)
     {
-        UseUniform(uniform);
+        for (unsigned int column = 0; column < columns; ++column)
+        {
+            std::size_t offset = uniform.blockOffset + element * uniform.arrayStride + column * uniform.matrixStride;
+            assert(offset + columnSize <= blockData.size());
+            std::memcpy(blockData.data() + offset, values, columnSize);
+            values += columnSize;
+        }
     }
 }
 
 void ShaderUniformCollection::UseUniform(const DataUniform& uniform) const
 {
+    ++s_uploadStats.uniformCount;
+    s_uploadStats.uniformBytes += ShaderUniformLayout::GetDataUniformSize(uniform) * Data::GetTypeSize(uniform.type);
+
     switch (uniform.type)
     {
     case Data::Type::Int:
@@ -323,10 +367,10 @@ void ShaderUniformCollection::UseUniform(const DataUniform& uniform) const
 void ShaderUniformCollection::UseUniform(const TextureUniform& uniform) const
 {
     //TODO: default texture
-    if (uniform.texture)
+    const std::shared_ptr<const TextureObject>& texture = GetTextureValue(uniform);
+    if (texture)
     {
-        size_t textureIndex = &uniform - m_textureUniforms.data();
-        m_shaderProgram->SetTexture(uniform.location, static_cast<int>(textureIndex), *uniform.texture);
+        m_shaderProgram->SetTexture(uniform.location, uniform.unit, *texture);
     }
 }
 
@@ -383,100 +427,68 @@ void ShaderUniformCollection::UseUniform<float>(const DataUniform& uniform) cons
 template<>
 void ShaderUniformCollection::GetUniformValue(ShaderProgram::Location location, std::shared_ptr<const TextureObject>& value) const
 {
-    const TextureUniform& uniform = GetTextureUniform(location);
-    value = uniform.texture;
+    const TextureUniform& uniform = m_layout->GetTextureUniform(location);
+    value = GetTextureValue(uniform);
 }
 
 template<>
 void ShaderUniformCollection::SetUniformValue(ShaderProgram::Location location, const std::shared_ptr<const TextureObject>& value)
 {
-    TextureUniform& uniform = GetTextureUniform(location);
+    const TextureUniform& uniform = m_layout->GetTextureUniform(location);
     assert(!value || uniform.target == value->GetTarget());
-    uniform.texture = value;
-}
-
-int ShaderUniformCollection::GetDataUniformSize(const DataUniform& uniform) const
-{
-    int size = 0;
-    switch (uniform.dimension)
+    if (m_baseCollection)
     {
-    case UniformDimension::Scalar:
-        size = 1;
-        break;
-    case UniformDimension::Vector2:
-        size = 2;
-        break;
-    case UniformDimension::Vector3:
-        size = 3;
-        break;
-    case UniformDimension::Vector4:
-    case UniformDimension::Matrix2x2:
-        size = 4;
-        break;
-    case UniformDimension::Matrix2x3:
-    case UniformDimension::Matrix3x2:
-        size = 6;
-        break;
-    case UniformDimension::Matrix2x4:
-    case UniformDimension::Matrix4x2:
-        size = 8;
-        break;
-    case UniformDimension::Matrix3x3:
-        size = 9;
-        break;
-    case UniformDimension::Matrix3x4:
-    case UniformDimension::Matrix4x3:
-        size = 12;
-        break;
-    case UniformDimension::Matrix4x4:
-        size = 16;
-        break;
-    default:
-        assert(false);
+        TextureOverride* textureOverride = const_cast<TextureOverride*>(FindTextureOverride(uniform.unit));
+        if (textureOverride)
+        {
+            textureOverride->texture = value;
+        }
+        else
+        {
+            m_textureOverrides.push_back(TextureOverride{ uniform.unit, value });
+        }
+    }
+    else
+    {
+        m_textureValues[uniform.unit] = value;
     }
-    return size * uniform.count;
-}
-
-void ShaderUniformCollection::Reset()
-{
-    m_shaderProgram = nullptr;
-    m_dataUniforms.clear();
-    m_textureUniforms.clear();
-    m_locationDataIndex.clear();
-    m_locationTextureIndex.clear();
-    m_intDataValues.clear();
-    m_uintDataValues.clear();
-    m_floatDataValues.clear();
-    m_doubleDataValues.clear();
-}
-
-#ifndef NDEBUG
-bool ShaderUniformCollection::IsScalar(UniformDimension dimension) const
-{
-    return dimension == UniformDimension::Scalar;
 }
 
-bool ShaderUniformCollection::IsVector(UniformDimension dimension) const
+void ShaderUniformCollection::CopyUniformValues(const ShaderUniformCollection& source)
 {
-    return dimension >= UniformDimension::VectorFirst && dimension <= UniformDimension::VectorLast;
-}
+    const ShaderUniformLayout& sourceLayout = *source.m_layout;
 
-bool ShaderUniformCollection::IsMatrix(UniformDimension dimension) const
-{
-    return dimension >= UniformDimension::MatrixFirst && dimension <= UniformDimension::MatrixLast;
-}
+    // Locations can be different in each program, match them by name
+    for (const DataUniform& uniform : m_layout->GetDataUniforms())
+    {
+        const DataUniform* sourceUniform = sourceLayout.FindDataUniform(sourceLayout.FindUniformLocation(uniform.name.c_str()));
+        if (sourceUniform && sourceUniform->type == uniform.type && sourceUniform->dimension == uniform.dimension && sourceUniform->count == uniform.count)
+        {
+            std::size_t size = ShaderUniformLayout::GetDataUniformSize(uniform) * Data::GetTypeSize(uniform.type);
+            std::memcpy(m_dataValues.data() + uniform.offset, source.m_dataValues.data() + sourceUniform->offset, size);
+        }
+    }
 
-bool ShaderUniformCollection::IsVectorSize(UniformDimension dimension, int size) const
-{
-    assert(size >= 2 && size <= 4);
-    return IsVector(dimension) && static_cast<int>(dimension) == static_cast<int>(UniformDimension::VectorFirst) + size - 2;
+    for (const TextureUniform& uniform : m_layout->GetTextureUniforms())
+    {
+        const TextureUniform* sourceUniform = sourceLayout.FindTextureUniform(sourceLayout.FindUniformLocation(uniform.name.c_str()));
+        if (sourceUniform && sourceUniform->target == uniform.target)
+        {
+            m_textureValues[uniform.unit] = source.m_textureValues[sourceUniform->unit];
+        }
+    }
 }
 
-bool ShaderUniformCollection::IsMatrixSize(UniformDimension dimension, int columns, int rows) const
+void ShaderUniformCollection::Reset()
 {
-    assert(columns >= 2 && columns <= 4);
-    assert(rows >= 2 && rows <= 4);
-    int offset = (columns - 2) * 3 + (rows - 2);
-    return IsMatrix(dimension) && static_cast<int>(dimension) == static_cast<int>(UniformDimension::MatrixFirst) + offset;
+    ++m_version;
+    m_shaderProgram = nullptr;
+    m_layout = nullptr;
+    m_dataValues.clear();
+    m_textureValues.clear();
+    m_baseCollection = nullptr;
+    m_dataOverrides.clear();
+    m_textureOverrides.clear();
+    m_dirtyUniforms.clear();
+    m_blockBuffer.dirty = true;
 }
-#endif
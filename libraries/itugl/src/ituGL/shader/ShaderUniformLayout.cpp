@@ -0,0 +1,448 @@
+#include <ituGL/shader/ShaderUniformLayout.h>
+#include <cassert>
+
+ShaderUniformLayout::ShaderUniformLayout(const ShaderProgram& shaderProgram, const NameSet& filteredUniforms)
+    : m_dataSize(0), m_materialBlockSize(0), m_uploadState(std::make_shared<UploadState>())
+{
+    // Find the material block, and make it read from the material binding point
+    int materialBlockIndex = -1;
+    GLuint blockIndex = shaderProgram.GetUniformBlockIndex(MaterialBlockName);
+    if (blockIndex != GL_INVALID_INDEX)
+    {
+        materialBlockIndex = static_cast<int>(blockIndex);
+        m_materialBlockSize = shaderProgram.GetUniformBlockSize(blockIndex);
+        shaderProgram.SetUniformBlockBinding(blockIndex, MaterialBlockBinding);
+    }
+
+    // Block members don't have a location, they get one from BlockLocationBase
+    std::vector<DataUniform> blockUniforms;
+
+    unsigned int uniformCount = shaderProgram.GetUniformCount();
+
+    // Loop over all the uniforms
+    for (unsigned int i = 0; i < uniformCount; ++i)
+    {
+        // Get the information of uniform in position i
+        int size;
+        GLenum glType;
+        char uniformName[256];
+        shaderProgram.GetUniformInfo(i, size, glType, std::span(uniformName, sizeof(uniformName)));
+
+        // If the named is in the filtered list, skip
+        if (filteredUniforms.contains(uniformName))
+            continue;
+
+        Data::Type type;
+        UniformDimension dimension;
+        TextureObject::Target target;
+
+        int uniformBlockIndex, blockOffset, arrayStride, matrixStride;
+        shaderProgram.GetUniformBlockInfo(i, uniformBlockIndex, blockOffset, arrayStride, matrixStride);
+        if (uniformBlockIndex >= 0)
+        {
+            // Only the material block is handled, the others are set by whoever owns them
+            if (uniformBlockIndex == materialBlockIndex && IsDataUniform(glType, type, dimension))
+            {
+                DataUniform uniform;
+                uniform.name = uniformName;
+                uniform.type = type;
+                uniform.dimension = dimension;
+                uniform.count = size;
+                uniform.blockOffset = blockOffset;
+                uniform.arrayStride = arrayStride;
+                uniform.matrixStride = matrixStride;
+                blockUniforms.push_back(std::move(uniform));
+            }
+            continue;
+        }
+
+        // Get the uniform location
+        ShaderProgram::Location location = shaderProgram.GetUniformLocation(uniformName);
+        assert(location >= 0);
+
+        if (IsDataUniform(glType, type, dimension))
+        {
+            // If it is a data property, store as data
+            DataUniform uniform;
+            uniform.name = uniformName;
+            uniform.location = location;
+            uniform.type = type;
+            uniform.dimension = dimension;
+            uniform.count = size;
+            uniform.blockOffset = -1;
+            uniform.arrayStride = 0;
+            uniform.matrixStride = 0;
+            AddUniform(std::move(uniform));
+        }
+        else if (IsTextureUniform(glType, target))
+        {
+            // If it is a texture property, store as property
+            TextureUniform uniform;
+            uniform.name = uniformName;
+            uniform.location = location;
+            uniform.target = target;
+            AddUniform(std::move(uniform));
+        }
+        else
+        {
+            // Unsupported uniform type
+            assert(false);
+        }
+    }
+
+    ShaderProgram::Location nextLocation = BlockLocationBase;
+    for (DataUniform& uniform : blockUniforms)
+    {
+        uniform.location = nextLocation++;
+        AddUniform(std::move(uniform));
+    }
+}
+
+std::shared_ptr<const ShaderUniformLayout> ShaderUniformLayout::GetLayout(const std::shared_ptr<ShaderProgram>& shaderProgram, const NameSet& filteredUniforms)
+{
+    struct CacheEntry
+    {
+        std::weak_ptr<ShaderProgram> shaderProgram;
+        NameSet filteredUniforms;
+        std::weak_ptr<const ShaderUniformLayout> layout;
+    };
+
+    // Layouts are only kept alive by the collections using them. The weak program pointer detects if the address was reused
+    static std::unordered_map<const ShaderProgram*, std::vector<CacheEntry>> s_cache;
+
+    assert(shaderProgram);
+    std::vector<CacheEntry>& entries = s_cache[shaderProgram.get()];
+
+    std::shared_ptr<const ShaderUniformLayout> layout;
+    for (auto itEntry = entries.begin(); itEntry != entries.end();)
+    {
+        if (itEntry->shaderProgram.lock() != shaderProgram || itEntry->layout.expired())
+        {
+            itEntry = entries.erase(itEntry);
+            continue;
+        }
+        if (!layout && itEntry->filteredUniforms == filteredUniforms)
+        {
+            layout = itEntry->layout.lock();
+        }
+        ++itEntry;
+    }
+
+    if (!layout)
+    {
+        std::shared_ptr<ShaderUniformLayout> newLayout = std::make_shared<ShaderUniformLayout>(*shaderProgram, filteredUniforms);
+
+        // All the layouts of the program must agree on who set the values last
+        if (!entries.empty())
+        {
+            newLayout->m_uploadState = entries.front().layout.lock()->m_uploadState;
+        }
+
+        layout = newLayout;
+        entries.push_back(CacheEntry{ shaderProgram, filteredUniforms, layout });
+    }
+    return layout;
+}
+
+const ShaderUniformLayout::DataUniform* ShaderUniformLayout::FindDataUniform(ShaderProgram::Location location) const
+{
+    const std::vector<int>& locationIndex = location >= BlockLocationBase ? m_blockLocationDataIndex : m_locationDataIndex;
+    int indexLocation = location >= BlockLocationBase ? location - BlockLocationBase : location;
+    if (indexLocation < 0 || indexLocation >= static_cast<int>(locationIndex.size()) || locationIndex[indexLocation] < 0)
+        return nullptr;
+
+    const DataUniform& uniform = m_dataUniforms[locationIndex[indexLocation]];
+    assert(uniform.location == location);
+    return &uniform;
+}
+
+const ShaderUniformLayout::TextureUniform* ShaderUniformLayout::FindTextureUniform(ShaderProgram::Location location) const
+{
+    if (location < 0 || location >= static_cast<int>(m_locationTextureIndex.size()) || m_locationTextureIndex[location] < 0)
+        return nullptr;
+
+    const TextureUniform& uniform = m_textureUniforms[m_locationTextureIndex[location]];
+    assert(uniform.location == location);
+    return &uniform;
+}
+
+const ShaderUniformLayout::DataUniform& ShaderUniformLayout::GetDataUniform(ShaderProgram::Location location) const
+{
+    const DataUniform* uniform = FindDataUniform(location);
+    assert(uniform);
+    return *uniform;
+}
+
+const ShaderUniformLayout::TextureUniform& ShaderUniformLayout::GetTextureUniform(ShaderProgram::Location location) const
+{
+    const TextureUniform* uniform = FindTextureUniform(location);
+    assert(uniform);
+    return *uniform;
+}
+
+ShaderProgram::Location ShaderUniformLayout::FindUniformLocation(const char* name) const
+{
+    auto itFind = m_nameLocations.find(name);
+    return itFind != m_nameLocations.end() ? itFind->second : -1;
+}
+
+bool ShaderUniformLayout::IsDataUniform(GLenum glType, Data::Type& type, UniformDimension& dimension)
+{
+    // Type
+    switch (glType)
+    {
+    case GL_BOOL:
+    case GL_INT:
+    case GL_INT_VEC2:
+    case GL_INT_VEC3:
+    case GL_INT_VEC4:
+        type = Data::Type::Int;
+        break;
+    case GL_UNSIGNED_INT:
+    case GL_UNSIGNED_INT_VEC2:
+    case GL_UNSIGNED_INT_VEC3:
+    case GL_UNSIGNED_INT_VEC4:
+        type = Data::Type::UInt;
+        break;
+    case GL_FLOAT:
+    case GL_FLOAT_VEC2:
+    case GL_FLOAT_VEC3:
+    case GL_FLOAT_VEC4:
+    case GL_FLOAT_MAT2:
+    case GL_FLOAT_MAT2x3:
+    case GL_FLOAT_MAT2x4:
+    case GL_FLOAT_MAT3x2:
+    case GL_FLOAT_MAT3:
+    case GL_FLOAT_MAT3x4:
+    case GL_FLOAT_MAT4x2:
+    case GL_FLOAT_MAT4x3:
+    case GL_FLOAT_MAT4:
+        type = Data::Type::Float;
+        break;
+    case GL_DOUBLE:
+    case GL_DOUBLE_VEC2:
+    case GL_DOUBLE_VEC3:
+    case GL_DOUBLE_VEC4:
+        type = Data::Type::Int;
+        break;
+    default:
+        return false;
+    }
+
+    // UniformDimension
+    switch (glType)
+    {
+    case GL_BOOL:
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+    case GL_DOUBLE:
+        dimension = UniformDimension::Scalar;
+        break;
+    case GL_INT_VEC2:
+    case GL_UNSIGNED_INT_VEC2:
+    case GL_FLOAT_VEC2:
+    case GL_DOUBLE_VEC2:
+        dimension = UniformDimension::Vector2;
+        break;
+    case GL_INT_VEC3:
+    case GL_UNSIGNED_INT_VEC3:
+    case GL_FLOAT_VEC3:
+    case GL_DOUBLE_VEC3:
+        dimension = UniformDimension::Vector3;
+        break;
+    case GL_INT_VEC4:
+    case GL_UNSIGNED_INT_VEC4:
+    case GL_FLOAT_VEC4:
+    case GL_DOUBLE_VEC4:
+        dimension = UniformDimension::Vector4;
+        break;
+    case GL_FLOAT_MAT2:
+        dimension = UniformDimension::Matrix2x2;
+        break;
+    case GL_FLOAT_MAT2x3:
+        dimension = UniformDimension::Matrix2x3;
+        break;
+    case GL_FLOAT_MAT2x4:
+        dimension = UniformDimension::Matrix2x4;
+        break;
+    case GL_FLOAT_MAT3x2:
+        dimension = UniformDimension::Matrix3x2;
+        break;
+    case GL_FLOAT_MAT3:
+        dimension = UniformDimension::Matrix3x3;
+        break;
+    case GL_FLOAT_MAT3x4:
+        dimension = UniformDimension::Matrix3x4;
+        break;
+    case GL_FLOAT_MAT4x2:
+        dimension = UniformDimension::Matrix4x2;
+        break;
+    case GL_FLOAT_MAT4x3:
+        dimension = UniformDimension::Matrix4x3;
+        break;
+    case GL_FLOAT_MAT4:
+        dimension = UniformDimension::Matrix4x4;
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+bool ShaderUniformLayout::IsTextureUniform(GLenum glType, TextureObject::Target& target)
+{
+    switch (glType)
+    {
+    case GL_SAMPLER_1D:
+        target = TextureObject::Target::Texture1D;
+        break;
+    case GL_SAMPLER_1D_ARRAY:
+        target = TextureObject::Target::Texture1DArray;
+        break;
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_2D_SHADOW:
+        target = TextureObject::Target::Texture2D;
+        break;
+    case GL_SAMPLER_2D_ARRAY:
+        target = TextureObject::Target::Texture2DArray;
+        break;
+    case GL_SAMPLER_2D_MULTISAMPLE:
+        target = TextureObject::Target::Texture2DMultisample;
+        break;
+    case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        target = TextureObject::Target::Texture2DMultisampleArray;
+        break;
+    case GL_SAMPLER_3D:
+        target = TextureObject::Target::Texture3D;
+        break;
+    case GL_SAMPLER_CUBE:
+        target = TextureObject::Target::TextureCubemap;
+        break;
+    case GL_SAMPLER_CUBE_MAP_ARRAY:
+        target = TextureObject::Target::TextureCubemapArray;
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+void ShaderUniformLayout::AddUniform(DataUniform&& uniform)
+{
+    // Align the values to their type size, so they can be read in place from the buffer
+    unsigned int typeSize = Data::GetTypeSize(uniform.type);
+    uniform.offset = (m_dataSize + typeSize - 1) / typeSize * typeSize;
+    m_dataSize = uniform.offset + GetDataUniformSize(uniform) * typeSize;
+
+    if (IsInMaterialBlock(uniform))
+    {
+        AddLocation(m_blockLocationDataIndex, uniform.location - BlockLocationBase, static_cast<int>(m_dataUniforms.size()));
+    }
+    else
+    {
+        AddLocation(m_locationDataIndex, uniform.location, static_cast<int>(m_dataUniforms.size()));
+    }
+    AddName(uniform.name, uniform.location);
+    m_dataUniforms.push_back(std::move(uniform));
+}
+
+void ShaderUniformLayout::AddUniform(TextureUniform&& uniform)
+{
+    uniform.unit = static_cast<int>(m_textureUniforms.size());
+
+    AddLocation(m_locationTextureIndex, uniform.location, uniform.unit);
+    AddName(uniform.name, uniform.location);
+    m_textureUniforms.push_back(std::move(uniform));
+}
+
+void ShaderUniformLayout::AddLocation(std::vector<int>& locationIndex, ShaderProgram::Location location, int index)
+{
+    if (location >= static_cast<int>(locationIndex.size()))
+    {
+        locationIndex.resize(location + 1, -1);
+    }
+    locationIndex[location] = index;
+}
+
+void ShaderUniformLayout::AddName(const std::string& name, ShaderProgram::Location location)
+{
+    m_nameLocations[name] = location;
+
+    // Arrays are reported as "name[0]", but can also be found as "name"
+    if (name.ends_with("[0]"))
+    {
+        m_nameLocations[name.substr(0, name.size() - 3)] = location;
+    }
+}
+
+unsigned int ShaderUniformLayout::GetDataUniformSize(const DataUniform& uniform)
+{
+    unsigned int size = 0;
+    switch (uniform.dimension)
+    {
+    case UniformDimension::Scalar:
+        size = 1;
+        break;
+    case UniformDimension::Vector2:
+        size = 2;
+        break;
+    case UniformDimension::Vector3:
+        size = 3;
+        break;
+    case UniformDimension::Vector4:
+    case UniformDimension::Matrix2x2:
+        size = 4;
+        break;
+    case UniformDimension::Matrix2x3:
+    case UniformDimension::Matrix3x2:
+        size = 6;
+        break;
+    case UniformDimension::Matrix2x4:
+    case UniformDimension::Matrix4x2:
+        size = 8;
+        break;
+    case UniformDimension::Matrix3x3:
+        size = 9;
+        break;
+    case UniformDimension::Matrix3x4:
+    case UniformDimension::Matrix4x3:
+        size = 12;
+        break;
+    case UniformDimension::Matrix4x4:
+        size = 16;
+        break;
+    default:
+        assert(false);
+    }
+    return size * uniform.count;
+}
+
+bool ShaderUniformLayout::IsScalar(UniformDimension dimension)
+{
+    return dimension == UniformDimension::Scalar;
+}
+
+bool ShaderUniformLayout::IsVector(UniformDimension dimension)
+{
+    return dimension >= UniformDimension::VectorFirst && dimension <= UniformDimension::VectorLast;
+}
+
+bool ShaderUniformLayout::IsMatrix(UniformDimension dimension)
+{
+    return dimension >= UniformDimension::MatrixFirst && dimension <= UniformDimension::MatrixLast;
+}
+
+bool ShaderUniformLayout::IsVectorSize(UniformDimension dimension, int size)
+{
+    assert(size >= 2 && size <= 4);
+    return IsVector(dimension) && static_cast<int>(dimension) == static_cast<int>(UniformDimension::VectorFirst) + size - 2;
+}
+
+bool ShaderUniformLayout::IsMatrixSize(UniformDimension dimension, int columns, int rows)
+{
+    assert(columns >= 2 && columns <= 4);
+    assert(rows >= 2 && rows <= 4);
+    int offset = (columns - 2) * 3 + (rows - 2);
+    return IsMatrix(dimension) && static_cast<int>(dimension) == static_cast<int>(UniformDimension::MatrixFirst) + offset;
+}
@@ -0,0 +1,24 @@
+#include <ituGL/shader/UniformBufferObject.h>
+
+UniformBufferObject::UniformBufferObject()
+{
+    // Nothing to do here, it is done by the base class
+}
+
+// Indexed binding also binds the generic target
+void UniformBufferObject::BindRange(GLuint binding, size_t offset, size_t size) const
+{
+    glBindBufferRange(GetTarget(), binding, GetHandle(), offset, size);
+#ifndef NDEBUG
+    s_boundHandle = GetHandle();
+#endif
+}
+
+// Indexed binding also binds the generic target
+void UniformBufferObject::BindBase(GLuint binding) const
+{
+    glBindBufferBase(GetTarget(), binding, GetHandle());
+#ifndef NDEBUG
+    s_boundHandle = GetHandle();
+#endif
+}
@@ -0,0 +1,6 @@
+#include <ituGL/texture/PixelBufferObject.h>
+
+PixelBufferObject::PixelBufferObject()
+{
+    // Nothing to do here, it is done by the base class
+}
@@ -20,3 +20,44 @@ void Texture2DObject::SetImage(GLint level, GLsizei width, GLsizei height, Forma
 {
     SetImage<float>(level, width, height, format, internalFormat, std::span<float>());
 }
+
+void Texture2DObject::SetCompressedImage(GLint level, GLsizei width, GLsizei height, InternalFormat internalFormat, std::span<const std::byte> data)
+{
+    assert(IsBound());
+    assert(GetBlockSize(internalFormat) > 0);
+    assert(data.size_bytes() == static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(internalFormat));
+    glCompressedTexImage2D(GetTarget(), level, internalFormat, width, height, 0, static_cast<GLsizei>(data.size_bytes()), data.data());
+}
+
+template <>
+void Texture2DObject::SetSubImage<std::byte>(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, Format format, std::span<const std::byte> data, Data::Type type)
+{
+    assert(IsBound());
+    assert(type != Data::Type::None);
+    assert(data.size_bytes() == width * height * GetComponentCount(format) * Data::GetTypeSize(type));
+    glTexSubImage2D(GetTarget(), level, x, y, width, height, format, static_cast<GLenum>(type), data.data());
+}
+
+void Texture2DObject::SetSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, Format format, Data::Type type, size_t bufferOffset)
+{
+    assert(IsBound());
+    assert(type != Data::Type::None);
+    // With a pixel buffer object bound, the pointer is interpreted as an offset in the buffer
+    glTexSubImage2D(GetTarget(), level, x, y, width, height, format, static_cast<GLenum>(type), reinterpret_cast<const void*>(bufferOffset));
+}
+
+template <>
+void Texture2DObject::GetImage<std::byte>(GLint level, Format format, std::span<std::byte> data, Data::Type type) const
+{
+    assert(IsBound());
+    assert(type != Data::Type::None);
+    GLint width = 0, height = 0;
+    glGetTexLevelParameteriv(GetTarget(), level, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GetTarget(), level, GL_TEXTURE_HEIGHT, &height);
+    if (data.size_bytes() < static_cast<size_t>(width) * height * GetComponentCount(format) * Data::GetTypeSize(type))
+    {
+        assert(false);
+        return;
+    }
+    glGetTexImage(GetTarget(), level, format, static_cast<GLenum>(type), data.data());
+}
@@ -0,0 +1,323 @@
+#include <ituGL/texture/TextureBlockCompressor.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+TextureObject::InternalFormat TextureBlockCompressor::GetCompressedFormat(int componentCount, bool srgb)
+{
+    switch (componentCount)
+    {
+    case 1:
+        return TextureObject::InternalFormatBC4;
+    case 2:
+        return TextureObject::InternalFormatBC5;
+    case 3:
+        return srgb ? TextureObject::InternalFormatBC1SRGB : TextureObject::InternalFormatBC1;
+    case 4:
+        return srgb ? TextureObject::InternalFormatBC3SRGB : TextureObject::InternalFormatBC3;
+    default:
+        assert(false);
+        return TextureObject::InternalFormatInvalid;
+    }
+}
+
+size_t TextureBlockCompressor::GetCompressedSize(int width, int height, TextureObject::InternalFormat internalFormat)
+{
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * TextureObject::GetBlockSize(internalFormat);
+}
+
+void TextureBlockCompressor::Compress(std::span<const std::byte> data, int width, int height, int componentCount,
+    TextureObject::InternalFormat internalFormat, std::span<std::byte> output)
+{
+    assert(data.size_bytes() == static_cast<size_t>(width) * height * componentCount);
+    assert(output.size_bytes() == GetCompressedSize(width, height, internalFormat));
+
+    const unsigned char* pixels = reinterpret_cast<const unsigned char*>(data.data());
+    std::byte* blockOutput = output.data();
+    for (int y = 0; y < height; y += 4)
+    {
+        for (int x = 0; x < width; x += 4)
+        {
+            Block block;
+            LoadBlock(pixels, width, height, componentCount, x, y, block);
+            switch (internalFormat)
+            {
+            case TextureObject::InternalFormatBC1:
+            case TextureObject::InternalFormatBC1SRGB:
+                EncodeColorBlock(block, blockOutput);
+                blockOutput += 8;
+                break;
+            case TextureObject::InternalFormatBC3:
+            case TextureObject::InternalFormatBC3SRGB:
+                // Alpha block first, then the color block
+                EncodeChannelBlock(block, 3, blockOutput);
+                EncodeColorBlock(block, blockOutput + 8);
+                blockOutput += 16;
+                break;
+            case TextureObject::InternalFormatBC4:
+                EncodeChannelBlock(block, 0, blockOutput);
+                blockOutput += 8;
+                break;
+            case TextureObject::InternalFormatBC5:
+                EncodeChannelBlock(block, 0, blockOutput);
+                EncodeChannelBlock(block, 1, blockOutput + 8);
+                blockOutput += 16;
+                break;
+            default:
+                assert(false);
+                return;
+            }
+        }
+    }
+}
+
+void TextureBlockCompressor::DecompressBC4(std::span<const std::byte> data, int width, int height, std::span<float> output)
+{
+    assert(data.size_bytes() == GetCompressedSize(width, height, TextureObject::InternalFormatBC4));
+    assert(output.size() == static_cast<size_t>(width) * height);
+
+    const std::byte* blockInput = data.data();
+    for (int y = 0; y < height; y += 4)
+    {
+        for (int x = 0; x < width; x += 4)
+        {
+            float value0 = static_cast<float>(std::to_integer<int>(blockInput[0]));
+            float value1 = static_cast<float>(std::to_integer<int>(blockInput[1]));
+
+            // 8 interpolated values if value0 > value1, otherwise 6 interpolated values plus 0 and 1
+            float palette[8] = { value0 / 255.0f, value1 / 255.0f };
+            if (value0 > value1)
+            {
+                for (int index = 1; index < 7; ++index)
+                {
+                    palette[index + 1] = ((7 - index) * value0 + index * value1) / (7.0f * 255.0f);
+                }
+            }
+            else
+            {
+                for (int index = 1; index < 5; ++index)
+                {
+                    palette[index + 1] = ((5 - index) * value0 + index * value1) / (5.0f * 255.0f);
+                }
+                palette[6] = 0.0f;
+                palette[7] = 1.0f;
+            }
+
+            uint64_t indices = 0;
+            for (int i = 0; i < 6; ++i)
+            {
+                indices |= std::to_integer<uint64_t>(blockInput[2 + i]) << (8 * i);
+            }
+
+            // Pixels outside the image are skipped, edge blocks repeat them
+            for (int i = 0; i < 16; ++i)
+            {
+                int pixelX = x + (i & 3);
+                int pixelY = y + (i >> 2);
+                if (pixelX < width && pixelY < height)
+                {
+                    output[static_cast<size_t>(pixelY) * width + pixelX] = palette[(indices >> (3 * i)) & 7];
+                }
+            }
+            blockInput += 8;
+        }
+    }
+}
+
+void TextureBlockCompressor::LoadBlock(const unsigned char* data, int width, int height, int componentCount, int x, int y, Block& block)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        int pixelX = std::min(x + (i & 3), width - 1);
+        int pixelY = std::min(y + (i >> 2), height - 1);
+        const unsigned char* pixel = data + (static_cast<size_t>(pixelY) * width + pixelX) * componentCount;
+        for (int c = 0; c < 4; ++c)
+        {
+            block[i][c] = c < componentCount ? pixel[c] : (c == 3 ? 255 : 0);
+        }
+    }
+}
+
+// Pack a color to 565, rounding each component
+static uint16_t PackColor565(const float color[3])
+{
+    int r = std::clamp(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+    int g = std::clamp(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+    int b = std::clamp(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+// Expand a 565 color to 8 bits per component, the way the decoder does it
+static void UnpackColor565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+static void WriteLittleEndian(std::byte* output, uint64_t value, int byteCount)
+{
+    for (int i = 0; i < byteCount; ++i)
+    {
+        output[i] = static_cast<std::byte>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void TextureBlockCompressor::EncodeColorBlock(const Block& block, std::byte* output)
+{
+    // Principal axis of the colors, with a few power iterations on the covariance matrix
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            mean[c] += block[i][c] / 16.0f;
+        }
+    }
+
+    float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+    {
+        float r = block[i][0] - mean[0];
+        float g = block[i][1] - mean[1];
+        float b = block[i][2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 4; ++iteration)
+    {
+        float r = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+        float g = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+        float b = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+        float length = std::max({ std::abs(r), std::abs(g), std::abs(b) });
+        if (length < 1e-6f)
+        {
+            // All the colors are the same, any axis works
+            break;
+        }
+        axis[0] = r / length;
+        axis[1] = g / length;
+        axis[2] = b / length;
+    }
+
+    // Endpoints are the colors with the extreme projections on the axis
+    int minIndex = 0, maxIndex = 0;
+    float minProjection = 0.0f, maxProjection = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float projection = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+        if (i == 0 || projection < minProjection)
+        {
+            minProjection = projection;
+            minIndex = i;
+        }
+        if (i == 0 || projection > maxProjection)
+        {
+            maxProjection = projection;
+            maxIndex = i;
+        }
+    }
+
+    float maxColor[3] = { float(block[maxIndex][0]), float(block[maxIndex][1]), float(block[maxIndex][2]) };
+    float minColor[3] = { float(block[minIndex][0]), float(block[minIndex][1]), float(block[minIndex][2]) };
+    uint16_t color0 = PackColor565(maxColor);
+    uint16_t color1 = PackColor565(minColor);
+
+    // color0 > color1 selects the mode with 4 colors and no transparency
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        UnpackColor565(color0, palette[0]);
+        UnpackColor565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestIndex = 0;
+            int bestDistance = INT32_MAX;
+            for (int index = 0; index < 4; ++index)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; ++c)
+                {
+                    int difference = block[i][c] - palette[index][c];
+                    distance += difference * difference;
+                }
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestIndex = index;
+                }
+            }
+            indices |= static_cast<uint32_t>(bestIndex) << (2 * i);
+        }
+    }
+
+    WriteLittleEndian(output, color0, 2);
+    WriteLittleEndian(output + 2, color1, 2);
+    WriteLittleEndian(output + 4, indices, 4);
+}
+
+void TextureBlockCompressor::EncodeChannelBlock(const Block& block, int channel, std::byte* output)
+{
+    int minValue = 255, maxValue = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        minValue = std::min<int>(minValue, block[i][channel]);
+        maxValue = std::max<int>(maxValue, block[i][channel]);
+    }
+
+    // value0 > value1 selects the mode with 8 interpolated values
+    uint64_t indices = 0;
+    if (maxValue != minValue)
+    {
+        int palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int index = 1; index < 7; ++index)
+        {
+            palette[index + 1] = ((7 - index) * maxValue + index * minValue) / 7;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestIndex = 0;
+            int bestDistance = INT32_MAX;
+            for (int index = 0; index < 8; ++index)
+            {
+                int distance = std::abs(block[i][channel] - palette[index]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestIndex = index;
+                }
+            }
+            indices |= static_cast<uint64_t>(bestIndex) << (3 * i);
+        }
+    }
+
+    output[0] = static_cast<std::byte>(maxValue);
+    output[1] = static_cast<std::byte>(minValue);
+    WriteLittleEndian(output + 2, indices, 6);
+}
@@ -0,0 +1,141 @@
+#include <ituGL/texture/TextureMipChain.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+TextureMipChain::TextureMipChain() : m_format(TextureObject::FormatInvalid), m_dataType(Data::Type::None), m_pixelSize(0)
+{
+}
+
+TextureMipChain::TextureMipChain(std::span<const std::byte> data, int width, int height, TextureObject::Format format, Data::Type dataType)
+    : m_format(format), m_dataType(dataType), m_pixelSize(TextureObject::GetComponentCount(format) * Data::GetTypeSize(dataType))
+{
+    assert(data.size_bytes() == static_cast<size_t>(width) * height * m_pixelSize);
+
+    // Compute the size of every level first, to allocate the buffer once
+    int levelCount = GetLevelCount(width, height);
+    m_levels.reserve(levelCount);
+    size_t offset = 0;
+    for (int level = 0; level < levelCount; ++level)
+    {
+        size_t size = static_cast<size_t>(width) * height * m_pixelSize;
+        m_levels.push_back(Level{ width, height, offset, size });
+        offset += size;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    m_data.resize(offset);
+
+    std::memcpy(m_data.data(), data.data(), data.size_bytes());
+    for (int level = 1; level < levelCount; ++level)
+    {
+        switch (m_dataType)
+        {
+        case Data::Type::UByte:
+            Downsample<unsigned char>(level);
+            break;
+        case Data::Type::Float:
+            Downsample<float>(level);
+            break;
+        default:
+            // Only the types decoded by the texture loaders are supported
+            assert(false);
+            break;
+        }
+    }
+}
+
+int TextureMipChain::GetLevelCount(int width, int height)
+{
+    int levelCount = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2)
+    {
+        ++levelCount;
+    }
+    return levelCount;
+}
+
+// Add two rows component by component. The sums of 8-bit components are kept in 16 bits
+static void AddRows(const unsigned char* row0, const unsigned char* row1, unsigned short* sum, int count)
+{
+    int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+        __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sum + i), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sum + i + 8), high);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        sum[i] = static_cast<unsigned short>(row0[i] + row1[i]);
+    }
+}
+
+static void AddRows(const float* row0, const float* row1, float* sum, int count)
+{
+    int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(row0 + i), _mm_loadu_ps(row1 + i)));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        sum[i] = row0[i] + row1[i];
+    }
+}
+
+template<typename T>
+void TextureMipChain::Downsample(int level)
+{
+    const Level& srcLevel = m_levels[level - 1];
+    const Level& dstLevel = m_levels[level];
+    const T* src = reinterpret_cast<const T*>(m_data.data() + srcLevel.offset);
+    T* dst = reinterpret_cast<T*>(m_data.data() + dstLevel.offset);
+
+    int componentCount = TextureObject::GetComponentCount(m_format);
+    int srcRowLength = srcLevel.width * componentCount;
+
+    // Each row is filtered in two passes: the two source rows are added vertically, with SIMD when available,
+    // and then pairs of pixels of the sum are added horizontally
+    using Sum = std::conditional_t<std::is_integral_v<T>, unsigned short, float>;
+    std::vector<Sum> rowSum(srcRowLength);
+    for (int y = 0; y < dstLevel.height; ++y)
+    {
+        const T* row0 = src + static_cast<size_t>(std::min(y * 2, srcLevel.height - 1)) * srcRowLength;
+        const T* row1 = src + static_cast<size_t>(std::min(y * 2 + 1, srcLevel.height - 1)) * srcRowLength;
+        AddRows(row0, row1, rowSum.data(), srcRowLength);
+
+        for (int x = 0; x < dstLevel.width; ++x)
+        {
+            int x0 = std::min(x * 2, srcLevel.width - 1) * componentCount;
+            int x1 = std::min(x * 2 + 1, srcLevel.width - 1) * componentCount;
+            for (int c = 0; c < componentCount; ++c)
+            {
+                if constexpr (std::is_integral_v<T>)
+                {
+                    // Round to nearest
+                    unsigned int sum = rowSum[x0 + c] + rowSum[x1 + c];
+                    *dst++ = static_cast<T>((sum + 2) / 4);
+                }
+                else
+                {
+                    *dst++ = (rowSum[x0 + c] + rowSum[x1 + c]) * 0.25f;
+                }
+            }
+        }
+    }
+}
@@ -119,6 +119,7 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatR16F:
     case InternalFormatR32F:
     case InternalFormatRCompressed:
+    case InternalFormatBC4:
         return format == FormatR;
     case InternalFormatRG:
     case InternalFormatRG8:
@@ -128,6 +129,7 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatRG16F:
     case InternalFormatRG32F:
     case InternalFormatRGCompressed:
+    case InternalFormatBC5:
         return format == FormatRG;
     case InternalFormatRGB:
     case InternalFormatRGB8:
@@ -140,6 +142,8 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatRGBCompressed:
     case InternalFormatSRGBCompressed:
     case InternalFormatR11G11B10:
+    case InternalFormatBC1:
+    case InternalFormatBC1SRGB:
         return format == FormatRGB || format == FormatBGR;
     case InternalFormatRGBA:
     case InternalFormatRGBA8:
@@ -152,6 +156,8 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatRGBACompressed:
     case InternalFormatSRGBACompressed:
     case InternalFormatRGB10A2:
+    case InternalFormatBC3:
+    case InternalFormatBC3SRGB:
         return format == FormatRGBA || format == FormatBGRA;
     case InternalFormatDepth:
     case InternalFormatDepth16:
@@ -204,6 +210,7 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatR16F:
     case InternalFormatR32F:
     case InternalFormatRCompressed:
+    case InternalFormatBC4:
     case InternalFormatR11G11B10:
     case InternalFormatRGB10A2:
     case InternalFormatDepth:
@@ -222,6 +229,7 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatRG16F:
     case InternalFormatRG32F:
     case InternalFormatRGCompressed:
+    case InternalFormatBC5:
         return 2;
     case InternalFormatRGB:
     case InternalFormatRGB8:
@@ -233,6 +241,8 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatSRGB8:
     case InternalFormatRGBCompressed:
     case InternalFormatSRGBCompressed:
+    case InternalFormatBC1:
+    case InternalFormatBC1SRGB:
         return 3;
     case InternalFormatRGBA:
     case InternalFormatRGBA8:
@@ -244,9 +254,29 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatSRGBA8:
     case InternalFormatRGBACompressed:
     case InternalFormatSRGBACompressed:
+    case InternalFormatBC3:
+    case InternalFormatBC3SRGB:
         return 4;
     default:
         //Unknown format
         return 0;
     }
 }
+
+int TextureObject::GetBlockSize(InternalFormat internalFormat)
+{
+    switch (internalFormat)
+    {
+    case InternalFormatBC1:
+    case InternalFormatBC1SRGB:
+    case InternalFormatBC4:
+        return 8;
+    case InternalFormatBC3:
+    case InternalFormatBC3SRGB:
+    case InternalFormatBC5:
+        return 16;
+    default:
+        // Not block compressed
+        return 0;
+    }
+}
@@ -0,0 +1,380 @@
+#include <ituGL/texture/TextureStreamer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+TextureStreamer::TextureStreamer(size_t budgetBytes, size_t uploadBytesPerFrame, int residentSize)
+    : m_uploads(UploadBufferCount)
+    , m_budgetBytes(budgetBytes)
+    , m_uploadBytesPerFrame(uploadBytesPerFrame)
+    , m_residentSize(residentSize)
+    , m_frame(0)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    for (Upload& upload : m_uploads)
+    {
+        if (upload.fence)
+        {
+            glDeleteSync(upload.fence);
+        }
+    }
+}
+
+std::shared_ptr<Texture2DObject> TextureStreamer::AddTexture(TextureMipChain&& mipChain, TextureObject::InternalFormat internalFormat, bool wrapping)
+{
+    assert(!mipChain.IsEmpty());
+
+    std::shared_ptr<Texture2DObject> texture = std::make_shared<Texture2DObject>();
+    int levelCount = mipChain.GetLevelCount();
+
+    // Smallest levels that fit in the resident size, at least the last one
+    int tailLevel = levelCount - 1;
+    while (tailLevel > 0)
+    {
+        const TextureMipChain::Level& level = mipChain.GetLevel(tailLevel - 1);
+        if (std::max(level.width, level.height) > m_residentSize)
+        {
+            break;
+        }
+        --tailLevel;
+    }
+
+    // Rows of the small levels are not aligned to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    texture->Bind();
+    for (int levelIndex = tailLevel; levelIndex < levelCount; ++levelIndex)
+    {
+        const TextureMipChain::Level& level = mipChain.GetLevel(levelIndex);
+        texture->SetImage<std::byte>(levelIndex, level.width, level.height, mipChain.GetFormat(), internalFormat,
+            mipChain.GetLevelData(levelIndex), mipChain.GetDataType());
+    }
+
+    texture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR_MIPMAP_LINEAR);
+    texture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+    if (!wrapping)
+    {
+        texture->SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+        texture->SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+    }
+
+    // Only the levels between base and max are required for the texture to be complete
+    texture->SetParameter(TextureObject::ParameterInt::MaxLevel, levelCount - 1);
+    texture->SetParameter(TextureObject::ParameterInt::BaseLevel, tailLevel);
+    Texture2DObject::Unbind();
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // Until something requests a level, stream the whole texture
+    const Texture2DObject& textureObject = *texture;
+    StreamedTexture& streamedTexture = m_textures[textureObject.GetHandle()];
+    streamedTexture.texture = texture;
+    streamedTexture.mipChain = std::move(mipChain);
+    streamedTexture.internalFormat = internalFormat;
+    streamedTexture.baseLevel = tailLevel;
+    streamedTexture.tailLevel = tailLevel;
+    streamedTexture.requestedLevel = 0;
+    streamedTexture.frameRequestedLevel = levelCount;
+    streamedTexture.uploadingLevel = -1;
+    streamedTexture.lastSeenFrame = m_frame;
+
+    return texture;
+}
+
+bool TextureStreamer::IsStreamed(const TextureObject& texture) const
+{
+    return m_textures.contains(texture.GetHandle());
+}
+
+void TextureStreamer::RequestScreenSize(const TextureObject& texture, float screenSize)
+{
+    if (StreamedTexture* streamedTexture = FindTexture(texture))
+    {
+        const TextureMipChain::Level& level = streamedTexture->mipChain.GetLevel(0);
+        RequestLevel(texture, GetRequiredLevel(std::max(level.width, level.height), screenSize));
+    }
+}
+
+void TextureStreamer::RequestLevel(const TextureObject& texture, int level)
+{
+    if (StreamedTexture* streamedTexture = FindTexture(texture))
+    {
+        level = std::clamp(level, 0, streamedTexture->mipChain.GetLevelCount() - 1);
+        streamedTexture->frameRequestedLevel = std::min(streamedTexture->frameRequestedLevel, level);
+    }
+}
+
+void TextureStreamer::Update()
+{
+    m_stats = Stats();
+
+    for (auto it = m_textures.begin(); it != m_textures.end(); )
+    {
+        StreamedTexture& streamedTexture = it->second;
+
+        // The texture object was deleted, the handle can be reused by a new one
+        if (streamedTexture.texture.expired())
+        {
+            it = m_textures.erase(it);
+            continue;
+        }
+
+        if (streamedTexture.frameRequestedLevel < streamedTexture.mipChain.GetLevelCount())
+        {
+            streamedTexture.requestedLevel = streamedTexture.frameRequestedLevel;
+            streamedTexture.frameRequestedLevel = streamedTexture.mipChain.GetLevelCount();
+            streamedTexture.lastSeenFrame = m_frame;
+        }
+        ++it;
+    }
+
+    FinishUploads();
+    DropLevels();
+    StartUploads();
+
+    m_stats.textureCount = static_cast<unsigned int>(m_textures.size());
+    for (const auto& texturePair : m_textures)
+    {
+        m_stats.residentBytes += GetResidentSize(texturePair.second);
+        m_stats.totalBytes += texturePair.second.mipChain.GetData().size_bytes();
+    }
+
+    ++m_frame;
+}
+
+int TextureStreamer::GetRequiredLevel(int textureSize, float screenSize)
+{
+    if (screenSize < 1.0f)
+    {
+        screenSize = 1.0f;
+    }
+    return std::max(static_cast<int>(std::floor(std::log2(textureSize / screenSize))), 0);
+}
+
+void TextureStreamer::FinishUploads()
+{
+    for (Upload& upload : m_uploads)
+    {
+        if (!upload.fence)
+        {
+            continue;
+        }
+
+        GLenum result = glClientWaitSync(upload.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            continue;
+        }
+        glDeleteSync(upload.fence);
+        upload.fence = nullptr;
+
+        // The texture might have been deleted while uploading
+        auto itTexture = m_textures.find(upload.textureHandle);
+        if (itTexture != m_textures.end() && itTexture->second.uploadingLevel == upload.level)
+        {
+            StreamedTexture& streamedTexture = itTexture->second;
+            if (std::shared_ptr<Texture2DObject> texture = streamedTexture.texture.lock())
+            {
+                streamedTexture.baseLevel = upload.level;
+                SetBaseLevel(*texture, upload.level);
+            }
+            streamedTexture.uploadingLevel = -1;
+        }
+        upload.level = -1;
+    }
+}
+
+void TextureStreamer::DropLevels()
+{
+    size_t residentBytes = 0;
+    std::vector<std::pair<Object::Handle, StreamedTexture*>> candidates;
+    for (auto& texturePair : m_textures)
+    {
+        StreamedTexture& streamedTexture = texturePair.second;
+        residentBytes += GetResidentSize(streamedTexture);
+        if (streamedTexture.uploadingLevel >= 0)
+        {
+            residentBytes += streamedTexture.mipChain.GetLevel(streamedTexture.uploadingLevel).size;
+        }
+        // Textures seen in this frame keep their levels
+        else if (streamedTexture.lastSeenFrame < m_frame && streamedTexture.baseLevel < streamedTexture.tailLevel)
+        {
+            candidates.push_back(std::make_pair(texturePair.first, &streamedTexture));
+        }
+    }
+
+    if (residentBytes <= m_budgetBytes)
+    {
+        return;
+    }
+
+    // Seen longest ago first
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.second->lastSeenFrame < b.second->lastSeenFrame; });
+
+    for (auto& candidate : candidates)
+    {
+        StreamedTexture& streamedTexture = *candidate.second;
+        std::shared_ptr<Texture2DObject> texture = streamedTexture.texture.lock();
+        while (residentBytes > m_budgetBytes && streamedTexture.baseLevel < streamedTexture.tailLevel)
+        {
+            int droppedLevel = streamedTexture.baseLevel;
+            residentBytes -= streamedTexture.mipChain.GetLevel(droppedLevel).size;
+            streamedTexture.baseLevel = droppedLevel + 1;
+            SetBaseLevel(*texture, streamedTexture.baseLevel);
+
+            // Levels below the base don't count for completeness, so the memory of the dropped one can be released
+            texture->Bind();
+            texture->SetImage(droppedLevel, 0, 0, streamedTexture.mipChain.GetFormat(), streamedTexture.internalFormat);
+            Texture2DObject::Unbind();
+
+            ++m_stats.droppedLevels;
+        }
+
+        // Don't stream the levels back until they are requested again
+        streamedTexture.requestedLevel = std::max(streamedTexture.requestedLevel, streamedTexture.baseLevel);
+
+        if (residentBytes <= m_budgetBytes)
+        {
+            break;
+        }
+    }
+}
+
+void TextureStreamer::StartUploads()
+{
+    size_t residentBytes = 0;
+    std::vector<std::pair<Object::Handle, StreamedTexture*>> candidates;
+    for (auto& texturePair : m_textures)
+    {
+        StreamedTexture& streamedTexture = texturePair.second;
+        residentBytes += GetResidentSize(streamedTexture);
+        if (streamedTexture.uploadingLevel >= 0)
+        {
+            residentBytes += streamedTexture.mipChain.GetLevel(streamedTexture.uploadingLevel).size;
+        }
+        else if (streamedTexture.baseLevel > streamedTexture.requestedLevel)
+        {
+            candidates.push_back(std::make_pair(texturePair.first, &streamedTexture));
+        }
+    }
+
+    // Seen most recently first, then the ones missing more levels
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b)
+        {
+            if (a.second->lastSeenFrame != b.second->lastSeenFrame)
+            {
+                return a.second->lastSeenFrame > b.second->lastSeenFrame;
+            }
+            return a.second->baseLevel - a.second->requestedLevel > b.second->baseLevel - b.second->requestedLevel;
+        });
+
+    size_t uploadedBytes = 0;
+    for (auto& candidate : candidates)
+    {
+        StreamedTexture& streamedTexture = *candidate.second;
+        int level = streamedTexture.baseLevel - 1;
+        size_t size = streamedTexture.mipChain.GetLevel(level).size;
+
+        if (residentBytes + size > m_budgetBytes)
+        {
+            continue;
+        }
+
+        // At least one level per frame, even if it is bigger than the limit
+        if (uploadedBytes > 0 && uploadedBytes + size > m_uploadBytesPerFrame)
+        {
+            break;
+        }
+
+        if (!StartUpload(candidate.first, streamedTexture, level))
+        {
+            break;
+        }
+        residentBytes += size;
+        uploadedBytes += size;
+    }
+}
+
+bool TextureStreamer::StartUpload(Object::Handle textureHandle, StreamedTexture& streamedTexture, int level)
+{
+    auto itUpload = std::find_if(m_uploads.begin(), m_uploads.end(), [](const Upload& upload) { return upload.level < 0; });
+    if (itUpload == m_uploads.end())
+    {
+        return false;
+    }
+    Upload& upload = *itUpload;
+
+    std::shared_ptr<Texture2DObject> texture = streamedTexture.texture.lock();
+    const TextureMipChain& mipChain = streamedTexture.mipChain;
+    const TextureMipChain::Level& mipLevel = mipChain.GetLevel(level);
+
+    // Allocate the level before binding the buffer, otherwise the null data would be read as an offset in the buffer
+    texture->Bind();
+    texture->SetImage(level, mipLevel.width, mipLevel.height, mipChain.GetFormat(), streamedTexture.internalFormat);
+
+    upload.buffer.Bind();
+    if (upload.bufferSize < mipLevel.size)
+    {
+        upload.bufferSize = mipLevel.size;
+        upload.buffer.AllocateData(upload.bufferSize, BufferObject::StreamDraw);
+    }
+
+    // The previous fence of this buffer already signaled, so there is no need to synchronize the mapping
+    std::span<const std::byte> data = mipChain.GetLevelData(level);
+    std::span<std::byte> mappedData = upload.buffer.MapData(0, mipLevel.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    bool mapped = !mappedData.empty();
+    if (mapped)
+    {
+        std::memcpy(mappedData.data(), data.data(), data.size_bytes());
+        mapped = upload.buffer.UnmapData();
+    }
+    if (!mapped)
+    {
+        upload.buffer.UpdateData(data);
+    }
+
+    // The copy from the buffer to the texture happens on the GPU timeline, the call returns right away
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    texture->SetSubImage(level, 0, 0, mipLevel.width, mipLevel.height, mipChain.GetFormat(), mipChain.GetDataType(), 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    PixelBufferObject::Unbind();
+    Texture2DObject::Unbind();
+
+    upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    upload.textureHandle = textureHandle;
+    upload.level = level;
+    streamedTexture.uploadingLevel = level;
+
+    ++m_stats.uploadedLevels;
+    m_stats.uploadedBytes += mipLevel.size;
+    return true;
+}
+
+void TextureStreamer::SetBaseLevel(Texture2DObject& texture, int baseLevel)
+{
+    texture.Bind();
+    texture.SetParameter(TextureObject::ParameterInt::BaseLevel, baseLevel);
+    Texture2DObject::Unbind();
+}
+
+size_t TextureStreamer::GetResidentSize(const StreamedTexture& streamedTexture)
+{
+    size_t size = 0;
+    for (int level = streamedTexture.baseLevel; level < streamedTexture.mipChain.GetLevelCount(); ++level)
+    {
+        size += streamedTexture.mipChain.GetLevel(level).size;
+    }
+    return size;
+}
+
+TextureStreamer::StreamedTexture* TextureStreamer::FindTexture(const TextureObject& texture)
+{
+    auto itTexture = m_textures.find(texture.GetHandle());
+    return itTexture != m_textures.end() ? &itTexture->second : nullptr;
+}
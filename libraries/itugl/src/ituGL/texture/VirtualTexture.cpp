@@ -0,0 +1,312 @@
+#include <ituGL/texture/VirtualTexture.h>
+
+#include <ituGL/asset/AssetLoadQueue.h>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+VirtualTexture::VirtualTexture(int pageCount, int pageSize, int border, int atlasPages, AssetLoadQueue& loadQueue, PageFunction pageFunction)
+    : m_pageCount(pageCount)
+    , m_pageSize(pageSize)
+    , m_border(border)
+    , m_atlasPages(atlasPages)
+    , m_levelCount(std::bit_width(static_cast<unsigned int>(pageCount)))
+    , m_loadQueue(loadQueue)
+    , m_pageFunction(std::make_shared<const PageFunction>(pageFunction))
+    , m_completedPages(std::make_shared<std::vector<int>>())
+    , m_loadsPerFrame(8)
+    , m_maxLoading(32)
+    , m_frame(0)
+{
+    // The feedback and the page table store the coordinates in 8 bits
+    assert(pageCount > 0 && pageCount <= 256 && std::has_single_bit(static_cast<unsigned int>(pageCount)));
+    assert(atlasPages > 1 && atlasPages <= 256);
+    assert(pageSize > 0 && border >= 0);
+    assert(*m_pageFunction);
+
+    int pageTotal = 0;
+    for (int level = 0; level < m_levelCount; ++level)
+    {
+        m_levelOffsets.push_back(pageTotal);
+        pageTotal += GetLevelPageCount(level) * GetLevelPageCount(level);
+    }
+    m_pages.resize(pageTotal);
+    m_pageTableData.resize(pageTotal, 0);
+    m_slots.resize(static_cast<size_t>(m_atlasPages) * m_atlasPages, -1);
+
+    // Atlas without mipmaps, each slot has the level it needs
+    m_atlas = std::make_shared<Texture2DObject>();
+    m_atlas->Bind();
+    m_atlas->SetImage(0, GetAtlasSize(), GetAtlasSize(), TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA8);
+    m_atlas->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR);
+    m_atlas->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+    m_atlas->SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+    m_atlas->SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+    m_atlas->SetParameter(TextureObject::ParameterInt::MaxLevel, 0);
+
+    // One mip level of the page table per level of the virtual texture, read without filtering
+    m_pageTable = std::make_shared<Texture2DObject>();
+    m_pageTable->Bind();
+    for (int level = 0; level < m_levelCount; ++level)
+    {
+        m_pageTable->SetImage(level, GetLevelPageCount(level), GetLevelPageCount(level), TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA8);
+    }
+    m_pageTable->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_NEAREST_MIPMAP_NEAREST);
+    m_pageTable->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_NEAREST);
+    m_pageTable->SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+    m_pageTable->SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+    m_pageTable->SetParameter(TextureObject::ParameterInt::MaxLevel, m_levelCount - 1);
+
+    // The last page is the fallback of all the others, fill it now
+    int rootIndex = GetPageIndex(m_levelCount - 1, 0, 0);
+    std::vector<uint32_t> texels(static_cast<size_t>(GetSlotSize()) * GetSlotSize());
+    (*m_pageFunction)(GetPageRequest(rootIndex), texels);
+    m_atlas->Bind();
+    m_atlas->SetSubImage<std::byte>(0, 0, 0, GetSlotSize(), GetSlotSize(), TextureObject::FormatRGBA, std::as_bytes(std::span(texels)), Data::Type::UByte);
+    Texture2DObject::Unbind();
+
+    m_pages[rootIndex].state = PageState::Resident;
+    m_pages[rootIndex].slot = 0;
+    m_slots[0] = rootIndex;
+    m_stats.residentPages = 1;
+
+    UpdatePageTable(m_levelCount - 1);
+}
+
+void VirtualTexture::AddFeedback(std::span<const uint32_t> feedback)
+{
+    // Neighbour texels usually want the same page
+    uint32_t previousTexel = 0;
+    int previousIndex = -1;
+    for (uint32_t texel : feedback)
+    {
+        if ((texel >> 24) == 0)
+        {
+            continue;
+        }
+
+        if (texel != previousTexel)
+        {
+            int level = std::min(static_cast<int>((texel >> 16) & 0xFF), m_levelCount - 1);
+            int maxPage = GetLevelPageCount(level) - 1;
+            previousIndex = GetPageIndex(level, std::min(static_cast<int>(texel & 0xFF), maxPage), std::min(static_cast<int>((texel >> 8) & 0xFF), maxPage));
+            previousTexel = texel;
+        }
+
+        Page& page = m_pages[previousIndex];
+        if (page.requestFrame != m_frame)
+        {
+            page.requestFrame = m_frame;
+            page.requestCount = 0;
+            m_requestedPages.push_back(previousIndex);
+        }
+        ++page.requestCount;
+    }
+}
+
+void VirtualTexture::Update()
+{
+    // Pages uploaded since the last update can be sampled now
+    int dirtyLevel = -1;
+    for (int pageIndex : *m_completedPages)
+    {
+        int level, pageX, pageY;
+        GetPageCoordinates(pageIndex, level, pageX, pageY);
+        m_pages[pageIndex].state = PageState::Resident;
+        dirtyLevel = std::max(dirtyLevel, level);
+        --m_stats.loadingPages;
+        ++m_stats.residentPages;
+        ++m_stats.loadedPages;
+    }
+    m_completedPages->clear();
+
+    // Keep the requested pages and their ancestors, that are drawn while the pages load. The missing ones are candidates,
+    // with the requests of all their descendants
+    m_candidates.clear();
+    for (int requestedIndex : m_requestedPages)
+    {
+        int level, pageX, pageY;
+        GetPageCoordinates(requestedIndex, level, pageX, pageY);
+        uint32_t requestCount = m_pages[requestedIndex].requestCount;
+        for (; level < m_levelCount; ++level, pageX >>= 1, pageY >>= 1)
+        {
+            int pageIndex = GetPageIndex(level, pageX, pageY);
+            Page& page = m_pages[pageIndex];
+            if (page.state == PageState::Resident)
+            {
+                page.lastUsedFrame = m_frame;
+            }
+            else if (page.state == PageState::Missing)
+            {
+                if (page.candidateFrame != m_frame)
+                {
+                    page.candidateFrame = m_frame;
+                    m_candidates.push_back(pageIndex);
+                }
+                if (pageIndex != requestedIndex)
+                {
+                    if (page.requestFrame != m_frame)
+                    {
+                        page.requestFrame = m_frame;
+                        page.requestCount = 0;
+                    }
+                    page.requestCount += requestCount;
+                }
+            }
+        }
+    }
+
+    // Coarse pages first, they improve more pixels and are the fallback of the finer ones
+    std::sort(m_candidates.begin(), m_candidates.end(), [this](int a, int b)
+        {
+            int levelA, levelB, pageX, pageY;
+            GetPageCoordinates(a, levelA, pageX, pageY);
+            GetPageCoordinates(b, levelB, pageX, pageY);
+            return levelA != levelB ? levelA > levelB : m_pages[a].requestCount > m_pages[b].requestCount;
+        });
+
+    unsigned int startedLoads = 0;
+    for (int pageIndex : m_candidates)
+    {
+        if (startedLoads >= m_loadsPerFrame || m_stats.loadingPages >= m_maxLoading)
+        {
+            break;
+        }
+
+        int slot = FindSlot();
+        if (slot < 0)
+        {
+            // Every slot is in use by this frame
+            break;
+        }
+
+        int evictedIndex = m_slots[slot];
+        if (evictedIndex >= 0)
+        {
+            int level, pageX, pageY;
+            GetPageCoordinates(evictedIndex, level, pageX, pageY);
+            m_pages[evictedIndex].state = PageState::Missing;
+            m_pages[evictedIndex].slot = -1;
+            dirtyLevel = std::max(dirtyLevel, level);
+            --m_stats.residentPages;
+            ++m_stats.evictedPages;
+        }
+
+        LoadPage(pageIndex, slot);
+        ++startedLoads;
+    }
+
+    if (dirtyLevel >= 0)
+    {
+        UpdatePageTable(dirtyLevel);
+    }
+
+    m_stats.requestedPages = static_cast<unsigned int>(m_requestedPages.size());
+    m_requestedPages.clear();
+    ++m_frame;
+}
+
+void VirtualTexture::GetPageCoordinates(int pageIndex, int& level, int& pageX, int& pageY) const
+{
+    level = static_cast<int>(std::upper_bound(m_levelOffsets.begin(), m_levelOffsets.end(), pageIndex) - m_levelOffsets.begin()) - 1;
+    int levelIndex = pageIndex - m_levelOffsets[level];
+    pageX = levelIndex % GetLevelPageCount(level);
+    pageY = levelIndex / GetLevelPageCount(level);
+}
+
+VirtualTexture::PageRequest VirtualTexture::GetPageRequest(int pageIndex) const
+{
+    PageRequest request;
+    GetPageCoordinates(pageIndex, request.level, request.pageX, request.pageY);
+    request.size = GetSlotSize();
+    request.texelSize = 1.0f / (GetSize() >> request.level);
+    request.uvMin = (glm::vec2(request.pageX, request.pageY) * static_cast<float>(m_pageSize) - static_cast<float>(m_border)) * request.texelSize;
+    return request;
+}
+
+int VirtualTexture::FindSlot()
+{
+    int rootIndex = GetPageIndex(m_levelCount - 1, 0, 0);
+    int oldestSlot = -1;
+    uint32_t oldestFrame = m_frame;
+    for (int slot = 0; slot < static_cast<int>(m_slots.size()); ++slot)
+    {
+        int pageIndex = m_slots[slot];
+        if (pageIndex < 0)
+        {
+            return slot;
+        }
+
+        const Page& page = m_pages[pageIndex];
+        if (pageIndex != rootIndex && page.state == PageState::Resident && page.lastUsedFrame < oldestFrame)
+        {
+            oldestSlot = slot;
+            oldestFrame = page.lastUsedFrame;
+        }
+    }
+    return oldestSlot;
+}
+
+void VirtualTexture::LoadPage(int pageIndex, int slot)
+{
+    Page& page = m_pages[pageIndex];
+    page.state = PageState::Loading;
+    page.slot = slot;
+    page.lastUsedFrame = m_frame;
+    m_slots[slot] = pageIndex;
+    ++m_stats.loadingPages;
+
+    // The tasks don't use the virtual texture, so it can be destroyed while they run
+    PageRequest request = GetPageRequest(pageIndex);
+    int x = (slot % m_atlasPages) * GetSlotSize();
+    int y = (slot / m_atlasPages) * GetSlotSize();
+    m_loadQueue.SubmitWork([=, pageFunction = m_pageFunction, atlas = m_atlas, completedPages = m_completedPages, &loadQueue = m_loadQueue]()
+        {
+            std::shared_ptr<std::vector<uint32_t>> texels = std::make_shared<std::vector<uint32_t>>(static_cast<size_t>(request.size) * request.size);
+            (*pageFunction)(request, *texels);
+            loadQueue.SubmitUpload([=]()
+                {
+                    atlas->Bind();
+                    atlas->SetSubImage<std::byte>(0, x, y, request.size, request.size, TextureObject::FormatRGBA,
+                        std::as_bytes(std::span(*texels)), Data::Type::UByte);
+                    Texture2DObject::Unbind();
+                },
+                [=]()
+                {
+                    completedPages->push_back(pageIndex);
+                });
+        });
+}
+
+void VirtualTexture::UpdatePageTable(int fromLevel)
+{
+    m_pageTable->Bind();
+    for (int level = fromLevel; level >= 0; --level)
+    {
+        int levelPageCount = GetLevelPageCount(level);
+        for (int pageY = 0; pageY < levelPageCount; ++pageY)
+        {
+            for (int pageX = 0; pageX < levelPageCount; ++pageX)
+            {
+                int pageIndex = GetPageIndex(level, pageX, pageY);
+                const Page& page = m_pages[pageIndex];
+                uint32_t& entry = m_pageTableData[pageIndex];
+                if (page.state == PageState::Resident)
+                {
+                    entry = static_cast<uint32_t>(page.slot % m_atlasPages) | (static_cast<uint32_t>(page.slot / m_atlasPages) << 8)
+                        | (static_cast<uint32_t>(level) << 16) | 0xFF000000u;
+                }
+                else
+                {
+                    // The root page is always resident, so there is always a parent
+                    entry = m_pageTableData[GetPageIndex(level + 1, pageX >> 1, pageY >> 1)];
+                }
+            }
+        }
+
+        std::span<const uint32_t> levelData = std::span(m_pageTableData).subspan(m_levelOffsets[level], static_cast<size_t>(levelPageCount) * levelPageCount);
+        m_pageTable->SetSubImage<std::byte>(level, 0, 0, levelPageCount, levelPageCount, TextureObject::FormatRGBA,
+            std::as_bytes(levelData), Data::Type::UByte);
+    }
+    Texture2DObject::Unbind();
+}